@@ -14,10 +14,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
 
 /* 파일명의 "00000000"은 자신의 학번으로 변경할 것 */
 #include "my_assembler_20211448.h"
 
+/** 프로세스 전체에서 공유하는 INCLUDE 파일 캐시 */
+static include_cache shared_include_cache = {PTHREAD_MUTEX_INITIALIZER, NULL};
+/** 프로세스 전체에서 공유하는 식별자 이름 풀 (0번은 NAME_NONE) */
+static name_pool shared_name_pool = {PTHREAD_RWLOCK_INITIALIZER, {NULL}, 1, NULL, 0};
+/** INCLUDE 캐시와 이름 풀을 사용하는 어셈블러 컨텍스트 수와 그 잠금 */
+static pthread_mutex_t shared_users_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shared_users = 0;
+/** 감시 모드를 끝내라는 신호를 받았는지 여부 */
+static volatile sig_atomic_t watch_stopped = 0;
+/** 벤치마크 단계의 이름 (BENCH_* 순서, 기준 파일과 보고서에 사용) */
+static const char *bench_phase_names[BENCH_PHASES] = {
+	"inst_table", "input", "pass1", "pass2", "output"
+};
+
 /**
  * @brief 사용자로부터 SIC/XE 소스코드를 받아서 object code를 출력한다.
  *
@@ -26,1554 +53,9972 @@
  * 없는 한 변경하지 말 것.
  */
 int main(int argc, char **argv) {
-	/** SIC/XE 머신의 instruction 정보를 저장하는 테이블 */
-	inst *inst_table[MAX_INST_TABLE_LENGTH];
-	int inst_table_length;
-
-	/** SIC/XE 소스코드를 저장하는 테이블 */
-	char *input[MAX_INPUT_LINES];
-	int input_length;
-
-	/** 소스코드의 각 라인을 토큰 전환하여 저장하는 테이블 */
-	token *tokens[MAX_INPUT_LINES];
-	int tokens_length;
-
-	/** 소스코드 내의 심볼을 저장하는 테이블 */
-	symbol *symbol_table[MAX_TABLE_LENGTH];
-	int symbol_table_length;
-
-	/** 소스코드 내의 리터럴을 저장하는 테이블 */
-	literal *literal_table[MAX_TABLE_LENGTH];
-	int literal_table_length;
-
-	/** 오브젝트 코드를 저장하는 변수 */
-	object_code *obj_code = (object_code*)calloc(1, sizeof(object_code));
-	if(obj_code==NULL){
+	/** 기계어 목록부터 출력 버퍼까지 어셈블에 필요한 모든 상태 */
+	assembler_ctx *ctx = assembler_create();
+	if(ctx==NULL){
 		return -2;
 	}
-
+	
+	/** SIC/XE 소스코드 파일의 내용 */
+	char *source = NULL;
+	size_t source_length = 0;
+	
+	/** 출력 파일별 출력 작업 */
+	output_job jobs[ASSEMBLER_OUTPUT_NUM] = {
+		{"output_symtab.txt", &ctx->outputs[ASSEMBLER_OUTPUT_SYMTAB], 0},
+		{"output_littab.txt", &ctx->outputs[ASSEMBLER_OUTPUT_LITTAB], 0},
+		{"output_objectcode.txt", &ctx->outputs[ASSEMBLER_OUTPUT_OBJECTCODE], 0},
+		{"output_listing.txt", &ctx->outputs[ASSEMBLER_OUTPUT_LISTING], 0},
+	};
+	
+	/** "--stat" 옵션이 주어지면 통계를 stdout으로 출력 */
+	/** "--threads" 옵션이 주어지면 출력 파일들을 동시에 작성 */
+	/** "--stdout" 옵션이 주어지면 파일 대신 태그를 붙여 stdout으로 출력 */
+	/** "--stream" 옵션이 주어지면 소스코드를 메모리에 모두 올리지 않고 어셈블 */
+	/** "--snapshot" 옵션이 주어지면 pass 1의 결과를 스냅샷 파일로 저장 */
+	/** "--from-snapshot" 옵션이 주어지면 소스코드 대신 스냅샷 파일에서 시작 */
+	/** "--disasm [파일]" 옵션이 주어지면 어셈블하지 않고 오브젝트 코드를 역어셈블 */
+	/** "--listing" 옵션이 주어지면 pass 2에서 리스팅 파일도 작성 */
+	/** "--diag-json" 옵션이 주어지면 소스코드의 오류를 JSON으로 stderr에 출력 */
+	/** "--watch" 옵션이 주어지면 종료할 때까지 소스코드가 바뀔 때마다 다시 어셈블 */
+	/** "--optimize [규칙,...]" 옵션이 주어지면 pass 1 뒤에 peephole 최적화를 적용 */
+	/** "--xref" 옵션이 주어지면 상호 참조 파일도 작성 */
+	/** "--xref-query 질의 [이름] [파일]" 옵션이 주어지면 어셈블하지 않고 상호 참조 파일을 검색 */
+	/** "--bench save|compare [기준 파일]" 옵션이 주어지면 단계별 실행 시간을 반복해서 재어
+	 *  기준 파일로 저장하거나 기준과 비교 ("--bench-runs 횟수", "--bench-threshold 감소율%") */
+	int stat_flag = 0, thread_flag = 0, stdout_flag = 0, stream_flag = 0;
+	int snapshot_flag = 0, from_snapshot_flag = 0, disasm_flag = 0;
+	int listing_flag = 0, diag_json_flag = 0, watch_flag = 0, xref_flag = 0;
+	const char *disasm_dir = "output_objectcode.txt";
+	const char *optimize_rules = NULL;
+	const char *xref_query_str = NULL, *xref_name = NULL;
+	const char *xref_dir = "output_xref.txt";
+	const char *bench_mode = NULL, *bench_dir = "bench_baseline.txt";
+	int bench_runs = BENCH_RUNS;
+	double bench_threshold = BENCH_THRESHOLD;
+	for(int i=1;i<argc;i++){
+		if(!strcmp(argv[i], "--stat")){
+			stat_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--threads")){
+			thread_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--stdout")){
+			stdout_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--stream")){
+			stream_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--snapshot")){
+			snapshot_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--from-snapshot")){
+			from_snapshot_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--listing")){
+			listing_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--diag-json")){
+			diag_json_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--watch")){
+			watch_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--optimize")){
+			optimize_rules = "all";
+			// 다음 인자가 옵션이 아니면 적용할 규칙 목록
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				optimize_rules = argv[++i];
+			}
+		}
+		else if(!strcmp(argv[i], "--xref")){
+			xref_flag = 1;
+		}
+		else if(!strcmp(argv[i], "--xref-query")){
+			// 질의, "unused"가 아니면 이름, 옵션이 아니면 상호 참조 파일 경로
+			xref_query_str = i+1 < argc ? argv[++i] : "";
+			if(strcmp(xref_query_str, "unused") && i+1 < argc){
+				xref_name = argv[++i];
+			}
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				xref_dir = argv[++i];
+			}
+		}
+		else if(!strcmp(argv[i], "--bench")){
+			// "save" 또는 "compare", 옵션이 아니면 기준 파일 경로
+			bench_mode = i+1 < argc ? argv[++i] : "";
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				bench_dir = argv[++i];
+			}
+		}
+		else if(!strcmp(argv[i], "--bench-runs")){
+			bench_runs = i+1 < argc ? atoi(argv[++i]) : 0;
+		}
+		else if(!strcmp(argv[i], "--bench-threshold")){
+			bench_threshold = i+1 < argc ? atof(argv[++i]) : 0;
+		}
+		else if(!strcmp(argv[i], "--disasm")){
+			disasm_flag = 1;
+			// 다음 인자가 옵션이 아니면 역어셈블할 파일 경로
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				disasm_dir = argv[++i];
+			}
+		}
+	}
+	
 	int err = 0;
+	
+	// 스트리밍 모드는 토큰 테이블을 메모리에 남기지 않음
+	if (stream_flag && (snapshot_flag || from_snapshot_flag || listing_flag)) {
+		fprintf(stderr, "--stream은 스냅샷, 리스팅 옵션과 함께 사용할 수 없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	if (disasm_flag && (stream_flag || snapshot_flag || from_snapshot_flag ||
+						listing_flag || optimize_rules != NULL || xref_flag)) {
+		fprintf(stderr, "--disasm은 어셈블 옵션과 함께 사용할 수 없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	// 최적화는 메모리에 있는 토큰 테이블 전체를 고침
+	if (optimize_rules != NULL && (stream_flag || from_snapshot_flag)) {
+		fprintf(stderr, "--optimize는 --stream, --from-snapshot과 함께 사용할 수 "
+						"없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	if (optimize_rules != NULL &&
+		peephole_parse_rules(optimize_rules, &ctx->optimize) < 0) {
+		fprintf(stderr, "--optimize: 알 수 없는 규칙이 있습니다. "
+						"(clear, load, jump, compare, all)\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	// 상호 참조는 메모리에 있는 토큰 테이블 전체와 EQU의 수식에서 만듦
+	// (스냅샷에서 시작하면 EQU의 수식을 다시 컴파일하지 않음)
+	if (xref_flag && (stream_flag || from_snapshot_flag || watch_flag)) {
+		fprintf(stderr, "--xref는 --stream, --from-snapshot, --watch와 함께 사용할 수 "
+						"없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	
+	// 질의 모드는 기계어 목록 없이 상호 참조 파일만 읽어 stdout으로 출력
+	if (xref_query_str != NULL) {
+		output_buffer out = {0};
+		
+		if ((err = output_buffer_init(&out, 4096)) < 0 ||
+			(err = xref_query_file(xref_dir, xref_query_str, xref_name, &out)) < 0 ||
+			(err = output_buffer_write(&out, NULL)) < 0) {
+			fprintf(stderr,
+					"xref_query: 상호 참조 검색에 실패했습니다. "
+					"(defs 이름, uses 이름, unused) (error_code: %d)\n",
+					err);
+		}
+		output_buffer_free(&out);
+		assembler_destroy(ctx);
+		return err < 0 ? -1 : 0;
+	}
+	
+	// 벤치마크는 메모리에 있는 소스코드를 처음부터 끝까지 반복해서 어셈블
+	if (bench_mode != NULL &&
+		((strcmp(bench_mode, "save") && strcmp(bench_mode, "compare")) ||
+		 bench_runs < 3 || bench_threshold <= 0)) {
+		fprintf(stderr, "--bench: save 또는 compare여야 하며, --bench-runs는 3 이상, "
+						"--bench-threshold는 0보다 커야 합니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	if (bench_mode != NULL && (stream_flag || snapshot_flag || from_snapshot_flag ||
+							   disasm_flag || watch_flag || stdout_flag)) {
+		fprintf(stderr, "--bench는 스트리밍, 스냅샷, 역어셈블, 감시, --stdout 옵션과 함께 "
+						"사용할 수 없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+	
+	if (watch_flag && (stream_flag || snapshot_flag || from_snapshot_flag ||
+					   disasm_flag || stdout_flag)) {
+		fprintf(stderr, "--watch는 스트리밍, 스냅샷, 역어셈블, --stdout 옵션과 함께 "
+						"사용할 수 없습니다.\n");
+		assembler_destroy(ctx);
+		return -1;
+	}
+
+	ctx->listing = listing_flag;
+	ctx->xref = xref_flag;
 
-	if ((err = init_inst_table(inst_table, &inst_table_length,
-							   "inst_table.txt")) < 0) {
+	if ((err = assembler_load_inst_table(ctx, "inst_table.txt")) < 0) {
 		fprintf(stderr,
 				"init_inst_table: 기계어 목록 초기화에 실패했습니다. "
 				"(error_code: %d)\n",
 				err);
+		assembler_destroy(ctx);
 		return -1;
 	}
 
-	if ((err = init_input(input, &input_length, "input.txt")) < 0) {
+	// 역어셈블 모드는 오브젝트 코드 파일만 읽어 output_disasm.txt로 출력
+	if (disasm_flag) {
+		output_buffer out = {0};
+		output_job job = {"output_disasm.txt", &out, 0};
+		
+		if ((err = read_file(disasm_dir, &source, &source_length)) < 0 ||
+			(err = assembler_disassemble(ctx, source, source_length, &out)) < 0 ||
+			(err = stdout_flag ? write_tagged_output(&job, 1)
+							   : write_output_files(&job, 1, 0)) < 0) {
+			fprintf(stderr,
+					"disassemble: 역어셈블 과정에서 실패했습니다. (error_code: %d)\n",
+					err);
+		}
+		free(source);
+		output_buffer_free(&out);
+		assembler_destroy(ctx);
+		return err < 0 ? -1 : 0;
+	}
+
+	// 벤치마크 모드는 결과를 기준 파일로 저장하거나 기준과 비교하여 stdout으로 출력
+	if (bench_mode != NULL) {
+		bench_result base, now;
+		output_buffer out = {0};
+		int compare = !strcmp(bench_mode, "compare");
+		
+		if (compare && (err = bench_load(bench_dir, &base)) < 0) {
+			fprintf(stderr,
+					"bench_load: 기준 파일 %s을(를) 읽을 수 없거나 형식(버전 %d)이 맞지 "
+					"않습니다. (error_code: %d)\n",
+					bench_dir, BENCH_VERSION, err);
+			assembler_destroy(ctx);
+			return -1;
+		}
+		if ((err = run_bench(ctx, "inst_table.txt", "input.txt", jobs,
+							 listing_flag ? ASSEMBLER_OUTPUT_NUM : ASSEMBLER_OUTPUT_LISTING,
+							 bench_runs, &now)) < 0) {
+			if (ctx->diags.length > 0 || ctx->diags.dropped > 0) {
+				report_diagnostics(ctx, "input.txt", diag_json_flag);
+			}
+			fprintf(stderr, "%s: 벤치마크 과정에서 실패했습니다. (error_code: %d)\n",
+					ctx->error_stage, err);
+			assembler_destroy(ctx);
+			return -1;
+		}
+		
+		if (!compare) {
+			if ((err = bench_save(bench_dir, &now)) < 0) {
+				fprintf(stderr, "bench_save: 기준 파일 저장에 실패했습니다. "
+								"(error_code: %d)\n",
+						err);
+			}
+			else {
+				printf("bench: %d회 실행 결과를 %s에 저장했습니다.\n", bench_runs,
+					   bench_dir);
+			}
+		}
+		else if ((err = output_buffer_init(&out, 1024)) >= 0) {
+			err = bench_compare(&base, &now, bench_threshold, &out);
+			if (output_buffer_write(&out, NULL) < 0 && err >= 0) {
+				err = -1;
+			}
+			if (err < 0) {
+				fprintf(stderr, "bench_compare: 기준과 비교할 수 없습니다. "
+								"(error_code: %d)\n",
+						err);
+			}
+		}
+		output_buffer_free(&out);
+		assembler_destroy(ctx);
+		// 회귀한 단계가 있으면 1
+		return err < 0 ? -1 : err > 0;
+	}
+	
+	// 감시 모드는 신호를 받아 끝날 때까지 바뀐 출력 파일만 다시 씀
+	if (watch_flag) {
+		err = watch_input(ctx, "input.txt", jobs,
+						  listing_flag ? ASSEMBLER_OUTPUT_NUM : ASSEMBLER_OUTPUT_LISTING,
+						  thread_flag, stat_flag, diag_json_flag);
+		if (err < 0) {
+			fprintf(stderr,
+					"watch_input: 파일 감시에 실패했습니다. (error_code: %d)\n",
+					err);
+		}
+		assembler_destroy(ctx);
+		return err < 0 ? -1 : 0;
+	}
+
+	// 스트리밍 모드는 오브젝트 코드를 어셈블하면서 파일에 바로 씀
+	if (stream_flag) {
+		err = assembler_assemble_stream(ctx, "input.txt",
+										"output_objectcode.txt");
+	}
+	else if (from_snapshot_flag) {
+		err = assembler_assemble_snapshot(ctx, "output_pass1.bin");
+	}
+	else if ((err = read_file("input.txt", &source, &source_length)) < 0) {
 		fprintf(stderr,
 				"init_input: 소스코드 입력에 실패했습니다. (error_code: %d)\n",
 				err);
+		assembler_destroy(ctx);
 		return -1;
 	}
-
-	if ((err = assem_pass1((const inst **)inst_table, inst_table_length,
-						   (const char **)input, input_length, tokens,
-						   &tokens_length, symbol_table, &symbol_table_length,
-						   literal_table, &literal_table_length)) < 0) {
-		fprintf(stderr,
-				"assem_pass1: 패스1 과정에서 실패했습니다. (error_code: %d)\n",
-				err);
+	else {
+		err = assembler_assemble(ctx, source, source_length);
+		free(source);
+	}
+	
+	// 소스코드의 오류는 모두 위치와 함께 출력 (JSON은 오류가 없어도 출력)
+	if (ctx->diags.length > 0 || ctx->diags.dropped > 0 || diag_json_flag) {
+		report_diagnostics(ctx, from_snapshot_flag ? "output_pass1.bin" : "input.txt",
+						   diag_json_flag);
+	}
+	if (err < 0) {
+		if (ctx->diags.length == 0) {
+			fprintf(stderr,
+					"%s: 어셈블 과정에서 실패했습니다. (error_code: %d)\n",
+					ctx->error_stage, err);
+		}
+		assembler_destroy(ctx);
 		return -1;
 	}
-
-	if ((err = make_symbol_table_output("output_symtab.txt",
-										(const symbol **)symbol_table,
-										symbol_table_length)) < 0) {
+	
+	if (snapshot_flag && (err = assembler_save_snapshot(ctx, "output_pass1.bin")) < 0) {
 		fprintf(stderr,
-				"make_symbol_table_output: 심볼테이블 파일 출력 과정에서 "
-				"실패했습니다. (error_code: %d)\n",
-				err);
+				"%s: 스냅샷 저장 과정에서 실패했습니다. (error_code: %d)\n",
+				ctx->error_stage, err);
+		assembler_destroy(ctx);
 		return -1;
 	}
-
-	if ((err = make_literal_table_output("output_littab.txt",
-										 (const literal **)literal_table,
-										 literal_table_length)) < 0) {
+	
+	// 작성한 출력을 파일마다 한 번의 write로 출력
+	// (스트리밍 모드의 오브젝트 코드는 이미 파일에 있음)
+	int jobs_length = stream_flag ? ASSEMBLER_OUTPUT_OBJECTCODE
+				   : listing_flag ? ASSEMBLER_OUTPUT_NUM : ASSEMBLER_OUTPUT_LISTING;
+	if (stdout_flag) {
+		err = write_tagged_output(jobs, jobs_length);
+	}
+	else {
+		err = write_output_files(jobs, jobs_length, thread_flag);
+	}
+	if (err < 0) {
 		fprintf(stderr,
-				"make_literal_table_output: 리터럴테이블 파일 출력 과정에서 "
-				"실패했습니다. (error_code: %d)\n",
+				"write_output_files: 파일 출력 과정에서 실패했습니다. "
+				"(error_code: %d)\n",
 				err);
+		assembler_destroy(ctx);
 		return -1;
 	}
-
-	if ((err = assem_pass2((const token **)tokens, tokens_length,
-						   (const inst **)inst_table, inst_table_length,
-						   (const symbol **)symbol_table, symbol_table_length,
-						   (const literal **)literal_table,
-						   literal_table_length, obj_code)) < 0) {
+	
+	if (xref_flag) {
+		output_buffer out = {0};
+		output_job job = {"output_xref.txt", &out, 0};
+		
+		if ((err = render_xref(&out, &ctx->xrefs, "input.txt")) < 0 ||
+			(err = stdout_flag ? write_tagged_output(&job, 1)
+							   : write_output_files(&job, 1, 0)) < 0) {
+			fprintf(stderr,
+					"render_xref: 상호 참조 출력 과정에서 실패했습니다. "
+					"(error_code: %d)\n",
+					err);
+			output_buffer_free(&out);
+			assembler_destroy(ctx);
+			return -1;
+		}
+		output_buffer_free(&out);
+	}
+	
+	if (stat_flag && (err = make_stat_output(NULL, &ctx->stat)) < 0) {
 		fprintf(stderr,
-				"assem_pass2: 패스2 과정에서 실패했습니다. (error_code: %d)\n",
+				"make_stat_output: 통계 출력 과정에서 실패했습니다. "
+				"(error_code: %d)\n",
 				err);
+		assembler_destroy(ctx);
 		return -1;
 	}
-
-	if ((err = make_objectcode_output("output_objectcode.txt",
-									  (const object_code *)obj_code)) < 0) {
+	
+	if (ctx->optimize && (err = make_peephole_output(NULL, &ctx->peephole)) < 0) {
 		fprintf(stderr,
-				"make_objectcode_output: 오브젝트코드 파일 출력 과정에서 "
-				"실패했습니다. (error_code: %d)\n",
+				"make_peephole_output: 최적화 결과 출력 과정에서 실패했습니다. "
+				"(error_code: %d)\n",
 				err);
+		assembler_destroy(ctx);
 		return -1;
 	}
 
+	assembler_destroy(ctx);
 	return 0;
 }
 
 /**
- * @brief 기계어 목록 파일(inst_table.txt)을 읽어 기계어 목록
- * 테이블(inst_table)을 생성한다.
+ * @brief 어셈블러 컨텍스트를 생성한다.
  *
- * @param inst_table 기계어 목록 테이블의 시작 주소
- * @param inst_table_length 기계어 목록 테이블의 길이를 저장하는 변수 주소
+ * @return 생성한 컨텍스트 주소 (할당에 실패한 경우 NULL)
+ *
+ * @details
+ * 어셈블에 필요한 모든 상태는 컨텍스트 안에 있으므로, 스레드마다 자신의
+ * 컨텍스트를 사용하면 여러 스레드에서 동시에 어셈블할 수 있다. 공유하는 INCLUDE
+ * 캐시와 이름 풀은 살아 있는 컨텍스트 수를 세어 마지막 컨텍스트를 해제할 때 비운다.
+ */
+assembler_ctx *assembler_create(void) {
+	// 포인터 테이블과 길이가 모두 0인 상태로 시작
+	assembler_ctx *ctx = (assembler_ctx*)calloc(1, sizeof(assembler_ctx));
+	if(ctx==NULL)return NULL;
+	
+	pthread_mutex_lock(&shared_users_lock);
+	shared_users++;
+	pthread_mutex_unlock(&shared_users_lock);
+	return ctx;
+}
+
+/**
+ * @brief 기계어 목록 파일을 읽어 컨텍스트에 저장한다.
+ *
+ * @param ctx 어셈블러 컨텍스트 주소
  * @param inst_table_dir 기계어 목록 파일 경로
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 기계어 목록 파일(inst_table.txt)을 읽어 기계어 목록 테이블(inst_table)을
- * 생성한다. 기계어 목록 파일 형식은 자유롭게 구현한다. 예시는 다음과 같다.
- *    ==============================================================
- *           | 이름 | 형식 | 기계어 코드 | 오퍼랜드의 갯수 | \n |
- *    ==============================================================
+ * 기계어 목록은 assembler_reset으로 지워지지 않으므로 한 번만 읽어 여러 번
+ * 어셈블할 수 있다. 이미 읽은 목록이 있다면 해제하고 새로 읽는다. 역어셈블에
+ * 사용하는 디코드 테이블도 함께 만든다. 걸린 시간은
+ * `ctx->phase_seconds[BENCH_INST_TABLE]`에 남는다.
  */
-int init_inst_table(inst *inst_table[], int *inst_table_length,
-					const char *inst_table_dir) {
-	FILE *fp;
-	// 읽기 권한으로 파일입출력을 시작함
-	fp = fopen(inst_table_dir, "r");
-	int err = 0;
+int assembler_load_inst_table(assembler_ctx *ctx, const char *inst_table_dir) {
+	double start = monotonic_seconds();
+	int err;
 	
-	// 파일입출력이 정상적이지 않았을 때 error
-	if(fp==NULL){
-		return err = -1;
+	for(int i=0;i<ctx->inst_table_length;i++){
+		free(ctx->inst_table[i]);
 	}
+	ctx->inst_table_length = 0;
 	
-	// 아무 입력도 받지 않은 상태에서 0으로 초기화
-	*inst_table_length = 0;
-	
-	// inst 구조체를 이용해 input 변수 생성
-	inst input;
-	
-	while(!feof(fp)){
-		// 파일에서 데이터를 가져옴
-		memset(&input, 0, sizeof(input));
-		fscanf(fp, "%9s\t%d\t%hhx\t%d\n", input.str, &input.format, &input.op, &input.ops);
-		
-		// 현재 입력받은 instruction의 수가 최대 instruction의 수보다 많을 때 error
-		if(*inst_table_length > MAX_INST_TABLE_LENGTH){
-			return err = -10001;
-		}
-		
-		// 입력받은 format이 3개 이상일 때 error
-		if(input.format>99){
-			return err = -10002;
-		}
-		// 입력받은 format이 2개일 때
-		if(input.format>9){
-			// 같은 타입이면 error
-			if(input.format/10 == input.format%10){
-				return err = -10003;
-			}
-			// 첫번째 형식이 1~4형식이 아니라면 error
-			if(input.format/10 > 4 || input.format/10 < 1){
-				return err = -10004;
-			}
-			// 두번째 형식이 1~4형식이 아니라면 error
-			if(input.format%10 > 4 || input.format%10 < 1){
-				return err = -10005;
-			}
-		}
-		else {
-			if(input.format > 4 || input.format < 1){
-				return err = -10006;
-			}
-		}
-		// 입력받은 opcode가 4의 배수가 아닐 때 error
-		if(input.op % 4 != 0){
-			return err = -10007;
-		}
-		
-		// 입력받은 operand의 수가 음수일 때 또는 operand 수가 최대 operand 수를 넘어갈 때 error
-		if(input.ops < 0 || MAX_OPERAND_PER_INST < input.ops){
-			return err = -10008;
-		}
-		
-		// instruction table에 입력받은 값을 저장하기 위해 동적할당
-		inst_table[*inst_table_length] = (inst*)calloc(1, sizeof(inst));
-		
-		// 동적할당에 실패했을 때 error
-		if(inst_table[*inst_table_length] == NULL){
-			return err = -2;
-		}
-		
-		// 할당한 공간에 입력받은 데이터를 복사함
-		memcpy(inst_table[*inst_table_length], &input, sizeof(inst));
-		// inst_table_length의 값을 1 증가 함
-		*inst_table_length += 1;
-		
+	if((err = init_inst_table(ctx->inst_table, &ctx->inst_table_length,
+							  inst_table_dir)) < 0){
+		ctx->error_stage = "init_inst_table";
 	}
-	// 파일 입출력을 종료함
-	fclose(fp);
-
-	// 정상종료 시 0을 반환함
+	init_decode_table(ctx->decode_table, (const inst **)ctx->inst_table,
+					  ctx->inst_table_length);
+	ctx->phase_seconds[BENCH_INST_TABLE] = monotonic_seconds() - start;
 	return err;
 }
 
 /**
- * @brief SIC/XE 소스코드 파일(input.txt)을 읽어 소스코드 테이블(input)을
- * 생성한다.
+ * @brief 메모리에 있는 소스코드를 어셈블하여 결과를 컨텍스트의 출력 버퍼에
+ * 작성한다.
  *
- * @param input 소스코드 테이블의 시작 주소
- * @param input_length 소스코드 테이블의 길이를 저장하는 변수 주소
- * @param input_dir 소스코드 파일 경로
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param source 소스코드 버퍼 ('\0'으로 끝날 필요 없음)
+ * @param source_length 소스코드 버퍼의 바이트 수
  * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 이전 어셈블 결과는 먼저 assembler_reset으로 해제한다. 성공하면
+ * `ctx->outputs`에 심볼 테이블, 리터럴 테이블, 오브젝트 코드가, `ctx->stat`에
+ * 통계가 남는다. 실패한 경우 `ctx->error_stage`에 실패한 단계의 이름이 남는다.
+ * 소스코드의 오류는 첫 오류에서 멈추지 않고 한 단계 안에서 모두 `ctx->diags`에
+ * 기록한 뒤 실패한다. pass 1에 오류가 있으면 pass 2는 수행하지 않는다.
+ * `ctx->optimize`가 0이 아니면 pass 1 뒤에 peephole 최적화를 적용하고 결과를
+ * `ctx->peephole`에 남긴다. 소스코드 라인 테이블, pass 1, pass 2에 걸린 시간은
+ * `ctx->phase_seconds`에 남는다.
  */
-int init_input(char *input[], int *input_length, const char *input_dir) {
-	FILE *fp;
-	// 읽기용 변수
-	char buf[100];
-	memset(buf, 0, sizeof(buf));
-	int len;
-	// 읽기 권한으로 파일입출력을 시작함
-	fp = fopen(input_dir, "r");
-	int err = 0;
+int assembler_assemble(assembler_ctx *ctx, const char *source,
+					   size_t source_length) {
+	double start;
+	int err;
 	
-	// 파일입출력에 실패하면 error
-	if(fp == NULL){
-		return err = -1;
-	}
+	assembler_reset(ctx);
 	
+	if(ctx->inst_table_length == 0){
+		ctx->error_stage = "assembler_load_inst_table";
+		return -1;
+	}
 	
-	// fgets를 통해 한 줄 씩 읽고 개행포함 최대 100개 파일에 읽을 것이 없거나 에러가 발생하면 중단 함
-	while(fgets(buf, 100, fp) != NULL){
-		
-		// 입력받은 데이터가 최대 line을 넘어가면 error
-		if(MAX_TABLE_LENGTH < *input_length){
-			return err = -1;
-		}
-		
-		// 입력값의 마지막값을 '\0'으로 변경
-		len = strlen(buf);
-		if(buf[len-1]=='\n'){
-			buf[len-1] = 0;
-		}
-		
-		// 크기에 맞게 동적할당
-		input[*input_length] = (char*)calloc(1, len);
-		
-		// 동적할당에 실패하면 error
-		if(input[*input_length]==NULL){
-			return err = -1;
-		}
-		
-		// buf값을 input값에 저장
-		strncpy(input[*input_length], buf, strlen(buf));
-		
-		// input_length 값을 1 증가
-		*input_length += 1;
-		memset(buf, 0, sizeof(buf));
+	start = monotonic_seconds();
+	if((err = init_input_buffer(&ctx->input, &ctx->input_length, source,
+								source_length, &ctx->diags)) < 0){
+		ctx->error_stage = "init_input";
+		return err;
 	}
+	ctx->phase_seconds[BENCH_INPUT] = monotonic_seconds() - start;
+	
+	start = monotonic_seconds();
 
-	// 파일 입출력을 종료
-	fclose(fp);
+	if((err = assem_pass1((const inst **)ctx->inst_table, ctx->inst_table_length,
+						  (const char **)ctx->input, ctx->input_length,
+						  &ctx->tokens, ctx->symbol_table,
+						  &ctx->symbol_table_length, ctx->literal_table,
+						  &ctx->literal_table_length, &ctx->diags)) < 0 ||
+	   ctx->diags.length > 0){
+		ctx->error_stage = "assem_pass1";
+		return err < 0 ? err : -1;
+	}
 	
-	// 오류가 없다면 0을 반환
+	if(ctx->optimize &&
+	   ((err = peephole_optimize((const inst **)ctx->inst_table,
+								 ctx->inst_table_length, ctx->optimize,
+								 &ctx->tokens, ctx->symbol_table,
+								 &ctx->symbol_table_length, ctx->literal_table,
+								 &ctx->literal_table_length, &ctx->peephole,
+								 &ctx->diags)) < 0 || ctx->diags.length > 0)){
+		ctx->error_stage = "peephole_optimize";
+		return err < 0 ? err : -1;
+	}
+	ctx->stat.token_lines = ctx->tokens.length;
+	ctx->stat.token_bytes = token_store_bytes(&ctx->tokens);
+	ctx->phase_seconds[BENCH_PASS1] = monotonic_seconds() - start;
+	
+	start = monotonic_seconds();
+	err = assembler_assemble_pass2(ctx);
+	ctx->phase_seconds[BENCH_PASS2] = monotonic_seconds() - start;
 	return err;
 }
 
 /**
- * @brief 어셈블리 코드을 위한 패스 1 과정을 수행한다.
+ * @brief 스냅샷 파일에서 pass 1의 결과를 읽어 pass 2부터 어셈블한다.
  *
- * @param inst_table 기계어 목록 테이블의 주소
- * @param inst_table_length 기계어 목록 테이블의 길이
- * @param input 소스코드 테이블의 주소
- * @param input_length 소스코드 테이블의 길이
- * @param tokens 토큰 테이블의 시작 주소
- * @param tokens_length 토큰 테이블의 길이를 저장하는 변수 주소
- * @param symbol_table 심볼 테이블의 시작 주소
- * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
- * @param literal_table 리터럴 테이블의 시작 주소
- * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param snapshot_dir assembler_save_snapshot으로 쓴 스냅샷 파일 경로
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 어셈블리 코드를 위한 패스1 과정을 수행하는 함수이다. 패스 1에서는 프로그램
- * 소스를 스캔하여 해당하는 토큰 단위로 분리하여 프로그램 라인별 토큰 테이블을
- * 생성한다. 토큰 테이블은 token_parsing 함수를 호출하여 설정하여야 한다. 또한,
- * assem_pass2 과정에서 사용하기 위한 심볼 테이블 및 리터럴 테이블을 생성한다.
+ * 소스코드를 다시 토큰으로 나누지 않는다는 점을 빼면 assembler_assemble과 같은
+ * 결과를 `ctx`에 남긴다.
  */
-int assem_pass1(const inst *inst_table[], int inst_table_length,
-				const char *input[], int input_length, token *tokens[],
-				int *tokens_length, symbol *symbol_table[],
-				int *symbol_table_length, literal *literal_table[],
-				int *literal_table_length) {
-	// 길이를 0으로 초기화
-	*tokens_length = 0;
-	*symbol_table_length = 0;
-	*literal_table_length = 0;
+int assembler_assemble_snapshot(assembler_ctx *ctx, const char *snapshot_dir) {
+	expr_scope scope;
+	int err;
 	
-	// Pass 1 과정에서 필요한 임시변수들을 선언
-	inst tmp_inst;
-	token tmp_token;
-	symbol tmp_symbol;
-	literal tmp_literal;
-	char tmp[10];
-	char tmp_base[10];
-	int inst_index = 0;
-	
-	// opcode의 format을 저장하는 변수
-	int format1=0, format2=0;
-	
-	// Location Counter를 정의
-	int location_counter = 0;
+	assembler_reset(ctx);
 	
-	for(int i=0;i<input_length;i++){
-		tokens[*tokens_length] = (token*)calloc(1, sizeof(token));
-		if(tokens[*tokens_length]==NULL)return -2;
-		if(token_parsing(input[i], tokens[(*tokens_length)++], inst_table, inst_table_length)<0){
-			return -1;
-		}
-		
-		
+	if(ctx->inst_table_length == 0){
+		ctx->error_stage = "assembler_load_inst_table";
+		return -1;
 	}
 	
-	for(int i=0;i<*tokens_length;i++){
-		// Pass 1과정을 진행하기 위한 정보들을 수집
-		memset(&tmp_token, 0, sizeof(tmp_token));
-		tmp_token = *tokens[i];
-		if(tmp_token.operator!=NULL){
-			inst_index = search_opcode(tmp_token.operator, inst_table, inst_table_length);
-			if(inst_index!=-1){
-				memset(&tmp_inst, 0, sizeof(tmp_inst));
-				tmp_inst = *inst_table[inst_index];
-			}
-		}
-			
-		
-		// 라인 주석인 경우 Pass 1과정에서 필요없으니 건너뜀
-		if(tmp_token.label==NULL && tmp_token.operator==NULL){
-			continue;
-		}
-		
-		// Location Counter를 START의 operand[0]로 지정
-		if(!strcmp(tmp_token.operator, "START")){
-			location_counter = atoi(tmp_token.operand[0]);
-			memset(tmp_base, 0, sizeof(tmp_base));
-			strncpy(tmp_base, tmp_token.label, strlen(tmp_token.label));
-		}
-		// CSECT를 만났을 경우
-		if(!strcmp(tmp_token.operator, "CSECT")){
-			memset(tmp_base, 0, sizeof(tmp_base));
-			strncpy(tmp_base, tmp_token.label, strlen(tmp_token.label));
-			location_counter = 0;
-		}
-		
-		// Label이 존재하는 경우 SYMTAB에 저장
-		if(tmp_token.label!=NULL){
-			memset(&tmp_symbol, 0, sizeof(tmp_symbol));
-			strncpy(tmp_symbol.name, tmp_token.label, strlen(tmp_token.label));
-			if(!strcmp(tmp_token.operator, "EQU")){
-				tmp_symbol.addr = -1;
-			}
-			else tmp_symbol.addr = location_counter;
-			strncpy(tmp_symbol.base, tmp_base, strlen(tmp_base));
-			symbol_table[*symbol_table_length] = (symbol*)calloc(1, sizeof(symbol));
-			if(symbol_table[*symbol_table_length]==NULL)return -2;
-			memcpy(symbol_table[(*symbol_table_length)++], &tmp_symbol, sizeof(tmp_symbol));
-		}
-		
-		// Location Counter를 증가시키는 로직
-		// 1~4형식을 사용하는 instruction인 경우
-		if(tmp_token.operator!=NULL && inst_index != -1){
-			// format1과 2를 가져온다.
-			// 1, 2형식인 경우 format1 = 0, format2는 1 또는 2이다.
-			// 3, 4형식인 경우 format1 = 3, format2는 4이다.
-			format1 = tmp_inst.format/10;
-			format2 = tmp_inst.format%10;
-			
-			if(format2==1)location_counter += 1;
-			else if(format2==2)location_counter += 2;
-			// 4형식을 지원하는 명령어가 실제로 4형식인지 확인
-			else if(format2==4 && *tmp_token.operator == '+'){
-				location_counter += 4;
-				// nixbpe 중 e 비트를 1로 채움
-				tmp_token.nixbpe |= 49;
-			}
-			else if(format1==3){
-				location_counter += 3;
-				// ni 비틀를 1로 채움 immediate는 나중에 고려
-				tmp_token.nixbpe |= 48;
-				// pc 비트를 1로 채움
-				tmp_token.nixbpe |= 2;
-			}
-		}
-		// operator과 "WORD", "RESW", "RESB", "BYTE" 인 경우
-		else if(!strcmp(tmp_token.operator, "WORD")){
-			location_counter += 3;
-		}
-		else if(!strcmp(tmp_token.operator, "RESW")){
-			location_counter += 3 * atoi(tmp_token.operand[0]);
-		}
-		else if(!strcmp(tmp_token.operator, "RESB")){
-			location_counter += atoi(tmp_token.operand[0]);
-		}
-		else if(!strcmp(tmp_token.operator, "BYTE")){
-			// 'X' 또는 'C'와 따옴표 2개의 길이를 뺀 실제 operand의 길이
-			if(*(tmp_token.operand[0])=='X'){
-				location_counter += (strlen(tmp_token.operand[0]) - 3)/2;
-			}
-			else {
-				location_counter += strlen(tmp_token.operand[0]) - 3;
-			}
-		}
-		// EQU인 경우
-		else if(!strcmp(tmp_token.operator, "EQU")){
-			if(*tmp_token.operand[0] == '*'){
-				symbol_table[*symbol_table_length - 1]->addr = location_counter;
-			}
-			// 사칙연산을 사용하는 EQU
-			else {
-				int opcode_index=0;
-				for(int k=0;k<strlen(tmp_token.operand[0]);k++){
-					if(tmp_token.operand[0][k]=='+' ||
-					   tmp_token.operand[0][k]=='-' ||
-					   tmp_token.operand[0][k]=='/' ||
-					   tmp_token.operand[0][k]=='*'){
-						opcode_index=k;
-						break;
-					}
-				}
-				int tmp_addr = 0;
-				// 왼쪽 심볼
-				memset(tmp, 0, sizeof(tmp));
-				strncpy(tmp, tmp_token.operand[0], opcode_index);
-				for(int k=0;k<*symbol_table_length-1;k++){
-					if(!strcmp(symbol_table[k]->name,tmp)){
-						tmp_addr += symbol_table[k]->addr;
-					}
-				}
-				// 오른쪽 심볼
-				int flag = 0;
-				memset(tmp, 0, sizeof(tmp));
-				strncpy(tmp, tmp_token.operand[0] + opcode_index + 1,
-						strlen(tmp_token.operand[0]) - (opcode_index + 1));
-				for(int k=0;k<*symbol_table_length-1;k++){
-					if(!strcmp(symbol_table[k]->name,tmp)){
-						switch(tmp_token.operand[0][opcode_index]){
-							case('+') : tmp_addr += symbol_table[k]->addr;break;
-							case('-'): tmp_addr -= symbol_table[k]->addr;break;
-							case('/') : tmp_addr /= symbol_table[k]->addr;break;
-							case('*') : tmp_addr *= symbol_table[k]->addr;break;
-							default: return -1;
-						}
-						flag = 1;
-					}
-				}
-				// 오른쪽이 심볼이 아닌경우
-				if(!flag){
-					switch(tmp_token.operand[0][opcode_index]){
-						case('+') : tmp_addr += atoi(tmp);break;
-						case('-'): tmp_addr -= atoi(tmp);break;
-						case('/') : tmp_addr /= atoi(tmp);break;
-						case('*') : tmp_addr *= atoi(tmp);break;
-						default: return -1;
-					}
-				}
-				// 구한 값을 넣어줌
-				tmp_symbol.addr=tmp_addr;
-				strncpy(tmp_symbol.base, tmp_symbol.name, strlen(tmp_symbol.name));
-				memcpy(symbol_table[*symbol_table_length - 1], &tmp_symbol, sizeof(tmp_symbol));
-			}
-		}
-		
-		
-		
-		// LTORG를 만나거나 END를 만났을 경우
-		if(!strcmp(tmp_token.operator, "LTORG") || !strcmp(tmp_token.operator, "END")){
-			for(int k=0;k<*literal_table_length;k++){
-				// 할당되어 있지 않은 리터럴들을 할당
-				if(literal_table[k]->addr==-1){
-					literal_table[k]->addr= location_counter;
-					location_counter += literal_table[k]->size;
-				}
-			}
-		}
-		
-		// operand가 '='로 시작하여 Literal을 의미하는 경우
-		if(tmp_token.operand[0]==NULL)continue;
-		if(*tmp_token.operand[0]=='='){
-			memset(&tmp_literal, 0, sizeof(tmp_literal));
-			// 이미 리터럴이 있는지 확인
-			int flag = 0;
-			for(int k=0;k<*literal_table_length;k++){
-				if(!strcmp(literal_table[k]->literal, tmp_token.operand[0]))
-				   flag = 1;
-			}
-			if(!flag){
-				strncpy(tmp_literal.literal, tmp_token.operand[0], strlen(tmp_token.operand[0]));
-				strncpy(tmp_literal.base, tmp_base, strlen(tmp_base));
-				tmp_literal.addr = -1;
-				tmp_literal.size = strlen(tmp_literal.literal) - 4;
-				literal_table[*literal_table_length] = (literal*)calloc(1, sizeof(literal));
-				if(literal_table[*literal_table_length]==NULL){
-					return -2;
-				}
-				memcpy(literal_table[(*literal_table_length)++], &tmp_literal, sizeof(tmp_literal));
-			}
-		}
-		
-		// nixbpe를 설정
-		for(int k=0;k<MAX_OPERAND_PER_INST && tmp_token.operand[k]!=NULL;k++){
-			// base 사용하는지 확인
-			if(!strcmp(tmp_token.operand[k], "base")){
-				tmp_token.nixbpe &= 48;
-				tmp_token.nixbpe |= 4;
-			}
-			// X 레지스터를 사용하는지 확인
-			if(!strcmp(tmp_token.operand[k], "X")){
-				tmp_token.nixbpe |= 8;
-			}
-			// immediate인지 확인
-			if(*tmp_token.operand[k] == '#'){
-				tmp_token.nixbpe &= 16;
-			}
-			if(*tmp_token.operand[k] == '@'){
-				tmp_token.nixbpe &= 32;
-				tmp_token.nixbpe |= 2;
-			}
-		}
-		
-		// 갱신한 nixbpe값을 저장
-		memcpy(tokens[i], &tmp_token, sizeof(tmp_token));
+	if((err = load_pass1_snapshot(snapshot_dir, (const inst **)ctx->inst_table,
+								  ctx->inst_table_length, &ctx->tokens,
+								  ctx->symbol_table, &ctx->symbol_table_length,
+								  ctx->literal_table, &ctx->literal_table_length,
+								  &ctx->diags)) < 0){
+		ctx->error_stage = "load_pass1_snapshot";
+		return err;
 	}
 	
+	// EQU 값은 심볼 테이블에 있으므로 pass 2가 사용할 수식만 다시 컴파일
+	memset(&scope, 0, sizeof(scope));
+	err = compile_expressions((const inst **)ctx->inst_table, &ctx->tokens,
+							  &scope, (const symbol **)ctx->symbol_table,
+							  ctx->symbol_table_length, NULL, &ctx->diags);
+	extref_set_free(&scope.refs);
+	if(err < 0 || ctx->diags.length > 0){
+		ctx->error_stage = "load_pass1_snapshot";
+		return err < 0 ? err : -1;
+	}
+	ctx->stat.token_lines = ctx->tokens.length;
+	ctx->stat.token_bytes = token_store_bytes(&ctx->tokens);
 	
-	return 0;
+	return assembler_assemble_pass2(ctx);
 }
 
 /**
- * @brief 한 줄의 소스코드를 파싱하여 토큰에 저장한다.
+ * @brief pass 1을 마친 컨텍스트에서 테이블을 출력하고 pass 2를 수행한다.
  *
- * @param input 파싱할 소스코드 문자열
- * @param tok 결과를 저장할 토큰 구조체 주소
- * @param inst_table 기계어 목록 테이블의 주소
- * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param ctx pass 1의 결과가 있는 어셈블러 컨텍스트 주소
  * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * `ctx->listing`이 0이 아니면 pass 2에서 리스팅도 함께 작성한다. `ctx->xref`가
+ * 0이 아니면 먼저 `ctx->xrefs`에 상호 참조 색인을 만든다.
  */
-int token_parsing(const char *input, token *tok, const inst *inst_table[],
-				  int inst_table_length) {
-	// 주석, Label, operator 등을 입력 받을 임시 문자열 생성
-	char tmp[100];
-	// 문자열의 끝을 저장
-	char *end = input + strlen(input);
-	// operand를 파싱하는 과정에서 사용될 변수들을 선언
-	char *operand;
-	unsigned int operand_length, operands;
+int assembler_assemble_pass2(assembler_ctx *ctx) {
+	output_buffer *listing = NULL;
+	int err;
 	
-	// token 매개변수를 초기화
-	tok->label = NULL;
-	tok->operator = NULL;
-	tok->nixbpe = 0;
-	tok->operand[0] = tok->operand[1] = tok->operand[2] = NULL;
-	tok->comment = NULL;
+	if(ctx->xref &&
+	   (err = xref_build(&ctx->xrefs, &ctx->tokens,
+						 (const symbol **)ctx->symbol_table,
+						 ctx->symbol_table_length,
+						 (const literal **)ctx->literal_table,
+						 ctx->literal_table_length)) < 0){
+		ctx->error_stage = "xref_build";
+		return err;
+	}
 	
-	// 문자열을 다 읽었는지 확인 하는 과정, 매 케이스마다 계속 등장함
-	if(input >= end) return 0;
-	// 해당 라인이 주석이라면 입력을 받고 리턴
-	if(*input=='.'){
-		sscanf(input+1, "%99[^\n]", tmp);
-		tok->comment = calloc(1, strlen(tmp));
-		if(tok->comment==NULL)return -2;
-		strncpy(tok->comment, tmp, strlen(tmp));
-		// 주석라인은 주석만 존재하므로 다 읽고 리턴함
-		return 0;
+	if((err = render_symbol_table(&ctx->outputs[ASSEMBLER_OUTPUT_SYMTAB],
+								  (const symbol **)ctx->symbol_table,
+								  ctx->symbol_table_length)) < 0){
+		ctx->error_stage = "render_symbol_table";
+		return err;
 	}
 	
-	if(input >= end) return 0;
-	// 현재 input위치에 '\t'가 아니라면 Label이 존재하므로 Label일 때 읽음
-	if(*input!='\t'){
-		// 문자열을 읽고 읽은만큼 포인터를 이동함
-		sscanf(input, "%s", tmp);
-		input += strlen(tmp);
-		tok->label = calloc(1, strlen(tmp));
-		if(tok->label==NULL)return -2;
-		strncpy(tok->label, tmp, strlen(tmp));
+	if((err = render_literal_table(&ctx->outputs[ASSEMBLER_OUTPUT_LITTAB],
+								   (const literal **)ctx->literal_table,
+								   ctx->literal_table_length)) < 0){
+		ctx->error_stage = "render_literal_table";
+		return err;
 	}
-	// '\t'를 건너뜀
-	input += 1;
 	
-	if(input >= end) return 0;
-	// 현재 input위치에 '\t'가 아니라면 operator이 존재하므로 operator일 때 읽음
-	if(*input!='\t'){
-		// 문자열을 읽고 읽은만큼 포인터를 이동함
-		sscanf(input, "%s", tmp);
-		input += strlen(tmp);
-		tok->operator = calloc(1, strlen(tmp));
-		if(tok->operator==NULL)return -2;
-		strncpy(tok->operator, tmp, strlen(tmp));
+	ctx->obj_code = (object_code*)calloc(1, sizeof(object_code));
+	if(ctx->obj_code == NULL){
+		ctx->error_stage = "assem_pass2";
+		return -2;
 	}
-	// '\t'를 건너뜀
-	input += 1;
 	
-	if(input >= end) return 0;
-	// 현재 input위치에 '\t'가 아니라면 operand이 존재하므로 operand일 때 읽음
-	if(*input!='\t'){
-		// 문자열을 읽고 읽은만큼 포인터를 이동함
-		sscanf(input, "%s", tmp);
-		input += strlen(tmp);
-		// operand_length는 0으로 operand는 tmp의 시작주소로 지정
-		operand_length = operands = 0;
-		operand = tmp;
-		// operand의 포인터를 이동시킬 것이기 때문에 반복문 종료조건을 다음과 같이 설정
-		while(input >= operand){
-			// 최대 오퍼랜드 개수를 넘어가면 에러를 반환
-			// 이미 3개를 입력받은 상황에서 반복문을 더 수행하는 것은 이상함으로 에러를 반환
-			if(operands>=MAX_OPERAND_PER_INST){
-				return -1;
-			}
-			
-			if(operand[operand_length]==','){
-				tok->operand[operands] = calloc(1, operand_length);
-				if(tok->operand[operands]==NULL)return -2;
-				strncpy(tok->operand[operands++], operand, operand_length);
-				// ','로 구분되어 있다면 다음 오퍼랜드가 있다는 것을 의미해서 operand 주소를 다음 오퍼랜드 시작주소로 넘김
-				operand += operand_length + 1;
-				continue;
-			}
-			
-			if(operand[operand_length]=='\0'){
-				tok->operand[operands] = calloc(1, operand_length);
-				if(tok->operand[operands]==NULL)return -2;
-				strncpy(tok->operand[operands++], operand, operand_length);
-				// 문자열의 끝을 만났다는 것은 마지막 오퍼랜드라는 것을 의미하기 때문에 반복물을 종료함
-				break;
-			}
-			// 계속 증가함
-			operand_length++;
+	// 리스팅은 라인마다 한 줄이므로 라인 수에 비례하여 미리 할당
+	if(ctx->listing){
+		listing = &ctx->outputs[ASSEMBLER_OUTPUT_LISTING];
+		if(output_buffer_init(listing, ctx->tokens.length * 64 + 64) < 0){
+			ctx->error_stage = "assem_pass2";
+			return -2;
 		}
-		
 	}
-	// '\t'를 건너뜀
-	input += 1;
-	if(input >= end) return 0;
-	// 지금까지 남은 문자가 있다면 그것은 모두 주석으로 간주
-	sscanf(input, "%99[^\n]", tmp);
-	tok->comment = calloc(1, strlen(tmp));
-	if(tok->comment==NULL)return -2;
-	strncpy(tok->comment, tmp, strlen(tmp));
-	// 항상 마지막은 주석이므로 주석을 만났기 때문에 0을 반환 함
+	
+	if((err = assem_pass2(&ctx->tokens, (const inst **)ctx->inst_table, ctx->inst_table_length,
+						  (const symbol **)ctx->symbol_table,
+						  ctx->symbol_table_length,
+						  (const literal **)ctx->literal_table,
+						  ctx->literal_table_length, ctx->obj_code,
+						  &ctx->stat, listing, &ctx->diags, ctx->sections)) < 0 ||
+	   ctx->diags.length > 0){
+		ctx->error_stage = "assem_pass2";
+		return err < 0 ? err : -1;
+	}
+	
+	if((err = render_objectcode(&ctx->outputs[ASSEMBLER_OUTPUT_OBJECTCODE],
+								(const object_code *)ctx->obj_code)) < 0){
+		ctx->error_stage = "render_objectcode";
+		return err;
+	}
+	
 	return 0;
 }
 
 /**
- * @brief 기계어 목록 테이블에서 특정 기계어를 검색하여, 해당 기계에가 위치한
- * 인덱스를 반환한다.
+ * @brief 컨텍스트에 있는 pass 1의 결과를 스냅샷 파일로 쓴다.
  *
- * @param str 검색할 기계어 문자열
- * @param inst_table 기계어 목록 테이블 주소
- * @param inst_table_length 기계어 목록 테이블의 길이
- * @return 기계어의 인덱스 (해당 기계어가 없는 경우 -1)
- *
- * @details
- * 기계어 목록 테이블에서 특정 기계어를 검색하여, 해당 기계에가 위치한 인덱스를
- * 반환한다. '+JSUB'와 같은 문자열에 대한 처리는 자유롭게 처리한다.
+ * @param ctx assembler_assemble 또는 assembler_assemble_snapshot을 마친 컨텍스트
+ * 주소
+ * @param snapshot_dir 스냅샷 파일 경로
+ * @return 오류 코드 (정상 종료 = 0)
  */
-int search_opcode(const char *str, const inst *inst_table[],
-				  int inst_table_length) {
-	// str이 4형식일 때
-	if(*str=='+')str += 1;
-	// 최대 instruction 수는 256개 이고 최대 라인수는 5000이기 떄문에 선형탐색을 채택
-	// 256 * 5000 연산은 0.1초 미만의 시간이 걸림
+int assembler_save_snapshot(assembler_ctx *ctx, const char *snapshot_dir) {
+	int err;
 	
-	for(int i=0;i<inst_table_length;i++){
-		// strcmp는 두 문자열이 같으면 0을 반환
-		if(!strcmp(str, inst_table[i]->str)){
-			// 같은 문자열이라면 op코드를 반환
-			return i;
-		}
+	if((err = make_pass1_snapshot(snapshot_dir, &ctx->tokens,
+								  ctx->inst_table_length,
+								  (const symbol **)ctx->symbol_table,
+								  ctx->symbol_table_length,
+								  (const literal **)ctx->literal_table,
+								  ctx->literal_table_length)) < 0){
+		ctx->error_stage = "make_pass1_snapshot";
 	}
-
-	return -1;
+	return err;
 }
 
 /**
- * @brief 어셈블리 코드을 위한 패스 2 과정을 수행한다.
+ * @brief 소스코드 파일을 스트리밍 모드로 어셈블하여 오브젝트 코드를 파일에 바로
+ * 쓴다.
  *
- * @param tokens 토큰 테이블 주소
- * @param tokens_length 토큰 테이블 길이
- * @param inst_table 기계어 목록 테이블 주소
- * @param inst_table_length 기계어 목록 테이블 길이
- * @param symbol_table 심볼 테이블 주소
- * @param symbol_table_length 심볼 테이블 길이
- * @param literal_table 리터럴 테이블 주소
- * @param literal_table_length 리터럴 테이블 길이
- * @param obj_code 오브젝트 코드에 대한 정보를 저장하는 구조체 주소
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param input_dir 소스코드 파일 경로
+ * @param objectcode_dir 오브젝트 코드를 쓸 파일 경로
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 어셈블리 코드를 기계어 코드로 바꾸기 위한 패스2 과정을 수행한다. 패스 2의
- * 프로그램을 기계어로 바꾸는 작업은 라인 단위로 수행된다.
+ * 소스코드와 토큰 테이블, 오브젝트 코드 전체를 메모리에 두지 않고 pass 1의
+ * 결과를 임시 파일로 넘기므로, 메모리 사용량은 심볼 테이블과 리터럴 테이블,
+ * 그리고 STREAM_WINDOW_LINES 라인의 토큰으로 제한된다. 성공하면 `ctx->outputs`
+ * 에는 심볼 테이블과 리터럴 테이블만 남는다. 명령어의 operand는 pass 2에서
+ * 컴파일하므로 정의되지 않은 심볼은 pass 1에 오류가 없을 때만 `ctx->diags`에
+ * 기록된다.
  */
-int assem_pass2(const token *tokens[], int tokens_length,
-				const inst *inst_table[], int inst_table_length,
-				const symbol *symbol_table[], int symbol_table_length,
-				const literal *literal_table[], int literal_table_length,
-				object_code *obj_code) {
+int assembler_assemble_stream(assembler_ctx *ctx, const char *input_dir,
+							  const char *objectcode_dir) {
+	FILE *input = NULL, *spill = NULL, *out = NULL;
+	int err = 0;
 	
-	modification_record *mod_red = (modification_record*)calloc(1, sizeof(modification_record));
-	if(mod_red==NULL)return -2;
-	modification_record *now_red = mod_red;
+	assembler_reset(ctx);
 	
-	// Pass 2 과정에서 필요한 임시변수들을 선언
-	inst tmp_inst;
-	token tmp_token;
-	char pro_name[10];
-	int pro_start = 0;
-	char tmp_hex[10];
-	char tmp_base[10];
-	char tmp_ref[MAX_OPERAND_PER_INST][10];
-	int ref_cnt = 0;
-	int inst_index = 0;
-	int ltorg_flag = 0;
+	if(ctx->inst_table_length == 0){
+		ctx->error_stage = "assembler_load_inst_table";
+		return -1;
+	}
 	
-	// 왼쪽과 오른쪽 문자열의 길이를 저장하는 변수
-	int left_str=0, right_str=0;
-	// Location Counter를 정의
-	int location_counter = 0;
-	int total = 0;
-	int pos = 0;
+	if((input = fopen(input_dir, "r"))==NULL){
+		ctx->error_stage = "init_input";
+		return -1;
+	}
+	if((spill = tmpfile())==NULL){
+		ctx->error_stage = "assem_pass1";
+		fclose(input);
+		return -1;
+	}
 	
-	// 프로그램 크기를 저장
-	int pro_size[10];
-	int pro_cnt = 0;
-	memset(pro_size, 0, sizeof(pro_size));
+	if((err = assem_pass1_stream((const inst **)ctx->inst_table,
+								 ctx->inst_table_length, input, spill,
+								 ctx->symbol_table, &ctx->symbol_table_length,
+								 ctx->literal_table, &ctx->literal_table_length,
+								 &ctx->stat, &ctx->diags)) < 0 ||
+	   ctx->diags.length > 0){
+		ctx->error_stage = "assem_pass1";
+		if(err>=0)err = -1;
+	}
+	fclose(input);
 	
-	// 현재 포인터를 지정
-	object_code *now = obj_code;
-	memset(now->line, 0, sizeof(now->line));
+	if(err>=0 && (err = render_symbol_table(&ctx->outputs[ASSEMBLER_OUTPUT_SYMTAB],
+											(const symbol **)ctx->symbol_table,
+											ctx->symbol_table_length)) < 0){
+		ctx->error_stage = "render_symbol_table";
+	}
 	
-	for(int i=0;i<tokens_length;i++){
-		// 필요한 정보들을 가져옴
-		memset(&tmp_token, 0, sizeof(tmp_token));
-		tmp_token = *tokens[i];
-		if(tmp_token.operator!=NULL){
-			inst_index = search_opcode(tmp_token.operator, inst_table, inst_table_length);
-			if(inst_index!=-1){
-				memset(&tmp_inst, 0, sizeof(tmp_inst));
-				tmp_inst = *inst_table[inst_index];
-			}
+	if(err>=0 && (err = render_literal_table(&ctx->outputs[ASSEMBLER_OUTPUT_LITTAB],
+											 (const literal **)ctx->literal_table,
+											 ctx->literal_table_length)) < 0){
+		ctx->error_stage = "render_literal_table";
+	}
+	
+	if(err>=0 && (fflush(spill)!=0 || fseek(spill, 0, SEEK_SET)!=0 ||
+				  (out = fopen(objectcode_dir, "w"))==NULL)){
+		ctx->error_stage = "assem_pass2";
+		err = -1;
+	}
+	
+	if(err>=0){
+		err = assem_pass2_stream(spill, (const inst **)ctx->inst_table,
+								 ctx->inst_table_length,
+								 (const symbol **)ctx->symbol_table,
+								 ctx->symbol_table_length,
+								 (const literal **)ctx->literal_table,
+								 ctx->literal_table_length, out, &ctx->stat,
+								 &ctx->diags);
+		if(err<0 || ctx->diags.length > 0){
+			ctx->error_stage = "assem_pass2";
+			if(err>=0)err = -1;
 		}
+	}
+	
+	fclose(spill);
+	if(out!=NULL && fclose(out)!=0 && err>=0){
+		ctx->error_stage = "assem_pass2";
+		err = -1;
+	}
+	// 실패한 경우 중간까지 쓴 오브젝트 코드를 남기지 않음
+	if(out!=NULL && err<0)remove(objectcode_dir);
+	return err;
+}
+
+/**
+ * @brief 컨텍스트에 남아 있는 어셈블 결과와 중간 테이블을 모두 해제한다.
+ *
+ * @param ctx 어셈블러 컨텍스트 주소
+ *
+ * @details
+ * 기계어 목록은 유지하므로 바로 다음 소스코드를 어셈블할 수 있다.
+ */
+void assembler_reset(assembler_ctx *ctx) {
+	for(int i=0;i<ctx->input_length;i++){
+		free(ctx->input[i]);
+	}
+	free(ctx->input);
+	ctx->input = NULL;
+	ctx->input_length = 0;
+	
+	token_store_free(&ctx->tokens);
+	
+	for(int i=0;i<ctx->symbol_table_length;i++){
+		free(ctx->symbol_table[i]);
+	}
+	ctx->symbol_table_length = 0;
+	
+	for(int i=0;i<ctx->literal_table_length;i++){
+		free(ctx->literal_table[i]);
+	}
+	ctx->literal_table_length = 0;
+	
+	object_code_free(ctx->obj_code);
+	ctx->obj_code = NULL;
+	
+	for(int i=0;i<ASSEMBLER_OUTPUT_NUM;i++){
+		output_buffer_free(&ctx->outputs[i]);
+	}
+	memset(&ctx->stat, 0, sizeof(ctx->stat));
+	memset(&ctx->peephole, 0, sizeof(ctx->peephole));
+	xref_table_free(&ctx->xrefs);
+	diag_list_free(&ctx->diags);
+	ctx->error_stage = NULL;
+}
+
+/**
+ * @brief 컨텍스트와 컨텍스트가 가진 모든 메모리를 해제한다.
+ *
+ * @param ctx 어셈블러 컨텍스트 주소, 혹은 NULL
+ */
+void assembler_destroy(assembler_ctx *ctx) {
+	if(ctx == NULL)return;
+	
+	assembler_reset(ctx);
+	for(int i=0;i<ctx->inst_table_length;i++){
+		free(ctx->inst_table[i]);
+	}
+	free(ctx);
+	
+	// 마지막 컨텍스트였다면 공유하는 캐시와 이름 풀도 돌려줌
+	pthread_mutex_lock(&shared_users_lock);
+	if(--shared_users == 0){
+		include_cache_clear();
+		name_pool_clear();
+	}
+	pthread_mutex_unlock(&shared_users_lock);
+}
+
+/**
+ * @brief 다른 컨텍스트가 없다면 공유하는 INCLUDE 캐시와 이름 풀을 비운다.
+ *
+ * @param ctx 비우기 전에 assembler_reset할 어셈블러 컨텍스트 주소
+ * @return 비운 경우 1, 다른 컨텍스트가 있어 비우지 않은 경우 0
+ *
+ * @details
+ * 이름 풀은 한 번 발급한 번호를 지우지 않으므로, 한 컨텍스트로 계속 어셈블하는
+ * 감시 모드는 편집하며 새로 생긴 이름이 쌓인다. 이 함수는 `ctx`만 남아 있을 때
+ * 그 결과를 해제한 뒤 캐시와 이름 풀을 비운다. 이전 번호를 가진 다른 상태(감시
+ * 모드의 구간 결과 등)는 호출자가 함께 버려야 한다.
+ */
+int assembler_shared_clear(assembler_ctx *ctx) {
+	int cleared = 0;
+	
+	pthread_mutex_lock(&shared_users_lock);
+	if(shared_users == 1){
+		assembler_reset(ctx);
+		include_cache_clear();
+		name_pool_clear();
+		cleared = 1;
+	}
+	pthread_mutex_unlock(&shared_users_lock);
+	return cleared;
+}
+
+/**
+ * @brief 컨텍스트에 기록된 소스코드의 오류를 위치 순서로 stderr에 출력한다.
+ *
+ * @param ctx 어셈블을 마친 어셈블러 컨텍스트 주소
+ * @param source_name 소스코드의 오류 앞에 붙일 파일 이름
+ * @param json 0이 아니면 JSON으로 출력
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int report_diagnostics(assembler_ctx *ctx, const char *source_name, int json) {
+	output_buffer out = {0};
+	int err;
+	
+	diag_list_sort(&ctx->diags);
+	if((err = render_diagnostics(&out, &ctx->diags, source_name, json)) >= 0){
+		fwrite(out.data, 1, out.length, stderr);
+	}
+	output_buffer_free(&out);
+	return err;
+}
+
+/**
+ * @brief 소스코드와 INCLUDE 파일을 감시하며 바뀔 때마다 다시 어셈블한다.
+ *
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param input_dir 소스코드 파일 경로
+ * @param jobs 출력 파일별 출력 작업 배열 (`ctx->outputs` 순서)
+ * @param jobs_length 출력 작업 수
+ * @param thread_flag 0이 아니면 출력 파일들을 동시에 작성
+ * @param stat_flag 0이 아니면 어셈블할 때마다 통계를 stdout으로 출력
+ * @param diag_json 0이 아니면 소스코드의 오류를 JSON으로 출력
+ * @return 오류 코드 (SIGINT, SIGTERM을 받아 끝난 경우 = 0)
+ *
+ * @details
+ * 기계어 목록과 pass 2의 control section 구간 결과, 마지막으로 쓴 출력 파일의
+ * 내용을 메모리에 남겨두고 inotify로 소스코드와 INCLUDE 파일을 감시한다. 파일이
+ * 바뀌면 다시 어셈블하되 바뀌지 않은 구간은 pass 2를 건너뛰고, 내용이 바뀐 출력
+ * 파일만 다시 쓴 뒤 걸린 시간을 stdout으로 출력한다. 매크로와 INCLUDE는 구간을
+ * 넘나들 수 있으므로 토큰 분리와 pass 1은 매번 전체를 수행한다. 소스코드에 오류가
+ * 있으면 출력하고 다음 변경을 기다린다.
+ */
+int watch_input(assembler_ctx *ctx, const char *input_dir, output_job jobs[],
+				int jobs_length, int thread_flag, int stat_flag, int diag_json) {
+	watch_state ws;
+	struct sigaction sa;
+	char changed[MAX_PATH_LENGTH];
+	int wait = 1;
+	
+	memset(&ws, 0, sizeof(ws));
+	if((ws.fd = inotify_init1(IN_CLOEXEC)) < 0)return -1;
+	
+	// 신호를 받으면 기다리던 poll이 EINTR로 깨어나 정상 종료
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = watch_stop;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	
+	// 이미 있는 출력 파일과 내용이 같으면 처음에도 다시 쓰지 않음
+	for(int i=0;i<jobs_length;i++){
+		char *data = NULL;
+		size_t length = 0;
+		if(read_file(jobs[i].dir, &data, &length) < 0)continue;
+		ws.written[i].data = data;
+		ws.written[i].length = length;
+		ws.written[i].capacity = length + 1;
+		ws.known[i] = 1;
+	}
+	ctx->sections = &ws.sections;
+	
+	snprintf(changed, sizeof(changed), "%s", input_dir);
+	for(int first=1;wait>0;first=0){
+		struct timespec start, end;
+		int written = 0;
 		
-		// 주석 라인을 건너뜀
-		if(tmp_token.operator==NULL){
-			continue;
-		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int err = watch_assemble(ctx, &ws, input_dir, jobs, jobs_length,
+								 thread_flag, &written);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double ms = (end.tv_sec - start.tv_sec) * 1e3 +
+					(end.tv_nsec - start.tv_nsec) / 1e6;
 		
-		// operator가 "START"인 경우
-		else if(!strcmp(tmp_token.operator, "START")){
-			memset(pro_name, 0, sizeof(pro_name));
-			memset(tmp_base, 0, sizeof(tmp_base));
-			strncpy(pro_name, tmp_token.label, strlen(tmp_token.label));
-			strncpy(tmp_base, tmp_token.label, strlen(tmp_token.label));
-			// "H"문자열 추가
-			strcat(now->line, "H");
-			left_str = strlen(now->line);
-			right_str = strlen(tmp_token.label);
-			// 두 문자열의 합이 99이상이면 에러 '\t'를 붙일 것이기 때문
-			if(left_str + right_str >= 99)return -1;
-			// Header를 정의
-			strcat(now->line, tmp_token.label);
-			strcat(now->line, "\t");
-			
-			// 시작주소를 체크
-			memset(tmp_hex, 0, sizeof(tmp_hex));
-			sprintf(tmp_hex, "%06X", atoi(tmp_token.operand[0]));
-			pro_start = atoi(tmp_token.operand[0]);
-			pos = atoi(tmp_token.operand[0]);
-			left_str = strlen(now->line);
-			right_str = strlen(tmp_hex);
-			// 두 문자열의 합이 100이상이면 에러
-			if(left_str + right_str >= 100)return -1;
-			// Header를 정의
-			strcat(now->line, tmp_hex);
-			
-			// 다음 포인터를 지정
-			now->next = (object_code*)calloc(1, sizeof(object_code));
-			if(now->next==NULL){
-				return -2;
-			}
-			now = now->next;
-			continue;
+		if(ctx->diags.length > 0 || ctx->diags.dropped > 0 || diag_json){
+			report_diagnostics(ctx, input_dir, diag_json);
+		}
+		if(err < 0 && ctx->diags.length == 0){
+			fprintf(stderr, "%s: 어셈블 과정에서 실패했습니다. (error_code: %d)\n",
+					ctx->error_stage, err);
 		}
 		
-		// operator가 "EXTDEF"인 경우
-		else if(!strcmp(tmp_token.operator, "EXTDEF")){
-			strcat(now->line, "D");
-			for(int j=0;j<MAX_OPERAND_PER_INST && tmp_token.operand[j]!=NULL;j++){
-				left_str = strlen(now->line);
-				right_str = strlen(tmp_token.operand[j]);
-				if(left_str + right_str >= 100)return -1;
-				strcat(now->line, tmp_token.operand[j]);
-				
-				for(int k=0;k<symbol_table_length;k++){
-					if(!strcmp(tmp_token.operand[j], symbol_table[k]->name)){
-						memset(tmp_hex, 0, sizeof(tmp_hex));
-						sprintf(tmp_hex, "%06X", symbol_table[k]->addr);
-						left_str = strlen(now->line);
-						right_str = strlen(tmp_hex);
-						if(left_str + right_str >= 100)return -1;
-						strcat(now->line, tmp_hex);
-					}
-				}
-			}
-			// 다음 포인터를 지정
-			now->next = (object_code*)calloc(1, sizeof(object_code));
-			if(now->next==NULL){
-				return -2;
-			}
-			now = now->next;
-			continue;
+		if(err < 0){
+			printf("watch: %s %s, 실패 (%.3f ms)\n", changed,
+				   first ? "어셈블" : "변경", ms);
+		}
+		else {
+			printf("watch: %s %s, control section 구간 %d개 중 %d개 재사용, "
+				   "출력 파일 %d개 갱신 (%.3f ms)\n", changed,
+				   first ? "어셈블" : "변경", ws.sections.sections,
+				   ws.sections.reused, written, ms);
+			if(stat_flag)make_stat_output(NULL, &ctx->stat);
 		}
+		fflush(stdout);
 		
-		// operator가 "EXTREF"인 경우
-		else if(!strcmp(tmp_token.operator, "EXTREF")){
-			ref_cnt = 0;
-			for(int j=0;j<MAX_OPERAND_PER_INST;j++){
-				memset(tmp_ref[j], 0, sizeof(tmp_ref[j]));
-			}
-			strcat(now->line, "R");
-			for(int j=0;j<MAX_OPERAND_PER_INST && tmp_token.operand[j]!=NULL;j++){
-				left_str = strlen(now->line);
-				right_str = 6;
-				if(left_str + right_str >= 100)return -1;
-				sprintf(tmp_hex, "%-6s", tmp_token.operand[j]);
-				strcat(now->line, tmp_hex);
-				
-				// 해당 루틴에서 사용할 레퍼런스들을 저장
-				strncpy(tmp_ref[j], tmp_token.operand[j], strlen(tmp_token.operand[j]));
-				ref_cnt++;
-			}
-			// 다음 포인터를 지정
-			now->next = (object_code*)calloc(1, sizeof(object_code));
-			if(now->next==NULL){
-				return -2;
-			}
-			now = now->next;
+		wait = watch_wait(&ws, changed, sizeof(changed));
+	}
+	
+	ctx->sections = NULL;
+	watch_state_free(&ws);
+	return wait < 0 ? -1 : 0;
+}
+
+/**
+ * @brief 소스코드를 다시 읽어 어셈블하고, 내용이 바뀐 출력 파일만 다시 쓴다.
+ *
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param ws 감시 상태 주소
+ * @param input_dir 소스코드 파일 경로
+ * @param jobs 출력 파일별 출력 작업 배열 (`ctx->outputs` 순서)
+ * @param jobs_length 출력 작업 수
+ * @param thread_flag 0이 아니면 출력 파일들을 동시에 작성
+ * @param written 다시 쓴 출력 파일 수를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 어셈블에 실패하더라도 감시할 파일 목록은 읽은 INCLUDE 파일까지 갱신한다. 쓴
+ * 내용은 다음 비교를 위해 `ctx->outputs`의 버퍼와 맞바꾸어 보관한다. 이름 풀이
+ * 마지막으로 비운 뒤보다 WATCH_NAME_GROWTH배 넘게 커졌으면 어셈블하기 전에
+ * assembler_shared_clear로 비운다.
+ */
+int watch_assemble(assembler_ctx *ctx, watch_state *ws, const char *input_dir,
+				   output_job jobs[], int jobs_length, int thread_flag,
+				   int *written) {
+	output_job changed[ASSEMBLER_OUTPUT_NUM];
+	int changed_index[ASSEMBLER_OUTPUT_NUM];
+	int changed_length = 0;
+	char *source = NULL;
+	size_t source_length = 0;
+	int err, watch_err;
+	
+	*written = 0;
+	// 편집하며 생긴 이름이 쌓이지 않도록 이름 풀이 WATCH_NAME_GROWTH배가 되면
+	// 구간 결과와 함께 비우고 처음부터 어셈블
+	if(ws->names > 0 && name_count() > ws->names * WATCH_NAME_GROWTH){
+		if(assembler_shared_clear(ctx))section_cache_free(&ws->sections);
+		ws->names = 0;
+	}
+	if((err = read_file(input_dir, &source, &source_length)) < 0){
+		assembler_reset(ctx);
+		ctx->error_stage = "init_input";
+		return err;
+	}
+	err = assembler_assemble(ctx, source, source_length);
+	free(source);
+	if(ws->names == 0)ws->names = name_count();
+	
+	// INCLUDE가 바뀌었을 수 있으므로 감시할 파일을 다시 모음
+	watch_err = watch_update_files(ws, input_dir, &ctx->tokens);
+	if(err < 0)return err;
+	if(watch_err < 0){
+		ctx->error_stage = "watch_update_files";
+		return watch_err;
+	}
+	
+	for(int i=0;i<jobs_length;i++){
+		const output_buffer *out = jobs[i].out;
+		const output_buffer *old = &ws->written[i];
+		if(ws->known[i] && out->length==old->length &&
+		   (out->length==0 || !memcmp(out->data, old->data, out->length))){
 			continue;
 		}
+		changed[changed_length] = jobs[i];
+		changed_index[changed_length++] = i;
+	}
+	if(changed_length == 0)return 0;
+	
+	if((err = write_output_files(changed, changed_length, thread_flag)) < 0){
+		// 일부 파일만 써졌을 수 있으므로 다음에는 모두 다시 씀
+		for(int k=0;k<changed_length;k++){
+			ws->known[changed_index[k]] = 0;
+		}
+		ctx->error_stage = "write_output_files";
+		return err;
+	}
+	for(int k=0;k<changed_length;k++){
+		int i = changed_index[k];
+		output_buffer tmp = ws->written[i];
+		ws->written[i] = ctx->outputs[i];
+		ctx->outputs[i] = tmp;
+		ws->known[i] = 1;
+	}
+	*written = changed_length;
+	
+	return 0;
+}
+
+/**
+ * @brief 소스코드와 토큰 테이블에 나온 INCLUDE 파일들로 감시할 파일 목록을 다시
+ * 만든다.
+ *
+ * @param ws 감시 상태 주소
+ * @param input_dir 소스코드 파일 경로
+ * @param tokens 토큰 테이블 주소 (라인마다 나온 파일이 기록되어 있음)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 디렉터리의 watch는 지우지 않으므로 더 이상 포함하지 않는 파일의 이벤트는 목록에
+ * 없는 이름으로 무시된다.
+ */
+int watch_update_files(watch_state *ws, const char *input_dir,
+					   const token_store *tokens) {
+	name_id last = NAME_NONE;
+	int err;
+	
+	for(int i=0;i<ws->files_length;i++){
+		free(ws->files[i].path);
+	}
+	ws->files_length = 0;
+	
+	if((err = watch_add_file(ws, input_dir)) < 0)return err;
+	// 같은 파일의 라인은 이어져 있으므로 바로 앞과 다를 때만 찾아봄
+	for(int i=0;i<tokens->length;i++){
+		if(tokens->file[i]==NAME_NONE || tokens->file[i]==last)continue;
+		last = tokens->file[i];
+		if((err = watch_add_file(ws, name_str(last))) < 0)return err;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 파일 하나를 감시할 파일 목록에 추가하고 파일이 있는 디렉터리를 감시한다.
+ *
+ * @param ws 감시 상태 주소
+ * @param path 파일 경로
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int watch_add_file(watch_state *ws, const char *path) {
+	char dir[MAX_PATH_LENGTH];
+	const char *slash = strrchr(path, '/');
+	size_t length = strlen(path);
+	
+	for(int i=0;i<ws->files_length;i++){
+		if(!strcmp(ws->files[i].path, path))return 0;
+	}
+	if(length >= sizeof(dir))return -1;
+	
+	if(slash==NULL)strcpy(dir, ".");
+	else if(slash==path)strcpy(dir, "/");
+	else {
+		memcpy(dir, path, slash - path);
+		dir[slash - path] = '\0';
+	}
+	// 같은 디렉터리는 inotify가 같은 watch 번호를 돌려줌
+	int wd = inotify_add_watch(ws->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO |
+											IN_MOVED_FROM | IN_DELETE);
+	if(wd < 0)return -1;
+	
+	if(ws->files_length >= ws->files_capacity){
+		int capacity = ws->files_capacity ? ws->files_capacity * 2 : 16;
+		watch_file *files = (watch_file*)realloc(ws->files,
+												 capacity * sizeof(watch_file));
+		if(files==NULL)return -2;
+		ws->files = files;
+		ws->files_capacity = capacity;
+	}
+	
+	watch_file *f = &ws->files[ws->files_length];
+	f->path = (char*)malloc(length + 1);
+	if(f->path==NULL)return -2;
+	memcpy(f->path, path, length + 1);
+	f->name = slash==NULL ? f->path : f->path + (slash - path) + 1;
+	f->wd = wd;
+	ws->files_length++;
+	
+	return 0;
+}
+
+/**
+ * @brief 감시하는 파일이 바뀔 때까지 기다린다.
+ *
+ * @param ws 감시 상태 주소
+ * @param changed 처음 바뀐 파일 경로를 저장할 버퍼
+ * @param changed_size 버퍼의 크기
+ * @return 바뀐 경우 1, 신호를 받은 경우 0, 오류가 발생한 경우 음수
+ *
+ * @details
+ * 편집기는 저장 한 번에 여러 이벤트를 만들기도 하므로, 바뀐 파일을 찾은 뒤에는
+ * WATCH_SETTLE_MS 동안 이벤트가 없을 때까지 모아서 한 번만 알린다.
+ */
+int watch_wait(watch_state *ws, char *changed, size_t changed_size) {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd;
+	int found = 0;
+	
+	pfd.fd = ws->fd;
+	pfd.events = POLLIN;
+	while(!watch_stopped){
+		int ready = poll(&pfd, 1, found ? WATCH_SETTLE_MS : -1);
+		if(ready < 0){
+			if(errno==EINTR)continue;
+			return -1;
+		}
+		if(ready == 0)return 1;
 		
-		// operator가 "CSECT"인 경우
-		else if(!strcmp(tmp_token.operator, "CSECT")){
-			// line이 있는 경우만 새로운 줄을 생성
-			if(strlen(now->line)>0){
-				char tmp[100];
-				memset(tmp, 0, sizeof(tmp));
-				int now_pos = strlen(now->line)/2;
-				sprintf(tmp, "T%06X%02X", pos, now_pos);
-				pos += now_pos;
-				strcat(tmp, now->line);
-				memset(now->line, 0, sizeof(now->line));
-				strncpy(now->line, tmp, strlen(tmp));
-				
-				
-				now->next = (object_code*)calloc(1, sizeof(object_code));
-				if(now->next==NULL){
-					return -2;
-				}
-				now = now->next;
-			}
+		ssize_t length = read(ws->fd, buf, sizeof(buf));
+		if(length < 0){
+			if(errno==EINTR)continue;
+			return -1;
+		}
+		for(char *p = buf;p < buf + length;){
+			const struct inotify_event *ev = (const struct inotify_event*)p;
+			p += sizeof(struct inotify_event) + ev->len;
 			
-			if(!ltorg_flag){
-				
-				for(int k=0;k<literal_table_length;k++){
-					// 리터럴 확인
-					if(!strcmp(literal_table[k]->base, tmp_base)){
-						memset(tmp_hex, 0, sizeof(tmp_hex));
-						// 리터럴 타입 확인 후 적절하게 tmp_hex에 넣어줌
-						if(*(literal_table[k]->literal + 1)=='C'){
-							location_counter += literal_table[k]->size;
-							char h[4];
-							for(int j=3;j<3+literal_table[k]->size;j++){
-								memset(h, 0, sizeof(h));
-								sprintf(h, "%02X", literal_table[k]->literal[j]);
-								strcat(tmp_hex, h);
-							}
-							
-						}
-						else if(*(literal_table[k]->literal + 1)=='X'){
-							location_counter += literal_table[k]->size/2;
-							strncpy(tmp_hex, literal_table[k]->literal+3, literal_table[k]->size);
-						}
-						left_str = strlen(now->line);
-						right_str = strlen(tmp_hex);
-						if(left_str + right_str >= 100)return -1;
-						strcat(now->line, tmp_hex);
-					}
-				}
-				// line이 있는 경우만 새로운 줄을 생성
-				if(strlen(now->line)>0){
-					char tmp[100];
-					memset(tmp, 0, sizeof(tmp));
-					int now_pos = strlen(now->line)/2;
-					sprintf(tmp, "T%06X%02X", location_counter - now_pos, now_pos);
-					strcat(tmp, now->line);
-					memset(now->line, 0, sizeof(now->line));
-					strncpy(now->line, tmp, strlen(tmp));
-					now->next = (object_code*)calloc(1, sizeof(object_code));
-					if(now->next==NULL){
-						return -2;
-					}
-					now = now->next;
+			// 이벤트가 넘쳐 버려진 경우에는 어떤 파일이 바뀌었는지 알 수 없음
+			if(ev->mask & IN_Q_OVERFLOW){
+				if(!found)snprintf(changed, changed_size, "(알 수 없는 파일)");
+				found = 1;
+				continue;
+			}
+			if(ev->len == 0)continue;
+			for(int i=0;i<ws->files_length;i++){
+				if(ws->files[i].wd!=ev->wd || strcmp(ws->files[i].name, ev->name)){
+					continue;
 				}
+				if(!found)snprintf(changed, changed_size, "%s", ws->files[i].path);
+				found = 1;
+				break;
 			}
-			
-			
-			
-			while(mod_red->next != NULL){
-				// 헤더
-				strcat(now->line, "M");
-				// 주소
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%06X", mod_red->addr);
-				strcat(now->line, tmp_hex);
-				// 위치
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%02X", mod_red->pos);
-				strcat(now->line, tmp_hex);
-				// op, name
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 감시 상태가 가진 메모리와 inotify 파일 디스크립터를 해제한다.
+ *
+ * @param ws 감시 상태 주소
+ */
+void watch_state_free(watch_state *ws) {
+	if(ws->fd >= 0)close(ws->fd);
+	for(int i=0;i<ws->files_length;i++){
+		free(ws->files[i].path);
+	}
+	free(ws->files);
+	section_cache_free(&ws->sections);
+	for(int i=0;i<ASSEMBLER_OUTPUT_NUM;i++){
+		output_buffer_free(&ws->written[i]);
+	}
+	memset(ws, 0, sizeof(watch_state));
+	ws->fd = -1;
+}
+
+/**
+ * @brief SIGINT, SIGTERM을 받으면 감시 모드를 끝내도록 표시한다.
+ *
+ * @param sig 받은 신호 번호
+ */
+void watch_stop(int sig) {
+	(void)sig;
+	watch_stopped = 1;
+}
+
+/**
+ * @brief 토큰 하나와 토큰이 가리키는 문자열들을 해제한다.
+ *
+ * @param tok 해제할 토큰 주소, 혹은 NULL
+ */
+void token_free(token *tok) {
+	if(tok == NULL)return;
+	
+	token_clear(tok);
+	free(tok);
+}
+
+/**
+ * @brief 토큰의 문자열들을 새로 할당하여 다른 토큰으로 복사한다.
+ *
+ * @param dst 비어 있는 토큰 주소
+ * @param src 복사할 토큰 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 실패한 경우에도 지금까지 복사한 문자열은 dst에 남으므로 token_clear로 해제할
+ * 수 있다.
+ */
+int token_copy(token *dst, const token *src) {
+	const char *from[3 + MAX_OPERAND_PER_INST] = {src->label, src->operator,
+												  src->comment};
+	char **to[3 + MAX_OPERAND_PER_INST] = {&dst->label, &dst->operator,
+										   &dst->comment};
+	for(int k=0;k<MAX_OPERAND_PER_INST;k++){
+		from[3 + k] = src->operand[k];
+		to[3 + k] = &dst->operand[k];
+	}
+	
+	// 컴파일된 수식은 pass 1에서 토큰마다 새로 만들어지므로 복사하지 않음
+	dst->nixbpe = src->nixbpe;
+	dst->addr = src->addr;
+	dst->label_id = src->label_id;
+	for(int k=0;k<3 + MAX_OPERAND_PER_INST;k++){
+		if(from[k]==NULL)continue;
+		*to[k] = (char*)calloc(1, strlen(from[k]) + 1);
+		if(*to[k]==NULL)return -2;
+		strcpy(*to[k], from[k]);
+	}
+	if(src->names_length > 0){
+		size_t size = token_names_size(src->names, src->names_length);
+		dst->names = (char*)malloc(size);
+		if(dst->names==NULL)return -2;
+		memcpy(dst->names, src->names, size);
+		dst->names_length = src->names_length;
+	}
+	return 0;
+}
+
+/**
+ * @brief 토큰이 가리키는 문자열들을 해제하고 토큰을 비운다.
+ *
+ * @param tok 비울 토큰 주소
+ */
+void token_clear(token *tok) {
+	free(tok->label);
+	free(tok->operator);
+	for(int i=0;i<MAX_OPERAND_PER_INST;i++){
+		free(tok->operand[i]);
+	}
+	free(tok->comment);
+	free(tok->expr);
+	free(tok->names);
+	memset(tok, 0, sizeof(token));
+}
+
+/**
+ * @brief '\0'으로 구분하여 이어 붙인 이름 목록의 바이트 수를 구한다.
+ *
+ * @param names 이름 목록, 혹은 NULL
+ * @param names_length 이름 수
+ * @return 마지막 '\0'까지 포함한 바이트 수
+ */
+size_t token_names_size(const char *names, int names_length) {
+	size_t size = 0;
+	for(int k=0;k<names_length;k++){
+		size += strlen(names + size) + 1;
+	}
+	return size;
+}
+
+/**
+ * @brief 토큰의 이름 목록 뒤에 이름 하나를 추가한다.
+ *
+ * @param tok 이름을 추가할 토큰 주소
+ * @param name 추가할 이름
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int token_names_append(token *tok, const char *name) {
+	size_t size = token_names_size(tok->names, tok->names_length);
+	size_t len = strlen(name);
+	
+	char *names = (char*)realloc(tok->names, size + len + 1);
+	if(names==NULL)return -2;
+	memcpy(names + size, name, len + 1);
+	tok->names = names;
+	tok->names_length++;
+	
+	return 0;
+}
+
+/**
+ * @brief 토큰 테이블의 배열들을 최소 capacity개의 라인을 담을 수 있게 늘린다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param capacity 필요한 라인 수
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 소스코드의 라인 수로 한 번에 크기를 잡아두면 매크로나 INCLUDE로 라인이 늘어날
+ * 때만 다시 할당한다. 일부 배열만 늘어난 채로 실패해도 capacity는 바뀌지 않으므로
+ * token_store_free로 해제할 수 있다.
+ */
+int token_store_reserve(token_store *store, int capacity) {
+	if(capacity <= store->capacity)return 0;
+	if(capacity < 16)capacity = 16;
+	
+	// 필드마다 배열 주소와 원소 크기
+	void **arrays[] = {(void**)&store->label, (void**)&store->operator,
+					   (void**)&store->opcode, (void**)&store->operand,
+					   (void**)&store->operands, (void**)&store->comment,
+					   (void**)&store->nixbpe, (void**)&store->addr,
+					   (void**)&store->expr, (void**)&store->line,
+					   (void**)&store->file};
+	size_t sizes[] = {sizeof(name_id), sizeof(name_id), sizeof(short),
+					  sizeof(unsigned int), sizeof(unsigned short),
+					  sizeof(unsigned int), sizeof(char), sizeof(int),
+					  sizeof(expression*), sizeof(int), sizeof(name_id)};
+	for(size_t k=0;k<sizeof(arrays) / sizeof(arrays[0]);k++){
+		void *array = realloc(*arrays[k], capacity * sizes[k]);
+		if(array==NULL)return -2;
+		*arrays[k] = array;
+	}
+	store->capacity = capacity;
+	
+	return 0;
+}
+
+/**
+ * @brief 토큰 테이블의 text 뒤에 문자열을 '\0'과 함께 추가한다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param str 추가할 문자열
+ * @param length 추가할 바이트 수 ('\0' 제외)
+ * @param offset 추가한 위치를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int token_store_text(token_store *store, const char *str, size_t length,
+					 unsigned int *offset) {
+	// 0번 위치는 "없음"을 뜻하므로 비워둠
+	size_t need = (store->text_length ? store->text_length : 1) + length + 1;
+	if(need > 0xFFFFFFFFu)return -1;
+	
+	if(need > store->text_capacity){
+		size_t capacity = store->text_capacity ? store->text_capacity : 1024;
+		while(capacity < need)capacity *= 2;
+		char *text = (char*)realloc(store->text, capacity);
+		if(text==NULL)return -2;
+		store->text = text;
+		store->text_capacity = capacity;
+	}
+	if(store->text_length==0)store->text[store->text_length++] = '\0';
+	
+	*offset = (unsigned int)store->text_length;
+	memcpy(store->text + store->text_length, str, length);
+	store->text[store->text_length + length] = '\0';
+	store->text_length += length + 1;
+	
+	return 0;
+}
+
+/**
+ * @brief 토큰 하나의 내용을 토큰 테이블 끝에 추가한다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param tok 추가할 토큰 주소, 내용은 복사되므로 호출자가 해제한다
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * label과 operator는 이름 풀에 등록하고, operand 또는 EXTDEF/EXTREF 이름 목록과
+ * comment는 text에 복사한다. 컴파일된 수식은 복사하지 않는다. 소스코드 위치는
+ * 비워두므로 호출자(tokenize_line)가 채운다.
+ */
+int token_store_add(token_store *store, const token *tok) {
+	int err = 0;
+	int i = store->length;
+	
+	if(i >= store->capacity &&
+	   (err = token_store_reserve(store, store->capacity ? store->capacity * 2 : 16)) < 0){
+		return err;
+	}
+	
+	store->label[i] = tok->label_id;
+	if(tok->label!=NULL && tok->label_id==NAME_NONE &&
+	   (err = name_intern(tok->label, &store->label[i])) < 0){
+		return err;
+	}
+	if((err = name_intern(tok->operator, &store->operator[i])) < 0)return err;
+	
+	store->opcode[i] = -1;
+	store->operand[i] = 0;
+	store->operands[i] = 0;
+	if(tok->names_length > 0){
+		if(tok->names_length >= TOKEN_STORE_NAMES)return -1;
+		// 이름 목록은 이미 '\0'으로 구분되어 있으므로 마지막 '\0'을 빼고 복사
+		size_t size = token_names_size(tok->names, tok->names_length);
+		if((err = token_store_text(store, tok->names, size - 1,
+								   &store->operand[i])) < 0){
+			return err;
+		}
+		store->operands[i] = TOKEN_STORE_NAMES + tok->names_length;
+	}
+	for(int k=0;k<MAX_OPERAND_PER_INST && tok->operand[k]!=NULL;k++){
+		unsigned int offset;
+		if((err = token_store_text(store, tok->operand[k], strlen(tok->operand[k]),
+								   &offset)) < 0){
+			return err;
+		}
+		if(k==0)store->operand[i] = offset;
+		store->operands[i]++;
+	}
+	store->comment[i] = 0;
+	if(tok->comment!=NULL &&
+	   (err = token_store_text(store, tok->comment, strlen(tok->comment),
+							   &store->comment[i])) < 0){
+		return err;
+	}
+	
+	store->nixbpe[i] = tok->nixbpe;
+	store->addr[i] = tok->addr;
+	store->expr[i] = NULL;
+	store->line[i] = 0;
+	store->file[i] = NAME_NONE;
+	store->length++;
+	
+	return 0;
+}
+
+/**
+ * @brief 토큰 테이블의 한 라인을 token 형태의 뷰로 얻는다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param i 라인 번호
+ * @param tok 뷰를 저장할 토큰 주소
+ *
+ * @details
+ * 뷰의 문자열은 이름 풀과 토큰 테이블의 text를 직접 가리키므로 수정하거나
+ * 해제하면 안 되고, 토큰 테이블에 라인을 추가하기 전까지만 유효하다.
+ */
+void token_store_get(const token_store *store, int i, token *tok) {
+	memset(tok, 0, sizeof(token));
+	
+	tok->label_id = store->label[i];
+	if(store->label[i]!=NAME_NONE)tok->label = (char*)name_str(store->label[i]);
+	if(store->operator[i]!=NAME_NONE)tok->operator = (char*)name_str(store->operator[i]);
+	
+	char *operand = store->text + store->operand[i];
+	int operands = store->operands[i];
+	if(operands & TOKEN_STORE_NAMES){
+		tok->names = operand;
+		tok->names_length = operands - TOKEN_STORE_NAMES;
+	}
+	else {
+		for(int k=0;k<operands;k++){
+			tok->operand[k] = operand;
+			operand += strlen(operand) + 1;
+		}
+	}
+	if(store->comment[i]!=0)tok->comment = store->text + store->comment[i];
+	
+	tok->nixbpe = store->nixbpe[i];
+	tok->addr = store->addr[i];
+	tok->expr = store->expr[i];
+}
+
+/**
+ * @brief 토큰 테이블이 할당한 메모리의 바이트 수를 구한다.
+ *
+ * @param store 토큰 테이블 주소
+ * @return 할당된 바이트 수
+ */
+size_t token_store_bytes(const token_store *store) {
+	size_t line = 2 * sizeof(name_id) + sizeof(short) + 2 * sizeof(unsigned int) +
+				  sizeof(unsigned short) + sizeof(char) + 2 * sizeof(int) +
+				  sizeof(expression*) + sizeof(name_id);
+	return store->capacity * line + store->text_capacity;
+}
+
+/**
+ * @brief 토큰 테이블과 컴파일된 수식들을 해제하고 테이블을 비운다.
+ *
+ * @param store 토큰 테이블 주소
+ */
+void token_store_free(token_store *store) {
+	for(int i=0;i<store->length;i++){
+		free(store->expr[i]);
+	}
+	free(store->label);
+	free(store->operator);
+	free(store->opcode);
+	free(store->operand);
+	free(store->operands);
+	free(store->comment);
+	free(store->nixbpe);
+	free(store->addr);
+	free(store->expr);
+	free(store->line);
+	free(store->file);
+	free(store->text);
+	memset(store, 0, sizeof(token_store));
+}
+
+/**
+ * @brief 토큰 테이블을 비우되 할당한 배열은 다음 라인들을 위해 남겨둔다.
+ *
+ * @param store 토큰 테이블 주소
+ */
+void token_store_clear(token_store *store) {
+	for(int i=0;i<store->length;i++){
+		free(store->expr[i]);
+		store->expr[i] = NULL;
+	}
+	store->length = 0;
+	store->text_length = 0;
+}
+
+/**
+ * @brief 토큰 테이블의 라인들을 IR 형태로 임시 파일 끝에 쓴다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param fp 쓰기 권한으로 열린 파일
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 라인마다 token_ir 헤더와 operand 문자열을 쓴다. 이름은 이름 풀의 번호로 쓰므로
+ * 같은 프로세스 안에서만 token_store_load로 다시 읽을 수 있다.
+ */
+int token_store_spill(const token_store *store, FILE *fp) {
+	for(int i=0;i<store->length;i++){
+		token_ir ir;
+		const char *operand = store->text + store->operand[i];
+		int operands = store->operands[i];
+		size_t size = 0;
+		
+		// operand들은 text 안에 연속해서 저장되어 있음
+		if(operands & TOKEN_STORE_NAMES){
+			size = token_names_size(operand, operands - TOKEN_STORE_NAMES);
+		}
+		else {
+			for(int k=0;k<operands;k++){
+				size += strlen(operand + size) + 1;
+			}
+		}
+		if(size > 0xFFFF)return -1;
+		
+		memset(&ir, 0, sizeof(ir));
+		ir.label = store->label[i];
+		ir.operator = store->operator[i];
+		ir.addr = store->addr[i];
+		ir.opcode = store->opcode[i];
+		ir.operands = store->operands[i];
+		ir.text_length = (unsigned short)size;
+		ir.nixbpe = store->nixbpe[i];
+		ir.line = store->line[i];
+		ir.file = store->file[i];
+		
+		if(fwrite(&ir, sizeof(ir), 1, fp)!=1)return -1;
+		if(size > 0 && fwrite(operand, 1, size, fp)!=size)return -1;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief token_store_spill로 쓴 IR을 최대 max_lines개 읽어 토큰 테이블에 추가한다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param fp 읽기 권한으로 열린 파일
+ * @param max_lines 읽을 최대 라인 수
+ * @return 읽은 라인 수 (파일의 끝 = 0), 오류가 발생한 경우 음수
+ */
+int token_store_load(token_store *store, FILE *fp, int max_lines) {
+	char operand[0x10000];
+	int count = 0;
+	int err = 0;
+	
+	while(count < max_lines){
+		token_ir ir;
+		size_t got = fread(&ir, 1, sizeof(ir), fp);
+		
+		if(got==0)break;
+		// 헤더나 operand가 중간에 잘린 경우
+		if(got!=sizeof(ir))return -1;
+		if(ir.text_length > 0 &&
+		   fread(operand, 1, ir.text_length, fp)!=ir.text_length){
+			return -1;
+		}
+		
+		int i = store->length;
+		if(i >= store->capacity &&
+		   (err = token_store_reserve(store, store->capacity ? store->capacity * 2 : 16)) < 0){
+			return err;
+		}
+		
+		store->label[i] = ir.label;
+		store->operator[i] = ir.operator;
+		store->opcode[i] = ir.opcode;
+		store->operand[i] = 0;
+		// 마지막 '\0'은 token_store_text가 다시 붙임
+		if(ir.text_length > 0 &&
+		   (err = token_store_text(store, operand, ir.text_length - 1,
+								   &store->operand[i])) < 0){
+			return err;
+		}
+		store->operands[i] = ir.operands;
+		store->comment[i] = 0;
+		store->nixbpe[i] = ir.nixbpe;
+		store->addr[i] = ir.addr;
+		store->expr[i] = NULL;
+		store->line[i] = ir.line;
+		store->file[i] = ir.file;
+		store->length++;
+		count++;
+	}
+	
+	return count;
+}
+
+/**
+ * @brief 스냅샷에 쓸 이름 목록에 이름 하나를 추가한다.
+ *
+ * @param id 추가할 이름 풀 번호
+ * @param map 이름 풀 번호별 스냅샷 번호 (아직 없으면 NAME_NONE)
+ * @param ids 스냅샷 번호 순서의 이름 풀 번호 배열
+ * @param header 이름 수와 바이트 수를 더할 스냅샷 헤더 주소
+ */
+void snapshot_name_add(name_id id, name_id *map, name_id *ids,
+					   snapshot_header *header) {
+	if(id==NAME_NONE || map[id]!=NAME_NONE)return;
+	
+	ids[header->names++] = id;
+	map[id] = header->names;
+	header->names_bytes += strlen(name_str(id)) + 1;
+}
+
+/**
+ * @brief pass 1의 결과(토큰 테이블, 심볼 테이블, 리터럴 테이블)를 바이너리
+ * 스냅샷 파일로 쓴다.
+ *
+ * @param snapshot_dir 스냅샷 파일 경로
+ * @param tokens pass 1을 마친 토큰 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 파일 형식은 snapshot_header를 참고한다. 컴파일된 수식은 심볼 테이블 번호를
+ * 가리키므로 쓰지 않고, 읽은 뒤 compile_expressions로 다시 만든다. 실패한 경우
+ * 중간까지 쓴 파일은 지운다.
+ */
+int make_pass1_snapshot(const char *snapshot_dir, const token_store *tokens,
+						int inst_table_length, const symbol *symbol_table[],
+						int symbol_table_length, const literal *literal_table[],
+						int literal_table_length) {
+	snapshot_header header;
+	name_id pool_length;
+	int n = tokens->length;
+	int err = 0;
+	
+	pool_length = name_count();
+	
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.inst_table_length = inst_table_length;
+	header.symbol_size = sizeof(symbol);
+	header.literal_size = sizeof(literal);
+	header.tokens = n;
+	header.text_bytes = tokens->text_length;
+	header.symbols = symbol_table_length;
+	header.literals = literal_table_length;
+	
+	// 이름 풀 번호를 파일 안의 번호로 바꾸기 위한 표와 label/operator 변환 버퍼
+	name_id *map = (name_id*)calloc(pool_length, sizeof(name_id));
+	name_id *ids = (name_id*)malloc(pool_length * sizeof(name_id));
+	name_id *remapped = (name_id*)malloc((n > 0 ? n : 1) * sizeof(name_id));
+	if(map==NULL || ids==NULL || remapped==NULL){
+		free(map);
+		free(ids);
+		free(remapped);
+		return -2;
+	}
+	
+	for(int i=0;i<n;i++){
+		snapshot_name_add(tokens->label[i], map, ids, &header);
+		snapshot_name_add(tokens->operator[i], map, ids, &header);
+		snapshot_name_add(tokens->file[i], map, ids, &header);
+	}
+	for(int i=0;i<symbol_table_length;i++){
+		snapshot_name_add(symbol_table[i]->name, map, ids, &header);
+		snapshot_name_add(symbol_table[i]->base, map, ids, &header);
+	}
+	for(int i=0;i<literal_table_length;i++){
+		snapshot_name_add(literal_table[i]->base, map, ids, &header);
+	}
+	
+	size_t line = 5 * sizeof(uint32_t) + 2 * sizeof(int) + sizeof(short) +
+				  sizeof(unsigned short) + sizeof(char);
+	size_t size = sizeof(header) + header.names_bytes + n * line +
+				  header.text_bytes + symbol_table_length * sizeof(symbol) +
+				  literal_table_length * sizeof(literal);
+	header.size = (uint32_t)size;
+	
+	FILE *fp = size > 0xFFFFFFFFu ? NULL : fopen(snapshot_dir, "wb");
+	if(fp==NULL){
+		free(map);
+		free(ids);
+		free(remapped);
+		return -1;
+	}
+	
+	// 쓰기 오류는 마지막에 ferror로 한 번에 확인
+	fwrite(&header, sizeof(header), 1, fp);
+	for(uint32_t k=0;k<header.names;k++){
+		const char *name = name_str(ids[k]);
+		fwrite(name, 1, strlen(name) + 1, fp);
+	}
+	if(n > 0){
+		for(int i=0;i<n;i++)remapped[i] = map[tokens->label[i]];
+		fwrite(remapped, sizeof(name_id), n, fp);
+		for(int i=0;i<n;i++)remapped[i] = map[tokens->operator[i]];
+		fwrite(remapped, sizeof(name_id), n, fp);
+		for(int i=0;i<n;i++)remapped[i] = map[tokens->file[i]];
+		fwrite(remapped, sizeof(name_id), n, fp);
+		fwrite(tokens->operand, sizeof(unsigned int), n, fp);
+		fwrite(tokens->comment, sizeof(unsigned int), n, fp);
+		fwrite(tokens->addr, sizeof(int), n, fp);
+		fwrite(tokens->line, sizeof(int), n, fp);
+		fwrite(tokens->opcode, sizeof(short), n, fp);
+		fwrite(tokens->operands, sizeof(unsigned short), n, fp);
+		fwrite(tokens->nixbpe, sizeof(char), n, fp);
+	}
+	if(header.text_bytes > 0)fwrite(tokens->text, 1, header.text_bytes, fp);
+	for(int i=0;i<symbol_table_length;i++){
+		symbol sym = *symbol_table[i];
+		sym.name = map[sym.name];
+		sym.base = map[sym.base];
+		fwrite(&sym, sizeof(sym), 1, fp);
+	}
+	for(int i=0;i<literal_table_length;i++){
+		literal lit = *literal_table[i];
+		lit.base = map[lit.base];
+		fwrite(&lit, sizeof(lit), 1, fp);
+	}
+	
+	if(ferror(fp))err = -1;
+	if(fclose(fp)!=0)err = -1;
+	if(err<0)remove(snapshot_dir);
+	
+	free(map);
+	free(ids);
+	free(remapped);
+	return err;
+}
+
+/**
+ * @brief 스냅샷 파일을 읽지 않는 이유를 오류로 기록한다.
+ *
+ * @param diags 오류 목록 주소, 혹은 NULL
+ * @param format 이유의 printf 형식 문자열
+ * @return 항상 -1
+ */
+int snapshot_reject(diag_list *diags, const char *format, ...) {
+	char reason[MAX_DIAG_MESSAGE];
+	va_list ap;
+	
+	va_start(ap, format);
+	vsnprintf(reason, sizeof(reason), format, ap);
+	va_end(ap);
+	diag_add(diags, NAME_NONE, 0, 0, "스냅샷 파일이 올바르지 않습니다: %s", reason);
+	return -1;
+}
+
+/**
+ * @brief 스냅샷에서 읽은 토큰 한 라인의 nixbpe와 operand가 명령어 형식에 맞는지
+ * 확인한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param tokens 스냅샷에서 읽은 토큰 테이블 주소
+ * @param i 확인할 라인 번호
+ * @param diags 오류 목록 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * pass 2는 nixbpe를 오브젝트 코드에 그대로 밀어 넣으므로, pass 1이 만들 수 없는
+ * 값은 여기서 걸러낸다. 1, 2형식은 x 비트만, operand가 있는 3, 4형식은 n, i 중
+ * 하나 이상과 b, p 중 하나 이하를 가진다. 2형식의 operand는 pass 1과 같이
+ * 확인한다.
+ */
+int snapshot_check_line(const inst *inst_table[], const token_store *tokens,
+						int i, diag_list *diags) {
+	int nixbpe = tokens->nixbpe[i];
+	int opcode = tokens->opcode[i];
+	const inst *in = opcode!=-1 ? inst_table[opcode] : NULL;
+	char message[MAX_DIAG_MESSAGE];
+	token tok;
+	int k;
+	
+	// operand가 없는 라인은 pass 1이 nixbpe를 기록하지 않으므로 0
+	if(nixbpe < 0 || nixbpe > 63 ||
+	   (in!=NULL && in->format!=34 && (nixbpe & ~8)) ||
+	   (in!=NULL && in->format==34 && tokens->operands[i]==0 && nixbpe!=0) ||
+	   (in!=NULL && in->format==34 && tokens->operands[i]!=0 &&
+		((nixbpe & 48)==0 || (nixbpe & 6)==6))){
+		return snapshot_reject(diags, "%d번째 토큰의 nixbpe(%d)가 %s에 맞지 않습니다.",
+							   i + 1, nixbpe, in!=NULL ? in->str : "지시어");
+	}
+	if(in==NULL || in->format!=2)return 0;
+	
+	token_store_get(tokens, i, &tok);
+	if(pass1_check_format2(&tok, in, message, sizeof(message), &k)){
+		return snapshot_reject(diags, "%d번째 토큰: %s", i + 1, message);
+	}
+	return 0;
+}
+
+/**
+ * @brief 메모리에 올린 스냅샷 파일의 내용을 검사하면서 pass 1의 결과로 복원한다.
+ *
+ * @param data 스냅샷 파일의 내용
+ * @param size 스냅샷 파일의 바이트 수
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param tokens 비어 있는 토큰 테이블 주소
+ * @param symbol_table 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param diags 읽지 않는 이유를 기록할 오류 목록 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 실패한 경우에도 할당한 만큼 길이가 남아 있으므로 호출자가 해제할 수 있다.
+ */
+int parse_pass1_snapshot(const char *data, size_t size, const inst *inst_table[],
+						 int inst_table_length, token_store *tokens,
+						 symbol *symbol_table[], int *symbol_table_length,
+						 literal *literal_table[], int *literal_table_length,
+						 diag_list *diags) {
+	snapshot_header header;
+	int err = 0;
+	
+	if(size < sizeof(header)){
+		return snapshot_reject(diags, "헤더보다 짧습니다.");
+	}
+	memcpy(&header, data, sizeof(header));
+	
+	// 다른 형식이나 다른 빌드, 다른 기계어 목록으로 만든 스냅샷은 읽지 않음
+	if(memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) ||
+	   header.version!=SNAPSHOT_VERSION || header.size!=size ||
+	   header.inst_table_length!=(uint32_t)inst_table_length ||
+	   header.symbol_size!=sizeof(symbol) ||
+	   header.literal_size!=sizeof(literal) ||
+	   header.symbols > MAX_TABLE_LENGTH || header.literals > MAX_TABLE_LENGTH ||
+	   header.tokens > 0x7FFFFFFFu){
+		return snapshot_reject(diags, "다른 형식이나 다른 기계어 목록으로 만든 "
+							   "파일입니다.");
+	}
+	size_t line = 5 * sizeof(uint32_t) + 2 * sizeof(int) + sizeof(short) +
+				  sizeof(unsigned short) + sizeof(char);
+	if(sizeof(header) + (size_t)header.names_bytes + header.tokens * line +
+	   header.text_bytes + header.symbols * sizeof(symbol) +
+	   header.literals * sizeof(literal) != size){
+		return snapshot_reject(diags, "파일 크기가 헤더와 맞지 않습니다.");
+	}
+	
+	// 이름 목록을 이름 풀에 등록 (0번은 NAME_NONE)
+	const char *at = data + sizeof(header);
+	const char *end = at + header.names_bytes;
+	if(header.names_bytes > 0 && end[-1]!='\0'){
+		return snapshot_reject(diags, "이름 목록이 손상되었습니다.");
+	}
+	name_id *ids = (name_id*)malloc((header.names + 1) * sizeof(name_id));
+	if(ids==NULL)return -2;
+	ids[0] = NAME_NONE;
+	for(uint32_t k=1;k<=header.names && err>=0;k++){
+		if(at >= end || *at=='\0'){
+			err = -1;
+			break;
+		}
+		err = name_intern(at, &ids[k]);
+		at += strlen(at) + 1;
+	}
+	if(err==-1 || (err>=0 && at!=end)){
+		err = snapshot_reject(diags, "이름 목록이 손상되었습니다.");
+	}
+	
+	int n = header.tokens;
+	if(err>=0)err = token_store_reserve(tokens, n);
+	if(err>=0){
+		memcpy(tokens->label, at, n * sizeof(name_id));
+		at += n * sizeof(name_id);
+		memcpy(tokens->operator, at, n * sizeof(name_id));
+		at += n * sizeof(name_id);
+		memcpy(tokens->file, at, n * sizeof(name_id));
+		at += n * sizeof(name_id);
+		memcpy(tokens->operand, at, n * sizeof(unsigned int));
+		at += n * sizeof(unsigned int);
+		memcpy(tokens->comment, at, n * sizeof(unsigned int));
+		at += n * sizeof(unsigned int);
+		memcpy(tokens->addr, at, n * sizeof(int));
+		at += n * sizeof(int);
+		memcpy(tokens->line, at, n * sizeof(int));
+		at += n * sizeof(int);
+		memcpy(tokens->opcode, at, n * sizeof(short));
+		at += n * sizeof(short);
+		memcpy(tokens->operands, at, n * sizeof(unsigned short));
+		at += n * sizeof(unsigned short);
+		memcpy(tokens->nixbpe, at, n * sizeof(char));
+		at += n * sizeof(char);
+		memset(tokens->expr, 0, n * sizeof(expression*));
+	}
+	if(err>=0 && header.text_bytes > 0){
+		if(at[header.text_bytes-1]!='\0'){
+			err = snapshot_reject(diags, "토큰 문자열이 손상되었습니다.");
+		}
+		else if((tokens->text = (char*)malloc(header.text_bytes))==NULL){
+			err = -2;
+		}
+		else {
+			memcpy(tokens->text, at, header.text_bytes);
+			tokens->text_length = tokens->text_capacity = header.text_bytes;
+		}
+		at += header.text_bytes;
+	}
+	
+	// 이름 번호와 text 위치, 기계어 목록 번호가 범위 안에 있는지 확인
+	for(int i=0;i<n && err>=0;i++){
+		if(tokens->label[i] > header.names || tokens->operator[i] > header.names ||
+		   tokens->file[i] > header.names ||
+		   tokens->opcode[i] < -1 || tokens->opcode[i] >= inst_table_length ||
+		   tokens->operand[i] >= header.text_bytes ||
+		   tokens->comment[i] >= header.text_bytes){
+			err = snapshot_reject(diags, "%d번째 토큰의 이름, 문자열 위치나 기계어 "
+								  "번호가 범위를 벗어납니다.", i + 1);
+			break;
+		}
+		tokens->label[i] = ids[tokens->label[i]];
+		tokens->operator[i] = ids[tokens->operator[i]];
+		tokens->file[i] = ids[tokens->file[i]];
+		
+		// operand 문자열들이 모두 text 안에 있어야 token_store_get이 안전함
+		int operands = tokens->operands[i] & ~TOKEN_STORE_NAMES;
+		if(!(tokens->operands[i] & TOKEN_STORE_NAMES) &&
+		   operands > MAX_OPERAND_PER_INST){
+			err = snapshot_reject(diags, "%d번째 토큰의 operand 수(%d)가 범위를 "
+								  "벗어납니다.", i + 1, operands);
+			break;
+		}
+		size_t offset = tokens->operand[i];
+		for(int k=0;k<operands && err>=0;k++){
+			if(offset==0 || offset >= header.text_bytes){
+				err = snapshot_reject(diags, "%d번째 토큰의 operand 위치가 범위를 "
+									  "벗어납니다.", i + 1);
+			}
+			else offset += strlen(tokens->text + offset) + 1;
+		}
+		tokens->length++;
+		if(err>=0)err = snapshot_check_line(inst_table, tokens, i, diags);
+	}
+	
+	for(uint32_t i=0;i<header.symbols && err>=0;i++){
+		symbol *sym = (symbol*)malloc(sizeof(symbol));
+		if(sym==NULL){
+			err = -2;
+			break;
+		}
+		memcpy(sym, at, sizeof(symbol));
+		at += sizeof(symbol);
+		symbol_table[(*symbol_table_length)++] = sym;
+		if(sym->name > header.names || sym->base > header.names){
+			err = snapshot_reject(diags, "%u번째 심볼의 이름이 범위를 벗어납니다.",
+								  i + 1);
+			break;
+		}
+		sym->name = ids[sym->name];
+		sym->base = ids[sym->base];
+	}
+	for(uint32_t i=0;i<header.literals && err>=0;i++){
+		literal *lit = (literal*)malloc(sizeof(literal));
+		if(lit==NULL){
+			err = -2;
+			break;
+		}
+		memcpy(lit, at, sizeof(literal));
+		at += sizeof(literal);
+		literal_table[(*literal_table_length)++] = lit;
+		if(lit->base > header.names || lit->size < 0 ||
+		   lit->size > (int)sizeof(lit->value) ||
+		   memchr(lit->literal, '\0', sizeof(lit->literal))==NULL){
+			err = snapshot_reject(diags, "%u번째 리터럴이 손상되었습니다.", i + 1);
+			break;
+		}
+		lit->base = ids[lit->base];
+	}
+	
+	free(ids);
+	return err;
+}
+
+/**
+ * @brief make_pass1_snapshot으로 쓴 스냅샷 파일을 mmap하여 pass 1의 결과를
+ * 복원한다.
+ *
+ * @param snapshot_dir 스냅샷 파일 경로
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param tokens 비어 있는 토큰 테이블 주소
+ * @param symbol_table 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param diags 읽지 않는 이유를 기록할 오류 목록 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 필드별 배열을 그대로 복사하므로 소스코드를 다시 토큰으로 나누지 않는다.
+ * 컴파일된 수식은 비어 있으므로 pass 2 전에 compile_expressions를 호출해야 한다.
+ */
+int load_pass1_snapshot(const char *snapshot_dir, const inst *inst_table[],
+						int inst_table_length, token_store *tokens,
+						symbol *symbol_table[], int *symbol_table_length,
+						literal *literal_table[], int *literal_table_length,
+						diag_list *diags) {
+	struct stat st;
+	
+	*symbol_table_length = 0;
+	*literal_table_length = 0;
+	
+	int fd = open(snapshot_dir, O_RDONLY);
+	if(fd<0)return -1;
+	if(fstat(fd, &st)<0 || st.st_size < (off_t)sizeof(snapshot_header)){
+		close(fd);
+		return -1;
+	}
+	
+	char *map = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map==MAP_FAILED)return -1;
+	
+	int err = parse_pass1_snapshot(map, st.st_size, inst_table,
+								   inst_table_length, tokens, symbol_table,
+								   symbol_table_length, literal_table,
+								   literal_table_length, diags);
+	munmap(map, st.st_size);
+	return err;
+}
+
+/**
+ * @brief 오브젝트 코드 리스트 전체를 해제한다.
+ *
+ * @param obj_code 리스트의 첫 번째 라인 주소, 혹은 NULL
+ */
+void object_code_free(object_code *obj_code) {
+	while(obj_code != NULL){
+		object_code *next = obj_code->next;
+		free(obj_code);
+		obj_code = next;
+	}
+}
+
+/**
+ * @brief 기계어 목록 파일(inst_table.txt)을 읽어 기계어 목록
+ * 테이블(inst_table)을 생성한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 시작 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이를 저장하는 변수 주소
+ * @param inst_table_dir 기계어 목록 파일 경로
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 기계어 목록 파일(inst_table.txt)을 읽어 기계어 목록 테이블(inst_table)을
+ * 생성한다. 기계어 목록 파일 형식은 자유롭게 구현한다. 예시는 다음과 같다.
+ *    ==============================================================
+ *           | 이름 | 형식 | 기계어 코드 | 오퍼랜드의 갯수 | \n |
+ *    ==============================================================
+ */
+int init_inst_table(inst *inst_table[], int *inst_table_length,
+					const char *inst_table_dir) {
+	FILE *fp;
+	// 읽기 권한으로 파일입출력을 시작함
+	fp = fopen(inst_table_dir, "r");
+	int err = 0;
+	
+	// 파일입출력이 정상적이지 않았을 때 error
+	if(fp==NULL){
+		return err = -1;
+	}
+	
+	// 아무 입력도 받지 않은 상태에서 0으로 초기화
+	*inst_table_length = 0;
+	
+	// inst 구조체를 이용해 input 변수 생성
+	inst input;
+	
+	while(!feof(fp)){
+		// 파일에서 데이터를 가져옴
+		memset(&input, 0, sizeof(input));
+		fscanf(fp, "%9s\t%d\t%hhx\t%d\n", input.str, &input.format, &input.op, &input.ops);
+		
+		// 현재 입력받은 instruction의 수가 최대 instruction의 수보다 많을 때 error
+		if(*inst_table_length >= MAX_INST_TABLE_LENGTH){
+			fclose(fp);
+			return err = -10001;
+		}
+		
+		// 입력받은 format이 3개 이상일 때 error
+		if(input.format>99){
+			fclose(fp);
+			return err = -10002;
+		}
+		// 입력받은 format이 2개일 때
+		if(input.format>9){
+			// 같은 타입이면 error
+			if(input.format/10 == input.format%10){
+				fclose(fp);
+				return err = -10003;
+			}
+			// 첫번째 형식이 1~4형식이 아니라면 error
+			if(input.format/10 > 4 || input.format/10 < 1){
+				fclose(fp);
+				return err = -10004;
+			}
+			// 두번째 형식이 1~4형식이 아니라면 error
+			if(input.format%10 > 4 || input.format%10 < 1){
+				fclose(fp);
+				return err = -10005;
+			}
+		}
+		else {
+			if(input.format > 4 || input.format < 1){
+				fclose(fp);
+				return err = -10006;
+			}
+		}
+		// 입력받은 opcode가 4의 배수가 아닐 때 error
+		if(input.op % 4 != 0){
+			fclose(fp);
+			return err = -10007;
+		}
+		
+		// 입력받은 operand의 수가 음수일 때 또는 operand 수가 최대 operand 수를 넘어갈 때 error
+		if(input.ops < 0 || MAX_OPERAND_PER_INST < input.ops){
+			fclose(fp);
+			return err = -10008;
+		}
+		
+		// instruction table에 입력받은 값을 저장하기 위해 동적할당
+		inst_table[*inst_table_length] = (inst*)calloc(1, sizeof(inst));
+		
+		// 동적할당에 실패했을 때 error
+		if(inst_table[*inst_table_length] == NULL){
+			fclose(fp);
+			return err = -2;
+		}
+		
+		// 할당한 공간에 입력받은 데이터를 복사함
+		memcpy(inst_table[*inst_table_length], &input, sizeof(inst));
+		// inst_table_length의 값을 1 증가 함
+		*inst_table_length += 1;
+		
+	}
+	// 파일 입출력을 종료함
+	fclose(fp);
+
+	// 정상종료 시 0을 반환함
+	return err;
+}
+
+/**
+ * @brief SIC/XE 소스코드 파일(input.txt)을 읽어 소스코드 테이블(input)을
+ * 생성한다.
+ *
+ * @param input 할당한 소스코드 테이블 주소를 저장할 변수 주소
+ * @param input_length 소스코드 테이블의 길이를 저장하는 변수 주소
+ * @param input_dir 소스코드 파일 경로
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int init_input(char ***input, int *input_length, const char *input_dir) {
+	char *source = NULL;
+	size_t source_length = 0;
+	int err = 0;
+	
+	// 파일 전체를 읽은 뒤 메모리에서 라인 단위로 나눔
+	if((err = read_file(input_dir, &source, &source_length)) < 0){
+		return err;
+	}
+	err = init_input_buffer(input, input_length, source, source_length, NULL);
+	free(source);
+	
+	// 오류가 없다면 0을 반환
+	return err;
+}
+
+/**
+ * @brief 메모리에 있는 SIC/XE 소스코드를 라인 단위로 나누어 소스코드
+ * 테이블(input)을 생성한다.
+ *
+ * @param input 할당한 소스코드 테이블 주소를 저장할 변수 주소
+ * @param input_length 소스코드 테이블의 길이를 저장하는 변수 주소
+ * @param source 소스코드 버퍼 ('\0'으로 끝날 필요 없음)
+ * @param source_length 소스코드 버퍼의 바이트 수
+ * @param diags 오류를 기록할 목록 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 각 라인의 '\n'은 제거한다. 소스코드 테이블은 라인 수를 먼저 세어 한 번에
+ * 할당하므로 라인 수에는 제한이 없다. 실패한 경우에도 `*input`과
+ * `*input_length`에는 지금까지 할당한 라인들이 남아 있으므로 호출자가 해제할 수
+ * 있다. 토큰 파싱 버퍼의 크기에 맞춰 MAX_LINE_LENGTH - 1자를 넘는 라인은 그 줄의
+ * 오류로 기록하고 실패한다.
+ */
+int init_input_buffer(char ***input, int *input_length, const char *source,
+					  size_t source_length, diag_list *diags) {
+	const char *end = source + source_length;
+	const char *line = source;
+	size_t lines = 0;
+	
+	*input = NULL;
+	*input_length = 0;
+	
+	// 라인 수를 세어 테이블을 한 번에 할당
+	for(const char *c = source;c < end;c++){
+		if(*c=='\n')lines++;
+	}
+	if(source_length > 0 && end[-1]!='\n')lines++;
+	if(lines >= INT_MAX)return -1;
+	*input = (char**)calloc(lines + 1, sizeof(char*));
+	if(*input==NULL)return -2;
+	
+	while(line < end){
+		// 다음 '\n'까지가 한 라인, 없다면 버퍼의 끝까지
+		const char *next = memchr(line, '\n', end - line);
+		size_t len = (next != NULL ? next : end) - line;
+		
+		// 입력받은 라인이 최대 길이를 넘어가면 그 줄의 오류
+		if(len >= MAX_LINE_LENGTH){
+			int err = diag_add(diags, NAME_NONE, *input_length + 1,
+							   MAX_LINE_LENGTH, "라인이 %d자를 넘습니다.",
+							   MAX_LINE_LENGTH - 1);
+			return err < 0 ? err : -1;
+		}
+		
+		// 크기에 맞게 동적할당
+		(*input)[*input_length] = (char*)calloc(1, len + 1);
+		if((*input)[*input_length]==NULL){
+			return -2;
+		}
+		memcpy((*input)[*input_length], line, len);
+		*input_length += 1;
+		
+		if(next == NULL)break;
+		line = next + 1;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 파일 전체를 새로 할당한 버퍼로 읽는다.
+ *
+ * @param dir 읽을 파일 경로
+ * @param data 할당한 버퍼 주소를 저장할 변수 주소 ('\0'으로 끝남)
+ * @param length 읽은 바이트 수를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int read_file(const char *dir, char **data, size_t *length) {
+	FILE *fp = fopen(dir, "rb");
+	long size;
+	
+	if(fp == NULL){
+		return -1;
+	}
+	if(fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+	   fseek(fp, 0, SEEK_SET) != 0){
+		fclose(fp);
+		return -1;
+	}
+	
+	*data = (char*)malloc(size + 1);
+	if(*data == NULL){
+		fclose(fp);
+		return -2;
+	}
+	*length = fread(*data, 1, size, fp);
+	(*data)[*length] = '\0';
+	fclose(fp);
+	
+	return 0;
+}
+
+/**
+ * @brief 파일에서 한 라인을 읽는다.
+ *
+ * @param fp 읽기 권한으로 열린 파일
+ * @param line 라인을 저장할 버퍼 ('\n'은 제거됨)
+ * @param line_size 버퍼의 크기
+ * @return 읽은 경우 1, 파일의 끝인 경우 0, 오류가 발생한 경우 음수
+ *
+ * @details
+ * init_input_buffer와 같이 MAX_LINE_LENGTH - 1자를 넘는 라인은 오류로 처리한다.
+ */
+int read_line(FILE *fp, char *line, int line_size) {
+	if(fgets(line, line_size, fp)==NULL)return ferror(fp) ? -1 : 0;
+	
+	size_t len = strlen(line);
+	if(len > 0 && line[len-1]=='\n'){
+		line[--len] = '\0';
+	}
+	// 버퍼가 가득 찼는데 아직 라인이 끝나지 않은 경우
+	else if(!feof(fp)){
+		return -1;
+	}
+	if(len >= MAX_LINE_LENGTH)return -1;
+	
+	return 1;
+}
+
+/**
+ * @brief 어셈블리 코드을 위한 패스 1 과정을 수행한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param input 소스코드 테이블의 주소
+ * @param input_length 소스코드 테이블의 길이
+ * @param tokens 비어 있는 토큰 테이블 주소
+ * @param symbol_table 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 어셈블리 코드를 위한 패스1 과정을 수행하는 함수이다. 패스 1에서는 프로그램
+ * 소스를 스캔하여 해당하는 토큰 단위로 분리하여 프로그램 라인별 토큰 테이블을
+ * 생성한다. 토큰 테이블은 token_parsing 함수를 호출하여 설정하여야 한다. 또한,
+ * assem_pass2 과정에서 사용하기 위한 심볼 테이블 및 리터럴 테이블을 생성한다.
+ */
+int assem_pass1(const inst *inst_table[], int inst_table_length,
+				const char *input[], int input_length, token_store *tokens,
+				symbol *symbol_table[],
+				int *symbol_table_length, literal *literal_table[],
+				int *literal_table_length, diag_list *diags) {
+	// 길이를 0으로 초기화
+	*symbol_table_length = 0;
+	*literal_table_length = 0;
+	
+	// 소스코드를 토큰으로 나누면서 매크로를 정의하고 확장함
+	int err = tokenize_input(inst_table, inst_table_length, input, input_length,
+							 tokens, diags);
+	if(err<0)return err;
+	
+	return assem_pass1_tokens(inst_table, inst_table_length, tokens,
+							  symbol_table, symbol_table_length, literal_table,
+							  literal_table_length, diags);
+}
+
+/**
+ * @brief 토큰 테이블에 주소를 배정하고 심볼 테이블과 리터럴 테이블을 만든다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param tokens 토큰 테이블 주소 (수식은 컴파일되어 있지 않아야 함)
+ * @param symbol_table 비어 있는 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 비어 있는 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 토큰으로 나눈 뒤의 pass 1이다. 라인의 nixbpe는 여러 번 계산해도 같으므로
+ * peephole 최적화로 라인을 지운 토큰 테이블에 다시 수행할 수 있다.
+ */
+int assem_pass1_tokens(const inst *inst_table[], int inst_table_length,
+					   token_store *tokens, symbol *symbol_table[],
+					   int *symbol_table_length, literal *literal_table[],
+					   int *literal_table_length, diag_list *diags) {
+	pass1_state st;
+	int err;
+	
+	memset(&st, 0, sizeof(st));
+	st.inst_table = inst_table;
+	st.inst_table_length = inst_table_length;
+	st.symbol_table = symbol_table;
+	st.symbol_table_length = symbol_table_length;
+	st.literal_table = literal_table;
+	st.literal_table_length = literal_table_length;
+	st.diags = diags;
+	
+	err = assem_pass1_lines(&st, tokens);
+	extref_set_free(&st.labels);
+	if(err < 0)return err;
+	
+	// 모든 심볼의 위치가 정해졌으므로 수식을 컴파일하고 EQU 값을 계산
+	return resolve_expressions(inst_table, inst_table_length, tokens,
+							   symbol_table, *symbol_table_length, diags);
+}
+
+/**
+ * @brief 토큰 테이블의 라인들에 대해 pass 1을 수행한다.
+ *
+ * @param st 이전 라인들까지의 pass 1 상태 주소
+ * @param tokens 처리할 토큰 테이블 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 라인마다 주소와 nixbpe, 기계어 목록 테이블 번호를 토큰 테이블에 기록하고
+ * 심볼과 리터럴을 테이블에 추가한다. control section 이름과 Location Counter는
+ * `st`에 남으므로 토큰 테이블을 나누어 차례로 호출할 수 있다.
+ */
+int assem_pass1_lines(pass1_state *st, token_store *tokens) {
+	const inst **inst_table = st->inst_table;
+	int inst_table_length = st->inst_table_length;
+	symbol **symbol_table = st->symbol_table;
+	int *symbol_table_length = st->symbol_table_length;
+	literal **literal_table = st->literal_table;
+	int *literal_table_length = st->literal_table_length;
+	
+	// Pass 1 과정에서 필요한 임시변수들을 선언
+	inst tmp_inst;
+	token tmp_token;
+	symbol tmp_symbol;
+	literal tmp_literal;
+	name_id tmp_base = st->base;
+	int inst_index = 0;
+	char message[MAX_DIAG_MESSAGE];
+	int field = 0;
+	int err = 0;
+	
+	// opcode의 format을 저장하는 변수
+	int format1=0, format2=0;
+	
+	// Location Counter를 이어서 사용
+	int location_counter = st->location_counter;
+	
+	for(int i=0;i<tokens->length;i++){
+		// Pass 1과정을 진행하기 위한 정보들을 수집
+		token_store_get(tokens, i, &tmp_token);
+		if(tmp_token.operator!=NULL){
+			inst_index = search_opcode(tmp_token.operator, inst_table, inst_table_length);
+			// pass 2에서 다시 찾지 않도록 기록
+			tokens->opcode[i] = inst_index;
+			if(inst_index!=-1){
+				memset(&tmp_inst, 0, sizeof(tmp_inst));
+				tmp_inst = *inst_table[inst_index];
+			}
+		}
+			
+		
+		// 라인 주석인 경우 Pass 1과정에서 필요없으니 건너뜀
+		if(tmp_token.label==NULL && tmp_token.operator==NULL){
+			continue;
+		}
+		
+		// 잘못된 라인은 오류로 기록하고 심볼 없이 건너뜀
+		if(pass1_check_line(&tmp_token, inst_index, message, sizeof(message),
+							&field)){
+			if((err = diag_token(st->diags, tokens, i,
+								 token_column(&tmp_token, field), "%s",
+								 message)) < 0){
+				return err;
+			}
+			continue;
+		}
+		// 오브젝트 코드에 들어가지 않는 이름은 오류로 기록하고 라인은 계속 처리
+		if(pass1_check_names(&tmp_token, message, sizeof(message), &field) &&
+		   (err = diag_token(st->diags, tokens, i,
+							 token_column(&tmp_token, field), "%s",
+							 message)) < 0){
+			return err;
+		}
+		// 2형식의 잘못된 operand는 그 operand의 열로 기록
+		if(inst_index!=-1 && tmp_inst.format==2 &&
+		   pass1_check_format2(&tmp_token, &tmp_inst, message, sizeof(message),
+							   &field)){
+			int column = token_column(&tmp_token, 2);
+			for(int k=0;k<field;k++){
+				column += strlen(tmp_token.operand[k]) + 1;
+			}
+			if((err = diag_token(st->diags, tokens, i, column, "%s",
+								 message)) < 0){
+				return err;
+			}
+		}
+		
+		// Location Counter를 START의 operand[0]로 지정
+		if(!strcmp(tmp_token.operator, "START")){
+			location_counter = atoi(tmp_token.operand[0]);
+			tmp_base = tmp_token.label_id;
+			extref_set_clear(&st->labels);
+		}
+		// CSECT를 만났을 경우
+		if(!strcmp(tmp_token.operator, "CSECT")){
+			// 이전 control section에서 LTORG 이후 남은 리터럴들을 먼저 할당
+			if(place_literal_pool(literal_table, *literal_table_length,
+								  &location_counter) < 0){
+				return -2;
+			}
+			tmp_base = tmp_token.label_id;
+			location_counter = 0;
+			extref_set_clear(&st->labels);
+		}
+		
+		// 수식의 '*'와 이후 과정을 위해 이 라인의 주소를 기록
+		tokens->addr[i] = tmp_token.addr = location_counter;
+		
+		// 같은 control section에 이미 정의된 label은 오류로 기록하고 처음 정의를 유지
+		int duplicate = tmp_token.label!=NULL &&
+						extref_set_contains(&st->labels, tmp_token.label_id);
+		if(duplicate &&
+		   (err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 0),
+							 "심볼 '%s'이(가) 이미 정의되어 있습니다.",
+							 tmp_token.label)) < 0){
+			return err;
+		}
+		
+		// Label이 존재하는 경우 SYMTAB에 저장
+		if(tmp_token.label!=NULL && !duplicate){
+			memset(&tmp_symbol, 0, sizeof(tmp_symbol));
+			tmp_symbol.name = tmp_token.label_id;
+			if(!strcmp(tmp_token.operator, "EQU")){
+				tmp_symbol.addr = -1;
+			}
+			else tmp_symbol.addr = location_counter;
+			tmp_symbol.base = tmp_base;
+			tmp_symbol.line = i;
+			// 심볼 테이블이 가득 차면 더 진행할 수 없으므로 오류를 남기고 멈춤
+			if(*symbol_table_length >= MAX_TABLE_LENGTH){
+				diag_token(st->diags, tokens, i, token_column(&tmp_token, 0),
+						   "심볼 테이블이 가득 찼습니다. (최대 %d개)",
+						   MAX_TABLE_LENGTH);
+				return -1;
+			}
+			symbol_table[*symbol_table_length] = (symbol*)calloc(1, sizeof(symbol));
+			if(symbol_table[*symbol_table_length]==NULL)return -2;
+			memcpy(symbol_table[(*symbol_table_length)++], &tmp_symbol, sizeof(tmp_symbol));
+			if((err = extref_set_add(&st->labels, tmp_token.label_id)) < 0)return err;
+		}
+		
+		// Location Counter를 증가시키는 로직
+		// 1~4형식을 사용하는 instruction인 경우
+		if(tmp_token.operator!=NULL && inst_index != -1){
+			// format1과 2를 가져온다.
+			// 1, 2형식인 경우 format1 = 0, format2는 1 또는 2이다.
+			// 3, 4형식인 경우 format1 = 3, format2는 4이다.
+			format1 = tmp_inst.format/10;
+			format2 = tmp_inst.format%10;
+			
+			if(format2==1)location_counter += 1;
+			else if(format2==2)location_counter += 2;
+			// 4형식을 지원하는 명령어가 실제로 4형식인지 확인
+			else if(format2==4 && *tmp_token.operator == '+'){
+				location_counter += 4;
+				// nixbpe 중 e 비트를 1로 채움
+				tmp_token.nixbpe |= 49;
+			}
+			else if(format1==3){
+				location_counter += 3;
+				// ni 비틀를 1로 채움 immediate는 나중에 고려
+				tmp_token.nixbpe |= 48;
+				// pc 비트를 1로 채움
+				tmp_token.nixbpe |= 2;
+			}
+		}
+		// operator과 "WORD", "RESW", "RESB", "BYTE" 인 경우
+		else if(!strcmp(tmp_token.operator, "WORD")){
+			location_counter += 3;
+		}
+		else if(!strcmp(tmp_token.operator, "RESW")){
+			location_counter += 3 * atoi(tmp_token.operand[0]);
+		}
+		else if(!strcmp(tmp_token.operator, "RESB")){
+			location_counter += atoi(tmp_token.operand[0]);
+		}
+		else if(!strcmp(tmp_token.operator, "BYTE")){
+			// 'X' 또는 'C'와 따옴표 2개의 길이를 뺀 실제 operand의 길이
+			if(*(tmp_token.operand[0])=='X'){
+				location_counter += (strlen(tmp_token.operand[0]) - 3)/2;
+			}
+			else {
+				location_counter += strlen(tmp_token.operand[0]) - 3;
+			}
+		}
+		// BASE, NOBASE인 경우
+		// Location Counter는 변하지 않고 b비트는 pass 2에서 displacement를 보고 결정
+		else if(!strcmp(tmp_token.operator, "BASE") ||
+				!strcmp(tmp_token.operator, "NOBASE")){
+			continue;
+		}
+		// EQU인 경우 (label과 operand는 pass1_check_line에서 확인, 중복된 label은
+		// 심볼이 없으므로 건너뜀)
+		else if(!strcmp(tmp_token.operator, "EQU")){
+			if(duplicate)continue;
+			if(!strcmp(tmp_token.operand[0], "*")){
+				symbol_table[*symbol_table_length - 1]->addr = location_counter;
+			}
+			// 수식을 사용하는 EQU는 모든 심볼이 정의된 뒤에 계산
+			else {
+				symbol_table[*symbol_table_length - 1]->pending = 1;
+			}
+		}
+		
+		
+		
+		// LTORG를 만나거나 END를 만났을 경우
+		if(!strcmp(tmp_token.operator, "LTORG") || !strcmp(tmp_token.operator, "END")){
+			// 할당되어 있지 않은 리터럴들을 하나의 pool로 묶어 할당
+			if(place_literal_pool(literal_table, *literal_table_length,
+								  &location_counter) < 0){
+				return -2;
+			}
+		}
+		
+		// operand가 '='로 시작하여 Literal을 의미하는 경우
+		if(tmp_token.operand[0]==NULL)continue;
+		if(*tmp_token.operand[0]=='='){
+			memset(&tmp_literal, 0, sizeof(tmp_literal));
+			if(strlen(tmp_token.operand[0]) >= sizeof(tmp_literal.literal)){
+				if((err = diag_token(st->diags, tokens, i,
+									 token_column(&tmp_token, 2),
+									 "리터럴 '%s'이(가) %d자를 넘습니다.",
+									 tmp_token.operand[0],
+									 (int)sizeof(tmp_literal.literal) - 1)) < 0){
+					return err;
+				}
+				continue;
+			}
+			// 같은 control section에 이미 같은 리터럴이 있는지 확인
+			// (이전 pool의 리터럴은 이 라인에서 닿을 수 있는 경우에만 사용)
+			int flag = 0;
+			for(int k=0;k<*literal_table_length;k++){
+				if(literal_table[k]->base==tmp_base &&
+				   !strcmp(literal_table[k]->literal, tmp_token.operand[0]) &&
+				   (literal_table[k]->addr==-1 ||
+					literal_reachable(literal_table[k], tmp_token.nixbpe,
+									  location_counter)))
+				   flag = 1;
+			}
+			if(!flag){
+				strncpy(tmp_literal.literal, tmp_token.operand[0], strlen(tmp_token.operand[0]));
+				tmp_literal.base = tmp_base;
+				tmp_literal.addr = -1;
+				tmp_literal.size = literal_encode(tmp_literal.literal, tmp_literal.value);
+				if(tmp_literal.size < 0){
+					if((err = diag_token(st->diags, tokens, i,
+										 token_column(&tmp_token, 2),
+										 "리터럴 '%s'의 형식이 잘못되었습니다. "
+										 "(=C'...', =X'...' 또는 =정수)",
+										 tmp_token.operand[0])) < 0){
+						return err;
+					}
+					continue;
+				}
+				// 이전 pool에 같은 값을 가진 리터럴이 있고 이 라인에서 닿는다면
+				// 그 주소를 공유 (닿지 않으면 다음 pool에 새로 배치)
+				for(int k=0;k<*literal_table_length;k++){
+					if(literal_table[k]->addr!=-1 &&
+					   literal_reachable(literal_table[k], tmp_token.nixbpe,
+										 location_counter) &&
+					   literal_table[k]->size==tmp_literal.size &&
+					   literal_table[k]->base==tmp_base &&
+					   !memcmp(literal_table[k]->value, tmp_literal.value, tmp_literal.size)){
+						tmp_literal.addr = literal_table[k]->addr;
+						tmp_literal.skip = tmp_literal.size;
+						break;
+					}
+				}
+				if(*literal_table_length >= MAX_TABLE_LENGTH){
+					diag_token(st->diags, tokens, i, token_column(&tmp_token, 2),
+							   "리터럴 테이블이 가득 찼습니다. (최대 %d개)",
+							   MAX_TABLE_LENGTH);
+					return -1;
+				}
+				literal_table[*literal_table_length] = (literal*)calloc(1, sizeof(literal));
+				if(literal_table[*literal_table_length]==NULL){
+					return -2;
+				}
+				memcpy(literal_table[(*literal_table_length)++], &tmp_literal, sizeof(tmp_literal));
+			}
+		}
+		
+		// nixbpe를 설정
+		for(int k=0;k<MAX_OPERAND_PER_INST && tmp_token.operand[k]!=NULL;k++){
+			// X 레지스터를 사용하는지 확인
+			if(!strcmp(tmp_token.operand[k], "X")){
+				tmp_token.nixbpe |= 8;
+			}
+			// immediate인지 확인
+			if(*tmp_token.operand[k] == '#'){
+				// 4형식인 경우 e비트는 유지
+				tmp_token.nixbpe &= 17;
+			}
+			if(*tmp_token.operand[k] == '@'){
+				tmp_token.nixbpe &= 32;
+				tmp_token.nixbpe |= 2;
+			}
+		}
+		
+		// 갱신한 nixbpe값을 저장
+		tokens->nixbpe[i] = tmp_token.nixbpe;
+	}
+	
+	st->base = tmp_base;
+	st->location_counter = location_counter;
+	return 0;
+}
+
+/**
+ * @brief pass 1에서 라인의 operator와 필수 필드가 올바른지 확인한다.
+ *
+ * @param tok 확인할 토큰 주소 (label 또는 operator가 있는 라인)
+ * @param inst_index 기계어 목록 테이블 번호 (지시어는 -1)
+ * @param message 오류 내용을 저장할 버퍼
+ * @param message_size 버퍼의 크기
+ * @param field 오류가 있는 필드 번호를 저장할 변수 주소
+ * @return 오류가 있으면 1, 없으면 0
+ *
+ * @details
+ * 이전에는 확인하지 않아 잘못 계산되거나 NULL을 참조하던 라인들을 미리 걸러낸다.
+ */
+int pass1_check_line(const token *tok, int inst_index, char *message,
+					 int message_size, int *field) {
+	// 지시어와 각각 label, operand가 필요한지 여부
+	static const struct {
+		const char *name;
+		int label;
+		int operand;
+	} directives[] = {
+		{"START", 1, 1}, {"END", 0, 0}, {"CSECT", 1, 0}, {"EXTDEF", 0, 0},
+		{"EXTREF", 0, 0}, {"WORD", 0, 1}, {"RESW", 0, 1}, {"RESB", 0, 1},
+		{"BYTE", 0, 1}, {"BASE", 0, 1}, {"NOBASE", 0, 0}, {"EQU", 1, 1},
+		{"LTORG", 0, 0},
+	};
+	const char *operator = tok->operator;
+	const char *operand = tok->operand[0];
+	int d = 0;
+	
+	if(operator==NULL){
+		*field = 1;
+		snprintf(message, message_size, "label '%s' 뒤에 operator가 없습니다.",
+				 tok->label);
+		return 1;
+	}
+	if(inst_index!=-1)return 0;
+	
+	while(d < (int)(sizeof(directives) / sizeof(directives[0])) &&
+		  strcmp(directives[d].name, operator)){
+		d++;
+	}
+	if(d==(int)(sizeof(directives) / sizeof(directives[0]))){
+		*field = 1;
+		snprintf(message, message_size, "알 수 없는 operator '%s'입니다.",
+				 operator);
+		return 1;
+	}
+	if(directives[d].label && tok->label==NULL){
+		*field = 0;
+		snprintf(message, message_size, "%s에는 label이 필요합니다.", operator);
+		return 1;
+	}
+	if(directives[d].operand && operand==NULL){
+		*field = 2;
+		snprintf(message, message_size, "%s에는 operand가 필요합니다.", operator);
+		return 1;
+	}
+	
+	*field = 2;
+	// 시작 주소와 예약 크기는 10진수
+	if(!strcmp(operator, "START") || !strcmp(operator, "RESW") ||
+	   !strcmp(operator, "RESB")){
+		const char *p = operand;
+		while(*p>='0' && *p<='9')p++;
+		if(p==operand || *p!='\0'){
+			snprintf(message, message_size,
+					 "%s의 operand '%s'은(는) 10진수여야 합니다.", operator,
+					 operand);
+			return 1;
+		}
+	}
+	// BYTE는 C'...' 또는 짝수 자리의 X'...'
+	if(!strcmp(operator, "BYTE")){
+		size_t len = strlen(operand);
+		int valid = len >= 3 && (*operand=='C' || *operand=='X') &&
+					operand[1]=='\'' && operand[len-1]=='\'';
+		if(valid && *operand=='X'){
+			valid = (len - 3) % 2 == 0;
+			for(size_t k=2;k<len-1 && valid;k++){
+				valid = hex_digit(operand[k]) >= 0;
+			}
+		}
+		if(!valid){
+			snprintf(message, message_size,
+					 "BYTE의 operand '%s'의 형식이 잘못되었습니다. "
+					 "(C'...' 또는 짝수 자리의 X'...')", operand);
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief control section 이름과 EXTDEF, EXTREF의 이름이 오브젝트 코드에 들어가는지
+ * 확인한다.
+ *
+ * @param tok 확인할 토큰 주소 (pass1_check_line을 통과한 라인)
+ * @param message 오류 내용을 저장할 버퍼
+ * @param message_size 버퍼의 크기
+ * @param field 오류가 있는 필드 번호를 저장할 변수 주소
+ * @return 오류가 있으면 1, 없으면 0
+ *
+ * @details
+ * H, D, R, M 레코드는 이름을 6자리 필드로 기록하므로 MAX_EXTERNAL_NAME자를 넘는
+ * 이름은 오류이다. 라인 자체는 올바르므로 pass 1은 오류를 기록한 뒤에도 라인을
+ * 처리하여 뒤따르는 오류가 생기지 않게 한다.
+ */
+int pass1_check_names(const token *tok, char *message, int message_size,
+					  int *field) {
+	const char *operator = tok->operator;
+	
+	if((!strcmp(operator, "START") || !strcmp(operator, "CSECT")) &&
+	   strlen(tok->label) > MAX_EXTERNAL_NAME){
+		*field = 0;
+		snprintf(message, message_size,
+				 "control section 이름 '%s'은(는) %d자를 넘을 수 없습니다.",
+				 tok->label, MAX_EXTERNAL_NAME);
+		return 1;
+	}
+	if(!strcmp(operator, "EXTDEF") || !strcmp(operator, "EXTREF")){
+		const char *name = tok->names;
+		for(int k=0;k<tok->names_length;k++, name += strlen(name) + 1){
+			if(strlen(name) <= MAX_EXTERNAL_NAME)continue;
+			*field = 2;
+			snprintf(message, message_size,
+					 "%s의 이름 '%s'은(는) %d자를 넘을 수 없습니다.", operator,
+					 name, MAX_EXTERNAL_NAME);
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 레지스터 이름의 번호를 구한다.
+ *
+ * @param name 레지스터 이름
+ * @return 레지스터 번호 (레지스터가 아니면 -1)
+ */
+int register_number(const char *name) {
+	static const char *registers[] = {
+		"A", "X", "L", "B", "S", "T", "F", "", "PC", "SW",
+	};
+	
+	if(name==NULL || *name=='\0')return -1;
+	for(int r=0;r<(int)(sizeof(registers) / sizeof(registers[0]));r++){
+		if(!strcmp(registers[r], name))return r;
+	}
+	return -1;
+}
+
+/**
+ * @brief 2형식 명령어의 operand 하나를 오브젝트 코드의 4비트 값으로 바꾼다.
+ *
+ * @param operator 명령어 이름
+ * @param k operand 번호 (0 또는 1)
+ * @param operand operand 문자열
+ * @return 4비트 값 (올바르지 않은 operand이면 -1)
+ *
+ * @details
+ * SVC의 operand는 0~15의 수를 그대로, SHIFTL과 SHIFTR의 두 번째 operand는
+ * 1~16의 수에서 1을 뺀 값으로 기록한다. 나머지는 레지스터 번호이다.
+ */
+int format2_operand(const char *operator, int k, const char *operand) {
+	int svc = !strcmp(operator, "SVC");
+	int shift = k==1 && (!strcmp(operator, "SHIFTL") ||
+						 !strcmp(operator, "SHIFTR"));
+	const char *p = operand;
+	int n = 0;
+	
+	if(!svc && !shift)return register_number(operand);
+	while(*p>='0' && *p<='9' && n <= 16){
+		n = n * 10 + (*p++ - '0');
+	}
+	if(p==operand || *p!='\0')return -1;
+	if(svc)return n <= 15 ? n : -1;
+	return n>=1 && n<=16 ? n - 1 : -1;
+}
+
+/**
+ * @brief 2형식 명령어의 operand 개수와 각 operand를 확인한다.
+ *
+ * @param tok 확인할 토큰 주소 (2형식 명령어 라인)
+ * @param in 명령어 정보 주소
+ * @param message 오류 내용을 저장할 버퍼
+ * @param message_size 버퍼의 크기
+ * @param operand 오류가 있는 operand 번호를 저장할 변수 주소
+ * @return 오류가 있으면 1, 없으면 0
+ *
+ * @details
+ * 이전에는 알 수 없는 레지스터를 A(0)로 기록하였다. 라인의 크기는 변하지 않으므로
+ * pass 1은 오류를 기록한 뒤에도 라인을 처리한다.
+ */
+int pass1_check_format2(const token *tok, const inst *in, char *message,
+						int message_size, int *operand) {
+	int count = 0;
+	
+	while(count < MAX_OPERAND_PER_INST && tok->operand[count]!=NULL)count++;
+	if(count!=in->ops){
+		*operand = count < in->ops ? 0 : in->ops;
+		snprintf(message, message_size, "%s에는 operand가 %d개 필요합니다.",
+				 tok->operator, in->ops);
+		return 1;
+	}
+	for(int k=0;k<count;k++){
+		if(format2_operand(tok->operator, k, tok->operand[k]) >= 0)continue;
+		*operand = k;
+		// SVC와 SHIFTL, SHIFTR의 두 번째 operand는 수
+		if(!strcmp(tok->operator, "SVC") ||
+		   (k==1 && strncmp(tok->operator, "SHIFT", 5)==0)){
+			snprintf(message, message_size,
+					 "%s의 operand '%s'은(는) %s의 수여야 합니다.",
+					 tok->operator, tok->operand[k],
+					 k==0 ? "0~15" : "1~16");
+		}
+		else {
+			snprintf(message, message_size, "알 수 없는 레지스터 '%s'입니다.",
+					 tok->operand[k]);
+		}
+		return 1;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief pass 1을 마친 토큰 테이블에서 불필요한 명령어를 지우고 주소를 다시
+ * 배정한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param rules 적용할 PEEPHOLE_* 규칙
+ * @param tokens pass 1을 마친 토큰 테이블 주소
+ * @param symbol_table 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param report control section별, 규칙별 결과를 저장할 구조체 주소
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 주석 라인만 사이에 둔 연속한 두 명령어를 규칙과 비교한다. 사이에 지시어가
+ * 있거나 label이 있어 다른 곳에서 들어올 수 있는 명령어는 지우지 않는다. 지운
+ * 명령어가 있으면 심볼 테이블과 리터럴 테이블을 비우고 assem_pass1_tokens로
+ * 주소를 다시 배정하므로, 지운 명령어만 쓰던 리터럴도 함께 사라진다.
+ */
+int peephole_optimize(const inst *inst_table[], int inst_table_length,
+					  int rules, token_store *tokens, symbol *symbol_table[],
+					  int *symbol_table_length, literal *literal_table[],
+					  int *literal_table_length, peephole_report *report,
+					  diag_list *diags) {
+	// 바로 앞의 명령어 라인 (사이에 지시어가 있었다면 -1)
+	int prev = -1;
+	peephole_section *section = NULL;
+	int removed_length = 0;
+	int victim = 0;
+	
+	memset(report, 0, sizeof(peephole_report));
+	if(tokens->length==0)return 0;
+	
+	char *removed = (char*)calloc(tokens->length, sizeof(char));
+	if(removed==NULL)return -2;
+	
+	for(int i=0;i<tokens->length;i++){
+		const char *operator = name_str(tokens->operator[i]);
+		
+		// 주석 라인은 건너뛰고, 명령어가 아닌 라인에서는 연속이 끊김
+		if(tokens->operator[i]==NAME_NONE){
+			if(tokens->label[i]!=NAME_NONE)prev = -1;
+			continue;
+		}
+		if(!strcmp(operator, "START") || !strcmp(operator, "CSECT")){
+			section = NULL;
+			if(report->length < MAX_CONTROL_SECTION_NUM){
+				section = &report->sections[report->length++];
+				section->name = tokens->label[i];
+			}
+			prev = -1;
+			continue;
+		}
+		if(tokens->opcode[i]==-1){
+			prev = -1;
+			continue;
+		}
+		
+		int rule = peephole_match(tokens, prev, i, rules, &victim);
+		if(rule==0){
+			prev = i;
+			continue;
+		}
+		
+		removed[victim] = 1;
+		removed_length++;
+		if(section!=NULL){
+			section->instructions++;
+			section->bytes += peephole_size(inst_table[tokens->opcode[victim]],
+											name_str(tokens->operator[victim]));
+		}
+		for(int k=0;k<PEEPHOLE_RULES;k++){
+			if(rule==(1 << k))report->rules[k]++;
+		}
+		// 뒤의 명령어를 지웠다면 앞의 명령어가 다음 명령어와 이어짐
+		if(victim!=i)prev = i;
+	}
+	
+	if(removed_length==0){
+		free(removed);
+		return 0;
+	}
+	
+	token_store_remove(tokens, removed);
+	free(removed);
+	
+	// 주소가 바뀌므로 컴파일한 수식과 두 테이블을 모두 다시 만듦
+	for(int i=0;i<tokens->length;i++){
+		free(tokens->expr[i]);
+		tokens->expr[i] = NULL;
+	}
+	for(int i=0;i<*symbol_table_length;i++){
+		free(symbol_table[i]);
+	}
+	*symbol_table_length = 0;
+	for(int i=0;i<*literal_table_length;i++){
+		free(literal_table[i]);
+	}
+	*literal_table_length = 0;
+	
+	return assem_pass1_tokens(inst_table, inst_table_length, tokens,
+							  symbol_table, symbol_table_length, literal_table,
+							  literal_table_length, diags);
+}
+
+/**
+ * @brief 연속한 두 명령어에 적용되는 peephole 규칙을 찾는다.
+ *
+ * @param tokens 토큰 테이블 주소
+ * @param prev 바로 앞의 명령어 라인 번호 (없으면 -1)
+ * @param i 현재 명령어 라인 번호
+ * @param rules 적용할 PEEPHOLE_* 규칙
+ * @param victim 지울 라인 번호를 저장할 변수 주소
+ * @return 적용한 규칙 (없으면 0)
+ *
+ * @details
+ * SIC/XE에서 condition code는 비교 명령어(COMP, COMPR, TIX, TIXR)만 바꾸므로,
+ * 비교는 바로 앞과 operand까지 같은 경우에만 다시 할 필요가 없다.
+ */
+int peephole_match(const token_store *tokens, int prev, int i, int rules,
+				   int *victim) {
+	token cur, before;
+	int labeled = tokens->label[i]!=NAME_NONE;
+	
+	token_store_get(tokens, i, &cur);
+	if(prev>=0)token_store_get(tokens, prev, &before);
+	
+	// 바로 앞에서 같은 레지스터를 이미 0으로 만듦
+	if((rules & PEEPHOLE_CLEAR) && prev>=0 && !labeled){
+		char reg = peephole_zero_register(&cur);
+		if(reg && reg==peephole_zero_register(&before)){
+			*victim = i;
+			return PEEPHOLE_CLEAR;
+		}
+	}
+	
+	// 앞의 load를 읽기 전에 덮어씀 (X를 index로 쓰는 load는 앞의 값을 읽음)
+	// BASE로 base relative를 계산할 수 있는 LDB는 제외
+	if((rules & PEEPHOLE_LOAD) && prev>=0 &&
+	   tokens->label[prev]==NAME_NONE){
+		char reg = peephole_register(cur.operator);
+		if(reg && reg!='B' && reg==peephole_register(before.operator) &&
+		   !(reg=='X' && (cur.nixbpe & 8))){
+			*victim = prev;
+			return PEEPHOLE_LOAD;
+		}
+	}
+	
+	if((rules & PEEPHOLE_COMPARE) && prev>=0 && !labeled &&
+	   peephole_same_compare(tokens, prev, i)){
+		*victim = i;
+		return PEEPHOLE_COMPARE;
+	}
+	
+	if((rules & PEEPHOLE_JUMP) && !labeled && peephole_jump_next(tokens, i)){
+		*victim = i;
+		return PEEPHOLE_JUMP;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief load 명령어가 값을 넣는 레지스터를 구한다.
+ *
+ * @param operator operator 문자열 ('+'로 시작할 수 있음)
+ * @return 레지스터 이름 (A, X, L, B, S, T), load가 아니면 0
+ */
+char peephole_register(const char *operator) {
+	if(operator==NULL)return 0;
+	if(*operator=='+')operator++;
+	if(strlen(operator)!=3 || strncmp(operator, "LD", 2))return 0;
+	return strchr("AXLBST", operator[2])!=NULL ? operator[2] : 0;
+}
+
+/**
+ * @brief 명령어가 레지스터를 0으로 만드는 경우 그 레지스터를 구한다.
+ *
+ * @param tok 명령어의 토큰 주소
+ * @return 레지스터 이름 (CLEAR r 또는 LDr #0), 아니면 0
+ */
+char peephole_zero_register(const token *tok) {
+	const char *operand = tok->operand[0];
+	if(tok->operator==NULL || operand==NULL || tok->operand[1]!=NULL)return 0;
+	
+	if(!strcmp(tok->operator, "CLEAR")){
+		if(strlen(operand)==1 && strchr("AXLBST", *operand)!=NULL)return *operand;
+		return 0;
+	}
+	if(!strcmp(operand, "#0"))return peephole_register(tok->operator);
+	return 0;
+}
+
+/**
+ * @brief 두 라인이 operand까지 같은 비교 명령어인지 확인한다.
+ *
+ * @param tokens 토큰 테이블 주소
+ * @param prev 앞의 라인 번호
+ * @param i 뒤의 라인 번호
+ * @return 같은 비교이면 1, 아니면 0
+ */
+int peephole_same_compare(const token_store *tokens, int prev, int i) {
+	const char *operator = name_str(tokens->operator[i]);
+	token cur, before;
+	
+	if(tokens->operator[i]!=tokens->operator[prev] ||
+	   tokens->nixbpe[i]!=tokens->nixbpe[prev] ||
+	   tokens->operands[i]!=tokens->operands[prev]){
+		return 0;
+	}
+	if(*operator=='+')operator++;
+	if(strcmp(operator, "COMP") && strcmp(operator, "COMPR"))return 0;
+	
+	token_store_get(tokens, i, &cur);
+	token_store_get(tokens, prev, &before);
+	for(int k=0;k<MAX_OPERAND_PER_INST && cur.operand[k]!=NULL;k++){
+		if(strcmp(cur.operand[k], before.operand[k]))return 0;
+	}
+	return 1;
+}
+
+/**
+ * @brief jump 명령어가 바로 다음 명령어로 가는지 확인한다.
+ *
+ * @param tokens 토큰 테이블 주소
+ * @param i jump 명령어의 라인 번호
+ * @return 다음 명령어로 가는 J, JEQ, JGT, JLT이면 1, 아니면 0
+ *
+ * @details
+ * operand가 indirect나 index가 아닌 심볼 하나이고, 주석 라인을 건너뛴 다음
+ * 라인이 그 심볼을 label로 가진 명령어여야 한다. 다음 control section으로 가는
+ * jump는 실행할 때 이어져 있지 않으므로 지우지 않는다.
+ */
+int peephole_jump_next(const token_store *tokens, int i) {
+	const char *operator = name_str(tokens->operator[i]);
+	token cur;
+	int next = i + 1;
+	
+	if(*operator=='+')operator++;
+	if(strcmp(operator, "J") && strcmp(operator, "JEQ") &&
+	   strcmp(operator, "JGT") && strcmp(operator, "JLT")){
+		return 0;
+	}
+	// n, i가 모두 1이고 x가 0인 simple addressing만 허용
+	if((tokens->nixbpe[i] & 56)!=48)return 0;
+	
+	token_store_get(tokens, i, &cur);
+	if(cur.operand[0]==NULL || cur.operand[1]!=NULL)return 0;
+	
+	while(next < tokens->length && tokens->operator[next]==NAME_NONE &&
+		  tokens->label[next]==NAME_NONE){
+		next++;
+	}
+	if(next >= tokens->length || tokens->opcode[next]==-1 ||
+	   tokens->label[next]==NAME_NONE){
+		return 0;
+	}
+	return !strcmp(name_str(tokens->label[next]), cur.operand[0]);
+}
+
+/**
+ * @brief 명령어의 바이트 수를 구한다.
+ *
+ * @param in 기계어 정보 주소
+ * @param operator operator 문자열 ('+'로 시작하면 4형식)
+ * @return 명령어의 바이트 수
+ */
+int peephole_size(const inst *in, const char *operator) {
+	int format = in->format % 10;
+	if(format==1 || format==2)return format;
+	if(format==4 && *operator=='+')return 4;
+	return 3;
+}
+
+/**
+ * @brief ','로 구분된 규칙 이름 목록을 PEEPHOLE_* 비트로 바꾼다.
+ *
+ * @param str 규칙 이름 목록 (clear, load, jump, compare, all)
+ * @param rules 규칙을 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0, 모르는 이름이 있는 경우 = -1)
+ */
+int peephole_parse_rules(const char *str, int *rules) {
+	static const struct {
+		const char *name;
+		int rule;
+	} names[] = {
+		{"clear", PEEPHOLE_CLEAR}, {"load", PEEPHOLE_LOAD},
+		{"jump", PEEPHOLE_JUMP}, {"compare", PEEPHOLE_COMPARE},
+		{"all", PEEPHOLE_ALL},
+	};
+	
+	*rules = 0;
+	while(*str){
+		size_t len = strcspn(str, ",");
+		int found = 0;
+		for(size_t k=0;k<sizeof(names)/sizeof(names[0]);k++){
+			if(strlen(names[k].name)==len && !strncmp(names[k].name, str, len)){
+				*rules |= names[k].rule;
+				found = 1;
+			}
+		}
+		if(!found)return -1;
+		str += len;
+		if(*str==',')str++;
+	}
+	
+	return *rules==0 ? -1 : 0;
+}
+
+/**
+ * @brief 표시한 라인들을 토큰 테이블에서 지우고 남은 라인을 앞으로 당긴다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param removed 라인마다 지울지 여부를 표시한 배열
+ *
+ * @details
+ * text는 그대로 두므로 지운 라인의 operand와 comment는 테이블을 해제할 때까지
+ * 남는다.
+ */
+void token_store_remove(token_store *store, const char *removed) {
+	int length = 0;
+	
+	for(int i=0;i<store->length;i++){
+		if(removed[i]){
+			free(store->expr[i]);
+			continue;
+		}
+		store->label[length] = store->label[i];
+		store->operator[length] = store->operator[i];
+		store->opcode[length] = store->opcode[i];
+		store->operand[length] = store->operand[i];
+		store->operands[length] = store->operands[i];
+		store->comment[length] = store->comment[i];
+		store->nixbpe[length] = store->nixbpe[i];
+		store->addr[length] = store->addr[i];
+		store->expr[length] = store->expr[i];
+		store->line[length] = store->line[i];
+		store->file[length] = store->file[i];
+		length++;
+	}
+	store->length = length;
+}
+
+/**
+ * @brief 소스코드 파일을 한 라인씩 읽으며 패스 1을 수행하고, 토큰을 IR 형태로
+ * 임시 파일에 쓴다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param input 읽기 권한으로 열린 소스코드 파일
+ * @param spill IR을 쓸 임시 파일
+ * @param symbol_table 심볼 테이블의 시작 주소
+ * @param symbol_table_length 심볼 테이블의 길이를 저장하는 변수 주소
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이를 저장하는 변수 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 토큰은 STREAM_WINDOW_LINES 라인씩 모아 assem_pass1_lines를 수행한 뒤 임시
+ * 파일로 내보내므로, 메모리에는 한 구간의 토큰만 남는다. EQU 값을 계산하기 위해
+ * START, CSECT, EXTREF와 EQU 라인만 따로 모아두었다가 마지막에
+ * resolve_expressions를 수행한다.
+ */
+int assem_pass1_stream(const inst *inst_table[], int inst_table_length,
+					   FILE *input, FILE *spill, symbol *symbol_table[],
+					   int *symbol_table_length, literal *literal_table[],
+					   int *literal_table_length, assem_stat *stat,
+					   diag_list *diags) {
+	char line[MAX_LINE_LENGTH + 1];
+	// 현재 구간의 토큰과 EQU 계산에 필요한 라인들
+	token_store window, scope;
+	tokenize_state ts;
+	pass1_state st;
+	int lines = 0;
+	size_t peak = 0;
+	int more = 1;
+	int err = 0;
+	
+	// 길이를 0으로 초기화
+	*symbol_table_length = 0;
+	*literal_table_length = 0;
+	
+	memset(&window, 0, sizeof(window));
+	memset(&scope, 0, sizeof(scope));
+	memset(&ts, 0, sizeof(ts));
+	ts.inst_table = inst_table;
+	ts.inst_table_length = inst_table_length;
+	ts.tokens = &window;
+	ts.diags = diags;
+	memset(&st, 0, sizeof(st));
+	st.inst_table = inst_table;
+	st.inst_table_length = inst_table_length;
+	st.symbol_table = symbol_table;
+	st.symbol_table_length = symbol_table_length;
+	st.literal_table = literal_table;
+	st.literal_table_length = literal_table_length;
+	st.diags = diags;
+	
+	while(err>=0 && more>0){
+		if((more = read_line(input, line, sizeof(line))) < 0){
+			err = more;
+			break;
+		}
+		if(more>0){
+			int start = window.length;
+			ts.line++;
+			err = tokenize_line(&ts, line, NULL);
+			token_store_locate(&window, start, ts.file, ts.line);
+			if(err<0)break;
+		}
+		// 구간이 다 차거나 파일이 끝났을 때만 처리
+		if(more>0 && window.length < STREAM_WINDOW_LINES)continue;
+		
+		int symbols = *symbol_table_length;
+		if((err = assem_pass1_lines(&st, &window)) < 0)break;
+		
+		for(int i=0;i<window.length && err>=0;i++){
+			const char *operator = name_str(window.operator[i]);
+			token view;
+			
+			if(window.operator[i]==NAME_NONE)continue;
+			if(strcmp(operator, "START") && strcmp(operator, "CSECT") &&
+			   strcmp(operator, "EXTREF") && strcmp(operator, "EQU")){
+				continue;
+			}
+			token_store_get(&window, i, &view);
+			view.comment = NULL;
+			if((err = token_store_add(&scope, &view)) < 0)break;
+			// EQU의 오류도 원래 위치로 보고
+			scope.line[scope.length - 1] = window.line[i];
+			scope.file[scope.length - 1] = window.file[i];
+			// 이 구간에서 정의한 수식 EQU는 scope의 라인을 가리키게 함
+			for(int k=symbols;k<*symbol_table_length;k++){
+				if(symbol_table[k]->pending && symbol_table[k]->line==i){
+					symbol_table[k]->line = scope.length - 1;
+				}
+			}
+		}
+		if(err<0)break;
+		
+		if((err = token_store_spill(&window, spill)) < 0)break;
+		lines += window.length;
+		if(token_store_bytes(&window) > peak)peak = token_store_bytes(&window);
+		token_store_clear(&window);
+	}
+	
+	int end = tokenize_finish(&ts);
+	if(err>=0)err = end;
+	
+	// 모든 심볼의 위치가 정해졌으므로 EQU 값을 계산
+	if(err>=0){
+		err = resolve_expressions(inst_table, inst_table_length, &scope,
+								  symbol_table, *symbol_table_length, diags);
+	}
+	if(stat!=NULL){
+		stat->token_lines = lines;
+		stat->token_bytes = peak + token_store_bytes(&scope);
+	}
+	
+	token_store_free(&window);
+	token_store_free(&scope);
+	extref_set_free(&st.labels);
+	return err < 0 ? err : 0;
+}
+
+/**
+ * @brief 한 줄의 소스코드를 파싱하여 토큰에 저장한다.
+ *
+ * @param input 파싱할 소스코드 문자열
+ * @param tok 결과를 저장할 토큰 구조체 주소
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int token_parsing(const char *input, token *tok, const inst *inst_table[],
+				  int inst_table_length) {
+	// 주석, Label, operator 등을 입력 받을 임시 문자열 생성
+	char tmp[MAX_LINE_LENGTH];
+	// 문자열의 끝을 저장
+	const char *end = input + strlen(input);
+	// operand를 파싱하는 과정에서 사용될 변수들을 선언
+	char *operand;
+	unsigned int operand_length, operands;
+	
+	// token 매개변수를 초기화
+	tok->label = NULL;
+	tok->operator = NULL;
+	tok->nixbpe = 0;
+	tok->operand[0] = tok->operand[1] = tok->operand[2] = NULL;
+	tok->comment = NULL;
+	tok->names = NULL;
+	tok->names_length = 0;
+	tok->label_id = NAME_NONE;
+	
+	// 문자열을 다 읽었는지 확인 하는 과정, 매 케이스마다 계속 등장함
+	if(input >= end) return 0;
+	// 해당 라인이 주석이라면 입력을 받고 리턴
+	if(*input=='.'){
+		tok->comment = calloc(1, strlen(input + 1) + 1);
+		if(tok->comment==NULL)return -2;
+		strcpy(tok->comment, input + 1);
+		// 주석라인은 주석만 존재하므로 다 읽고 리턴함
+		return 0;
+	}
+	
+	if(input >= end) return 0;
+	// 현재 input위치에 '\t'가 아니라면 Label이 존재하므로 Label일 때 읽음
+	if(*input!='\t'){
+		// 문자열을 읽고 읽은만큼 포인터를 이동함
+		sscanf(input, "%s", tmp);
+		input += strlen(tmp);
+		tok->label = calloc(1, strlen(tmp) + 1);
+		if(tok->label==NULL)return -2;
+		strncpy(tok->label, tmp, strlen(tmp));
+		// 이후 과정에서 정수로 비교할 수 있도록 label을 이름 풀에 등록
+		int err = name_intern(tok->label, &tok->label_id);
+		if(err<0)return err;
+	}
+	// '\t'를 건너뜀
+	input += 1;
+	
+	if(input >= end) return 0;
+	// 현재 input위치에 '\t'가 아니라면 operator이 존재하므로 operator일 때 읽음
+	if(*input!='\t'){
+		// 문자열을 읽고 읽은만큼 포인터를 이동함
+		sscanf(input, "%s", tmp);
+		input += strlen(tmp);
+		tok->operator = calloc(1, strlen(tmp) + 1);
+		if(tok->operator==NULL)return -2;
+		strncpy(tok->operator, tmp, strlen(tmp));
+	}
+	// '\t'를 건너뜀
+	input += 1;
+	
+	if(input >= end) return 0;
+	// 현재 input위치에 '\t'가 아니라면 operand이 존재하므로 operand일 때 읽음
+	if(*input!='\t'){
+		// 문자열을 읽고 읽은만큼 포인터를 이동함
+		sscanf(input, "%s", tmp);
+		input += strlen(tmp);
+		// EXTDEF, EXTREF의 이름 목록은 개수 제한 없이 따로 저장
+		if(tok->operator!=NULL &&
+		   (!strcmp(tok->operator, "EXTDEF") || !strcmp(tok->operator, "EXTREF"))){
+			int err = token_parse_names(tok, tmp);
+			if(err<0)return err;
+		}
+		else {
+			// operand_length는 0으로 operand는 tmp의 시작주소로 지정
+			operand_length = operands = 0;
+			operand = tmp;
+			// operand의 포인터를 이동시킬 것이기 때문에 반복문 종료조건을 다음과 같이 설정
+			while(operand <= tmp + strlen(tmp)){
+				// 최대 오퍼랜드 개수를 넘어가면 에러를 반환
+				// 이미 3개를 입력받은 상황에서 반복문을 더 수행하는 것은 이상함으로 에러를 반환
+				if(operands>=MAX_OPERAND_PER_INST){
+					return -1;
+				}
+			
+				if(operand[operand_length]==','){
+					tok->operand[operands] = calloc(1, operand_length + 1);
+					if(tok->operand[operands]==NULL)return -2;
+					strncpy(tok->operand[operands++], operand, operand_length);
+					// ','로 구분되어 있다면 다음 오퍼랜드가 있다는 것을 의미해서 operand 주소를 다음 오퍼랜드 시작주소로 넘김
+					operand += operand_length + 1;
+					operand_length = 0;
+					continue;
+				}
+			
+				if(operand[operand_length]=='\0'){
+					tok->operand[operands] = calloc(1, operand_length + 1);
+					if(tok->operand[operands]==NULL)return -2;
+					strncpy(tok->operand[operands++], operand, operand_length);
+					// 문자열의 끝을 만났다는 것은 마지막 오퍼랜드라는 것을 의미하기 때문에 반복물을 종료함
+					break;
+				}
+				// 계속 증가함
+				operand_length++;
+			}
+		}
+	}
+	// '\t'를 건너뜀
+	input += 1;
+	if(input >= end) return 0;
+	// 지금까지 남은 문자가 있다면 그것은 모두 주석으로 간주
+	tok->comment = calloc(1, strlen(input) + 1);
+	if(tok->comment==NULL)return -2;
+	strcpy(tok->comment, input);
+	// 항상 마지막은 주석이므로 주석을 만났기 때문에 0을 반환 함
+	return 0;
+}
+
+/**
+ * @brief EXTDEF, EXTREF의 operand를 ','로 나누어 토큰의 이름 목록에 저장한다.
+ *
+ * @param tok 이름 목록을 저장할 토큰 주소
+ * @param operand 나눌 operand 문자열
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 일반 operand와 달리 MAX_OPERAND_PER_INST개로 제한하지 않는다. 빈 이름은
+ * 오류로 처리한다.
+ */
+int token_parse_names(token *tok, const char *operand) {
+	size_t len = strlen(operand);
+	
+	tok->names = (char*)malloc(len + 1);
+	if(tok->names==NULL)return -2;
+	memcpy(tok->names, operand, len + 1);
+	
+	// ','를 '\0'으로 바꾸어 이름들을 이어 붙인 목록으로 만듦
+	tok->names_length = 1;
+	for(size_t k=0;k<len;k++){
+		if(tok->names[k]!=',')continue;
+		tok->names[k] = '\0';
+		tok->names_length++;
+	}
+	// 빈 이름은 허용하지 않음
+	const char *name = tok->names;
+	for(int k=0;k<tok->names_length;k++){
+		if(*name=='\0')return -1;
+		name += strlen(name) + 1;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 기계어 목록 테이블에서 특정 기계어를 검색하여, 해당 기계에가 위치한
+ * 인덱스를 반환한다.
+ *
+ * @param str 검색할 기계어 문자열
+ * @param inst_table 기계어 목록 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @return 기계어의 인덱스 (해당 기계어가 없는 경우 -1)
+ *
+ * @details
+ * 기계어 목록 테이블에서 특정 기계어를 검색하여, 해당 기계에가 위치한 인덱스를
+ * 반환한다. '+JSUB'와 같은 문자열에 대한 처리는 자유롭게 처리한다.
+ */
+int search_opcode(const char *str, const inst *inst_table[],
+				  int inst_table_length) {
+	// str이 4형식일 때
+	if(*str=='+')str += 1;
+	// 최대 instruction 수는 256개 이고 최대 라인수는 5000이기 떄문에 선형탐색을 채택
+	// 256 * 5000 연산은 0.1초 미만의 시간이 걸림
+	
+	for(int i=0;i<inst_table_length;i++){
+		// strcmp는 두 문자열이 같으면 0을 반환
+		if(!strcmp(str, inst_table[i]->str)){
+			// 같은 문자열이라면 op코드를 반환
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief 소스코드 테이블을 토큰 테이블로 변환하면서 매크로와 INCLUDE를
+ * 처리한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param input 소스코드 테이블의 주소
+ * @param input_length 소스코드 테이블의 길이
+ * @param tokens 결과를 저장할 비어 있는 토큰 테이블 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * MACRO와 MEND 사이의 라인은 한 번만 token_parsing하여 매크로의 템플릿으로
+ * 저장하고, 매크로 호출 라인은 템플릿의 operand 슬롯을 인자로 채운 토큰들로
+ * 바로 확장한다. INCLUDE 라인은 포함한 파일의 라인들로 대체된다. 따라서 pass 1
+ * 이후의 과정에는 MACRO, MEND, INCLUDE와 매크로 호출이 남지 않는다. 토큰
+ * 테이블은 소스코드의 라인 수만큼 미리 할당한다.
+ */
+int tokenize_input(const inst *inst_table[], int inst_table_length,
+				   const char *input[], int input_length, token_store *tokens,
+				   diag_list *diags) {
+	tokenize_state st;
+	memset(&st, 0, sizeof(st));
+	st.inst_table = inst_table;
+	st.inst_table_length = inst_table_length;
+	st.tokens = tokens;
+	st.diags = diags;
+	int err = token_store_reserve(tokens, input_length);
+	
+	for(int i=0;i<input_length && err>=0;i++){
+		int start = tokens->length;
+		st.line = i + 1;
+		err = tokenize_line(&st, input[i], NULL);
+		token_store_locate(tokens, start, st.file, st.line);
+	}
+	
+	int end = tokenize_finish(&st);
+	return err < 0 ? err : end;
+}
+
+/**
+ * @brief 추가된 라인들 중 위치가 비어 있는 라인에 소스코드 위치를 기록한다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param start 위치를 기록할 첫 번째 라인 번호
+ * @param file 소스코드 파일 (INCLUDE 파일이 아니면 NAME_NONE)
+ * @param line 줄 번호
+ *
+ * @details
+ * INCLUDE한 파일의 라인들은 안쪽에서 이미 자신의 위치를 기록했으므로 그대로
+ * 두고, 매크로를 확장한 라인들은 호출한 줄의 위치를 가진다.
+ */
+void token_store_locate(token_store *store, int start, name_id file, int line) {
+	for(int i=start;i<store->length;i++){
+		if(store->line[i]!=0)continue;
+		store->line[i] = line;
+		store->file[i] = file;
+	}
+}
+
+/**
+ * @brief 소스코드가 끝났을 때 매크로 정의가 닫혔는지 확인하고 매크로 테이블을
+ * 해제한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int tokenize_finish(tokenize_state *st) {
+	int err = 0;
+	
+	// MEND 없이 소스코드가 끝난 경우
+	if(st->defining!=NULL || st->skip_macro){
+		err = diag_add(st->diags, st->defining_file, st->defining_line, 1,
+					   "MACRO에 짝이 되는 MEND가 없습니다.");
+	}
+	macro_table_free(&st->mt);
+	return err;
+}
+
+/**
+ * @brief 소스코드 한 줄을 처리하여 토큰 테이블이나 정의 중인 매크로에 추가한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @param line 처리할 소스코드 문자열
+ * @param parsed 미리 파싱해 둔 토큰, 혹은 NULL (NULL이면 token_parsing을 호출)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * `st->diags`가 있으면 잘못된 라인은 `st->file`, `st->line` 위치의 오류로 기록하고
+ * 토큰 없이 넘어간다. 정의에 실패한 매크로의 본문은 MEND까지 건너뛴다.
+ */
+int tokenize_line(tokenize_state *st, const char *line, const token *parsed) {
+	// 라인을 필드로 나눈 결과와 매크로 인자
+	char fields[3][MAX_LINE_LENGTH];
+	char *args[MAX_MACRO_PARAMS];
+	int args_length = 0;
+	token tmp_token;
+	int err = 0;
+	
+	split_fields(line, fields);
+	
+	// 정의에 실패한 매크로의 본문은 MEND까지 버림
+	if(st->skip_macro){
+		if(!strcmp(fields[1], "MEND"))st->skip_macro = 0;
+		return 0;
+	}
+	
+	// 매크로 정의 중에는 MEND를 만날 때까지 템플릿으로 저장
+	if(st->defining!=NULL){
+		if(!strcmp(fields[1], "MEND")){
+			st->defining = NULL;
+			return 0;
+		}
+		// 중첩된 매크로 정의와 본문 안의 INCLUDE는 지원하지 않음
+		if(!strcmp(fields[1], "MACRO") || !strcmp(fields[1], "INCLUDE")){
+			return diag_add(st->diags, st->file, st->line, line_column(line, 1),
+							"매크로 본문 안에서는 %s를 사용할 수 없습니다.",
+							fields[1]);
+		}
+		// 주석 라인은 확장 결과에 넣지 않음
+		if(*line=='.')return 0;
+		
+		memset(&tmp_token, 0, sizeof(tmp_token));
+		if(parsed!=NULL)err = token_copy(&tmp_token, parsed);
+		else err = token_parsing(line, &tmp_token, st->inst_table,
+								 st->inst_table_length);
+		if(err<0 || (err = macro_template_add(st->defining, &tmp_token,
+											  st->line)) < 0){
+			token_clear(&tmp_token);
+		}
+		if(err==-1)return tokenize_parse_error(st, line, fields);
+		return err;
+	}
+	
+	if(!strcmp(fields[1], "MACRO")){
+		st->defining_file = st->file;
+		st->defining_line = st->line;
+		if((err = macro_define(&st->mt, fields[0], fields[2], st->file,
+							   &st->defining)) != -1){
+			return err;
+		}
+		st->skip_macro = 1;
+		return diag_add(st->diags, st->file, st->line, line_column(line, 0),
+						"매크로 정의가 잘못되었습니다. (이름은 1~9자, 인자는 "
+						"'&이름' 또는 '&이름=값' 형식으로 최대 %d개)",
+						MAX_MACRO_PARAMS);
+	}
+	// 짝이 없는 MEND
+	if(!strcmp(fields[1], "MEND")){
+		return diag_add(st->diags, st->file, st->line, line_column(line, 1),
+						"MEND에 짝이 되는 MACRO가 없습니다.");
+	}
+	// 다른 소스 파일을 그 자리에 포함
+	if(!strcmp(fields[1], "INCLUDE")){
+		if(*fields[0] || *fields[2]=='\0'){
+			return diag_add(st->diags, st->file, st->line, line_column(line, 0),
+							"INCLUDE에는 label 없이 파일 경로 operand가 필요합니다.");
+		}
+		return tokenize_include(st, fields[2]);
+	}
+	
+	// 매크로 호출이라면 인자를 나누어 확장
+	const macro *m = macro_search(&st->mt, fields[1]);
+	if(m!=NULL){
+		if((args_length = split_args(fields[2], args, MAX_MACRO_PARAMS)) < 0){
+			return diag_add(st->diags, st->file, st->line, line_column(line, 2),
+							"매크로 '%s'의 인자가 %d개를 넘습니다.", m->name,
+							MAX_MACRO_PARAMS);
+		}
+		int start = st->tokens->length;
+		macro_clash clash = {0};
+		err = macro_expand(&st->mt, m, (const char **)args, args_length,
+						   *fields[0] ? fields[0] : NULL, st->tokens,
+						   &st->expansions, 0, &clash);
+		if(err==0 || (err==-1 && st->tokens->length >= MAX_EXPANDED_LINES)){
+			return tokenize_added(st, start);
+		}
+		if(err!=-1)return err;
+		// 본문의 label이 다른 매크로의 호출에 붙은 경우 호출 라인에는 label이 없음
+		if(clash.m!=NULL){
+			return tokenize_macro_clash(st, line_column(line, *fields[0] ? 0 : 1),
+										&clash);
+		}
+		return diag_add(st->diags, st->file, st->line, line_column(line, 1),
+						"매크로 '%s'을(를) 확장할 수 없습니다. (인자 수 초과 또는 "
+						"중첩 %d단계 초과)", m->name, MAX_MACRO_DEPTH);
+	}
+	
+	// 일반 라인은 기존과 같이 토큰으로 변환하여 토큰 테이블에 복사
+	if(parsed!=NULL)err = token_store_add(st->tokens, parsed);
+	else {
+		memset(&tmp_token, 0, sizeof(tmp_token));
+		if((err = token_parsing(line, &tmp_token, st->inst_table,
+								st->inst_table_length)) < 0){
+			token_clear(&tmp_token);
+			return err==-1 ? tokenize_parse_error(st, line, fields) : err;
+		}
+		err = token_store_add(st->tokens, &tmp_token);
+		token_clear(&tmp_token);
+	}
+	if(err<0)return err;
+	return tokenize_added(st, st->tokens->length - 1);
+}
+
+/**
+ * @brief 호출 라인의 label과 본문 라인의 label이 겹쳐 확장할 수 없는 오류를 기록한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @param column 오류를 기록할 호출 라인의 열 번호
+ * @param clash macro_expand가 채운 정보의 주소
+ * @return 오류 코드 (기록한 경우 = 0)
+ *
+ * @details
+ * 오류는 호출 라인에 기록하고, 메시지에 label이 있는 본문 라인의 위치를 함께
+ * 적는다. 본문 라인의 label은 항상 1열에서 시작한다.
+ */
+int tokenize_macro_clash(tokenize_state *st, int column,
+						 const macro_clash *clash) {
+	char where[MAX_LINE_LENGTH];
+	const macro *m = clash->m;
+	
+	if(m->file!=NAME_NONE){
+		snprintf(where, sizeof(where), "%s의 %d번째 줄 1열", name_str(m->file),
+				 m->lines[clash->body]);
+	}
+	else snprintf(where, sizeof(where), "%d번째 줄 1열", m->lines[clash->body]);
+	return diag_add(st->diags, st->file, st->line, column,
+					"label '%s'을(를) 붙일 매크로 '%s'의 첫 문장(%s)에 이미 "
+					"label '%s'이(가) 있습니다.", clash->label, m->name, where,
+					clash->tmpl);
+}
+
+/**
+ * @brief 토큰 테이블에 추가된 라인들을 세고 길이 제한을 확인한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @param start 이번 줄에서 추가된 첫 번째 라인 번호
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 매크로와 INCLUDE는 한 줄을 여러 라인으로 늘리므로 확장하는 동안 토큰 테이블의
+ * 길이와 label 수를 확인한다. 토큰 테이블이 MAX_EXPANDED_LINES에 이르거나 label이
+ * 심볼 테이블에 담을 수 있는 MAX_TABLE_LENGTH개를 넘으면 오류를 남기고 -1을
+ * 반환하여 확장을 멈춘다.
+ */
+int tokenize_added(tokenize_state *st, int start) {
+	int err;
+	
+	if(st->tokens->length >= MAX_EXPANDED_LINES){
+		err = diag_add(st->diags, st->file, st->line, 1,
+					   "매크로와 INCLUDE를 확장한 라인이 너무 많습니다. (최대 %d줄)",
+					   MAX_EXPANDED_LINES);
+		return err < 0 ? err : -1;
+	}
+	for(int i=start;i<st->tokens->length;i++){
+		if(st->tokens->label[i]!=NAME_NONE)st->labels++;
+	}
+	if(st->labels > MAX_TABLE_LENGTH){
+		err = diag_add(st->diags, st->file, st->line, 1,
+					   "심볼 테이블이 가득 찼습니다. (최대 %d개)",
+					   MAX_TABLE_LENGTH);
+		return err < 0 ? err : -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief token_parsing이 거부한 라인의 오류를 기록한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @param line 소스코드 문자열
+ * @param fields split_fields로 나눈 라인의 필드
+ * @return 오류 코드 (기록한 경우 = 0)
+ */
+int tokenize_parse_error(tokenize_state *st, const char *line,
+						 char fields[3][MAX_LINE_LENGTH]) {
+	if(!strcmp(fields[1], "EXTDEF") || !strcmp(fields[1], "EXTREF")){
+		return diag_add(st->diags, st->file, st->line, line_column(line, 2),
+						"%s의 이름 목록에 빈 이름이 있습니다.", fields[1]);
+	}
+	return diag_add(st->diags, st->file, st->line, line_column(line, 2),
+					"operand가 %d개를 넘습니다.", MAX_OPERAND_PER_INST);
+}
+
+/**
+ * @brief INCLUDE로 지정된 파일의 라인들을 현재 위치에서 처리한다.
+ *
+ * @param st 토큰 변환 상태 주소
+ * @param path 포함할 파일 경로
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 파일은 include_cache에서 가져오므로 같은 파일을 여러 번 포함하더라도 읽기와
+ * 파싱은 한 번만 일어난다. 파일 안의 라인도 매크로 정의와 호출, INCLUDE를 모두
+ * 사용할 수 있으며 순환 포함을 막기 위해 깊이를 MAX_INCLUDE_DEPTH로 제한한다.
+ * 최상위 소스의 상대 경로는 현재 디렉터리를, 포함된 파일 안의 상대 경로는 그
+ * 파일의 디렉터리를 기준으로 한다.
+ */
+int tokenize_include(tokenize_state *st, const char *path) {
+	char line[MAX_LINE_LENGTH];
+	char full_path[MAX_PATH_LENGTH];
+	const char *parent_dir = st->include_dir;
+	name_id parent_file = st->file;
+	int parent_line = st->line;
+	name_id file = NAME_NONE;
+	int err = 0;
+	
+	if(st->include_depth >= MAX_INCLUDE_DEPTH){
+		return diag_add(st->diags, st->file, st->line, 1,
+						"INCLUDE 중첩이 %d단계를 넘습니다.", MAX_INCLUDE_DEPTH);
+	}
+	
+	// 포함한 파일 안의 상대 경로는 그 파일이 있는 디렉터리를 기준으로 함
+	if(*path!='/' && parent_dir!=NULL){
+		if(snprintf(full_path, sizeof(full_path), "%s/%s", parent_dir, path)
+		   >= (int)sizeof(full_path)){
+			return diag_add(st->diags, st->file, st->line, 1,
+							"INCLUDE 파일 경로가 너무 깁니다.");
+		}
+	}
+	else {
+		if(strlen(path) >= sizeof(full_path)){
+			return diag_add(st->diags, st->file, st->line, 1,
+							"INCLUDE 파일 경로가 너무 깁니다.");
+		}
+		strcpy(full_path, path);
+	}
+	
+	include_file *f = include_cache_acquire(full_path, st->inst_table,
+											st->inst_table_length, &err);
+	if(f==NULL && err==-1){
+		return diag_add(st->diags, st->file, st->line, 1,
+						"INCLUDE 파일 '%s'을(를) 읽을 수 없습니다.", full_path);
+	}
+	if(f==NULL)return err;
+	// 포함한 파일 안의 오류는 그 파일의 경로와 줄 번호로 보고
+	if((err = name_intern(full_path, &file)) < 0){
+		include_cache_release(f);
+		return err;
+	}
+	
+	// 이 파일의 디렉터리를 중첩된 INCLUDE의 기준으로 사용
+	char dir[MAX_PATH_LENGTH];
+	char *slash = strrchr(full_path, '/');
+	if(slash==NULL)strcpy(dir, ".");
+	else if(slash==full_path)strcpy(dir, "/");
+	else {
+		memcpy(dir, full_path, slash - full_path);
+		dir[slash - full_path] = '\0';
+	}
+	
+	st->include_depth++;
+	st->include_dir = dir;
+	st->file = file;
+	for(int i=0;i<f->lines && err>=0;i++){
+		int start = st->tokens->length;
+		// 파일을 mmap한 영역은 '\0'으로 끝나지 않으므로 라인을 복사해서 사용
+		memcpy(line, f->map + f->line_start[i], f->line_length[i]);
+		line[f->line_length[i]] = '\0';
+		st->line = i + 1;
+		err = tokenize_line(st, line, f->tokens[i]);
+		token_store_locate(st->tokens, start, st->file, st->line);
+	}
+	st->file = parent_file;
+	st->line = parent_line;
+	st->include_dir = parent_dir;
+	st->include_depth--;
+	
+	include_cache_release(f);
+	return err;
+}
+
+/**
+ * @brief 캐시에서 INCLUDE 파일을 찾고, 없거나 바뀐 경우 새로 읽어 파싱한다.
+ *
+ * @param path 포함할 파일 경로
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param err 실패한 경우 오류 코드를 저장할 변수 주소
+ * @return 참조 수를 늘린 캐시 항목 주소 (실패한 경우 NULL)
+ *
+ * @details
+ * 캐시는 프로세스 전체에서 공유하며 경로와 수정 시각, 크기가 같으면 같은
+ * 파일로 본다. 사용이 끝나면 include_cache_release를 호출해야 한다. 파일을 읽고
+ * 파싱하는 동안에는 잠금을 풀어 다른 스레드가 캐시를 사용할 수 있게 하고, 다시
+ * 잠근 뒤 그 사이에 다른 스레드가 같은 파일을 넣었는지 확인한다. 넣었다면 그
+ * 항목을 사용하고 읽은 항목은 해제한다. 파일이 바뀐 경우 기존 항목은 캐시에서
+ * 빠지고 마지막 사용자가 반환할 때 해제된다.
+ */
+include_file *include_cache_acquire(const char *path, const inst *inst_table[],
+									int inst_table_length, int *err) {
+	include_cache *cache = &shared_include_cache;
+	struct stat st;
+	include_file *f;
+	
+	if(stat(path, &st) < 0){
+		*err = -1;
+		return NULL;
+	}
+	
+	pthread_mutex_lock(&cache->lock);
+	f = include_cache_find(cache, path, st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+						   st.st_size);
+	pthread_mutex_unlock(&cache->lock);
+	if(f!=NULL)return f;
+	
+	// 잠금 없이 읽고 파싱
+	include_file *loaded = include_file_load(path, inst_table, inst_table_length, err);
+	if(loaded==NULL)return NULL;
+	
+	pthread_mutex_lock(&cache->lock);
+	f = include_cache_find(cache, path, loaded->mtime_sec, loaded->mtime_nsec,
+						   loaded->size);
+	if(f==NULL){
+		loaded->refs = 1;
+		loaded->next = cache->files;
+		cache->files = loaded;
+		f = loaded;
+		loaded = NULL;
+	}
+	pthread_mutex_unlock(&cache->lock);
+	
+	// 다른 스레드가 먼저 넣은 항목을 사용
+	if(loaded!=NULL)include_file_free(loaded);
+	return f;
+}
+
+/**
+ * @brief 잠금을 가진 상태에서 캐시의 항목을 찾아 참조 수를 늘린다.
+ *
+ * @param cache INCLUDE 파일 캐시 주소 (잠겨 있어야 함)
+ * @param path 찾을 파일 경로
+ * @param mtime_sec 파일의 수정 시각 (초)
+ * @param mtime_nsec 파일의 수정 시각 (나노초)
+ * @param size 파일 크기
+ * @return 참조 수를 늘린 캐시 항목 주소 (없거나 바뀐 경우 NULL)
+ *
+ * @details
+ * 경로가 같지만 수정 시각이나 크기가 다른 항목은 캐시에서 빼고, 사용 중이 아니면
+ * 바로 해제한다.
+ */
+include_file *include_cache_find(include_cache *cache, const char *path,
+								 long mtime_sec, long mtime_nsec, off_t size) {
+	for(include_file **link = &cache->files;*link!=NULL;link = &(*link)->next){
+		include_file *f = *link;
+		if(strcmp(f->path, path))continue;
+		
+		if(f->mtime_sec==mtime_sec && f->mtime_nsec==mtime_nsec && f->size==size){
+			f->refs++;
+			return f;
+		}
+		// 파일이 바뀌었다면 캐시에서 뺌
+		*link = f->next;
+		f->stale = 1;
+		if(f->refs==0)include_file_free(f);
+		break;
+	}
+	return NULL;
+}
+
+/**
+ * @brief include_cache_acquire로 얻은 캐시 항목의 사용을 마친다.
+ *
+ * @param f 반환할 캐시 항목 주소
+ */
+void include_cache_release(include_file *f) {
+	include_cache *cache = &shared_include_cache;
+	
+	pthread_mutex_lock(&cache->lock);
+	f->refs--;
+	if(f->stale && f->refs==0)include_file_free(f);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * @brief INCLUDE 파일 캐시를 비운다.
+ *
+ * @details
+ * 어셈블러를 포함한 프로그램이 종료하기 전이나 메모리를 돌려받고 싶을 때
+ * 호출한다. 사용 중인 항목은 마지막 사용자가 반환할 때 해제된다.
+ */
+void include_cache_clear(void) {
+	include_cache *cache = &shared_include_cache;
+	
+	pthread_mutex_lock(&cache->lock);
+	while(cache->files!=NULL){
+		include_file *f = cache->files;
+		cache->files = f->next;
+		f->stale = 1;
+		if(f->refs==0)include_file_free(f);
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * @brief INCLUDE 파일을 mmap하고 각 라인을 미리 토큰으로 파싱한다.
+ *
+ * @param path 읽을 파일 경로
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param err 실패한 경우 오류 코드를 저장할 변수 주소
+ * @return 새로 만든 캐시 항목 주소 (실패한 경우 NULL)
+ *
+ * @details
+ * 파싱에 실패한 라인(MACRO 라인처럼 operand가 많은 라인 등)의 토큰은 NULL로
+ * 남겨 두고, 실제로 일반 라인으로 사용될 때 다시 파싱하여 오류를 보고한다.
+ */
+include_file *include_file_load(const char *path, const inst *inst_table[],
+								int inst_table_length, int *err) {
+	char line[MAX_LINE_LENGTH];
+	struct stat st;
+	include_file *f = (include_file*)calloc(1, sizeof(include_file));
+	if(f==NULL){
+		*err = -2;
+		return NULL;
+	}
+	
+	int fd = open(path, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) < 0){
+		if(fd >= 0)close(fd);
+		free(f);
+		*err = -1;
+		return NULL;
+	}
+	f->mtime_sec = st.st_mtim.tv_sec;
+	f->mtime_nsec = st.st_mtim.tv_nsec;
+	f->size = st.st_size;
+	f->map_length = st.st_size;
+	// 빈 파일은 mmap할 수 없으므로 라인이 없는 항목으로 둠
+	if(f->map_length > 0){
+		f->map = (char*)mmap(NULL, f->map_length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(f->map==MAP_FAILED){
+			f->map = NULL;
+			close(fd);
+			include_file_free(f);
+			*err = -1;
+			return NULL;
+		}
+	}
+	close(fd);
+	
+	f->path = (char*)calloc(1, strlen(path) + 1);
+	if(f->path==NULL){
+		include_file_free(f);
+		*err = -2;
+		return NULL;
+	}
+	strcpy(f->path, path);
+	
+	// 라인 수를 세어 배열을 한 번에 할당
+	int lines = 0;
+	for(size_t k=0;k<f->map_length;k++){
+		if(f->map[k]=='\n')lines++;
+	}
+	if(f->map_length > 0 && f->map[f->map_length - 1]!='\n')lines++;
+	f->line_start = (size_t*)calloc(lines + 1, sizeof(size_t));
+	f->line_length = (int*)calloc(lines + 1, sizeof(int));
+	f->tokens = (token**)calloc(lines + 1, sizeof(token*));
+	if(f->line_start==NULL || f->line_length==NULL || f->tokens==NULL){
+		include_file_free(f);
+		*err = -2;
+		return NULL;
+	}
+	
+	size_t start = 0;
+	while(start < f->map_length){
+		const char *next = memchr(f->map + start, '\n', f->map_length - start);
+		size_t len = (next != NULL ? (size_t)(next - f->map) : f->map_length) - start;
+		
+		// init_input_buffer와 같이 너무 긴 라인은 오류
+		if(len >= sizeof(line)){
+			include_file_free(f);
+			*err = -1;
+			return NULL;
+		}
+		memcpy(line, f->map + start, len);
+		line[len] = '\0';
+		
+		int i = f->lines++;
+		f->line_start[i] = start;
+		f->line_length[i] = len;
+		f->tokens[i] = (token*)calloc(1, sizeof(token));
+		if(f->tokens[i]==NULL){
+			include_file_free(f);
+			*err = -2;
+			return NULL;
+		}
+		if(token_parsing(line, f->tokens[i], inst_table, inst_table_length) < 0){
+			token_free(f->tokens[i]);
+			f->tokens[i] = NULL;
+		}
+		
+		start += len + 1;
+	}
+	
+	return f;
+}
+
+/**
+ * @brief 캐시 항목 하나와 mmap한 영역을 해제한다.
+ *
+ * @param f 해제할 캐시 항목 주소
+ */
+void include_file_free(include_file *f) {
+	if(f->map!=NULL)munmap(f->map, f->map_length);
+	if(f->tokens!=NULL){
+		for(int i=0;i<f->lines;i++){
+			token_free(f->tokens[i]);
+		}
+	}
+	free(f->tokens);
+	free(f->line_start);
+	free(f->line_length);
+	free(f->path);
+	free(f);
+}
+
+/**
+ * @brief 문자열의 해시 값을 계산한다. (FNV-1a)
+ *
+ * @param str 문자열
+ * @return 해시 값
+ */
+unsigned int name_hash(const char *str) {
+	unsigned int hash = 2166136261u;
+	while(*str){
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief 잠금을 잡은 상태에서 이름 풀의 해시 테이블로 문자열의 번호를 찾는다.
+ *
+ * @param pool 이름 풀 주소
+ * @param str 찾을 문자열
+ * @param slot 찾지 못한 경우 추가할 슬롯 위치를 저장할 변수 주소, 혹은 NULL
+ * @return 문자열의 번호 (찾지 못한 경우 NAME_NONE)
+ */
+name_id name_pool_lookup(const name_pool *pool, const char *str,
+						 unsigned int *slot) {
+	if(pool->capacity==0)return NAME_NONE;
+	
+	unsigned int k = name_hash(str) & (pool->capacity - 1);
+	while(pool->slots[k]!=NAME_NONE){
+		if(!strcmp(name_str(pool->slots[k]), str))return pool->slots[k];
+		k = (k + 1) & (pool->capacity - 1);
+	}
+	if(slot!=NULL)*slot = k;
+	return NAME_NONE;
+}
+
+/**
+ * @brief 문자열을 이름 풀에 등록하고 번호를 얻는다.
+ *
+ * @param str 등록할 문자열
+ * @param id 번호를 저장할 변수 주소 (NULL이나 빈 문자열은 NAME_NONE)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 이미 등록된 문자열은 읽기 잠금만으로 찾고, 처음 보는 문자열일 때만 쓰기
+ * 잠금을 잡아 새 번호를 발급한다. 해시 테이블은 절반 이상 차면 두 배로 늘린다.
+ */
+int name_intern(const char *str, name_id *id) {
+	name_pool *pool = &shared_name_pool;
+	unsigned int slot = 0;
+	
+	*id = NAME_NONE;
+	if(str==NULL || *str=='\0')return 0;
+	if((*id = name_find(str))!=NAME_NONE)return 0;
+	
+	pthread_rwlock_wrlock(&pool->lock);
+	// 잠금을 기다리는 동안 다른 스레드가 등록했을 수 있으므로 다시 확인
+	if((*id = name_pool_lookup(pool, str, &slot))!=NAME_NONE){
+		pthread_rwlock_unlock(&pool->lock);
+		return 0;
+	}
+	if(pool->length >= (name_id)NAME_POOL_CHUNK * NAME_POOL_CHUNKS){
+		pthread_rwlock_unlock(&pool->lock);
+		return -1;
+	}
+	
+	// 해시 테이블이 절반 이상 차면 두 배로 늘려 다시 배치
+	if((pool->length + 1) * 2 > pool->capacity){
+		unsigned int capacity = pool->capacity ? pool->capacity * 2 : 1024;
+		name_id *slots = (name_id*)calloc(capacity, sizeof(name_id));
+		if(slots==NULL){
+			pthread_rwlock_unlock(&pool->lock);
+			return -2;
+		}
+		for(unsigned int i=0;i<pool->capacity;i++){
+			if(pool->slots[i]==NAME_NONE)continue;
+			unsigned int k = name_hash(name_str(pool->slots[i])) & (capacity - 1);
+			while(slots[k]!=NAME_NONE)k = (k + 1) & (capacity - 1);
+			slots[k] = pool->slots[i];
+		}
+		free(pool->slots);
+		pool->slots = slots;
+		pool->capacity = capacity;
+		name_pool_lookup(pool, str, &slot);
+	}
+	
+	char ***chunk = &pool->chunks[pool->length / NAME_POOL_CHUNK];
+	if(*chunk==NULL){
+		*chunk = (char**)calloc(NAME_POOL_CHUNK, sizeof(char*));
+		if(*chunk==NULL){
+			pthread_rwlock_unlock(&pool->lock);
+			return -2;
+		}
+	}
+	char *copy = (char*)calloc(1, strlen(str) + 1);
+	if(copy==NULL){
+		pthread_rwlock_unlock(&pool->lock);
+		return -2;
+	}
+	strcpy(copy, str);
+	(*chunk)[pool->length % NAME_POOL_CHUNK] = copy;
+	pool->slots[slot] = pool->length;
+	*id = pool->length++;
+	
+	pthread_rwlock_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+ * @brief 이름 풀에서 문자열의 번호를 찾는다. 등록하지는 않는다.
+ *
+ * @param str 찾을 문자열
+ * @return 문자열의 번호 (등록되지 않은 경우 NAME_NONE)
+ *
+ * @details
+ * 등록되지 않은 이름은 어떤 테이블에도 있을 수 없으므로 검색을 바로 끝낼 수
+ * 있다.
+ */
+name_id name_find(const char *str) {
+	name_pool *pool = &shared_name_pool;
+	
+	if(str==NULL || *str=='\0')return NAME_NONE;
+	pthread_rwlock_rdlock(&pool->lock);
+	name_id id = name_pool_lookup(pool, str, NULL);
+	pthread_rwlock_unlock(&pool->lock);
+	return id;
+}
+
+/**
+ * @brief 번호에 해당하는 문자열을 얻는다.
+ *
+ * @param id 이름 풀의 번호
+ * @return 문자열 (NAME_NONE인 경우 "")
+ *
+ * @details
+ * 발급된 문자열은 이름 풀을 비우기 전까지 옮겨지지 않으므로 잠금 없이 읽는다.
+ */
+const char *name_str(name_id id) {
+	if(id==NAME_NONE)return "";
+	return shared_name_pool.chunks[id / NAME_POOL_CHUNK][id % NAME_POOL_CHUNK];
+}
+
+/**
+ * @brief 이름 풀에서 지금까지 발급한 번호의 수를 얻는다.
+ *
+ * @return 다음에 발급할 번호 (NAME_NONE을 포함한 번호 수)
+ */
+name_id name_count(void) {
+	name_id length;
+	
+	pthread_rwlock_rdlock(&shared_name_pool.lock);
+	length = shared_name_pool.length;
+	pthread_rwlock_unlock(&shared_name_pool.lock);
+	return length;
+}
+
+/**
+ * @brief 이름 풀을 비운다.
+ *
+ * @details
+ * 이전에 발급한 번호가 모두 무효가 되므로 사용 중인 어셈블러 컨텍스트와
+ * INCLUDE 캐시가 없을 때만 호출해야 한다. assembler_destroy가 마지막 컨텍스트를
+ * 해제할 때, 감시 모드는 assembler_shared_clear로 호출한다.
+ */
+void name_pool_clear(void) {
+	name_pool *pool = &shared_name_pool;
+	
+	pthread_rwlock_wrlock(&pool->lock);
+	for(int c=0;c<NAME_POOL_CHUNKS;c++){
+		if(pool->chunks[c]==NULL)continue;
+		for(int i=0;i<NAME_POOL_CHUNK;i++){
+			free(pool->chunks[c][i]);
+		}
+		free(pool->chunks[c]);
+		pool->chunks[c] = NULL;
+	}
+	free(pool->slots);
+	pool->slots = NULL;
+	pool->capacity = 0;
+	pool->length = 1;
+	pthread_rwlock_unlock(&pool->lock);
+}
+
+/**
+ * @brief 소스코드 한 줄을 label, operator, operand 필드의 문자열로 나눈다.
+ *
+ * @param input 나눌 소스코드 문자열
+ * @param fields label, operator, operand 문자열을 저장할 배열 (없으면 "")
+ *
+ * @details
+ * token_parsing과 같이 필드는 '\t'로 구분하고, 각 필드는 공백 전까지만 읽는다.
+ * operand 필드를 ','로 나누지 않으므로 인자가 많은 매크로 라인에 사용한다.
+ */
+void split_fields(const char *input, char fields[3][MAX_LINE_LENGTH]) {
+	memset(fields, 0, sizeof(char) * 3 * MAX_LINE_LENGTH);
+	
+	// 주석 라인은 모든 필드가 비어 있음
+	if(*input=='.')return;
+	
+	for(int k=0;k<3 && *input;k++){
+		int len = 0;
+		while(*input && *input!='\t' && *input!=' ' && len<MAX_LINE_LENGTH - 1){
+			fields[k][len++] = *input++;
+		}
+		// 다음 '\t'까지 건너뜀
+		while(*input && *input!='\t')input++;
+		if(*input=='\t')input++;
+	}
+}
+
+/**
+ * @brief operand 필드를 ','로 나누어 인자 배열을 만든다.
+ *
+ * @param field 나눌 operand 필드, 제자리에서 '\0'으로 나뉜다
+ * @param args 각 인자의 시작 주소를 저장할 배열
+ * @param max 최대 인자 수
+ * @return 인자 수 (인자가 너무 많은 경우 -1)
+ *
+ * @details
+ * 따옴표 안의 ','는 구분자로 보지 않는다. 빈 필드는 인자 0개로, "A,,B"의
+ * 가운데 인자는 빈 문자열로 처리한다.
+ */
+int split_args(char *field, char *args[], int max) {
+	int length = 0;
+	int quoted = 0;
+	
+	if(*field=='\0')return 0;
+	
+	args[length++] = field;
+	for(;*field;field++){
+		if(*field=='\'')quoted = !quoted;
+		else if(*field==',' && !quoted){
+			if(length>=max)return -1;
+			*field = '\0';
+			args[length++] = field + 1;
+		}
+	}
+	
+	return length;
+}
+
+/**
+ * @brief 매크로 테이블에서 이름이 같은 매크로를 찾는다.
+ *
+ * @param mt 매크로 테이블 주소
+ * @param name 찾을 매크로 이름
+ * @return 매크로 주소 (없는 경우 NULL)
+ */
+const macro *macro_search(const macro_table *mt, const char *name) {
+	if(name==NULL || *name=='\0')return NULL;
+	
+	for(int i=0;i<mt->length;i++){
+		if(!strcmp(mt->macros[i].name, name)){
+			return &mt->macros[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief MACRO 라인으로 새 매크로를 정의한다.
+ *
+ * @param mt 매크로 테이블 주소
+ * @param name 매크로 이름 (MACRO 라인의 label)
+ * @param params MACRO 라인의 operand 필드, 제자리에서 나뉜다
+ * @param file MACRO 라인이 있는 파일 (소스코드는 NAME_NONE)
+ * @param defining 정의를 시작한 매크로 주소를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * `&A`는 위치 인자, `&A=값`은 기본값이 있는 keyword 인자이다. 같은 이름의
+ * 매크로를 다시 정의하면 이후 호출부터 새 정의를 사용한다.
+ */
+int macro_define(macro_table *mt, const char *name, char *params,
+				 name_id file, macro **defining) {
+	char *args[MAX_MACRO_PARAMS];
+	int args_length;
+	macro *m;
+	
+	if(*name=='\0' || strlen(name) >= sizeof(m->name))return -1;
+	if((args_length = split_args(params, args, MAX_MACRO_PARAMS)) < 0)return -1;
+	
+	// 같은 이름이 있다면 기존 정의를 비우고 재사용
+	m = (macro*)macro_search(mt, name);
+	if(m!=NULL){
+		macro_clear(m);
+	}
+	else {
+		if(mt->length >= mt->capacity){
+			int capacity = mt->capacity ? mt->capacity * 2 : 16;
+			macro *macros = (macro*)realloc(mt->macros, capacity * sizeof(macro));
+			if(macros==NULL)return -2;
+			mt->macros = macros;
+			mt->capacity = capacity;
+		}
+		m = &mt->macros[mt->length++];
+	}
+	memset(m, 0, sizeof(macro));
+	strcpy(m->name, name);
+	m->file = file;
+	
+	for(int k=0;k<args_length;k++){
+		char *param = args[k];
+		char *value = strchr(param, '=');
+		
+		// 인자 이름은 '&'로 시작해야 함
+		if(*param!='&')return -1;
+		param += 1;
+		if(value!=NULL)*value++ = '\0';
+		if(*param=='\0' || strlen(param) >= sizeof(m->param[k]))return -1;
+		
+		strcpy(m->param[k], param);
+		if(value!=NULL){
+			m->defaults[k] = (char*)calloc(1, strlen(value) + 1);
+			if(m->defaults[k]==NULL)return -2;
+			strcpy(m->defaults[k], value);
+		}
+		m->params++;
+	}
+	
+	*defining = m;
+	return 0;
+}
+
+/**
+ * @brief 매크로 본문의 한 줄을 템플릿으로 추가한다.
+ *
+ * @param m 정의 중인 매크로 주소
+ * @param tok 본문 라인을 파싱한 토큰 주소, 성공하면 내용이 템플릿으로 옮겨진다
+ * @param line 본문 라인의 줄 번호 (확장할 수 없을 때 오류 위치로 사용)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * label, operator, operand와 EXTDEF/EXTREF 이름의 `&이름`을 MACRO_PARAM_MARK와
+ * 인자 번호 1바이트로 미리 바꾸어 둔다. 확장할 때는 이름을 비교하지 않고
+ * 번호로 인자를 채운다.
+ */
+int macro_template_add(macro *m, token *tok, int line) {
+	macro_mark_params(m, tok->label);
+	macro_mark_params(m, tok->operator);
+	for(int k=0;k<MAX_OPERAND_PER_INST;k++){
+		macro_mark_params(m, tok->operand[k]);
+	}
+	// 이름마다 길이가 줄어들 수 있으므로 앞으로 당겨 다시 이어 붙임
+	char *src = tok->names, *dst = tok->names;
+	for(int k=0;k<tok->names_length;k++){
+		size_t len = strlen(src);
+		macro_mark_params(m, src);
+		size_t marked = strlen(src);
+		memmove(dst, src, marked + 1);
+		dst += marked + 1;
+		src += len + 1;
+	}
+	
+	if(m->body_length >= m->body_capacity){
+		int capacity = m->body_capacity ? m->body_capacity * 2 : 16;
+		token *body = (token*)realloc(m->body, capacity * sizeof(token));
+		if(body==NULL)return -2;
+		m->body = body;
+		int *lines = (int*)realloc(m->lines, capacity * sizeof(int));
+		if(lines==NULL)return -2;
+		m->lines = lines;
+		m->body_capacity = capacity;
+	}
+	m->lines[m->body_length] = line;
+	m->body[m->body_length++] = *tok;
+	
+	return 0;
+}
+
+/**
+ * @brief 템플릿 필드 하나의 인자 참조를 인자 번호로 바꾼다.
+ *
+ * @param m 정의 중인 매크로 주소
+ * @param field 바꿀 필드, 혹은 NULL
+ *
+ * @details
+ * 인자 참조는 항상 원래 길이보다 짧아지므로 제자리에서 변환한다.
+ */
+void macro_mark_params(const macro *m, char *field) {
+	char *src = field, *dst = field;
+	if(field==NULL)return;
+	
+	while(*src){
+		int index = -1, len = 0;
+		if(*src=='&'){
+			for(int p=0;p<m->params;p++){
+				int l = strlen(m->param[p]);
+				// 가장 긴 이름과 일치시켜 &AB와 &ABC를 구분
+				if(l > len && !strncmp(src + 1, m->param[p], l)){
+					index = p;
+					len = l;
+				}
+			}
+		}
+		if(index==-1){
+			*dst++ = *src++;
+			continue;
+		}
+		*dst++ = MACRO_PARAM_MARK;
+		*dst++ = (char)(index + 1);
+		src += len + 1;
+	}
+	*dst = '\0';
+}
+
+/**
+ * @brief 템플릿 필드 하나에 인자 값을 채운 새 문자열을 만든다.
+ *
+ * @param field 템플릿 필드, 혹은 NULL
+ * @param values 인자 번호별 값
+ * @param id 확장 번호, '$'로 시작하는 label을 구분하는 데 사용
+ * @param out 새로 할당한 문자열 주소를 저장할 변수 주소 (field가 NULL이면 NULL)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * '$'는 확장마다 달라지는 두 글자($AA, $AB, ...)로 바꾸어 매크로 안의 label이
+ * 호출마다 겹치지 않도록 한다.
+ */
+int macro_substitute(const char *field, const char *values[], int id,
+					 char **out) {
+	size_t len = 0;
+	*out = NULL;
+	if(field==NULL)return 0;
+	
+	// 필요한 길이를 먼저 계산
+	for(const char *c=field;*c;c++){
+		if(*c==MACRO_PARAM_MARK){
+			len += strlen(values[(unsigned char)*++c - 1]);
+		}
+		else if(*c=='$')len += 3;
+		else len += 1;
+	}
+	
+	char *dst = (char*)calloc(1, len + 1);
+	if(dst==NULL)return -2;
+	*out = dst;
+	
+	for(const char *c=field;*c;c++){
+		if(*c==MACRO_PARAM_MARK){
+			const char *value = values[(unsigned char)*++c - 1];
+			strcpy(dst, value);
+			dst += strlen(value);
+		}
+		else if(*c=='$'){
+			*dst++ = '$';
+			*dst++ = 'A' + id / 26 % 26;
+			*dst++ = 'A' + id % 26;
+		}
+		else *dst++ = *c;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 매크로 호출 하나를 토큰들로 확장하여 토큰 테이블 뒤에 추가한다.
+ *
+ * @param mt 매크로 테이블 주소
+ * @param m 호출한 매크로 주소
+ * @param args 호출 인자 배열
+ * @param args_length 호출 인자 수
+ * @param label 호출 라인의 label, 혹은 NULL
+ * @param tokens 확장한 토큰을 추가할 토큰 테이블 주소
+ * @param expansions 지금까지의 확장 횟수를 저장하는 변수 주소
+ * @param depth 현재 확장의 중첩 깊이
+ * @param clash label이 겹쳐 확장할 수 없을 때 그 정보를 저장할 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * `이름=값` 형태의 인자는 keyword 인자로, 나머지는 순서대로 위치 인자로
+ * 대응시킨다. 주어지지 않은 인자는 기본값 또는 빈 문자열이 되고, 빈 문자열이 된
+ * operand는 제거된다. 호출 라인의 label은 확장된 첫 번째 문장에 붙인다. 그
+ * 문장에 이미 label이 있으면 `clash`의 `m`을 채우고 -1을 반환한다. 본문에 다른
+ * 매크로의 호출이 있으면 MAX_MACRO_DEPTH까지 재귀적으로 확장한다.
+ */
+int macro_expand(const macro_table *mt, const macro *m, const char *args[],
+				 int args_length, const char *label, token_store *tokens,
+				 int *expansions, int depth, macro_clash *clash) {
+	const char *values[MAX_MACRO_PARAMS];
+	int position = 0;
+	int id = (*expansions)++;
+	int err = 0;
+	
+	if(depth >= MAX_MACRO_DEPTH)return -1;
+	// 중첩된 호출이 토큰 테이블을 끝없이 늘리지 않도록 확장을 멈춤
+	if(tokens->length >= MAX_EXPANDED_LINES)return -1;
+	
+	// 기본값으로 초기화한 뒤 인자를 대응시킴
+	for(int p=0;p<m->params;p++){
+		values[p] = m->defaults[p] ? m->defaults[p] : "";
+	}
+	for(int k=0;k<args_length;k++){
+		const char *eq = strchr(args[k], '=');
+		int keyword = -1;
+		if(eq!=NULL && eq!=args[k]){
+			for(int p=0;p<m->params;p++){
+				if(strlen(m->param[p])==(size_t)(eq - args[k]) &&
+				   !strncmp(m->param[p], args[k], eq - args[k])){
+					keyword = p;
+					break;
+				}
+			}
+		}
+		if(keyword!=-1){
+			values[keyword] = eq + 1;
+		}
+		else {
+			if(position >= m->params)return -1;
+			values[position++] = args[k];
+		}
+	}
+	
+	for(int b=0;b<m->body_length && err>=0;b++){
+		const token *tmpl = &m->body[b];
+		token tmp_token;
+		token *tok = &tmp_token;
+		memset(tok, 0, sizeof(token));
+		
+		tok->nixbpe = tmpl->nixbpe;
+		if((err = macro_substitute(tmpl->label, values, id, &tok->label)) < 0 ||
+		   (err = macro_substitute(tmpl->operator, values, id, &tok->operator)) < 0){
+			token_clear(tok);
+			return err;
+		}
+		// 빈 문자열이 된 operand는 제거하고 앞으로 당김
+		int operands = 0;
+		for(int k=0;k<MAX_OPERAND_PER_INST;k++){
+			char *operand;
+			if((err = macro_substitute(tmpl->operand[k], values, id, &operand)) < 0){
+				token_clear(tok);
+				return err;
+			}
+			if(operand!=NULL && *operand=='\0'){
+				free(operand);
+				operand = NULL;
+			}
+			if(operand!=NULL)tok->operand[operands++] = operand;
+		}
+		// EXTDEF, EXTREF 이름도 같은 방식으로 채우고 빈 이름은 제거
+		const char *tmpl_name = tmpl->names;
+		for(int k=0;k<tmpl->names_length;k++){
+			char *name;
+			if((err = macro_substitute(tmpl_name, values, id, &name)) < 0){
+				token_clear(tok);
+				return err;
+			}
+			if(*name!='\0')err = token_names_append(tok, name);
+			free(name);
+			if(err<0){
+				token_clear(tok);
+				return err;
+			}
+			tmpl_name += strlen(tmpl_name) + 1;
+		}
+		if(tmpl->comment!=NULL){
+			tok->comment = (char*)calloc(1, strlen(tmpl->comment) + 1);
+			if(tok->comment==NULL){
+				token_clear(tok);
+				return -2;
+			}
+			strcpy(tok->comment, tmpl->comment);
+		}
+		
+		// 호출 라인의 label은 첫 번째 문장의 label이 됨
+		if(label!=NULL){
+			if(tok->label!=NULL){
+				clash->m = m;
+				clash->body = b;
+				snprintf(clash->label, sizeof(clash->label), "%s", label);
+				snprintf(clash->tmpl, sizeof(clash->tmpl), "%s", tok->label);
+				token_clear(tok);
+				return -1;
+			}
+			tok->label = (char*)calloc(1, strlen(label) + 1);
+			if(tok->label==NULL){
+				token_clear(tok);
+				return -2;
+			}
+			strcpy(tok->label, label);
+			label = NULL;
+		}
+		// 치환이 끝난 label을 이름 풀에 등록
+		if((err = name_intern(tok->label, &tok->label_id)) < 0){
+			token_clear(tok);
+			return err;
+		}
+		
+		// 본문 안의 매크로 호출은 확장한 operand를 인자로 다시 확장
+		const macro *inner = macro_search(mt, tok->operator);
+		if(inner!=NULL){
+			int inner_length = 0;
+			while(inner_length<MAX_OPERAND_PER_INST && tok->operand[inner_length]!=NULL){
+				inner_length++;
+			}
+			err = macro_expand(mt, inner, (const char **)tok->operand,
+							   inner_length, tok->label, tokens, expansions,
+							   depth + 1, clash);
+			token_clear(tok);
+			continue;
+		}
+		
+		err = token_store_add(tokens, tok);
+		token_clear(tok);
+	}
+	
+	return err;
+}
+
+/**
+ * @brief 매크로 하나가 가진 기본값과 템플릿을 해제한다.
+ *
+ * @param m 해제할 매크로 주소
+ */
+void macro_clear(macro *m) {
+	for(int p=0;p<m->params;p++){
+		free(m->defaults[p]);
+	}
+	for(int b=0;b<m->body_length;b++){
+		token_clear(&m->body[b]);
+	}
+	free(m->body);
+	free(m->lines);
+	memset(m, 0, sizeof(macro));
+}
+
+/**
+ * @brief 매크로 테이블 전체를 해제한다.
+ *
+ * @param mt 해제할 매크로 테이블 주소
+ */
+void macro_table_free(macro_table *mt) {
+	for(int i=0;i<mt->length;i++){
+		macro_clear(&mt->macros[i]);
+	}
+	free(mt->macros);
+	memset(mt, 0, sizeof(macro_table));
+}
+
+/**
+ * @brief 리터럴 표현식을 실제 바이트 값으로 변환한다.
+ *
+ * @param str 변환할 리터럴 표현식 (=C'EOF', =X'05' 등)
+ * @param value 변환된 바이트를 저장할 배열 주소
+ * @return 변환된 바이트 수 (형식이 잘못된 경우 -1)
+ */
+int literal_encode(const char *str, unsigned char *value) {
+	int len = strlen(str);
+	int size = 0;
+	unsigned int byte;
+	
+	// '=', 타입 문자, 따옴표 2개를 포함해야 함
+	if(len < 4 || str[0]!='=' || str[2]!='\'' || str[len-1]!='\''){
+		return -1;
+	}
+	
+	if(str[1]=='C'){
+		for(int i=3;i<len-1;i++){
+			value[size++] = (unsigned char)str[i];
+		}
+	}
+	else if(str[1]=='X'){
+		// 16진수는 2글자가 1바이트
+		if((len - 4) % 2 != 0)return -1;
+		for(int i=3;i<len-1;i+=2){
+			if(sscanf(str + i, "%2x", &byte)!=1)return -1;
+			value[size++] = (unsigned char)byte;
+		}
+	}
+	else return -1;
+	
+	return size;
+}
+
+/**
+ * @brief 아직 주소가 할당되지 않은 리터럴들을 하나의 리터럴 pool로 배치한다.
+ *
+ * @param literal_table 리터럴 테이블의 시작 주소
+ * @param literal_table_length 리터럴 테이블의 길이
+ * @param location_counter pool이 시작될 Location Counter 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 리터럴을 표현식이 아닌 실제 바이트 값으로 비교하여 pool 크기를 줄인다. 긴
+ * 리터럴부터 배치하면서 이미 배치된 바이트 안에 포함되는 리터럴은 그 주소를
+ * 공유하고, pool의 끝부분과 앞부분이 겹치는 리터럴은 겹치는 만큼만 이어 붙인다.
+ * 공유된 앞부분의 바이트 수는 `skip`에 저장되어 패스 2에서 출력되지 않는다.
+ * 배치가 끝나면 패스 2가 주소 순서대로 출력할 수 있도록 pool 내부를 주소
+ * 순으로 정렬한다.
+ */
+int place_literal_pool(literal *literal_table[], int literal_table_length,
+					   int *location_counter) {
+	// 할당되지 않은 첫 리터럴을 찾음. 그 이후의 리터럴은 모두 이번 pool에 속하거나
+	// 이전 pool의 리터럴과 주소를 공유하는 리터럴임
+	int start = 0;
+	while(start < literal_table_length && literal_table[start]->addr!=-1){
+		start++;
+	}
+	if(start==literal_table_length)return 0;
+	
+	// 이번 pool에 배치할 리터럴들과 전체 크기를 구함
+	literal **pending = (literal**)calloc(literal_table_length - start, sizeof(literal*));
+	if(pending==NULL)return -2;
+	int pending_length = 0;
+	int total = 0;
+	for(int i=start;i<literal_table_length;i++){
+		if(literal_table[i]->addr==-1){
+			pending[pending_length++] = literal_table[i];
+			total += literal_table[i]->size;
+		}
+	}
+	
+	unsigned char *pool = (unsigned char*)calloc(1, total + 1);
+	if(pool==NULL){
+		free(pending);
+		return -2;
+	}
+	int pool_length = 0;
+	
+	// 긴 리터럴부터 배치해야 짧은 리터럴이 포함될 가능성이 높음
+	// 같은 크기끼리는 등장 순서를 유지하도록 삽입 정렬을 사용
+	for(int i=1;i<pending_length;i++){
+		literal *tmp = pending[i];
+		int j = i;
+		while(j > 0 && pending[j-1]->size < tmp->size){
+			pending[j] = pending[j-1];
+			j--;
+		}
+		pending[j] = tmp;
+	}
+	
+	for(int i=0;i<pending_length;i++){
+		literal *lit = pending[i];
+		int found = -1;
+		
+		// 이미 배치된 바이트 안에 포함되는지 확인
+		for(int k=0;k + lit->size <= pool_length;k++){
+			if(!memcmp(pool + k, lit->value, lit->size)){
+				found = k;
+				break;
+			}
+		}
+		if(found!=-1){
+			lit->addr = *location_counter + found;
+			lit->skip = lit->size;
+			continue;
+		}
+		
+		// pool의 끝부분과 리터럴의 앞부분이 겹치는 최대 길이를 구함
+		int overlap = lit->size - 1;
+		if(overlap > pool_length)overlap = pool_length;
+		while(overlap > 0 &&
+			  memcmp(pool + pool_length - overlap, lit->value, overlap)){
+			overlap--;
+		}
+		lit->addr = *location_counter + pool_length - overlap;
+		lit->skip = overlap;
+		memcpy(pool + pool_length, lit->value + overlap, lit->size - overlap);
+		pool_length += lit->size - overlap;
+	}
+	
+	// 패스 2에서 주소 순서대로 출력하기 위해 정렬
+	for(int i=start+1;i<literal_table_length;i++){
+		literal *tmp = literal_table[i];
+		int j = i;
+		while(j > start && literal_table[j-1]->addr > tmp->addr){
+			literal_table[j] = literal_table[j-1];
+			j--;
+		}
+		literal_table[j] = tmp;
+	}
+	
+	*location_counter += pool_length;
+	free(pool);
+	free(pending);
+	
+	return 0;
+}
+
+/**
+ * @brief 현재 control section에서 심볼 또는 리터럴의 주소를 찾는다.
+ *
+ * @param str 찾을 심볼 이름 또는 리터럴 표현식
+ * @param base 현재 control section 이름의 번호
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 심볼 또는 리터럴의 주소 (찾지 못한 경우 -1)
+ */
+int search_address(const char *str, name_id base,
+				   const symbol *symbol_table[], int symbol_table_length,
+				   const literal *literal_table[], int literal_table_length) {
+	if(str==NULL)return -1;
+	
+	// 등록되지 않은 이름은 심볼 테이블에 있을 수 없음
+	name_id name = name_find(str);
+	for(int k=0;k<symbol_table_length && name!=NAME_NONE;k++){
+		if(symbol_table[k]->name==name && symbol_table[k]->base==base){
+			return symbol_table[k]->addr;
+		}
+	}
+	for(int k=0;k<literal_table_length;k++){
+		if(literal_table[k]->base==base &&
+		   !strcmp(literal_table[k]->literal, str)){
+			return literal_table[k]->addr;
+		}
+	}
+	
+	return -1;
+}
+
+/**
+ * @brief 이전 pool에 배치된 리터럴을 사용하는 라인에서 닿을 수 있는지 확인한다.
+ *
+ * @param lit 배치된 리터럴 주소
+ * @param nixbpe 리터럴을 사용하는 라인의 nixbpe
+ * @param location_counter 다음 명령어의 주소 (PC 값)
+ * @return 닿을 수 있으면 1, 아니면 0
+ *
+ * @details
+ * 4형식은 주소를 그대로 넣으므로 항상 닿는다. 3형식은 pc relative 범위만
+ * 확인한다. BASE의 값은 pass 1에서 아직 정해지지 않았을 수 있으므로 base
+ * relative로만 닿는 리터럴은 공유하지 않고 다음 pool에 새로 배치한다.
+ */
+int literal_reachable(const literal *lit, int nixbpe, int location_counter) {
+	if(nixbpe & 1)return 1;
+	int disp = lit->addr - location_counter;
+	return -2048 <= disp && disp <= 2047;
+}
+
+/**
+ * @brief 같은 리터럴이 여러 pool에 있을 때 사용하는 라인에서 가장 가까운 주소를 찾는다.
+ *
+ * @param str 찾을 리터럴 표현식
+ * @param base 현재 control section 이름의 번호
+ * @param location_counter 다음 명령어의 주소 (PC 값)
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 리터럴의 주소 (찾지 못한 경우 -1)
+ *
+ * @details
+ * pass 1은 닿지 않는 이전 pool의 리터럴을 공유하지 않고 다음 pool에 새로
+ * 배치하므로 같은 리터럴이 여러 번 테이블에 있을 수 있다. 닿는 리터럴이 있으면
+ * 가장 가까운 리터럴이 닿으므로 가장 가까운 주소를 사용한다. 거리가 같으면
+ * pc relative 범위가 뒤쪽으로 한 바이트 짧으므로 앞의 주소를 사용한다.
+ */
+int search_literal(const char *str, name_id base, int location_counter,
+				   const literal *literal_table[], int literal_table_length) {
+	int addr = -1;
+	int best = 0;
+	for(int k=0;k<literal_table_length;k++){
+		if(literal_table[k]->base!=base ||
+		   strcmp(literal_table[k]->literal, str))continue;
+		int dist = abs(literal_table[k]->addr - location_counter);
+		if(addr==-1 || dist < best ||
+		   (dist==best && literal_table[k]->addr < addr)){
+			addr = literal_table[k]->addr;
+			best = dist;
+		}
+	}
+	return addr;
+}
+
+/**
+ * @brief 3형식 명령어의 displacement를 계산하여 오브젝트 코드에 채운다.
+ *
+ * @param value p비트가 설정된 상태의 3형식 오브젝트 코드 주소
+ * @param target 목표 주소
+ * @param location_counter 다음 명령어의 주소 (PC 값)
+ * @param base_addr BASE로 선언된 주소 (NOBASE인 경우 -1)
+ * @return 0 = pc relative, 1 = base relative, -1 = 범위를 벗어남
+ *
+ * @details
+ * pc relative(-2048 ~ 2047)를 먼저 시도하고, 범위를 벗어나면 BASE가 선언되어
+ * 있을 때에 한해 base relative(0 ~ 4095)로 인코딩한다. base relative를 사용하는
+ * 경우 p비트를 끄고 b비트를 켠다.
+ */
+int calc_relative_disp(int *value, int target, int location_counter,
+					   int base_addr) {
+	int disp = target - location_counter;
+	
+	// pc relative로 표현 가능한 경우
+	if(-2048 <= disp && disp <= 2047){
+		*value |= (disp & 0xFFF);
+		return 0;
+	}
+	
+	// BASE가 선언되어 있고 base relative로 표현 가능한 경우
+	disp = target - base_addr;
+	if(base_addr >= 0 && 0 <= disp && disp <= 4095){
+		// nixbpe는 12비트 밀려있으므로 p비트(2)를 끄고 b비트(4)를 켬
+		*value &= ~(2 << 12);
+		*value |= (4 << 12);
+		*value |= disp;
+		return 1;
+	}
+	
+	return -1;
+}
+
+/**
+ * @brief 외부 참조 집합에 이름을 추가한다.
+ *
+ * @param set 외부 참조 집합 주소
+ * @param name 추가할 이름의 번호
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * open addressing 해시 테이블이며, 절반 이상 차면 두 배로 늘려 다시 배치한다.
+ * 이미 있는 이름은 다시 추가하지 않는다.
+ */
+int extref_set_add(extref_set *set, name_id name) {
+	if(extref_set_contains(set, name))return 0;
+	
+	if((set->length + 1) * 2 > set->capacity){
+		int capacity = set->capacity ? set->capacity * 2 : 64;
+		name_id *names = (name_id*)calloc(capacity, sizeof(name_id));
+		if(names==NULL)return -2;
+		for(int i=0;i<set->capacity;i++){
+			if(set->names[i]==NAME_NONE)continue;
+			unsigned int k = (set->names[i] * 2654435761u) & (capacity - 1);
+			while(names[k]!=NAME_NONE)k = (k + 1) & (capacity - 1);
+			names[k] = set->names[i];
+		}
+		free(set->names);
+		set->names = names;
+		set->capacity = capacity;
+	}
+	
+	unsigned int k = (name * 2654435761u) & (set->capacity - 1);
+	while(set->names[k]!=NAME_NONE)k = (k + 1) & (set->capacity - 1);
+	set->names[k] = name;
+	set->length++;
+	
+	return 0;
+}
+
+/**
+ * @brief 외부 참조 집합에 이름이 있는지 확인한다.
+ *
+ * @param set 외부 참조 집합 주소
+ * @param name 찾을 이름의 번호
+ * @return 있으면 1, 없으면 0
+ */
+int extref_set_contains(const extref_set *set, name_id name) {
+	if(set->length==0 || name==NAME_NONE)return 0;
+	
+	unsigned int k = (name * 2654435761u) & (set->capacity - 1);
+	while(set->names[k]!=NAME_NONE){
+		if(set->names[k]==name)return 1;
+		k = (k + 1) & (set->capacity - 1);
+	}
+	return 0;
+}
+
+/**
+ * @brief 다음 control section을 위해 외부 참조 집합을 비운다.
+ *
+ * @param set 외부 참조 집합 주소
+ *
+ * @details
+ * 할당된 슬롯은 다음 control section에서 다시 사용한다.
+ */
+void extref_set_clear(extref_set *set) {
+	if(set->names!=NULL){
+		memset(set->names, 0, set->capacity * sizeof(name_id));
+	}
+	set->length = 0;
+}
+
+/**
+ * @brief 외부 참조 집합이 사용하던 메모리를 해제한다.
+ *
+ * @param set 외부 참조 집합 주소
+ */
+void extref_set_free(extref_set *set) {
+	free(set->names);
+	memset(set, 0, sizeof(extref_set));
+}
+
+/**
+ * @brief 수식 문자열을 심볼 번호가 미리 결정된 RPN 형태로 컴파일한다.
+ *
+ * @param str 컴파일할 수식 문자열
+ * @param base 수식이 속한 control section 이름의 번호
+ * @param location 수식의 '*'가 가리키는 주소
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param refs 현재 control section의 EXTREF 이름 집합
+ * @param out 새로 할당한 수식 주소를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 10진수, 심볼, 외부 참조, 현재 위치('*'), 단항 '-', '+ - * /'와 괄호를
+ * 지원한다. '*'는 피연산자 자리에서는 현재 위치, 연산자 자리에서는 곱셈이다.
+ * 심볼은 같은 control section의 심볼 테이블 번호로, 외부 참조는 수식 안의 외부
+ * 이름 번호로 바꾸어 두므로 계산할 때 이름을 다시 찾지 않는다. 정의되지 않은
+ * 이름은 오류이다.
+ */
+int expr_compile(const char *str, name_id base, int location,
+				 const symbol *symbol_table[], int symbol_table_length,
+				 const extref_set *refs, expression **out) {
+	expression tmp;
+	expr_item items[MAX_EXPR_ITEMS];
+	char ops[MAX_EXPR_ITEMS];
+	int length = 0, ops_length = 0;
+	// 다음에 피연산자가 올 차례인지 (단항 연산자와 '*'를 구분)
+	int expect_operand = 1;
+	
+	memset(&tmp, 0, sizeof(tmp));
+	tmp.location = location;
+	*out = NULL;
+	
+	while(*str){
+		expr_item item;
+		memset(&item, 0, sizeof(item));
+		
+		if(length >= MAX_EXPR_ITEMS || ops_length >= MAX_EXPR_ITEMS)return -1;
+		
+		// 10진수
+		if(*str>='0' && *str<='9'){
+			if(!expect_operand)return -1;
+			long number = 0;
+			while(*str>='0' && *str<='9'){
+				number = number * 10 + (*str++ - '0');
+				if(number > 0xFFFFFF)return -1;
+			}
+			item.kind = EXPR_NUMBER;
+			item.value = (int)number;
+			items[length++] = item;
+			expect_operand = 0;
+			continue;
+		}
+		
+		// 심볼 또는 외부 참조
+		if((*str>='A' && *str<='Z') || (*str>='a' && *str<='z') || *str=='$'){
+			char name[MAX_LINE_LENGTH];
+			int len = 0;
+			if(!expect_operand)return -1;
+			while((*str>='A' && *str<='Z') || (*str>='a' && *str<='z') ||
+				  (*str>='0' && *str<='9') || *str=='$' || *str=='_'){
+				if(len >= (int)sizeof(name) - 1)return -1;
+				name[len++] = *str++;
+			}
+			name[len] = '\0';
+			
+			// 등록되지 않은 이름은 심볼도 외부 참조도 아니므로 정의되지 않은 심볼
+			name_id id = name_find(name);
+			if(id==NAME_NONE)return -1;
+			
+			item.value = -1;
+			for(int k=0;k<symbol_table_length;k++){
+				if(symbol_table[k]->name==id && symbol_table[k]->base==base){
+					item.kind = EXPR_SYMBOL;
+					item.value = k;
+					break;
+				}
+			}
+			if(item.value==-1 && extref_set_contains(refs, id)){
+				// 같은 외부 이름은 한 번만 저장
+				int e = 0;
+				while(e<tmp.externs_length && tmp.externs[e]!=id)e++;
+				if(e==tmp.externs_length){
+					if(e >= MAX_EXPR_EXTERNS)return -1;
+					tmp.externs[tmp.externs_length++] = id;
+				}
+				item.kind = EXPR_EXTERN;
+				item.value = e;
+			}
+			// 정의되지 않은 심볼
+			if(item.value==-1)return -1;
+			
+			items[length++] = item;
+			expect_operand = 0;
+			continue;
+		}
+		
+		char c = *str++;
+		if(expect_operand){
+			if(c=='*'){
+				item.kind = EXPR_LOCATION;
+				items[length++] = item;
+				expect_operand = 0;
+			}
+			else if(c=='(')ops[ops_length++] = '(';
+			else if(c=='-')ops[ops_length++] = 'n';
+			else if(c!='+')return -1;
+			continue;
+		}
+		
+		if(c==')'){
+			while(ops_length>0 && ops[ops_length - 1]!='('){
+				item.kind = EXPR_OPERATOR;
+				item.op = ops[--ops_length];
+				items[length++] = item;
+			}
+			if(ops_length==0)return -1;
+			ops_length--;
+			continue;
+		}
+		if(c!='+' && c!='-' && c!='*' && c!='/')return -1;
+		
+		// 우선순위가 같거나 높은 연산자를 먼저 출력 (왼쪽 결합)
+		while(ops_length>0 && ops[ops_length - 1]!='(' &&
+			  expr_precedence(ops[ops_length - 1]) >= expr_precedence(c)){
+			if(length >= MAX_EXPR_ITEMS)return -1;
+			item.kind = EXPR_OPERATOR;
+			item.op = ops[--ops_length];
+			items[length++] = item;
+		}
+		ops[ops_length++] = c;
+		expect_operand = 1;
+	}
+	
+	if(expect_operand)return -1;
+	while(ops_length>0){
+		if(ops[ops_length - 1]=='(' || length >= MAX_EXPR_ITEMS)return -1;
+		expr_item item;
+		memset(&item, 0, sizeof(item));
+		item.kind = EXPR_OPERATOR;
+		item.op = ops[--ops_length];
+		items[length++] = item;
+	}
+	
+	// 항목 수만큼만 할당
+	*out = (expression*)malloc(sizeof(expression) + length * sizeof(expr_item));
+	if(*out==NULL)return -2;
+	memcpy(*out, &tmp, sizeof(expression));
+	(*out)->length = length;
+	memcpy((*out)->items, items, length * sizeof(expr_item));
+	
+	return 0;
+}
+
+/**
+ * @brief 연산자의 우선순위를 반환한다.
+ *
+ * @param op 연산자 문자 ('n'은 단항 '-')
+ * @return 우선순위 (클수록 먼저 계산)
+ */
+int expr_precedence(char op) {
+	if(op=='n')return 3;
+	if(op=='*' || op=='/')return 2;
+	return 1;
+}
+
+/**
+ * @brief 컴파일된 수식의 값과 재배치 정보를 계산한다.
+ *
+ * @param expr 컴파일된 수식 주소
+ * @param symbol_table 심볼 테이블 주소
+ * @param result 계산 결과를 저장할 구조체 주소
+ * @return 0 = 계산 완료, 1 = 아직 값이 정해지지 않은 EQU 심볼을 참조,
+ *         음수 = 오류
+ *
+ * @details
+ * 값과 함께 relative 항의 개수(더하면 +1, 빼면 -1)와 외부 참조별 계수를
+ * 계산한다. 곱셈과 나눗셈은 두 피연산자가 모두 absolute인 경우에만 허용한다.
+ */
+int expr_eval(const expression *expr, const symbol *symbol_table[],
+			  expr_value *result) {
+	expr_value stack[MAX_EXPR_ITEMS];
+	int top = 0;
+	
+	for(int i=0;i<expr->length;i++){
+		const expr_item *item = &expr->items[i];
+		
+		if(item->kind!=EXPR_OPERATOR){
+			expr_value *v = &stack[top++];
+			memset(v, 0, sizeof(expr_value));
+			if(item->kind==EXPR_NUMBER){
+				v->value = item->value;
+			}
+			else if(item->kind==EXPR_LOCATION){
+				v->value = expr->location;
+				v->relative = 1;
+			}
+			else if(item->kind==EXPR_SYMBOL){
+				const symbol *sym = symbol_table[item->value];
+				if(sym->pending)return 1;
+				v->value = sym->addr;
+				v->relative = sym->absolute ? 0 : 1;
+			}
+			else {
+				v->externs[item->value] = 1;
+			}
+			continue;
+		}
+		
+		// 단항 '-'
+		if(item->op=='n'){
+			expr_value *v = &stack[top - 1];
+			v->value = -v->value;
+			v->relative = -v->relative;
+			for(int e=0;e<expr->externs_length;e++){
+				v->externs[e] = -v->externs[e];
+			}
+			continue;
+		}
+		
+		expr_value *l = &stack[top - 2], *r = &stack[top - 1];
+		top--;
+		if(item->op=='+' || item->op=='-'){
+			int sign = item->op=='+' ? 1 : -1;
+			l->value += sign * r->value;
+			l->relative += sign * r->relative;
+			for(int e=0;e<expr->externs_length;e++){
+				l->externs[e] += sign * r->externs[e];
+			}
+			continue;
+		}
+		
+		// 곱셈과 나눗셈은 absolute끼리만 가능
+		if(l->relative!=0 || r->relative!=0)return -1;
+		for(int e=0;e<expr->externs_length;e++){
+			if(l->externs[e]!=0 || r->externs[e]!=0)return -1;
+		}
+		if(item->op=='*')l->value *= r->value;
+		else {
+			if(r->value==0)return -1;
+			l->value /= r->value;
+		}
+	}
+	
+	*result = stack[0];
+	return 0;
+}
+
+/**
+ * @brief 토큰 테이블에서 수식을 사용하는 operand를 컴파일한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param tokens 토큰 테이블의 주소
+ * @param scope 이전 라인들까지의 control section 정보 주소
+ * @param symbol_table 심볼 테이블의 주소
+ * @param symbol_table_length 심볼 테이블의 길이
+ * @param pending 컴파일한 EQU 수를 더할 변수 주소, 혹은 NULL (NULL이면 EQU는
+ * 건너뜀)
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * control section 이름과 EXTREF 목록은 `scope`에 남으므로 토큰 테이블을 나누어
+ * 차례로 호출할 수 있다. 컴파일하지 못한 operand는 정의되지 않은 이름이 있으면
+ * 그 이름의 위치로, 아니면 operand의 위치로 기록한다.
+ */
+int compile_expressions(const inst *inst_table[], token_store *tokens,
+						expr_scope *scope, const symbol *symbol_table[],
+						int symbol_table_length, int *pending,
+						diag_list *diags) {
+	char name[MAX_LINE_LENGTH];
+	int err = 0;
+	
+	token view;
+	token *tok = &view;
+	
+	for(int i=0;i<tokens->length && err>=0;i++){
+		token_store_get(tokens, i, tok);
+		const char *operand = tok->operand[0];
+		
+		if(tok->operator==NULL)continue;
+		
+		// control section이 바뀌면 EXTREF 목록도 새로 시작
+		if(!strcmp(tok->operator, "START") || !strcmp(tok->operator, "CSECT")){
+			scope->base = tok->label_id;
+			extref_set_clear(&scope->refs);
+			continue;
+		}
+		if(!strcmp(tok->operator, "EXTREF")){
+			const char *ref = tok->names;
+			for(int k=0;k<tok->names_length && err>=0;k++){
+				name_id name = NAME_NONE;
+				if((err = name_intern(ref, &name)) >= 0){
+					err = extref_set_add(&scope->refs, name);
+				}
+				ref += strlen(ref) + 1;
+			}
+			continue;
+		}
+		
+		if(operand==NULL)continue;
+		if(!strcmp(tok->operator, "EQU")){
+			if(pending==NULL || !strcmp(operand, "*"))continue;
+			(*pending)++;
+		}
+		else if(strcmp(tok->operator, "WORD")){
+			// 3/4형식 명령어의 리터럴이 아닌 operand만 컴파일
+			int inst_index = tokens->opcode[i];
+			if(inst_index==-1 || inst_table[inst_index]->format/10!=3)continue;
+			if(*operand=='=')continue;
+			if(*operand=='#' || *operand=='@')operand += 1;
+		}
+		
+		err = expr_compile(operand, scope->base, tok->addr, symbol_table,
+						   symbol_table_length, &scope->refs, &tokens->expr[i]);
+		if(err!=-1)continue;
+		
+		// 계산할 수 없는 EQU는 남은 수에서 뺌
+		if(!strcmp(tok->operator, "EQU"))(*pending)--;
+		int column = token_column(tok, 2) + (int)(operand - tok->operand[0]);
+		int at = expr_find_undefined(operand, scope->base, symbol_table,
+									 symbol_table_length, &scope->refs, name,
+									 sizeof(name));
+		if(at>=0){
+			err = diag_token(diags, tokens, i, column + at,
+							 "정의되지 않은 심볼 '%s'을(를) 사용했습니다.", name);
+		}
+		else {
+			err = diag_token(diags, tokens, i, column,
+							 "operand '%s'의 수식이 잘못되었습니다.", operand);
+		}
+	}
+	
+	return err < 0 ? err : 0;
+}
+
+/**
+ * @brief 수식 문자열에서 심볼 테이블과 EXTREF 어디에도 없는 첫 번째 이름을 찾는다.
+ *
+ * @param str 수식 문자열
+ * @param base 수식이 속한 control section 이름의 번호
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param refs 현재 control section의 EXTREF 이름 집합
+ * @param name 찾은 이름을 저장할 버퍼
+ * @param name_size 버퍼의 크기
+ * @return 이름이 시작하는 위치 (없는 경우 -1)
+ *
+ * @details
+ * expr_compile이 실패한 뒤 오류의 원인을 알리기 위해서만 사용하므로 이름을
+ * 읽는 규칙은 expr_compile과 같다.
+ */
+int expr_find_undefined(const char *str, name_id base,
+						const symbol *symbol_table[], int symbol_table_length,
+						const extref_set *refs, char *name, int name_size) {
+	const char *p = str;
+	
+	while(*p){
+		if(!((*p>='A' && *p<='Z') || (*p>='a' && *p<='z') || *p=='$')){
+			p++;
+			continue;
+		}
+		
+		const char *start = p;
+		int len = 0;
+		while((*p>='A' && *p<='Z') || (*p>='a' && *p<='z') ||
+			  (*p>='0' && *p<='9') || *p=='$' || *p=='_'){
+			if(len < name_size - 1)name[len++] = *p;
+			p++;
+		}
+		name[len] = '\0';
+		
+		name_id id = name_find(name);
+		int found = id!=NAME_NONE && extref_set_contains(refs, id);
+		for(int k=0;k<symbol_table_length && !found && id!=NAME_NONE;k++){
+			found = symbol_table[k]->name==id && symbol_table[k]->base==base;
+		}
+		if(!found)return (int)(start - str);
+	}
+	
+	return -1;
+}
+
+/**
+ * @brief pass 1이 끝난 뒤 수식을 사용하는 operand를 컴파일하고 EQU 값을
+ * 계산한다.
+ *
+ * @param inst_table 기계어 목록 테이블의 주소
+ * @param inst_table_length 기계어 목록 테이블의 길이
+ * @param tokens 토큰 테이블의 주소
+ * @param symbol_table 심볼 테이블의 주소
+ * @param symbol_table_length 심볼 테이블의 길이
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * EQU, WORD와 3/4형식 명령어의 operand를 한 번만 컴파일하여 토큰에 저장하고,
+ * pass 2는 저장된 수식을 계산만 한다. 리터럴 operand는 컴파일하지 않는다. EQU는
+ * 참조하는 EQU의 값이 정해질 때까지 계산을 미루며, 더 이상 정해지는 값이 없는데
+ * 남은 EQU가 있다면 남은 EQU마다 순환 정의 오류를 기록한다. EQU는 이름이 아니라
+ * 심볼에 기록된 정의 라인(`line`)으로 찾으므로 같은 이름이 여러 번 정의되어도
+ * 각 EQU는 자신의 심볼에 값을 채운다. 매 반복마다 남은 EQU는 값이 정해지거나
+ * 오류로 기록되어 줄어들므로 반복은 항상 끝난다.
+ */
+int resolve_expressions(const inst *inst_table[], int inst_table_length,
+						token_store *tokens, symbol *symbol_table[],
+						int symbol_table_length, diag_list *diags) {
+	expr_scope scope;
+	int pending = 0;
+	int err = 0;
+	
+	token view;
+	token *tok = &view;
+	
+	memset(&scope, 0, sizeof(scope));
+	err = compile_expressions(inst_table, tokens, &scope,
+							  (const symbol **)symbol_table,
+							  symbol_table_length, &pending, diags);
+	extref_set_free(&scope.refs);
+	if(err<0)return err;
+	
+	// 남은 EQU를 심볼로 다시 셈 (수식을 컴파일하지 못한 EQU는 오류를 이미
+	// 기록했으므로 값 없이 끝냄)
+	pending = 0;
+	for(int k=0;k<symbol_table_length;k++){
+		symbol *sym = symbol_table[k];
+		if(!sym->pending)continue;
+		if(sym->line < 0 || sym->line >= tokens->length ||
+		   tokens->expr[sym->line]==NULL){
+			sym->pending = 0;
+		}
+		else pending++;
+	}
+	
+	// 참조하는 값이 정해진 EQU부터 차례로 계산
+	// (더 이상 정해지는 값이 없으면 한 번 더 돌며 남은 EQU를 오류로 기록)
+	int report = 0;
+	while(pending > 0){
+		int progress = 0;
+		for(int k=0;k<symbol_table_length;k++){
+			symbol *sym = symbol_table[k];
+			expr_value ev;
+			
+			if(!sym->pending)continue;
+			int i = sym->line;
+			token_store_get(tokens, i, tok);
+			
+			// 순환 정의
+			if(report){
+				if((err = diag_token(diags, tokens, i, token_column(tok, 2),
+									 "EQU '%s'의 값이 순환 정의되어 정해지지 "
+									 "않습니다.", tok->label)) < 0){
+					return err;
+				}
+				sym->pending = 0;
+				pending--;
+				continue;
+			}
+			
+			if((err = expr_eval(tok->expr, (const symbol **)symbol_table, &ev)) < 0){
+				if((err = diag_token(diags, tokens, i, token_column(tok, 2),
+									 "EQU '%s'의 값을 계산할 수 없습니다.",
+									 tok->label)) < 0){
+					return err;
+				}
+				sym->pending = 0;
+				pending--;
+				continue;
+			}
+			if(err==1)continue;
+			
+			// 심볼은 absolute 또는 relative 하나여야 하고 외부 참조를 가질 수 없음
+			int valid = ev.relative==0 || ev.relative==1;
+			for(int e=0;e<tok->expr->externs_length;e++){
+				if(ev.externs[e]!=0)valid = 0;
+			}
+			if(!valid && (err = diag_token(diags, tokens, i, token_column(tok, 2),
+										   "EQU '%s'의 값은 absolute 또는 "
+										   "relative 하나여야 하며 외부 참조를 "
+										   "사용할 수 없습니다.",
+										   tok->label)) < 0){
+				return err;
+			}
+			sym->addr = ev.value;
+			sym->absolute = ev.relative==0;
+			sym->pending = 0;
+			pending--;
+			progress = 1;
+		}
+		if(!progress)report = 1;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 3/4형식 명령어의 컴파일된 operand를 계산하여 주소 필드를 채운다.
+ *
+ * @param value opcode와 nixbpe가 채워진 오브젝트 코드 주소
+ * @param tok 명령어 토큰 주소
+ * @param symbol_table 심볼 테이블 주소
+ * @param location_counter 다음 명령어의 주소 (PC 값)
+ * @param base_addr BASE로 선언된 주소 (NOBASE인 경우 -1)
+ * @param base 현재 control section 이름의 번호
+ * @param mod_table Modification Record 배열 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 4형식은 값을 20비트 주소 필드에 그대로 넣고 외부 참조마다 Modification
+ * Record를 추가한다. 3형식에서 relative 값은 pc/base relative로, absolute 값은
+ * 0 ~ 4095 범위에서 p, b비트 없이 그대로 넣는다. 3형식은 외부 참조를 사용할 수
+ * 없다.
+ */
+int encode_operand_expr(int *value, const token *tok,
+						const symbol *symbol_table[], int location_counter,
+						int base_addr, name_id base,
+						modification_table *mod_table, assem_stat *stat) {
+	expr_value ev;
+	int relative;
+	
+	if(expr_eval(tok->expr, symbol_table, &ev)!=0)return -1;
+	
+	if(tok->nixbpe & 1){
+		if(ev.relative!=0 && ev.relative!=1)return -1;
+		*value |= ev.value & 0xFFFFF;
+		// 외부 참조의 계수만큼 주소 필드(20비트, 5 half-byte)를 수정
+		for(int e=0;e<tok->expr->externs_length;e++){
+			int count = ev.externs[e] < 0 ? -ev.externs[e] : ev.externs[e];
+			for(int c=0;c<count;c++){
+				if(modification_add(mod_table, tok->expr->externs[e], base,
+									location_counter - 3, 5,
+									ev.externs[e] < 0 ? '-' : '+', stat)<0){
+					return -2;
+				}
+			}
+		}
+		return 0;
+	}
+	
+	for(int e=0;e<tok->expr->externs_length;e++){
+		if(ev.externs[e]!=0)return -1;
+	}
+	// absolute 값은 주소를 그대로 사용
+	if(ev.relative==0){
+		if(ev.value<0 || ev.value>4095)return -1;
+		*value &= ~(2 << 12);
+		*value |= ev.value;
+		return 0;
+	}
+	if(ev.relative!=1)return -1;
+	
+	*value |= (2 << 12);
+	relative = calc_relative_disp(value, ev.value, location_counter, base_addr);
+	if(relative<0)return -1;
+	if(relative==1 && stat!=NULL)stat->base_relative++;
+	return 0;
+}
+
+/**
+ * @brief 작성 중인 Text Record를 오브젝트 코드의 한 줄로 내보낸다.
+ *
+ * @param text 작성 중인 Text Record 주소
+ * @param now 오브젝트 코드의 현재 (비어있는) 줄을 가리키는 포인터의 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 기록된 바이트가 없으면 아무것도 하지 않는다. Text Record를 기록한 뒤 다음 줄을
+ * 할당하여 `now`를 이동시킨다.
+ */
+int text_record_flush(text_record *text, object_code **now, assem_stat *stat) {
+	// 명령어 단위로 끊었을 때의 Text Record도 함께 마무리
+	if(text->aligned_length > 0){
+		if(stat!=NULL)stat->aligned_records++;
+		text->aligned_length = 0;
+	}
+	
+	if(text->length==0)return 0;
+	
+	sprintf((*now)->line, "T%06X%02X%s", text->start, text->length, text->hex);
+	(*now)->next = (object_code*)calloc(1, sizeof(object_code));
+	if((*now)->next==NULL){
+		return -2;
+	}
+	*now = (*now)->next;
+	
+	if(stat!=NULL)stat->text_records++;
+	text->length = 0;
+	memset(text->hex, 0, sizeof(text->hex));
+	
+	return 0;
+}
+
+/**
+ * @brief 생성된 코드를 Text Record에 채운다.
+ *
+ * @param text 작성 중인 Text Record 주소
+ * @param addr 코드가 위치할 시작 주소
+ * @param hex 코드를 나타내는 16진수 문자열
+ * @param now 오브젝트 코드의 현재 (비어있는) 줄을 가리키는 포인터의 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 작성 중인 Text Record와 주소가 이어지지 않는 경우에만 새로운 Text Record를
+ * 시작하고, 그 외에는 명령어 경계와 상관없이 최대 길이(30바이트)까지 채운다.
+ * 비교를 위해 명령어 단위로만 끊었을 경우의 Text Record 수도 함께 센다.
+ */
+int text_record_append(text_record *text, int addr, const char *hex,
+					   object_code **now, assem_stat *stat) {
+	int bytes = strlen(hex) / 2;
+	if(bytes==0)return 0;
+	
+	// 주소가 이어지지 않으면 작성 중인 Text Record를 내보냄
+	if(text->length > 0 && text->start + text->length != addr){
+		if(text_record_flush(text, now, stat)<0)return -2;
+	}
+	// 명령어 단위로 끊는 경우 이번 코드가 들어가지 않으면 새로운 record가 필요
+	if(text->aligned_length > 0 &&
+	   (text->aligned_length + bytes > MAX_TEXT_RECORD_LENGTH ||
+		text->aligned_end != addr)){
+		if(stat!=NULL)stat->aligned_records++;
+		text->aligned_length = 0;
+	}
+	text->aligned_length += bytes;
+	text->aligned_end = addr + bytes;
+	
+	for(int i=0;i<bytes;i++){
+		if(text->length==0){
+			text->start = addr + i;
+		}
+		text->hex[text->length * 2] = hex[i * 2];
+		text->hex[text->length * 2 + 1] = hex[i * 2 + 1];
+		text->length++;
+		
+		// 최대 길이까지 채웠다면 바로 내보냄
+		if(text->length==MAX_TEXT_RECORD_LENGTH){
+			int aligned_length = text->aligned_length;
+			text->aligned_length = 0;
+			if(text_record_flush(text, now, stat)<0)return -2;
+			text->aligned_length = aligned_length;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief Modification Record 하나를 배열에 추가한다.
+ *
+ * @param mod_table Modification Record 배열 주소
+ * @param name 외부 참조 심볼 이름의 번호
+ * @param base 현재 control section 이름의 번호
+ * @param addr 수정할 주소
+ * @param pos 수정할 half-byte 수
+ * @param op 수정 연산 ('+' 또는 '-')
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 배열이 가득 찬 경우 크기를 두 배로 늘린다. control section이 바뀌어도 배열을
+ * 비우기만 하고 다시 사용하므로 참조마다 할당하지 않는다.
+ */
+int modification_add(modification_table *mod_table, name_id name,
+					 name_id base, int addr, int pos, char op,
+					 assem_stat *stat) {
+	if(mod_table->length==mod_table->capacity){
+		int capacity = mod_table->capacity ? mod_table->capacity * 2 : 16;
+		modification_record *records = (modification_record*)realloc(
+			mod_table->records, capacity * sizeof(modification_record));
+		if(records==NULL)return -2;
+		mod_table->records = records;
+		mod_table->capacity = capacity;
+	}
+	
+	modification_record *rec = &mod_table->records[mod_table->length++];
+	memset(rec, 0, sizeof(modification_record));
+	rec->name = name;
+	rec->base = base;
+	rec->addr = addr;
+	rec->pos = pos;
+	rec->op = op;
+	
+	if(stat!=NULL)stat->mod_records_raw++;
+	
+	return 0;
+}
+
+/**
+ * @brief Modification Record의 정렬 순서를 정하는 비교 함수 (qsort용)
+ *
+ * @details
+ * 주소, 수정 길이, 심볼 이름, 연산 순서로 비교한다. 같은 위치에 같은 심볼을
+ * 더하고 빼는 record가 서로 이웃하게 된다.
+ */
+int modification_compare(const void *a, const void *b) {
+	const modification_record *x = (const modification_record*)a;
+	const modification_record *y = (const modification_record*)b;
+	
+	if(x->addr!=y->addr)return x->addr - y->addr;
+	if(x->pos!=y->pos)return x->pos - y->pos;
+	if(x->name!=y->name){
+		// 출력 순서가 번호 발급 순서에 영향을 받지 않도록 이름으로 비교
+		return strcmp(name_str(x->name), name_str(y->name));
+	}
+	return x->op - y->op;
+}
+
+/**
+ * @brief EXTDEF, EXTREF 라인으로 Define Record 또는 Refer Record를 출력한다.
+ *
+ * @param tok EXTDEF 또는 EXTREF 토큰 주소
+ * @param base 현재 control section 이름의 번호
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @param now 오브젝트 코드의 현재 (비어있는) 줄을 가리키는 포인터의 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 한 줄이 MAX_OBJECT_CODE_STRING - 1자를 넘지 않도록 필요한 만큼 여러 줄로
+ * 나누어 출력한다. Define Record는 6자리로 맞춘 이름과 주소 6자리를, Refer
+ * Record는 6자리로 맞춘 이름을 이어 붙인다. 현재 control section에 정의되지
+ * 않은 이름을 EXTDEF하면 오류이다.
+ */
+int make_external_records(const token *tok, name_id base,
+						  const symbol *symbol_table[], int symbol_table_length,
+						  const literal *literal_table[], int literal_table_length,
+						  object_code **now) {
+	char type = !strcmp(tok->operator, "EXTDEF") ? 'D' : 'R';
+	char entry[32];
+	
+	const char *name = tok->names;
+	for(int k=0;k<tok->names_length;k++, name += strlen(name) + 1){
+		if(type=='D'){
+			int addr = search_address(name, base, symbol_table,
+									  symbol_table_length, literal_table,
+									  literal_table_length);
+			if(addr==-1)return -1;
+			snprintf(entry, sizeof(entry), "%-6s%06X", name, addr);
+		}
+		else snprintf(entry, sizeof(entry), "%-6s", name);
+		
+		// 현재 줄에 들어가지 않으면 다음 줄에서 새 record를 시작
+		if((*now)->line[0]!='\0' &&
+		   strlen((*now)->line) + strlen(entry) > MAX_OBJECT_CODE_STRING - 1){
+			(*now)->next = (object_code*)calloc(1, sizeof(object_code));
+			if((*now)->next==NULL)return -2;
+			*now = (*now)->next;
+		}
+		if((*now)->line[0]=='\0')(*now)->line[0] = type;
+		strcat((*now)->line, entry);
+	}
+	
+	// 다음 포인터를 지정
+	(*now)->next = (object_code*)calloc(1, sizeof(object_code));
+	if((*now)->next==NULL)return -2;
+	*now = (*now)->next;
+	
+	return 0;
+}
+
+/**
+ * @brief 현재 control section의 Modification Record를 정렬, 병합하여 출력한다.
+ *
+ * @param mod_table Modification Record 배열 주소
+ * @param now 오브젝트 코드의 현재 (비어있는) 줄을 가리키는 포인터의 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 주소 순으로 정렬한 뒤 같은 위치에서 같은 심볼을 더하고 빼는 record 쌍은
+ * 결과가 0이므로 함께 제거한다. 같은 위치에 같은 심볼을 두 번 더하는 record는
+ * 값을 두 번 더해야 하므로 그대로 둔다. 출력이 끝나면 배열을 비운다.
+ */
+int make_modification_records(modification_table *mod_table,
+							  object_code **now, assem_stat *stat) {
+	if(mod_table->length > 0){
+		qsort(mod_table->records, mod_table->length,
+			  sizeof(modification_record), modification_compare);
+	}
+	
+	// 정렬 후 '+'와 '-'가 이웃한 같은 위치, 같은 심볼의 record를 상쇄
+	int length = 0;
+	for(int i=0;i<mod_table->length;i++){
+		modification_record *rec = &mod_table->records[i];
+		if(length > 0){
+			modification_record *prev = &mod_table->records[length-1];
+			if(prev->addr==rec->addr && prev->pos==rec->pos &&
+			   prev->name==rec->name && prev->op!=rec->op){
+				length--;
+				continue;
+			}
+		}
+		mod_table->records[length++] = *rec;
+	}
+	
+	for(int i=0;i<length;i++){
+		modification_record *rec = &mod_table->records[i];
+		snprintf((*now)->line, sizeof((*now)->line), "M%06X%02X%c%s",
+				 rec->addr, rec->pos, rec->op, name_str(rec->name));
+		(*now)->next = (object_code*)calloc(1, sizeof(object_code));
+		if((*now)->next==NULL){
+			return -2;
+		}
+		*now = (*now)->next;
+	}
+	
+	if(stat!=NULL)stat->mod_records += length;
+	mod_table->length = 0;
+	
+	return 0;
+}
+
+/**
+ * @brief 현재 위치에 배치된 리터럴 pool을 16진수 문자열로 변환하여 이어 붙인다.
+ *
+ * @param line 오브젝트 코드 문자열을 이어 붙일 버퍼 주소
+ * @param line_size 버퍼의 크기
+ * @param base 현재 control section 이름의 번호
+ * @param location_counter pool이 시작되는 주소
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 출력한 바이트 수 (버퍼가 부족한 경우 -1)
+ *
+ * @details
+ * 리터럴 테이블은 pool 내부가 주소 순으로 정렬되어 있으므로, 현재 주소에서
+ * 이어지는 리터럴을 차례대로 출력한다. 앞선 리터럴과 공유하는 바이트(`skip`)는
+ * 다시 출력하지 않는다.
+ */
+int make_literal_pool_hex(char *line, int line_size, name_id base,
+						  int location_counter, const literal *literal_table[],
+						  int literal_table_length) {
+	int now = location_counter;
+	char h[4];
+	
+	for(int k=0;k<literal_table_length;k++){
+		const literal *lit = literal_table[k];
+		if(lit->base!=base)continue;
+		
+		// 다른 리터럴 안에 포함되어 출력할 것이 없는 경우
+		if(lit->skip==lit->size)continue;
+		if(lit->addr + lit->skip != now)continue;
+		
+		if(strlen(line) + (lit->size - lit->skip) * 2 >= line_size)return -1;
+		for(int j=lit->skip;j<lit->size;j++){
+			sprintf(h, "%02X", lit->value[j]);
+			strcat(line, h);
+		}
+		now += lit->size - lit->skip;
+	}
+	
+	return now - location_counter;
+}
+
+/**
+ * @brief 리스팅에 control section의 머리 줄을 작성한다.
+ *
+ * @param out 리스팅 출력 버퍼 주소
+ * @param name control section 이름
+ * @param first 첫 control section이면 1, 아니면 0 (앞에 빈 줄을 둠)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int listing_section(output_buffer *out, const char *name, int first) {
+	size_t size = strlen(name);
+	if(output_buffer_reserve(out, size + 12) < 0)return -2;
+	
+	char *p = out->data + out->length;
+	if(!first)*p++ = '\n';
+	memcpy(p, "; section ", 10);
+	p += 10;
+	memcpy(p, name, size);
+	p += size;
+	*p++ = '\n';
+	*p = '\0';
+	out->length = p - out->data;
+	return 0;
+}
+
+/**
+ * @brief 리스팅에 소스코드 한 줄을 작성한다.
+ *
+ * @param out 리스팅 출력 버퍼 주소
+ * @param loc 라인의 시작 주소 (주소를 표시하지 않는 라인은 -1)
+ * @param tok 라인의 토큰 주소
+ * @param hex 라인에서 생성한 코드의 16진수 문자열, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * pass 2의 라인마다 호출되므로 필드의 길이를 미리 구하지 않고 LISTING_LINE_RESERVE
+ * 바이트 안에 바로 작성한다. 매크로 인자 등으로 필드가 길어 넘치는 라인만 필요한
+ * 크기를 구해서 다시 작성한다.
+ */
+int listing_line(output_buffer *out, int loc, const token *tok, const char *hex) {
+	if(output_buffer_reserve(out, LISTING_LINE_RESERVE) < 0)return -2;
+	char *p = listing_format(out->data + out->length,
+							 out->data + out->length + LISTING_LINE_RESERVE -
+							 LISTING_LINE_SLACK, loc, tok, hex);
+	
+	if(p==NULL){
+		// 구분자가 필드와 같은 구간에 작성되므로 LISTING_LINE_SLACK을 두 번 더함
+		size_t size = LISTING_LINE_SLACK * 2;
+		if(tok->label!=NULL)size += strlen(tok->label);
+		if(tok->operator!=NULL)size += strlen(tok->operator);
+		for(int k=0;k<MAX_OPERAND_PER_INST && tok->operand[k]!=NULL;k++){
+			size += strlen(tok->operand[k]) + 1;
+		}
+		if(tok->names!=NULL)size += token_names_size(tok->names, tok->names_length);
+		if(hex!=NULL)size += strlen(hex);
+		if(tok->comment!=NULL)size += strlen(tok->comment);
+		
+		if(output_buffer_reserve(out, size) < 0)return -2;
+		p = listing_format(out->data + out->length,
+						   out->data + out->length + size - LISTING_LINE_SLACK,
+						   loc, tok, hex);
+		if(p==NULL)return -1;
+	}
+	
+	*p = '\0';
+	out->length = p - out->data;
+	return 0;
+}
+
+/**
+ * @brief 리스팅의 한 줄을 정해진 구간 안에 작성한다.
+ *
+ * @param p 작성할 위치
+ * @param end 필드를 작성할 수 있는 끝 위치 (뒤에 LISTING_LINE_SLACK 바이트가 더
+ * 있어야 함, 필드 사이의 구분자는 확인하지 않고 작성하므로 조금 넘을 수 있음)
+ * @param loc 라인의 시작 주소 (주소를 표시하지 않는 라인은 -1)
+ * @param tok 라인의 토큰 주소
+ * @param hex 라인에서 생성한 코드의 16진수 문자열, 혹은 NULL
+ * @return 작성한 다음 위치 ('\0'은 작성하지 않음), 구간이 부족하면 NULL
+ *
+ * @details
+ * 주소, label, operator, operand, 코드, comment를 '\t'로 구분하여 작성한다.
+ * 주석 라인은 label 열에 '.'을 작성한다. 코드나 comment가 없으면 뒤에 빈 열을
+ * 남기지 않는다.
+ */
+char *listing_format(char *p, const char *end, int loc, const token *tok,
+					 const char *hex) {
+	if(loc>=0)p = put_hex(p, loc, 6);
+	
+	// 주석 라인은 '.'과 comment만 작성
+	if(tok->operator==NULL){
+		const char *comment = tok->comment!=NULL ? tok->comment : "";
+		while(*comment=='\t' || *comment==' ')comment++;
+		*p++ = '\t';
+		*p++ = '.';
+		if(*comment!='\0'){
+			*p++ = '\t';
+			if((p = put_str(p, end, comment))==NULL)return NULL;
+		}
+		*p++ = '\n';
+		return p;
+	}
+	
+	*p++ = '\t';
+	if(tok->label!=NULL && (p = put_str(p, end, tok->label))==NULL)return NULL;
+	*p++ = '\t';
+	if((p = put_str(p, end, tok->operator))==NULL)return NULL;
+	
+	// operand 또는 EXTDEF, EXTREF의 이름 목록을 ','로 이어서 작성
+	if(tok->operand[0]!=NULL || tok->names!=NULL || hex!=NULL ||
+	   tok->comment!=NULL)*p++ = '\t';
+	const char *name = tok->names;
+	for(int k=0;k<(name!=NULL ? tok->names_length : MAX_OPERAND_PER_INST);k++){
+		const char *str = name!=NULL ? name : tok->operand[k];
+		if(str==NULL)break;
+		if(k>0)*p++ = ',';
+		char *next = put_str(p, end, str);
+		if(next==NULL)return NULL;
+		if(name!=NULL)name += next - p + 1;
+		p = next;
+	}
+	
+	if(hex!=NULL || tok->comment!=NULL)*p++ = '\t';
+	if(hex!=NULL && (p = put_str(p, end, hex))==NULL)return NULL;
+	if(tok->comment!=NULL){
+		*p++ = '\t';
+		if((p = put_str(p, end, tok->comment))==NULL)return NULL;
+	}
+	*p++ = '\n';
+	return p;
+}
+
+/**
+ * @brief 문자열을 정해진 구간 안에 복사한다.
+ *
+ * @param p 작성할 위치
+ * @param end 작성할 수 있는 끝 위치
+ * @param str 복사할 문자열
+ * @return 작성한 다음 위치 ('\0'은 작성하지 않음), 구간이 부족하면 NULL
+ */
+char *put_str(char *p, const char *end, const char *str) {
+	while(*str!='\0'){
+		if(p>=end)return NULL;
+		*p++ = *str++;
+	}
+	return p;
+}
+
+/**
+ * @brief 리스팅에 리터럴 pool에 배치된 리터럴들을 한 줄씩 작성한다.
+ *
+ * @param st pass 2 상태 주소 (`listing`이 NULL이 아니어야 함)
+ * @param base 현재 control section 이름의 번호
+ * @param location_counter pool이 시작되는 주소
+ * @param length pool의 바이트 수 (make_literal_pool_hex의 결과)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 다른 리터럴과 바이트를 공유하는 리터럴도 자신의 주소와 전체 값으로 작성한다.
+ * pool마다 리터럴 테이블 전체를 훑지 않도록 처음 호출할 때 listing_literal_order로
+ * 주소 순서를 만들고, pool은 주소 순으로 나오므로 이전 pool이 끝난 곳부터 찾는다.
+ * 한 pool 안의 리터럴은 리터럴 테이블 순서로 작성한다.
+ */
+int listing_literal_pool(pass2_state *st, name_id base, int location_counter,
+						 int length) {
+	const literal **literal_table = st->literal_table;
+	output_buffer *out = st->listing;
+	int n = st->literal_table_length;
+	
+	if(st->literal_order==NULL &&
+	   (st->literal_order = listing_literal_order(literal_table, n))==NULL){
+		return -2;
+	}
+	int *order = st->literal_order;
+	
+	// 앞선 control section과 앞선 pool의 리터럴을 건너뜀
+	int first = st->literal_next;
+	while(first < n && (literal_table[order[first]]->base!=base ||
+						literal_table[order[first]]->addr < location_counter)){
+		first++;
+	}
+	int last = first;
+	while(last < n && literal_table[order[last]]->base==base &&
+		  literal_table[order[last]]->addr < location_counter + length){
+		last++;
+	}
+	if(last==first)return 0;
+	st->literal_next = last;
+	
+	// pool 안에서는 리터럴 테이블 순서로 되돌림 (대부분 이미 정렬되어 있음)
+	for(int k=first+1;k<last;k++){
+		int index = order[k], j = k;
+		while(j > first && order[j-1] > index){
+			order[j] = order[j-1];
+			j--;
+		}
+		order[j] = index;
+	}
+	
+	for(int k=first;k<last;k++){
+		const literal *lit = literal_table[order[k]];
+		size_t size = strlen(lit->literal);
+		if(output_buffer_reserve(out, size + lit->size * 2 + 16) < 0)return -2;
+		char *p = put_hex(out->data + out->length, lit->addr, 6);
+		memcpy(p, "\t*\t", 3);
+		p += 3;
+		memcpy(p, lit->literal, size);
+		p += size;
+		*p++ = '\t';
+		for(int j=0;j<lit->size;j++){
+			p = put_hex(p, lit->value[j], 2);
+		}
+		*p++ = '\n';
+		*p = '\0';
+		out->length = p - out->data;
+	}
+	return 0;
+}
+
+/**
+ * @brief 리터럴 테이블 번호를 control section 안에서 주소 순으로 정렬한다.
+ *
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 정렬한 번호 배열 (호출자가 해제), 할당에 실패하면 NULL
+ *
+ * @details
+ * 리터럴은 control section 순서로 추가되고 새 pool일수록 주소가 크므로, 앞선
+ * pool의 주소를 공유하는 리터럴만 앞으로 옮기면 된다. 같은 control section의
+ * 리터럴끼리만 비교하는 삽입 정렬을 사용하며, 주소가 같으면 테이블 순서를 유지한다.
+ */
+int *listing_literal_order(const literal *literal_table[],
+						   int literal_table_length) {
+	int *order = (int*)malloc((literal_table_length > 0 ? literal_table_length : 1) *
+							  sizeof(int));
+	if(order==NULL)return NULL;
+	
+	for(int k=0;k<literal_table_length;k++){
+		const literal *lit = literal_table[k];
+		int j = k;
+		while(j > 0 && literal_table[order[j-1]]->base==lit->base &&
+			  literal_table[order[j-1]]->addr > lit->addr){
+			order[j] = order[j-1];
+			j--;
+		}
+		order[j] = k;
+	}
+	return order;
+}
+
+/**
+ * @brief 어셈블리 코드을 위한 패스 2 과정을 수행한다.
+ *
+ * @param tokens 토큰 테이블 주소
+ * @param inst_table 기계어 목록 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @param obj_code 오브젝트 코드에 대한 정보를 저장하는 구조체 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @param listing 리스팅을 작성할 초기화된 출력 버퍼 주소, 혹은 NULL
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @param sections 이전 결과를 재사용할 구간 캐시 주소, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 어셈블리 코드를 기계어 코드로 바꾸기 위한 패스2 과정을 수행한다. 패스 2의
+ * 프로그램을 기계어로 바꾸는 작업은 라인 단위로 수행된다. `listing`이 주어지면
+ * 같은 순회에서 라인마다 주소, 소스코드, 생성한 코드를 리스팅에 작성한다.
+ * 오류가 있는 라인은 `diags`에 기록하고 코드 없이 넘어가므로, 오류가 기록된
+ * 경우의 오브젝트 코드는 사용하면 안 된다. `sections`가 주어지면 바뀌지 않은
+ * control section 구간은 이전 결과를 재사용한다.
+ */
+int assem_pass2(const token_store *tokens,
+				const inst *inst_table[], int inst_table_length,
+				const symbol *symbol_table[], int symbol_table_length,
+				const literal *literal_table[], int literal_table_length,
+				object_code *obj_code, assem_stat *stat,
+				output_buffer *listing, diag_list *diags,
+				section_cache *sections) {
+	pass2_state st;
+	assem_pass2_init(&st, inst_table, inst_table_length, symbol_table,
+					 symbol_table_length, literal_table, literal_table_length,
+					 obj_code, stat);
+	st.listing = listing;
+	st.diags = diags;
+	
+	int err = sections!=NULL ? assem_pass2_sections(&st, tokens, sections)
+							 : assem_pass2_lines(&st, tokens);
+	if(err>=0)err = assem_pass2_finish(&st);
+	
+	// 도중에 실패하더라도 Modification Record 배열과 리터럴 순서는 여기서 한 번만 해제
+	free(st.mod_table.records);
+	free(st.literal_order);
+	return err;
+}
+
+/**
+ * @brief pass 2 상태를 초기화한다.
+ *
+ * @param st 초기화할 pass 2 상태 주소
+ * @param inst_table 기계어 목록 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @param obj_code 오브젝트 코드의 첫 번째 (비어있는) 줄 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ */
+void assem_pass2_init(pass2_state *st, const inst *inst_table[],
+					  int inst_table_length, const symbol *symbol_table[],
+					  int symbol_table_length, const literal *literal_table[],
+					  int literal_table_length, object_code *obj_code,
+					  assem_stat *stat) {
+	memset(st, 0, sizeof(pass2_state));
+	st->inst_table = inst_table;
+	st->inst_table_length = inst_table_length;
+	st->symbol_table = symbol_table;
+	st->symbol_table_length = symbol_table_length;
+	st->literal_table = literal_table;
+	st->literal_table_length = literal_table_length;
+	st->obj_code = st->now = obj_code;
+	st->stat = stat;
+	st->base_addr = -1;
+	memset(obj_code->line, 0, sizeof(obj_code->line));
+}
+
+/**
+ * @brief 토큰 테이블의 라인들에 대해 pass 2를 수행한다.
+ *
+ * @param st 이전 라인들까지의 pass 2 상태 주소
+ * @param tokens 처리할 토큰 테이블 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 라인 사이에 필요한 상태는 `st`에 남으므로 토큰 테이블을 나누어 차례로 호출할
+ * 수 있다. 모든 라인을 처리한 뒤에는 assem_pass2_finish를 호출해야 한다.
+ */
+int assem_pass2_lines(pass2_state *st, const token_store *tokens) {
+	const inst **inst_table = st->inst_table;
+	const symbol **symbol_table = st->symbol_table;
+	int symbol_table_length = st->symbol_table_length;
+	const literal **literal_table = st->literal_table;
+	int literal_table_length = st->literal_table_length;
+	modification_table *mod_table = &st->mod_table;
+	assem_stat *stat = st->stat;
+	output_buffer *listing = st->listing;
+	
+	// Pass 2 과정에서 필요한 임시변수들을 선언
+	inst tmp_inst;
+	token tmp_token;
+	name_id pro_name = st->pro_name;
+	int pro_start = st->pro_start;
+	char tmp_hex[MAX_OBJECT_CODE_STRING];
+	name_id tmp_base = st->base;
+	int inst_index = 0;
+	// 출력한 리터럴 pool의 바이트 수
+	int literal_length = 0;
+	// 리스팅에 작성할 라인의 시작 주소
+	int line_loc = 0;
+	// BASE 레지스터에 들어있다고 가정한 주소 (NOBASE인 경우 -1)
+	int base_addr = st->base_addr;
+	// 목표 주소와 relative 계산 결과를 저장
+	int target = 0;
+	int relative = 0;
+	int err = 0;
+	
+	// 왼쪽과 오른쪽 문자열의 길이를 저장하는 변수
+	int left_str=0, right_str=0;
+	// Location Counter를 이어서 사용
+	int location_counter = st->location_counter;
+	int total = st->total;
+	// 현재 control section의 시작 주소
+	int section_start = st->section_start;
+	
+	// 작성 중인 Text Record와 리터럴 pool을 저장할 버퍼
+	text_record text = st->text;
+	char literal_hex[MAX_OBJECT_CODE_LENGTH];
+	
+	// 프로그램 크기를 저장
+	int *pro_size = st->pro_size;
+	int pro_cnt = st->pro_cnt;
+	
+	// 현재 포인터를 지정
+	object_code *now = st->now;
+	
+	for(int i=0;i<tokens->length;i++){
+		// 필요한 정보들을 가져옴
+		token_store_get(tokens, i, &tmp_token);
+		if(tmp_token.operator!=NULL){
+			// pass 1에서 찾아둔 기계어 목록 테이블 번호를 사용
+			inst_index = tokens->opcode[i];
+			if(inst_index!=-1){
+				memset(&tmp_inst, 0, sizeof(tmp_inst));
+				tmp_inst = *inst_table[inst_index];
+			}
+		}
+		
+		line_loc = location_counter;
+		
+		// 주석 라인을 건너뜀
+		if(tmp_token.operator==NULL){
+			if(listing!=NULL && listing_line(listing, -1, &tmp_token, NULL)<0)return -2;
+			continue;
+		}
+		
+		// operator가 "START"인 경우
+		else if(!strcmp(tmp_token.operator, "START")){
+			pro_name = tmp_base = tmp_token.label_id;
+			// "H"문자열 추가
+			strcat(now->line, "H");
+			left_str = strlen(now->line);
+			right_str = strlen(tmp_token.label);
+			// 두 문자열의 합이 99이상이면 에러 '\t'를 붙일 것이기 때문
+			if(left_str + right_str >= 99){
+				err = diag_token(st->diags, tokens, i, 1,
+								 "control section 이름 '%s'이(가) 너무 깁니다.",
+								 tmp_token.label);
+				return err < -1 ? err : -1;
+			}
+			// Header를 정의
+			strcat(now->line, tmp_token.label);
+			strcat(now->line, "\t");
+			
+			// 시작주소를 체크
+			memset(tmp_hex, 0, sizeof(tmp_hex));
+			sprintf(tmp_hex, "%06X", atoi(tmp_token.operand[0]));
+			pro_start = atoi(tmp_token.operand[0]);
+			section_start = pro_start;
+			location_counter = pro_start;
+			left_str = strlen(now->line);
+			right_str = strlen(tmp_hex);
+			// 두 문자열의 합이 100이상이면 에러
+			if(left_str + right_str >= 100){
+				err = diag_token(st->diags, tokens, i, 1,
+								 "control section 이름 '%s'이(가) 너무 깁니다.",
+								 tmp_token.label);
+				return err < -1 ? err : -1;
+			}
+			// Header를 정의
+			strcat(now->line, tmp_hex);
+			
+			if(listing!=NULL &&
+			   (listing_section(listing, tmp_token.label, 1)<0 ||
+				listing_line(listing, pro_start, &tmp_token, NULL)<0)){
+				return -2;
+			}
+			
+			// 다음 포인터를 지정
+			now->next = (object_code*)calloc(1, sizeof(object_code));
+			if(now->next==NULL){
+				return -2;
+			}
+			now = now->next;
+			continue;
+		}
+		
+		// operator가 "EXTDEF" 또는 "EXTREF"인 경우
+		else if(!strcmp(tmp_token.operator, "EXTDEF") ||
+				!strcmp(tmp_token.operator, "EXTREF")){
+			err = make_external_records(&tmp_token, tmp_base, symbol_table,
+										symbol_table_length, literal_table,
+										literal_table_length, &now);
+			if(err==-1){
+				if((err = diag_token(st->diags, tokens, i,
+									 token_column(&tmp_token, 2),
+									 "EXTDEF한 이름 중 이 control section에 "
+									 "정의되지 않은 심볼이 있습니다.")) < 0){
+					return err;
+				}
+				continue;
+			}
+			if(err<0)return err;
+			if(listing!=NULL && listing_line(listing, -1, &tmp_token, NULL)<0)return -2;
+			continue;
+		}
+		
+		// operator가 "CSECT"인 경우
+		else if(!strcmp(tmp_token.operator, "CSECT")){
+			// 남아있는 리터럴 pool을 이어서 출력
+			memset(literal_hex, 0, sizeof(literal_hex));
+			literal_length = make_literal_pool_hex(literal_hex, sizeof(literal_hex),
+												   tmp_base, location_counter,
+												   literal_table, literal_table_length);
+			if(literal_length<0){
+				err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 1),
+								 "리터럴 pool이 너무 커서 출력할 수 없습니다.");
+				return err < -1 ? err : -1;
+			}
+			if(text_record_append(&text, location_counter, literal_hex, &now, stat)<0){
+				return -2;
+			}
+			if(listing!=NULL &&
+			   listing_literal_pool(st, tmp_base, location_counter,
+									 literal_length)<0){
+				return -2;
+			}
+			location_counter += literal_length;
+			// control section이 끝나므로 작성 중인 Text Record를 내보냄
+			if(text_record_flush(&text, &now, stat)<0)return -2;
+			
+			// 정렬 및 병합한 Modification Record를 출력
+			if(make_modification_records(mod_table, &now, stat)<0){
+				return -2;
+			}
+			
+			strcat(now->line, "E");
+			if(pro_name==tmp_base){
+				memset(tmp_hex, 0, sizeof(tmp_hex));
+				sprintf(tmp_hex, "%06X", pro_start);
+				strcat(now->line, tmp_hex);
+			}
+			now->next = (object_code*)calloc(1, sizeof(object_code));
+			if(now->next==NULL){
+				return -2;
+			}
+			now = now->next;
+			
+			
+			
+			
+			tmp_base = tmp_token.label_id;
+			// BASE는 control section마다 새로 선언해야 함
+			base_addr = -1;
+			// "H"문자열 추가
+			strcat(now->line, "H");
+			left_str = strlen(now->line);
+			right_str = strlen(tmp_token.label);
+			// 두 문자열의 합이 99이상이면 에러 '\t'를 붙일 것이기 때문
+			if(left_str + right_str >= 99){
+				err = diag_token(st->diags, tokens, i, 1,
+								 "control section 이름 '%s'이(가) 너무 깁니다.",
+								 tmp_token.label);
+				return err < -1 ? err : -1;
+			}
+			// Header를 정의
+			strcat(now->line, tmp_token.label);
+			strcat(now->line, "\t");
+			
+			// 시작주소 붙이기
+			memset(tmp_hex, 0, sizeof(tmp_hex));
+			sprintf(tmp_hex, "000000");
+			left_str = strlen(now->line);
+			right_str = strlen(tmp_hex);
+			// 두 문자열의 합이 100이상이면 에러
+			if(left_str + right_str >= 100){
+				err = diag_token(st->diags, tokens, i, 1,
+								 "control section 이름 '%s'이(가) 너무 깁니다.",
+								 tmp_token.label);
+				return err < -1 ? err : -1;
+			}
+			// Header를 정의
+			strcat(now->line, tmp_hex);
+			
+			
+			if(pro_cnt >= MAX_CONTROL_SECTION_NUM){
+				err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 1),
+								 "control section이 %d개를 넘습니다.",
+								 MAX_CONTROL_SECTION_NUM);
+				return err < -1 ? err : -1;
+			}
+			total += location_counter - section_start;
+			pro_size[pro_cnt++] = location_counter - section_start;
+			location_counter = 0;
+			section_start = 0;
+			
+			if(listing!=NULL &&
+			   (listing_section(listing, tmp_token.label, 0)<0 ||
+				listing_line(listing, 0, &tmp_token, NULL)<0)){
+				return -2;
+			}
+			
+			// 다음 포인터를 지정
+			now->next = (object_code*)calloc(1, sizeof(object_code));
+			if(now->next==NULL){
+				return -2;
+			}
+			now = now->next;
+			continue;
+		}
+		
+		// operator가 "END"인 경우
+		else if(!strcmp(tmp_token.operator, "END")){
+			// 남아있는 리터럴 pool을 이어서 출력
+			memset(literal_hex, 0, sizeof(literal_hex));
+			literal_length = make_literal_pool_hex(literal_hex, sizeof(literal_hex),
+												   tmp_base, location_counter,
+												   literal_table, literal_table_length);
+			if(literal_length<0){
+				err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 1),
+								 "리터럴 pool이 너무 커서 출력할 수 없습니다.");
+				return err < -1 ? err : -1;
+			}
+			if(text_record_append(&text, location_counter, literal_hex, &now, stat)<0){
+				return -2;
+			}
+			if(listing!=NULL &&
+			   (listing_line(listing, -1, &tmp_token, NULL)<0 ||
+				listing_literal_pool(st, tmp_base, location_counter,
+									 literal_length)<0)){
+				return -2;
+			}
+			location_counter += literal_length;
+			// 프로그램이 끝나므로 작성 중인 Text Record를 내보냄
+			if(text_record_flush(&text, &now, stat)<0)return -2;
+			
+			// 정렬 및 병합한 Modification Record를 출력
+			if(make_modification_records(mod_table, &now, stat)<0){
+				return -2;
+			}
+			
+			
+			
+			if(pro_cnt >= MAX_CONTROL_SECTION_NUM){
+				err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 1),
+								 "control section이 %d개를 넘습니다.",
+								 MAX_CONTROL_SECTION_NUM);
+				return err < -1 ? err : -1;
+			}
+			total += location_counter - section_start;
+			pro_size[pro_cnt++] = location_counter - section_start;
+			location_counter = 0;
+			
+			
+			if(strlen(now->line)>0){
+				now->next = (object_code*)calloc(1, sizeof(object_code));
+				if(now->next==NULL){
+					return -2;
+				}
+				now = now->next;
+			}
+			
+			// "E" 추가
+			strcat(now->line, "E");
+			continue;
+		}
+		
+		// operator가 "LTORG"인 경우
+		else if(!strcmp(tmp_token.operator, "LTORG")){
+			// 리터럴 pool은 주소가 이어지므로 작성 중인 Text Record에 이어서 기록
+			memset(literal_hex, 0, sizeof(literal_hex));
+			literal_length = make_literal_pool_hex(literal_hex, sizeof(literal_hex),
+												   tmp_base, location_counter,
+												   literal_table, literal_table_length);
+			if(literal_length<0){
+				err = diag_token(st->diags, tokens, i, token_column(&tmp_token, 1),
+								 "리터럴 pool이 너무 커서 출력할 수 없습니다.");
+				return err < -1 ? err : -1;
+			}
+			if(text_record_append(&text, location_counter, literal_hex, &now, stat)<0){
+				return -2;
+			}
+			if(listing!=NULL &&
+			   (listing_line(listing, -1, &tmp_token, NULL)<0 ||
+				listing_literal_pool(st, tmp_base, location_counter,
+									 literal_length)<0)){
+				return -2;
+			}
+			location_counter += literal_length;
+			continue;
+		}
+		
+		else if(!strcmp(tmp_token.operator, "EQU")){
+			if(listing!=NULL && listing_line(listing, -1, &tmp_token, NULL)<0)return -2;
+			continue;
+		}
+		
+		// operator가 "BASE"인 경우 이후 명령어들이 사용할 base 주소를 기억
+		else if(!strcmp(tmp_token.operator, "BASE")){
+			base_addr = search_address(tmp_token.operand[0], tmp_base,
+									   symbol_table, symbol_table_length,
+									   literal_table, literal_table_length);
+			if(base_addr==-1){
+				if((err = diag_token(st->diags, tokens, i,
+									 token_column(&tmp_token, 2),
+									 "BASE의 심볼 '%s'이(가) 이 control section에 "
+									 "정의되지 않았습니다.",
+									 tmp_token.operand[0])) < 0){
+					return err;
+				}
+				continue;
+			}
+			if(listing!=NULL && listing_line(listing, -1, &tmp_token, NULL)<0)return -2;
+			continue;
+		}
+		
+		// operator가 "NOBASE"인 경우 base relative를 더 이상 사용하지 않음
+		else if(!strcmp(tmp_token.operator, "NOBASE")){
+			base_addr = -1;
+			if(listing!=NULL && listing_line(listing, -1, &tmp_token, NULL)<0)return -2;
+			continue;
+		}
+		// 본문 구간
+		else {
+			int next_flag = 0;
+			memset(tmp_hex, 0, sizeof(tmp_hex));
+			// operator과 "WORD", "RESW", "RESB", "BYTE" 인 경우
+			if(!strcmp(tmp_token.operator, "WORD")){
+				expr_value ev;
+				if(tmp_token.expr==NULL ||
+				   expr_eval(tmp_token.expr, symbol_table, &ev)!=0 ||
+				   (ev.relative!=0 && ev.relative!=1)){
+					location_counter += 3;
+					if((err = diag_token(st->diags, tokens, i,
+										 token_column(&tmp_token, 2),
+										 "WORD의 값 '%s'을(를) 계산할 수 없습니다.",
+										 tmp_token.operand[0])) < 0){
+						return err;
+					}
+					continue;
+				}
 				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%c%s", mod_red->op, mod_red->name);
-				strcat(now->line, tmp_hex);
+				sprintf(tmp_hex, "%06X", ev.value & 0xFFFFFF);
+				// WORD는 3바이트 전체(6 half-byte)를 외부 참조의 계수만큼 수정해야 함
+				for(int e=0;e<tmp_token.expr->externs_length;e++){
+					int count = ev.externs[e] < 0 ? -ev.externs[e] : ev.externs[e];
+					for(int c=0;c<count;c++){
+						if(modification_add(mod_table, tmp_token.expr->externs[e],
+											tmp_base, location_counter, 6,
+											ev.externs[e] < 0 ? '-' : '+', stat)<0){
+							return -2;
+						}
+					}
+				}
+				location_counter += 3;
+			}
+			// 예약 공간은 주소가 끊기므로 작성 중인 Text Record를 내보냄
+			else if(!strcmp(tmp_token.operator, "RESW")){
+				location_counter += 3 * atoi(tmp_token.operand[0]);
+				if(text_record_flush(&text, &now, stat)<0)return -2;
+				next_flag = 1;
+			}
+			else if(!strcmp(tmp_token.operator, "RESB")){
+				location_counter += atoi(tmp_token.operand[0]);
+				if(text_record_flush(&text, &now, stat)<0)return -2;
+				next_flag = 1;
+			}
+			else if(!strcmp(tmp_token.operator, "BYTE")){
+				memset(tmp_hex, 0, sizeof(tmp_hex));
+				// 'X' 또는 'C'와 따옴표 2개의 길이를 뺀 실제 operand의 길이
+				if(*(tmp_token.operand[0])=='X'){
+					location_counter += (strlen(tmp_token.operand[0]) - 3)/2;
+					strncpy(tmp_hex, tmp_token.operand[0] + 2, strlen(tmp_token.operand[0]) - 3);
+				}
+				else if(*(tmp_token.operand[0])=='C'){
+					location_counter += strlen(tmp_token.operand[0]) - 3;
+					if((strlen(tmp_token.operand[0]) - 3) * 2 >= sizeof(tmp_hex)){
+						if((err = diag_token(st->diags, tokens, i,
+											 token_column(&tmp_token, 2),
+											 "BYTE 상수가 %d바이트를 넘습니다.",
+											 (int)(sizeof(tmp_hex) - 1) / 2)) < 0){
+							return err;
+						}
+						continue;
+					}
+					char h[4];
+					for(int k=2;k<strlen(tmp_token.operand[0])-1;k++){
+						sprintf(h, "%02X", (unsigned char)tmp_token.operand[0][k]);
+						strcat(tmp_hex, h);
+					}
+				}
+				
+			}
+			else if(!strcmp(tmp_token.operator, "RSUB")){
+				location_counter += 3;
+				memset(tmp_hex, 0, sizeof(tmp_hex));
+				sprintf(tmp_hex, "%06X", 0x4F0000);
+			}
+			if(next_flag){
+				if(listing!=NULL && listing_line(listing, line_loc, &tmp_token, NULL)<0)return -2;
+				continue;
+			}
+			// 명령어가 아닌 지시어(WORD, BYTE)의 코드는 위에서 만들었음
+			else if(inst_index==-1){
+			}
+			// n, i 비트가 0인 애들, 1 또는 2형식
+			else if((tmp_token.nixbpe & 32) == 0 && (tmp_token.nixbpe & 16) == 0){
+				// 1형식
+				if(tmp_inst.format==1){
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, "%02X", tmp_inst.op);
+					location_counter += 1;
+				}
+				// 2형식
+				else if(tmp_inst.format==2){
+					int value = 0;
+					value |= tmp_inst.op;
+					value <<= 4;
+					// operand는 pass 1에서 확인하였음
+					for(int k=0;k<2;k++){
+						if(k < tmp_inst.ops && tmp_token.operand[k]!=NULL){
+							int r = format2_operand(tmp_token.operator, k,
+													tmp_token.operand[k]);
+							if(r > 0)value |= r;
+						}
+						if(k==0)value <<= 4;
+					}
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, "%04X", value);
+					location_counter += 2;
+				}
+			}
+			// 수식으로 컴파일된 operand를 가진 3, 4형식
+			else if(tmp_inst.format==34 && tmp_token.expr!=NULL){
+				int value = tmp_inst.op;
+				value <<= 4;
+				value |= tmp_token.nixbpe;
+				value <<= 12;
+				if(tmp_token.nixbpe & 1){
+					value <<= 8;
+					location_counter += 4;
+				}
+				else location_counter += 3;
+				
+				err = encode_operand_expr(&value, &tmp_token, symbol_table,
+										  location_counter, base_addr, tmp_base,
+										  mod_table, stat);
+				if(err==-1){
+					if((err = diag_token(st->diags, tokens, i,
+										 token_column(&tmp_token, 2),
+										 "operand '%s'을(를) 주소로 바꿀 수 없습니다. "
+										 "(3형식의 범위 초과 또는 외부 참조)",
+										 tmp_token.operand[0])) < 0){
+						return err;
+					}
+					continue;
+				}
+				if(err<0)return err;
+				memset(tmp_hex, 0, sizeof(tmp_hex));
+				sprintf(tmp_hex, (tmp_token.nixbpe & 1) ? "%08X" : "%06X", value);
+			}
+			// 3, 4형식
+			else if(tmp_inst.format==34){
+				// value 변수에 논리연산을 사용해서 오브젝트 코드로만들고 16진수 문자열로 변경할 예정
+				int value = 0;
+				// opcode와 or연산하고 왼쪽으로 nixbpe의 6비트만큼 민다.
+				value |= tmp_inst.op;
 				
-				mod_red = mod_red->next;
+				value <<= 4;
+				// nixbpe와 or연산을하고 12	비트만큼 민다.
+				value |= tmp_token.nixbpe;
+				value <<= 12;
+				// 4형식인 경우 8비트만큼 더 민다.
+				if((tmp_token.nixbpe & 1)){
+					value <<= 8;
+				}
 				
-				// line이 있는 경우만 새로운 줄을 생성
-				if(strlen(now->line)>0){
-					now->next = (object_code*)calloc(1, sizeof(object_code));
-					if(now->next==NULL){
-						return -2;
+				// immdiate를 고려
+				if((tmp_token.nixbpe & 16) && !(tmp_token.nixbpe & 32)){
+					if(tmp_token.nixbpe & 1)location_counter += 4;
+					else location_counter += 3;
+					target = search_address(tmp_token.operand[0] + 1, tmp_base,
+											symbol_table, symbol_table_length,
+											literal_table, literal_table_length);
+					// 4형식은 값 또는 심볼의 주소를 그대로 넣어줌
+					if(tmp_token.nixbpe & 1){
+						value |= (target!=-1) ? target : atoi(tmp_token.operand[0]+1);
+					}
+					// 숫자가 아닌 심볼을 immediate로 사용하는 경우 (LDB #LENGTH 등)
+					else if(target!=-1){
+						value |= (2 << 12);
+						relative = calc_relative_disp(&value, target, location_counter, base_addr);
+						if(relative<0){
+							if((err = pass2_range_error(st, tokens, i, &tmp_token)) < 0){
+								return err;
+							}
+							continue;
+						}
+						if(relative==1 && stat!=NULL)stat->base_relative++;
+					}
+					else value |= atoi(tmp_token.operand[0]+1);
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, (tmp_token.nixbpe & 1) ? "%08X" : "%06X", value);
+				}
+				else if((tmp_token.nixbpe & 32) && !(tmp_token.nixbpe & 16)){
+					if(tmp_token.nixbpe & 1)location_counter += 4;
+					else location_counter += 3;
+					target = search_address(tmp_token.operand[0] + 1, tmp_base,
+											symbol_table, symbol_table_length,
+											literal_table, literal_table_length);
+					if(target!=-1){
+						relative = calc_relative_disp(&value, target, location_counter, base_addr);
+						if(relative<0){
+							if((err = pass2_range_error(st, tokens, i, &tmp_token)) < 0){
+								return err;
+							}
+							continue;
+						}
+						if(relative==1 && stat!=NULL)stat->base_relative++;
+					}
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, "%06X", value);
+				}
+				// 적절한 심보를 찾으면 심볼의 pc relactive값을 넣어줌
+				else if((tmp_token.nixbpe & 2)){
+					location_counter += 3;
+					if(*tmp_token.operand[0]=='='){
+						target = search_literal(tmp_token.operand[0], tmp_base,
+												location_counter, literal_table,
+												literal_table_length);
+					}
+					else target = search_address(tmp_token.operand[0], tmp_base,
+												 symbol_table, symbol_table_length,
+												 literal_table, literal_table_length);
+					if(target!=-1){
+						relative = calc_relative_disp(&value, target, location_counter, base_addr);
+						if(relative<0){
+							if((err = pass2_range_error(st, tokens, i, &tmp_token)) < 0){
+								return err;
+							}
+							continue;
+						}
+						if(relative==1 && stat!=NULL)stat->base_relative++;
 					}
-					now = now->next;
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, "%06X", value);
+				}
+				// 4형식은 심볼의 실제 주소를 넣어줌
+				else if((tmp_token.nixbpe & 1)){
+					location_counter += 4;
+					target = search_address(tmp_token.operand[0], tmp_base,
+											symbol_table, symbol_table_length,
+											literal_table, literal_table_length);
+					if(target!=-1)value |= target;
+					memset(tmp_hex, 0, sizeof(tmp_hex));
+					sprintf(tmp_hex, "%08X", value);
+				}
+			}
+			
+			
+			
+			// 생성한 코드는 명령어의 시작 주소부터 Text Record에 채움
+			if(text_record_append(&text, location_counter - strlen(tmp_hex)/2,
+								  tmp_hex, &now, stat)<0){
+				return -2;
+			}
+			if(listing!=NULL && listing_line(listing, line_loc, &tmp_token, tmp_hex)<0)return -2;
+			
+		}
+		
+	}
+	
+	st->pro_name = pro_name;
+	st->pro_start = pro_start;
+	st->base = tmp_base;
+	st->base_addr = base_addr;
+	st->location_counter = location_counter;
+	st->total = total;
+	st->section_start = section_start;
+	st->text = text;
+	st->pro_cnt = pro_cnt;
+	st->now = now;
+	return 0;
+}
+
+/**
+ * @brief pc/base relative로 닿지 않는 operand의 오류를 기록한다.
+ *
+ * @param st pass 2 상태 주소
+ * @param tokens 토큰 테이블 주소
+ * @param i 오류가 있는 라인 번호
+ * @param tok 오류가 있는 라인의 토큰 주소
+ * @return 오류 코드 (기록한 경우 = 0)
+ */
+int pass2_range_error(pass2_state *st, const token_store *tokens, int i,
+					  const token *tok) {
+	return diag_token(st->diags, tokens, i, token_column(tok, 2),
+					  "operand '%s'이(가) pc relative와 base relative 범위를 "
+					  "벗어납니다. (4형식이나 BASE를 사용할 것)",
+					  tok->operand[0]);
+}
+
+/**
+ * @brief Text Record 한 줄의 길이를 코드 크기 통계에 더한다.
+ *
+ * @param line 오브젝트 코드의 한 줄 주소
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ */
+void object_code_count(const object_code *line, assem_stat *stat) {
+	if(stat!=NULL && *line->line == 'T'){
+		int length = 0;
+		sscanf(line->line + 7, "%2X", &length);
+		stat->code_bytes += length;
+	}
+}
+
+/**
+ * @brief 완성된 오브젝트 코드 줄들을 스트리밍 출력 파일로 내보낸다.
+ *
+ * @param st pass 2 상태 주소
+ * @param all 작성 중인 줄까지 모두 내보낼지 여부
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 출력한 줄은 해제하므로 메모리에는 작성 중인 줄만 남는다. Header Record는
+ * 길이 6자리를 '0'으로 채워 두고 그 위치를 기억한다.
+ */
+int assem_pass2_flush(pass2_state *st, int all) {
+	if(st->out==NULL)return 0;
+	
+	while(st->obj_code!=NULL && (all || st->obj_code!=st->now)){
+		object_code *line = st->obj_code;
+		
+		if(fputs(line->line, st->out)==EOF)return -1;
+		if(*line->line == 'H' && st->pro_written < MAX_CONTROL_SECTION_NUM){
+			st->pro_offset[st->pro_written++] = ftell(st->out);
+			if(fputs("000000", st->out)==EOF)return -1;
+		}
+		if(fputc('\n', st->out)==EOF)return -1;
+		object_code_count(line, st->stat);
+		
+		st->obj_code = line->next;
+		if(line==st->now)st->now = NULL;
+		free(line);
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 모든 라인을 처리한 뒤 Header Record의 길이와 통계를 채운다.
+ *
+ * @param st pass 2 상태 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int assem_pass2_finish(pass2_state *st) {
+	char tmp_hex[MAX_OBJECT_CODE_STRING];
+	object_code *now;
+	int i = 0;
+	
+	// 이미 파일로 출력한 Header Record는 비워둔 자리를 채움
+	for(;i<st->pro_written && i<st->pro_cnt;i++){
+		if(fseek(st->out, st->pro_offset[i], SEEK_SET)!=0 ||
+		   fprintf(st->out, "%06X", st->pro_size[i]) < 0){
+			return -1;
+		}
+	}
+	if(st->pro_written > 0 && fseek(st->out, 0, SEEK_END)!=0)return -1;
+	
+	now = st->obj_code;
+	while(now!=NULL){
+		if(i >= st->pro_cnt)break;
+		
+		if(*now->line == 'H'){
+			memset(tmp_hex, 0, sizeof(tmp_hex));
+			sprintf(tmp_hex, "%06X", st->pro_size[i++]);
+			strcat(now->line, tmp_hex);
+		}
+		
+		now = now->next;
+	}
+	
+	// Text Record의 길이 필드를 모아 전체 코드 크기를 계산
+	if(st->stat!=NULL){
+		for(now = st->obj_code;now!=NULL;now = now->next){
+			object_code_count(now, st->stat);
+		}
+		// 다른 리터럴과 공유하여 줄어든 리터럴 pool의 크기를 계산
+		for(int k=0;k<st->literal_table_length;k++){
+			st->stat->literal_bytes += st->literal_table[k]->size - st->literal_table[k]->skip;
+			st->stat->literal_shared += st->literal_table[k]->skip;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief 임시 파일의 IR을 구간 단위로 읽어 패스 2를 수행하고, 오브젝트 코드를
+ * 바로 출력 파일에 쓴다.
+ *
+ * @param spill assem_pass1_stream이 IR을 쓴 임시 파일 (처음으로 되감아 둘 것)
+ * @param inst_table 기계어 목록 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @param out 쓰기 권한으로 열린 오브젝트 코드 파일 (fseek이 가능해야 함)
+ * @param stat 어셈블 통계를 저장할 구조체 주소, 혹은 NULL
+ * @param diags 오류를 모을 목록 주소, 혹은 NULL (NULL이면 첫 오류에서 멈춤)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int assem_pass2_stream(FILE *spill, const inst *inst_table[],
+					   int inst_table_length, const symbol *symbol_table[],
+					   int symbol_table_length, const literal *literal_table[],
+					   int literal_table_length, FILE *out, assem_stat *stat,
+					   diag_list *diags) {
+	// 현재 구간의 토큰과 구간 사이에 유지되는 EXTREF 목록
+	token_store window;
+	expr_scope scope;
+	pass2_state st;
+	int count = 0;
+	int err = 0;
+	
+	object_code *obj_code = (object_code*)calloc(1, sizeof(object_code));
+	if(obj_code==NULL)return -2;
+	
+	memset(&window, 0, sizeof(window));
+	memset(&scope, 0, sizeof(scope));
+	assem_pass2_init(&st, inst_table, inst_table_length, symbol_table,
+					 symbol_table_length, literal_table, literal_table_length,
+					 obj_code, stat);
+	st.out = out;
+	st.diags = diags;
+	
+	while((count = token_store_load(&window, spill, STREAM_WINDOW_LINES)) > 0){
+		if((err = compile_expressions(inst_table, &window, &scope, symbol_table,
+									  symbol_table_length, NULL, diags)) < 0 ||
+		   (err = assem_pass2_lines(&st, &window)) < 0 ||
+		   (err = assem_pass2_flush(&st, 0)) < 0){
+			break;
+		}
+		token_store_clear(&window);
+	}
+	if(err>=0 && count<0)err = count;
+	
+	if(err>=0 && (err = assem_pass2_flush(&st, 1)) >= 0){
+		err = assem_pass2_finish(&st);
+	}
+	
+	object_code_free(st.obj_code);
+	free(st.mod_table.records);
+	token_store_free(&window);
+	extref_set_free(&scope.refs);
+	return err;
+}
+
+/**
+ * @brief 토큰 테이블을 control section 구간으로 나누어 pass 2를 수행하고, 바뀌지
+ * 않은 구간은 이전 결과를 재사용한다.
+ *
+ * @param st assem_pass2_init으로 초기화한 pass 2 상태 주소
+ * @param tokens 처리할 토큰 테이블 주소
+ * @param cache 이전 pass 2의 구간 결과 (이번 pass 2의 결과로 바뀜)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 구간은 START, CSECT 라인 바로 다음에서 나뉜다. 구간마다 assem_pass2_lines를
+ * 나누어 호출하는 것과 같으므로 결과는 한 번에 호출한 경우와 같다. 오류가 있는
+ * 구간은 저장하지 않으므로 다음 pass 2에서 다시 수행한다.
+ */
+int assem_pass2_sections(pass2_state *st, const token_store *tokens,
+						 section_cache *cache) {
+	section_cache next;
+	int start = 0;
+	int err = 0;
+	
+	memset(&next, 0, sizeof(next));
+	for(int i=0;i<tokens->length && err>=0;i++){
+		const char *operator = name_str(tokens->operator[i]);
+		// 마지막 구간이 아니라면 START, CSECT 라인 다음에서만 나눔
+		if(i+1 < tokens->length && strcmp(operator, "START") &&
+		   strcmp(operator, "CSECT")){
+			continue;
+		}
+		err = section_run(st, tokens, start, i+1, cache, &next);
+		start = i+1;
+	}
+	
+	// 이번 pass 2에서 사용하지 않은 이전 결과는 해제
+	section_cache_free(cache);
+	*cache = next;
+	return err;
+}
+
+/**
+ * @brief pass 2 구간 하나를 이전 결과로 채우거나 새로 수행한다.
+ *
+ * @param st pass 2 상태 주소
+ * @param tokens 토큰 테이블 주소
+ * @param start 구간의 첫 번째 라인 번호
+ * @param end 구간의 마지막 라인 다음 번호
+ * @param cache 이전 pass 2의 구간 결과
+ * @param next 이번 pass 2의 구간 결과를 추가할 배열
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 재사용한 결과는 `cache`에서 `next`로 옮긴다. 구간의 시작이나 끝에 작성 중인
+ * Text Record나 Modification Record가 있으면 앞뒤 구간과 이어지므로 재사용하거나
+ * 저장하지 않는다.
+ */
+int section_run(pass2_state *st, const token_store *tokens, int start,
+				int end, section_cache *cache, section_cache *next) {
+	token_store view;
+	assem_stat stat_start;
+	object_code *first = st->now;
+	size_t listing_start = st->listing!=NULL ? st->listing->length : 0;
+	int diags_start = st->diags!=NULL ? st->diags->length + st->diags->dropped : 0;
+	int pro_cnt_start = st->pro_cnt;
+	int total_start = st->total;
+	int clean = st->text.length==0 && st->text.aligned_length==0 &&
+				st->mod_table.length==0 && *st->now->line=='\0';
+	int err;
+	
+	token_store_view(tokens, start, end, &view);
+	uint64_t key = section_key(st, &view);
+	next->sections++;
+	
+	// 옮기거나 저장할 자리를 먼저 확보
+	if(next->length >= next->capacity){
+		int capacity = next->capacity ? next->capacity * 2 : 16;
+		section_result *items = (section_result*)realloc(next->items,
+														 capacity * sizeof(section_result));
+		if(items==NULL)return -2;
+		next->items = items;
+		next->capacity = capacity;
+	}
+	
+	for(int k=0;clean && k<cache->length;k++){
+		section_result *res = &cache->items[k];
+		if(res->key!=key || res->lines!=view.length)continue;
+		if(st->pro_cnt + res->pro_cnt > MAX_CONTROL_SECTION_NUM)break;
+		
+		if((err = section_reuse(st, res)) < 0)return err;
+		next->items[next->length++] = *res;
+		cache->items[k] = cache->items[--cache->length];
+		next->reused++;
+		return 0;
+	}
+	
+	if(st->stat!=NULL)stat_start = *st->stat;
+	if((err = assem_pass2_lines(st, &view)) < 0)return err;
+	
+	if(!clean || st->text.length > 0 || st->text.aligned_length > 0 ||
+	   st->mod_table.length > 0 ||
+	   (st->diags!=NULL && st->diags->length + st->diags->dropped > diags_start)){
+		return 0;
+	}
+	
+	section_result *res = &next->items[next->length];
+	memset(res, 0, sizeof(section_result));
+	res->key = key;
+	res->lines = view.length;
+	if((err = section_save(st, first, listing_start, &stat_start,
+						   pro_cnt_start, total_start, res)) < 0){
+		section_result_free(res);
+		return err;
+	}
+	next->length++;
+	return 0;
+}
+
+/**
+ * @brief 저장한 구간 결과를 오브젝트 코드와 리스팅에 붙이고, pass 2 상태를 구간이
+ * 끝난 뒤로 옮긴다.
+ *
+ * @param st 구간이 시작하는 pass 2 상태 주소
+ * @param res 붙일 구간 결과 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int section_reuse(pass2_state *st, const section_result *res) {
+	const char *p = res->object;
+	const char *end = res->object + res->object_length;
+	
+	while(p < end){
+		const char *eol = (const char*)memchr(p, '\n', end - p);
+		memcpy(st->now->line, p, eol - p);
+		st->now->line[eol - p] = '\0';
+		st->now->next = (object_code*)calloc(1, sizeof(object_code));
+		if(st->now->next==NULL){
+			return -2;
+		}
+		st->now = st->now->next;
+		p = eol + 1;
+	}
+	strcpy(st->now->line, res->pending);
+	
+	if(st->listing!=NULL && res->listing_length > 0){
+		if(output_buffer_reserve(st->listing, res->listing_length) < 0)return -2;
+		memcpy(st->listing->data + st->listing->length, res->listing,
+			   res->listing_length);
+		st->listing->length += res->listing_length;
+		st->listing->data[st->listing->length] = '\0';
+	}
+	
+	st->pro_name = res->pro_name;
+	st->pro_start = res->pro_start;
+	st->base = res->base;
+	st->base_addr = res->base_addr;
+	st->location_counter = res->location_counter;
+	st->section_start = res->section_start;
+	st->text = res->text;
+	st->total += res->total;
+	for(int k=0;k<res->pro_cnt;k++){
+		st->pro_size[st->pro_cnt++] = res->pro_size[k];
+	}
+	if(st->stat!=NULL)assem_stat_add(st->stat, &res->stat, 1);
+	
+	return 0;
+}
+
+/**
+ * @brief 방금 수행한 구간의 결과를 저장한다.
+ *
+ * @param st 구간을 마친 pass 2 상태 주소
+ * @param first 구간이 시작할 때 작성 중이던 오브젝트 코드 줄 주소
+ * @param listing_start 구간이 시작할 때의 리스팅 바이트 수
+ * @param stat_start 구간이 시작할 때의 통계 주소 (st->stat이 NULL이면 무시)
+ * @param pro_cnt_start 구간이 시작할 때 끝난 control section 수
+ * @param total_start 구간이 시작할 때의 프로그램 크기
+ * @param res 결과를 저장할 구조체 주소 (key와 lines는 채워져 있어야 함)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int section_save(const pass2_state *st, const object_code *first,
+				 size_t listing_start, const assem_stat *stat_start,
+				 int pro_cnt_start, int total_start, section_result *res) {
+	const object_code *now;
+	size_t length = 0;
+	char *p;
+	
+	for(now = first;now!=st->now;now = now->next){
+		length += strlen(now->line) + 1;
+	}
+	res->object = (char*)malloc(length + 1);
+	if(res->object==NULL)return -2;
+	p = res->object;
+	for(now = first;now!=st->now;now = now->next){
+		size_t n = strlen(now->line);
+		memcpy(p, now->line, n);
+		p[n] = '\n';
+		p += n + 1;
+	}
+	res->object_length = length;
+	strcpy(res->pending, st->now->line);
+	
+	if(st->listing!=NULL){
+		res->listing_length = st->listing->length - listing_start;
+		res->listing = (char*)malloc(res->listing_length + 1);
+		if(res->listing==NULL)return -2;
+		memcpy(res->listing, st->listing->data + listing_start, res->listing_length);
+	}
+	
+	res->pro_name = st->pro_name;
+	res->pro_start = st->pro_start;
+	res->base = st->base;
+	res->base_addr = st->base_addr;
+	res->location_counter = st->location_counter;
+	res->section_start = st->section_start;
+	res->text = st->text;
+	res->total = st->total - total_start;
+	res->pro_cnt = st->pro_cnt - pro_cnt_start;
+	memcpy(res->pro_size, st->pro_size + pro_cnt_start, res->pro_cnt * sizeof(int));
+	if(st->stat!=NULL){
+		res->stat = *st->stat;
+		assem_stat_add(&res->stat, stat_start, -1);
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 구간의 라인들과 구간이 시작할 때의 pass 2 상태로 구간의 키를 만든다.
+ *
+ * @param st 구간이 시작하는 pass 2 상태 주소
+ * @param tokens 구간의 토큰 테이블 뷰 주소
+ * @return 구간의 키 (FNV-1a 해시)
+ *
+ * @details
+ * 라인마다 pass 1이 채운 주소와 opcode, nixbpe를 함께 넣으므로 구간 안의 심볼이나
+ * 리터럴 주소가 바뀌면 키도 바뀐다. 다른 control section의 심볼은 외부 참조로만
+ * 사용하므로 구간의 결과에 영향을 주지 않는다. label과 operator는 프로세스 안에서
+ * 바뀌지 않는 이름 풀 번호를 사용한다.
+ */
+uint64_t section_key(const pass2_state *st, const token_store *tokens) {
+	int state[7] = {(int)st->pro_name, st->pro_start, (int)st->base,
+					st->base_addr, st->location_counter, st->section_start,
+					st->listing!=NULL};
+	uint64_t hash = hash_bytes(14695981039346656037ULL, state, sizeof(state));
+	
+	for(int i=0;i<tokens->length;i++){
+		int fields[7] = {(int)tokens->label[i], (int)tokens->operator[i],
+						 tokens->opcode[i], tokens->operands[i],
+						 tokens->nixbpe[i], tokens->addr[i],
+						 tokens->comment[i]!=0};
+		hash = hash_bytes(hash, fields, sizeof(fields));
+		
+		// operand와 EXTDEF, EXTREF의 이름은 모두 '\0'으로 구분되어 이어져 있음
+		const char *text = tokens->text + tokens->operand[i];
+		int count = tokens->operands[i] & ~TOKEN_STORE_NAMES;
+		for(int k=0;k<count;k++){
+			size_t n = strlen(text) + 1;
+			hash = hash_bytes(hash, text, n);
+			text += n;
+		}
+		// comment는 리스팅에 그대로 출력됨
+		if(tokens->comment[i]!=0){
+			text = tokens->text + tokens->comment[i];
+			hash = hash_bytes(hash, text, strlen(text) + 1);
+		}
+	}
+	
+	return hash;
+}
+
+/**
+ * @brief 바이트들을 FNV-1a 해시에 더한다.
+ *
+ * @param hash 지금까지의 해시 값
+ * @param data 더할 바이트들의 주소
+ * @param length 더할 바이트 수
+ * @return 더한 뒤의 해시 값
+ */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+	const unsigned char *p = (const unsigned char*)data;
+	for(size_t i=0;i<length;i++){
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief 토큰 테이블의 [start, end) 라인을 복사하지 않고 가리키는 뷰를 만든다.
+ *
+ * @param store 토큰 테이블 주소
+ * @param start 첫 번째 라인 번호
+ * @param end 마지막 라인 다음 번호
+ * @param view 뷰를 저장할 토큰 테이블 주소
+ *
+ * @details
+ * 배열들은 `store`를 가리키고 text는 공유하므로 뷰에는 라인을 추가하거나 해제하면
+ * 안 된다.
+ */
+void token_store_view(const token_store *store, int start, int end,
+					  token_store *view) {
+	*view = *store;
+	view->length = view->capacity = end - start;
+	view->label += start;
+	view->operator += start;
+	view->opcode += start;
+	view->operand += start;
+	view->operands += start;
+	view->comment += start;
+	view->nixbpe += start;
+	view->addr += start;
+	view->expr += start;
+	view->line += start;
+	view->file += start;
+}
+
+/**
+ * @brief 통계에 다른 통계를 더하거나 뺀다.
+ *
+ * @param stat 결과를 저장할 통계 주소
+ * @param delta 더하거나 뺄 통계 주소
+ * @param sign 더하면 1, 빼면 -1
+ *
+ * @details
+ * pass 2의 라인을 처리하며 세는 항목만 계산한다. 코드와 리터럴 크기는
+ * assem_pass2_finish에서, 토큰 테이블의 크기는 pass 1이 끝난 뒤 센다.
+ */
+void assem_stat_add(assem_stat *stat, const assem_stat *delta, int sign) {
+	stat->base_relative += sign * delta->base_relative;
+	stat->text_records += sign * delta->text_records;
+	stat->aligned_records += sign * delta->aligned_records;
+	stat->mod_records += sign * delta->mod_records;
+	stat->mod_records_raw += sign * delta->mod_records_raw;
+}
+
+/**
+ * @brief 구간 결과 하나가 가진 메모리를 해제한다.
+ *
+ * @param res 구간 결과 주소
+ */
+void section_result_free(section_result *res) {
+	free(res->object);
+	free(res->listing);
+	res->object = res->listing = NULL;
+}
+
+/**
+ * @brief 구간 캐시의 모든 결과를 해제하고 비운다.
+ *
+ * @param cache 구간 캐시 주소
+ */
+void section_cache_free(section_cache *cache) {
+	for(int i=0;i<cache->length;i++){
+		section_result_free(&cache->items[i]);
+	}
+	free(cache->items);
+	memset(cache, 0, sizeof(section_cache));
+}
+
+/**
+ * @brief 심볼 테이블을 파일로 출력한다. `symbol_table_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다.
+ *
+ * @param symbol_table_dir 심볼 테이블을 저장할 파일 경로, 혹은 NULL
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 심볼 테이블을 파일로 출력한다. `symbol_table_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다. 명세서에 주어진 출력 예시와 완전히 동일할 필요는 없다.
+ */
+int make_symbol_table_output(const char *symbol_table_dir,
+							 const symbol *symbol_table[],
+							 int symbol_table_length) {
+	output_buffer out;
+	int err = 0;
+	
+	if((err = render_symbol_table(&out, symbol_table, symbol_table_length)) < 0){
+		return err;
+	}
+	err = output_buffer_write(&out, symbol_table_dir);
+	output_buffer_free(&out);
+
+	return err;
+}
+
+/**
+ * @brief 리터럴 테이블을 파일로 출력한다. `literal_table_dir`이 NULL인 경우
+ * 결과를 stdout으로 출력한다.
+ *
+ * @param literal_table_dir 리터럴 테이블을 저장할 파일 경로, 혹은 NULL
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 리터럴 테이블을 파일로 출력한다. `literal_table_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다. 명세서에 주어진 출력 예시와 완전히 동일할 필요는 없다.
+ */
+int make_literal_table_output(const char *literal_table_dir,
+							  const literal *literal_table[],
+							  int literal_table_length) {
+	output_buffer out;
+	int err = 0;
+	
+	if((err = render_literal_table(&out, literal_table, literal_table_length)) < 0){
+		return err;
+	}
+	err = output_buffer_write(&out, literal_table_dir);
+	output_buffer_free(&out);
+
+	return err;
+}
+
+/**
+ * @brief 오브젝트 코드를 파일로 출력한다. `objectcode_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다.
+ *
+ * @param objectcode_dir 오브젝트 코드를 저장할 파일 경로, 혹은 NULL
+ * @param obj_code 오브젝트 코드에 대한 정보를 담고 있는 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 오브젝트 코드를 파일로 출력한다. `objectcode_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다. 명세서의 주어진 출력 결과와 완전히 동일해야 한다.
+ * 예외적으로 각 라인 뒤쪽의 공백 문자 혹은 개행 문자의 차이는 허용한다.
+ */
+int make_objectcode_output(const char *objectcode_dir,
+						   const object_code *obj_code) {
+	output_buffer out;
+	int err = 0;
+	
+	if((err = render_objectcode(&out, obj_code)) < 0){
+		return err;
+	}
+	err = output_buffer_write(&out, objectcode_dir);
+	output_buffer_free(&out);
+
+	return err;
+}
+
+/**
+ * @brief 출력 버퍼를 주어진 크기로 미리 할당한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param capacity 미리 할당할 바이트 수
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int output_buffer_init(output_buffer *out, size_t capacity) {
+	if(capacity==0)capacity = 1;
+	out->data = (char*)malloc(capacity);
+	if(out->data==NULL)return -2;
+	out->data[0] = '\0';
+	out->length = 0;
+	out->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief 출력 버퍼의 뒤에 형식화된 문자열을 이어 붙인다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param format printf 형식 문자열
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 미리 할당한 크기가 부족한 경우에만 버퍼를 두 배씩 늘린다.
+ */
+int output_buffer_printf(output_buffer *out, const char *format, ...) {
+	va_list ap;
+	int need;
+	
+	va_start(ap, format);
+	need = vsnprintf(out->data + out->length, out->capacity - out->length,
+					 format, ap);
+	va_end(ap);
+	if(need < 0)return -1;
+	
+	// 남은 공간이 부족했다면 늘린 뒤 다시 작성
+	if(out->length + need + 1 > out->capacity){
+		size_t capacity = out->capacity * 2;
+		while(capacity < out->length + need + 1)capacity *= 2;
+		char *data = (char*)realloc(out->data, capacity);
+		if(data==NULL)return -2;
+		out->data = data;
+		out->capacity = capacity;
+		
+		va_start(ap, format);
+		vsnprintf(out->data + out->length, out->capacity - out->length,
+				  format, ap);
+		va_end(ap);
+	}
+	out->length += need;
+	
+	return 0;
+}
+
+/**
+ * @brief 출력 버퍼가 사용하던 메모리를 해제한다.
+ *
+ * @param out 출력 버퍼 주소
+ */
+void output_buffer_free(output_buffer *out) {
+	free(out->data);
+	out->data = NULL;
+	out->length = out->capacity = 0;
+}
+
+/**
+ * @brief 오류 목록에 오류 하나를 추가한다.
+ *
+ * @param diags 오류 목록 주소, 혹은 NULL
+ * @param file 오류가 있는 INCLUDE 파일 (소스코드는 NAME_NONE)
+ * @param line 줄 번호 (모르면 0)
+ * @param column 열 번호 (모르면 0)
+ * @param format 오류 내용의 printf 형식 문자열
+ * @param ap 형식 문자열의 인자
+ * @return 오류 코드 (기록한 경우 = 0)
+ *
+ * @details
+ * `diags`가 NULL이면 기록하지 않고 -1을 반환하므로, 호출자는 이 값을 그대로
+ * 반환하여 이전처럼 첫 오류에서 멈출 수 있다. MAX_DIAGNOSTICS개를 넘는 오류는
+ * 수만 센다.
+ */
+int diag_vadd(diag_list *diags, name_id file, int line, int column,
+			  const char *format, va_list ap) {
+	if(diags==NULL)return -1;
+	if(diags->length >= MAX_DIAGNOSTICS){
+		diags->dropped++;
+		return 0;
+	}
+	
+	if(diags->length >= diags->capacity){
+		int capacity = diags->capacity ? diags->capacity * 2 : 16;
+		diagnostic *items = (diagnostic*)realloc(diags->items,
+												 capacity * sizeof(diagnostic));
+		if(items==NULL)return -2;
+		diags->items = items;
+		diags->capacity = capacity;
+	}
+	
+	diagnostic *d = &diags->items[diags->length++];
+	d->file = file;
+	d->line = line;
+	d->column = column;
+	vsnprintf(d->message, sizeof(d->message), format, ap);
+	// 인자로 받은 메시지가 이미 잘려 있을 수도 있으므로 항상 확인
+	diag_truncate(d->message);
+	return 0;
+}
+
+/**
+ * @brief 길이 제한으로 잘린 메시지의 끝에서 완성되지 않은 UTF-8 문자를 지운다.
+ *
+ * @param message '\0'으로 끝나는 메시지
+ *
+ * @details
+ * 마지막 문자의 첫 바이트가 나타내는 길이보다 남은 바이트가 적으면 그 문자를
+ * 지운다. 메시지의 한글이 중간에서 잘려 잘못된 UTF-8이 출력되지 않게 한다.
+ * 잘리지 않은 메시지는 바뀌지 않는다.
+ */
+void diag_truncate(char *message) {
+	int len = strlen(message);
+	int start = len;
+	
+	// 마지막 문자의 첫 바이트를 찾음 (이어지는 바이트는 10xxxxxx)
+	while(start > 0 && (message[start-1] & 0xC0)==0x80)start--;
+	if(start==0)return;
+	start--;
+	unsigned char lead = (unsigned char)message[start];
+	int size = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+	if(start + size > len)message[start] = '\0';
+}
+
+/**
+ * @brief 오류 목록에 오류 하나를 추가한다. 인자는 diag_vadd와 같다.
+ *
+ * @return 오류 코드 (기록한 경우 = 0)
+ */
+int diag_add(diag_list *diags, name_id file, int line, int column,
+			 const char *format, ...) {
+	va_list ap;
+	int err;
+	
+	va_start(ap, format);
+	err = diag_vadd(diags, file, line, column, format, ap);
+	va_end(ap);
+	return err;
+}
+
+/**
+ * @brief 토큰 테이블의 한 라인에서 발견한 오류를 그 라인의 위치로 기록한다.
+ *
+ * @param diags 오류 목록 주소, 혹은 NULL
+ * @param tokens 토큰 테이블 주소
+ * @param i 오류가 있는 라인 번호
+ * @param column 열 번호 (token_column으로 구함)
+ * @param format 오류 내용의 printf 형식 문자열
+ * @return 오류 코드 (기록한 경우 = 0)
+ *
+ * @details
+ * 매크로를 확장한 라인들은 호출한 줄의 위치를 가지므로, 한 줄에서는 처음 발견한
+ * 오류만 기록한다.
+ */
+int diag_token(diag_list *diags, const token_store *tokens, int i, int column,
+			   const char *format, ...) {
+	va_list ap;
+	int err;
+	
+	if(diags==NULL)return -1;
+	if(diags->length > 0 && tokens->line[i]!=0 &&
+	   diags->items[diags->length - 1].line==tokens->line[i] &&
+	   diags->items[diags->length - 1].file==tokens->file[i]){
+		return 0;
+	}
+	
+	va_start(ap, format);
+	err = diag_vadd(diags, tokens->file[i], tokens->line[i], column, format, ap);
+	va_end(ap);
+	return err;
+}
+
+/**
+ * @brief 토큰의 필드가 소스코드 줄에서 시작하는 열 번호를 구한다.
+ *
+ * @param tok 토큰 주소
+ * @param field 필드 번호 (0: label, 1: operator, 2: operand)
+ * @return 1부터 시작하는 열 번호
+ *
+ * @details
+ * 토큰에는 원래 줄이 남아 있지 않으므로 필드 사이가 '\t' 하나로 구분되어 있다고
+ * 보고 앞 필드들의 길이로 계산한다.
+ */
+int token_column(const token *tok, int field) {
+	int column = 1;
+	
+	if(field>=1)column += (tok->label!=NULL ? strlen(tok->label) : 0) + 1;
+	if(field>=2)column += (tok->operator!=NULL ? strlen(tok->operator) : 0) + 1;
+	return column;
+}
+
+/**
+ * @brief 소스코드 한 줄에서 필드가 시작하는 열 번호를 구한다.
+ *
+ * @param line 소스코드 문자열
+ * @param field 필드 번호 (0: label, 1: operator, 2: operand)
+ * @return 1부터 시작하는 열 번호 (필드가 없으면 1)
+ */
+int line_column(const char *line, int field) {
+	const char *p = line;
+	
+	for(int k=0;k<field;k++){
+		p = strchr(p, '\t');
+		if(p==NULL)return 1;
+		p++;
+	}
+	return (int)(p - line) + 1;
+}
+
+/**
+ * @brief 오류 목록을 파일, 줄, 열 순서로 정렬한다.
+ *
+ * @param diags 오류 목록 주소
+ *
+ * @details
+ * 오류는 단계별로 기록되므로 출력하기 전에 소스코드 순서로 맞춘다. 소스코드의
+ * 오류가 INCLUDE 파일의 오류보다 먼저 온다.
+ */
+void diag_list_sort(diag_list *diags) {
+	if(diags->length > 1){
+		qsort(diags->items, diags->length, sizeof(diagnostic), diag_compare);
+	}
+}
+
+/**
+ * @brief 두 오류의 위치를 비교한다. (qsort용)
+ *
+ * @param a 첫 번째 오류 주소
+ * @param b 두 번째 오류 주소
+ * @return a가 앞이면 음수, 같으면 0, 뒤면 양수
+ */
+int diag_compare(const void *a, const void *b) {
+	const diagnostic *l = (const diagnostic*)a;
+	const diagnostic *r = (const diagnostic*)b;
+	
+	if(l->file!=r->file)return l->file < r->file ? -1 : 1;
+	if(l->line!=r->line)return l->line - r->line;
+	return l->column - r->column;
+}
+
+/**
+ * @brief 오류 목록이 사용하던 메모리를 해제하고 목록을 비운다.
+ *
+ * @param diags 오류 목록 주소
+ */
+void diag_list_free(diag_list *diags) {
+	free(diags->items);
+	memset(diags, 0, sizeof(diag_list));
+}
+
+/**
+ * @brief 파일 디스크립터에 버퍼의 내용을 모두 쓴다.
+ *
+ * @param fd 출력할 파일 디스크립터
+ * @param iov 출력할 버퍼들의 배열
+ * @param iovcnt 버퍼의 수
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 대부분 writev 한 번으로 끝나며, 일부만 쓰인 경우(pipe 등)에만 남은 부분을
+ * 이어서 쓴다.
+ */
+int write_all(int fd, struct iovec *iov, int iovcnt) {
+	while(iovcnt > 0){
+		ssize_t written = writev(fd, iov, iovcnt);
+		if(written < 0){
+			if(errno==EINTR)continue;
+			return -1;
+		}
+		// 모두 쓰인 버퍼들을 건너뛰고 일부만 쓰인 버퍼는 남은 부분부터 다시 씀
+		while(iovcnt > 0 && (size_t)written >= iov->iov_len){
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if(iovcnt > 0){
+			iov->iov_base = (char*)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief 출력 버퍼의 내용을 파일로 출력한다. `dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param dir 저장할 파일 경로, 혹은 NULL
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int output_buffer_write(const output_buffer *out, const char *dir) {
+	int fd = STDOUT_FILENO;
+	struct iovec iov;
+	int err = 0;
+	
+	if(dir!=NULL){
+		fd = open(dir, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0)return -1;
+	}
+	
+	iov.iov_base = out->data;
+	iov.iov_len = out->length;
+	err = write_all(fd, &iov, 1);
+	
+	if(dir!=NULL && close(fd) < 0)err = -1;
+	
+	return err;
+}
+
+/**
+ * @brief 심볼 테이블을 출력 버퍼에 작성한다.
+ *
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @param symbol_table 심볼 테이블 주소
+ * @param symbol_table_length 심볼 테이블 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int render_symbol_table(output_buffer *out, const symbol *symbol_table[],
+						int symbol_table_length) {
+	// 한 줄은 이름 2개와 주소, 구분자를 합쳐도 32바이트를 넘지 않음
+	if(output_buffer_init(out, symbol_table_length * 32 + 1) < 0)return -2;
+	
+	for(int i=0;i<symbol_table_length;i++){
+		int err;
+		// control section 이름과 absolute 심볼은 위치를 출력하지 않음
+		if(symbol_table[i]->absolute ||
+		   symbol_table[i]->name==symbol_table[i]->base){
+			err = output_buffer_printf(out, "%s\t%X\n", name_str(symbol_table[i]->name),
+									   symbol_table[i]->addr);
+		}
+		else {
+			err = output_buffer_printf(out, "%s\t%X\t +1 %s\n",
+									   name_str(symbol_table[i]->name),
+									   symbol_table[i]->addr,
+									   name_str(symbol_table[i]->base));
+		}
+		if(err < 0){
+			output_buffer_free(out);
+			return err;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 리터럴 테이블을 출력 버퍼에 작성한다.
+ *
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @param literal_table 리터럴 테이블 주소
+ * @param literal_table_length 리터럴 테이블 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 다른 리터럴과 바이트를 공유하는 리터럴은 공유하는 리터럴과 그 안에서의
+ * 위치를 함께 작성한다.
+ */
+int render_literal_table(output_buffer *out, const literal *literal_table[],
+						 int literal_table_length) {
+	// 한 줄은 표현식 2개와 주소, 구분자를 합쳐도 64바이트를 넘지 않음
+	if(output_buffer_init(out, literal_table_length * 64 + 1) < 0)return -2;
+	
+	for(int i=0;i<literal_table_length;i++){
+		int err = output_buffer_printf(out, "%s\t\t%X",
+									   literal_table[i]->literal, literal_table[i]->addr);
+		// 다른 리터럴과 바이트를 공유하는 경우 공유하는 리터럴을 함께 출력
+		if(err==0 && literal_table[i]->skip > 0){
+			for(int k=0;k<literal_table_length;k++){
+				if(k==i || literal_table[k]->base!=literal_table[i]->base)continue;
+				if(literal_table[k]->skip==literal_table[k]->size)continue;
+				if(literal_table[k]->addr <= literal_table[i]->addr &&
+				   literal_table[i]->addr < literal_table[k]->addr + literal_table[k]->size){
+					err = output_buffer_printf(out, "\t(%s+%d)", literal_table[k]->literal,
+											   literal_table[i]->addr - literal_table[k]->addr);
+					break;
 				}
-				
 			}
-			
-			strcat(now->line, "E");
-			if(!strcmp(pro_name, tmp_base)){
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%06X", pro_start);
-				strcat(now->line, tmp_hex);
+		}
+		if(err==0)err = output_buffer_printf(out, "\n");
+		if(err < 0){
+			output_buffer_free(out);
+			return err;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 오브젝트 코드를 출력 버퍼에 작성한다.
+ *
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @param obj_code 오브젝트 코드에 대한 정보를 담고 있는 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 각 줄의 길이를 먼저 더해 필요한 크기만큼 한 번에 할당한 뒤 복사한다.
+ */
+int render_objectcode(output_buffer *out, const object_code *obj_code) {
+	size_t total = 0;
+	const object_code *now;
+	
+	for(now = obj_code;now!=NULL;now = now->next){
+		total += strlen(now->line) + 1;
+	}
+	if(output_buffer_init(out, total + 1) < 0)return -2;
+	
+	for(now = obj_code;now!=NULL;now = now->next){
+		size_t len = strlen(now->line);
+		memcpy(out->data + out->length, now->line, len);
+		out->length += len;
+		out->data[out->length++] = '\n';
+	}
+	out->data[out->length] = '\0';
+	
+	return 0;
+}
+
+/**
+ * @brief 오류 목록을 출력 버퍼에 작성한다.
+ *
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @param diags 오류 목록 주소
+ * @param source_name 소스코드 파일 이름 (INCLUDE 파일이 아닌 위치에 사용)
+ * @param json 0이 아니면 JSON 형식으로 작성
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 기본 형식은 컴파일러와 같은 `파일:줄:열: 오류: 내용` 한 줄씩이다. JSON 형식은
+ * `{"errors":[{"file","line","column","message"}...],"count":N,"dropped":M}`
+ * 하나이며 위치를 모르는 값은 0이다.
+ */
+int render_diagnostics(output_buffer *out, const diag_list *diags,
+					   const char *source_name, int json) {
+	int err = 0;
+	
+	if(output_buffer_init(out, diags->length * 128 + 64) < 0)return -2;
+	
+	if(json)err = output_buffer_printf(out, "{\"errors\":[");
+	for(int k=0;k<diags->length && err>=0;k++){
+		const diagnostic *d = &diags->items[k];
+		const char *file = d->file!=NAME_NONE ? name_str(d->file) : source_name;
+		
+		if(!json){
+			if(d->line > 0){
+				err = output_buffer_printf(out, "%s:%d:%d: 오류: %s\n", file,
+										   d->line, d->column, d->message);
 			}
-			now->next = (object_code*)calloc(1, sizeof(object_code));
-			if(now->next==NULL){
-				return -2;
+			else err = output_buffer_printf(out, "%s: 오류: %s\n", file, d->message);
+			continue;
+		}
+		if((err = output_buffer_printf(out, k ? ",{\"file\":" : "{\"file\":")) < 0 ||
+		   (err = output_buffer_json_string(out, file)) < 0 ||
+		   (err = output_buffer_printf(out, ",\"line\":%d,\"column\":%d,"
+									   "\"message\":", d->line, d->column)) < 0 ||
+		   (err = output_buffer_json_string(out, d->message)) < 0){
+			break;
+		}
+		err = output_buffer_printf(out, "}");
+	}
+	if(err<0)return err;
+	
+	if(json){
+		return output_buffer_printf(out, "],\"count\":%d,\"dropped\":%d}\n",
+									diags->length, diags->dropped);
+	}
+	if(diags->dropped > 0){
+		return output_buffer_printf(out, "%s: 오류 %d개를 더 발견했지만 생략했습니다.\n",
+									source_name, diags->dropped);
+	}
+	return 0;
+}
+
+/**
+ * @brief 문자열을 따옴표로 감싼 JSON 문자열로 출력 버퍼에 이어 붙인다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param str 출력할 문자열 (UTF-8)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int output_buffer_json_string(output_buffer *out, const char *str) {
+	int err = output_buffer_printf(out, "\"");
+	
+	for(;*str && err>=0;str++){
+		unsigned char c = (unsigned char)*str;
+		if(c=='"' || c=='\\')err = output_buffer_printf(out, "\\%c", c);
+		else if(c < 0x20)err = output_buffer_printf(out, "\\u%04x", c);
+		else err = output_buffer_printf(out, "%c", c);
+	}
+	if(err<0)return err;
+	return output_buffer_printf(out, "\"");
+}
+
+/**
+ * @brief 출력 작업 하나를 수행하는 스레드 함수
+ *
+ * @param arg 수행할 출력 작업(output_job) 주소
+ * @return 항상 NULL (결과는 작업의 err 필드에 저장)
+ */
+void *output_job_run(void *arg) {
+	output_job *job = (output_job*)arg;
+	job->err = output_buffer_write(job->out, job->dir);
+	return NULL;
+}
+
+/**
+ * @brief 여러 출력 버퍼를 각자의 파일로 출력한다.
+ *
+ * @param jobs 출력 작업 배열
+ * @param jobs_length 출력 작업 수
+ * @param thread_flag 0이 아니면 파일마다 별도의 스레드에서 동시에 출력
+ * @return 오류 코드 (정상 종료 = 0, 실패한 경우 처음 실패한 작업의 오류 코드)
+ */
+int write_output_files(output_job jobs[], int jobs_length, int thread_flag) {
+	pthread_t threads[MAX_OUTPUT_JOBS];
+	int started[MAX_OUTPUT_JOBS];
+	
+	if(jobs_length > MAX_OUTPUT_JOBS)return -1;
+	
+	for(int i=0;i<jobs_length;i++){
+		started[i] = 0;
+		if(thread_flag &&
+		   pthread_create(&threads[i], NULL, output_job_run, &jobs[i])==0){
+			started[i] = 1;
+		}
+		// 스레드를 사용하지 않거나 생성에 실패하면 직접 출력
+		else {
+			output_job_run(&jobs[i]);
+		}
+	}
+	for(int i=0;i<jobs_length;i++){
+		if(started[i])pthread_join(threads[i], NULL);
+	}
+	for(int i=0;i<jobs_length;i++){
+		if(jobs[i].err < 0)return jobs[i].err;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 여러 출력 버퍼를 태그를 붙여 stdout 하나로 출력한다.
+ *
+ * @param jobs 출력 작업 배열
+ * @param jobs_length 출력 작업 수
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 각 출력 앞에 `### <파일 이름> <바이트 수>` 형식의 태그 줄을 붙여 하나의
+ * writev로 출력한다. 받는 쪽은 태그의 바이트 수만큼 읽어 각 파일을 분리할 수
+ * 있다.
+ */
+int write_tagged_output(output_job jobs[], int jobs_length) {
+	char tags[MAX_OUTPUT_JOBS][300];
+	struct iovec iov[MAX_OUTPUT_JOBS * 2];
+	
+	if(jobs_length > MAX_OUTPUT_JOBS)return -1;
+	
+	for(int i=0;i<jobs_length;i++){
+		snprintf(tags[i], sizeof(tags[i]), "### %s %zu\n",
+				 jobs[i].dir, jobs[i].out->length);
+		iov[i*2].iov_base = tags[i];
+		iov[i*2].iov_len = strlen(tags[i]);
+		iov[i*2+1].iov_base = jobs[i].out->data;
+		iov[i*2+1].iov_len = jobs[i].out->length;
+	}
+	
+	return write_all(STDOUT_FILENO, iov, jobs_length * 2);
+}
+
+/**
+ * @brief 어셈블 통계를 출력한다. `stat_dir`이 NULL인 경우 결과를 stdout으로
+ * 출력한다.
+ *
+ * @param stat_dir 통계를 저장할 파일 경로, 혹은 NULL
+ * @param stat 어셈블 통계를 담고 있는 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * base relative로 인코딩된 명령어는 BASE가 없었다면 4형식(4바이트)으로 작성해야
+ * 했으므로, 명령어 하나당 1바이트씩 더한 값을 BASE를 사용하지 않았을 때의 코드
+ * 크기로 함께 출력한다. 리터럴 pool에 실제로 기록된 바이트 수와 다른 리터럴과
+ * 공유하여 생략된 바이트 수, Text Record를 최대 길이까지 채워서 줄어든 record
+ * 수, 병합 전후의 Modification Record 수도 함께 출력한다.
+ */
+int make_stat_output(const char *stat_dir, const assem_stat *stat) {
+	FILE *fp;
+	// fp가 NULL이면 file pointer를 표준출력으로 설정
+	if(stat_dir==NULL){
+		fp = stdout;
+	}
+	else {
+		fp = fopen(stat_dir, "w");
+		if(fp==NULL){
+			return -1;
+		}
+	}
+	
+	int without_base = stat->code_bytes + stat->base_relative;
+	
+	fprintf(fp, "code bytes\t%d\n", stat->code_bytes);
+	fprintf(fp, "base relative\t%d\n", stat->base_relative);
+	fprintf(fp, "without BASE\t%d", without_base);
+	if(without_base > 0){
+		fprintf(fp, "\t(-%.1f%%)",
+				100.0 * stat->base_relative / without_base);
+	}
+	fprintf(fp, "\n");
+	fprintf(fp, "literal bytes\t%d\n", stat->literal_bytes);
+	fprintf(fp, "literal shared\t%d\n", stat->literal_shared);
+	fprintf(fp, "text records\t%d\t(instruction aligned: %d, saved %d)\n",
+			stat->text_records, stat->aligned_records,
+			stat->aligned_records - stat->text_records);
+	fprintf(fp, "modification records\t%d\t(before merge: %d)\n",
+			stat->mod_records, stat->mod_records_raw);
+	fprintf(fp, "token bytes\t%ld", stat->token_bytes);
+	if(stat->token_lines > 0){
+		fprintf(fp, "\t(%.1f bytes/line)",
+				(double)stat->token_bytes / stat->token_lines);
+	}
+	fprintf(fp, "\n");
+	
+	if(fp!=stdout){
+		fclose(fp);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief peephole 최적화 결과를 출력한다. `peephole_dir`이 NULL인 경우 결과를
+ * stdout으로 출력한다.
+ *
+ * @param peephole_dir 결과를 저장할 파일 경로, 혹은 NULL
+ * @param report peephole 최적화 결과를 담고 있는 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * control section마다 제거한 명령어 수와 줄어든 바이트 수를, 이어서 규칙마다
+ * 제거한 명령어 수를 출력한다.
+ */
+int make_peephole_output(const char *peephole_dir,
+						 const peephole_report *report) {
+	static const char *rule_names[PEEPHOLE_RULES] = {
+		"clear", "load", "jump", "compare"
+	};
+	int instructions = 0, bytes = 0;
+	FILE *fp;
+	
+	if(peephole_dir==NULL){
+		fp = stdout;
+	}
+	else {
+		fp = fopen(peephole_dir, "w");
+		if(fp==NULL){
+			return -1;
+		}
+	}
+	
+	for(int i=0;i<report->length;i++){
+		const peephole_section *section = &report->sections[i];
+		fprintf(fp, "peephole %s\t%d instructions\t%d bytes\n",
+				name_str(section->name), section->instructions, section->bytes);
+		instructions += section->instructions;
+		bytes += section->bytes;
+	}
+	fprintf(fp, "peephole total\t%d instructions\t%d bytes\n", instructions, bytes);
+	for(int k=0;k<PEEPHOLE_RULES;k++){
+		fprintf(fp, "peephole rule %s\t%d\n", rule_names[k], report->rules[k]);
+	}
+	
+	if(fp!=stdout){
+		fclose(fp);
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief pass 1을 마친 토큰 테이블에서 심볼, 리터럴, 외부 이름의 상호 참조
+ * 색인을 만든다.
+ *
+ * @param xrefs 비어 있는 상호 참조 색인 주소
+ * @param tokens pass 1을 마친 토큰 테이블의 주소
+ * @param symbol_table 심볼 테이블의 주소
+ * @param symbol_table_length 심볼 테이블의 길이
+ * @param literal_table 리터럴 테이블의 주소
+ * @param literal_table_length 리터럴 테이블의 길이
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * label은 정의로, EXTDEF와 EXTREF의 이름은 각각의 종류로 기록한다. EQU의 정의는
+ * 라인의 주소 대신 심볼의 값을 기록한다 (xref_def_addr 참고). 수식의 사용은
+ * resolve_expressions가 컴파일해 둔 심볼 테이블 번호와 외부 이름에서 얻으므로
+ * operand를 다시 파싱하지 않는다. 리터럴은 pass 1과 같은 순서로 리터럴 테이블에
+ * 추가되므로 새로 추가된 리터럴을 테이블 순서로 맞추어 가며, 리터럴을 배치한
+ * LTORG, END, CSECT 라인을 정의로 기록한다. 이전 pool의 리터럴에 닿지 않는
+ * 라인의 리터럴은 pass 1처럼 새 항목으로 센다. 다 모은 뒤 xref_group으로 정렬한다.
+ */
+int xref_build(xref_table *xrefs, const token_store *tokens,
+			   const symbol *symbol_table[], int symbol_table_length,
+			   const literal *literal_table[], int literal_table_length) {
+	name_id section = NAME_NONE;
+	name_id *literal_names = NULL;
+	int *literal_defs = NULL;
+	int next_literal = 0, placed = 0;
+	int err = 0;
+	
+	token view;
+	token *tok = &view;
+	
+	// 리터럴마다 이름 번호와 배치된 라인
+	if(literal_table_length > 0){
+		literal_names = (name_id*)calloc(literal_table_length, sizeof(name_id));
+		literal_defs = (int*)calloc(literal_table_length, sizeof(int));
+		if(literal_names==NULL || literal_defs==NULL){
+			free(literal_names);
+			free(literal_defs);
+			return -2;
+		}
+	}
+	for(int k=0;k<literal_table_length && err>=0;k++){
+		err = name_intern(literal_table[k]->literal, &literal_names[k]);
+		literal_defs[k] = -1;
+	}
+	
+	for(int i=0;i<tokens->length && err>=0;i++){
+		token_store_get(tokens, i, tok);
+		if(tok->operator==NULL)continue;
+		
+		// 아직 배치되지 않은 리터럴은 이 라인에서 배치됨
+		// (CSECT는 앞의 control section의 리터럴을 배치)
+		if(!strcmp(tok->operator, "LTORG") || !strcmp(tok->operator, "END") ||
+		   !strcmp(tok->operator, "CSECT")){
+			for(;placed<next_literal;placed++){
+				literal_defs[placed] = i;
 			}
-			now = now->next;
-			
-			
-			
-			
-			memset(tmp_base, 0, sizeof(tmp_base));
-			strncpy(tmp_base, tmp_token.label, strlen(tmp_token.label));
-			// "H"문자열 추가
-			strcat(now->line, "H");
-			left_str = strlen(now->line);
-			right_str = strlen(tmp_token.label);
-			// 두 문자열의 합이 99이상이면 에러 '\t'를 붙일 것이기 때문
-			if(left_str + right_str >= 99)return -1;
-			// Header를 정의
-			strcat(now->line, tmp_token.label);
-			strcat(now->line, "\t");
-			
-			// 시작주소 붙이기
-			memset(tmp_hex, 0, sizeof(tmp_hex));
-			sprintf(tmp_hex, "000000");
-			left_str = strlen(now->line);
-			right_str = strlen(tmp_hex);
-			// 두 문자열의 합이 100이상이면 에러
-			if(left_str + right_str >= 100)return -1;
-			// Header를 정의
-			strcat(now->line, tmp_hex);
-			
-			
-			total += location_counter;
-			pro_size[pro_cnt++] = location_counter;
-			location_counter = 0;
-			pos = 0;
-			
-			// 다음 포인터를 지정
-			now->next = (object_code*)calloc(1, sizeof(object_code));
-			if(now->next==NULL){
-				return -2;
+		}
+		if(!strcmp(tok->operator, "START") || !strcmp(tok->operator, "CSECT")){
+			section = tok->label_id;
+		}
+		
+		if(tok->label_id!=NAME_NONE &&
+		   (err = xref_add(xrefs, tokens, i, tok->label_id, section,
+						   xref_def_addr(tok, section, symbol_table,
+										 symbol_table_length),
+						   XREF_DEF)) < 0){
+			break;
+		}
+		
+		if(!strcmp(tok->operator, "EXTDEF") || !strcmp(tok->operator, "EXTREF")){
+			int kind = tok->operator[3]=='D' ? XREF_EXTDEF : XREF_EXTREF;
+			const char *name = tok->names;
+			for(int k=0;k<tok->names_length && err>=0;k++){
+				name_id id = NAME_NONE;
+				if((err = name_intern(name, &id)) >= 0){
+					err = xref_add(xrefs, tokens, i, id, section, tok->addr, kind);
+				}
+				name += strlen(name) + 1;
 			}
-			now = now->next;
-			ltorg_flag = 0;
 			continue;
 		}
 		
-		// operator가 "END"인 경우
-		else if(!strcmp(tmp_token.operator, "END")){
-			if(!ltorg_flag){
-				
-				for(int k=0;k<literal_table_length;k++){
-					
-					// 리터럴 확인
-					if(!strcmp(literal_table[k]->base, tmp_base)){
-						memset(tmp_hex, 0, sizeof(tmp_hex));
-						// 리터럴 타입 확인 후 적절하게 tmp_hex에 넣어줌
-						if(*(literal_table[k]->literal + 1)=='C'){
-							location_counter += literal_table[k]->size;
-							char h[4];
-							for(int j=3;j<3+literal_table[k]->size;j++){
-								memset(h, 0, sizeof(h));
-								sprintf(h, "%02X", literal_table[k]->literal[j]);
-								strcat(tmp_hex, h);
-							}
-							
-						}
-						else if(*(literal_table[k]->literal + 1)=='X'){
-							location_counter += literal_table[k]->size/2;
-							strncpy(tmp_hex, literal_table[k]->literal+3, literal_table[k]->size);
-						}
-						left_str = strlen(now->line);
-						right_str = strlen(tmp_hex);
-						if(left_str + right_str >= 100)return -1;
-						strcat(now->line, tmp_hex);
-					}
-				}
-				// line이 있는 경우만 새로운 줄을 생성
-				if(strlen(now->line)>0){
-					char tmp[100];
-					memset(tmp, 0, sizeof(tmp));
-					int now_pos = strlen(now->line)/2;
-					sprintf(tmp, "T%06X%02X", pos, now_pos);
-					pos += now_pos;
-					strcat(tmp, now->line);
-					memset(now->line, 0, sizeof(now->line));
-					strncpy(now->line, tmp, strlen(tmp));
-					
-					now->next = (object_code*)calloc(1, sizeof(object_code));
-					if(now->next==NULL){
-						return -2;
-					}
-					now = now->next;
+		const char *operand = tok->operand[0];
+		if(operand==NULL)continue;
+		
+		// 컴파일된 수식의 심볼과 외부 이름 (같은 이름은 한 번만)
+		if(tok->expr!=NULL){
+			const expression *expr = tok->expr;
+			for(int k=0;k<expr->length && err>=0;k++){
+				if(expr->items[k].kind!=EXPR_SYMBOL)continue;
+				int j = 0;
+				while(j<k && !(expr->items[j].kind==EXPR_SYMBOL &&
+							   expr->items[j].value==expr->items[k].value)){
+					j++;
 				}
-				ltorg_flag = 0;
+				if(j<k)continue;
+				err = xref_add(xrefs, tokens, i,
+							   symbol_table[expr->items[k].value]->name, section,
+							   tok->addr, XREF_USE);
 			}
-			
-			while(mod_red->next != NULL){
-				// 헤더
-				strcat(now->line, "M");
-				// 주소
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%06X", mod_red->addr);
-				strcat(now->line, tmp_hex);
-				// 위치
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%02X", mod_red->pos);
-				strcat(now->line, tmp_hex);
-				// op, name
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%c%s", mod_red->op, mod_red->name);
-				strcat(now->line, tmp_hex);
-				
-				mod_red = mod_red->next;
-				
-				// line이 있는 경우만 새로운 줄을 생성
-				if(strlen(now->line)>0){
-					now->next = (object_code*)calloc(1, sizeof(object_code));
-					if(now->next==NULL){
-						return -2;
-					}
-					now = now->next;
-				}
-				
+			for(int e=0;e<expr->externs_length && err>=0;e++){
+				err = xref_add(xrefs, tokens, i, expr->externs[e], section,
+							   tok->addr, XREF_USE);
 			}
-			
-			
-			
-			total += location_counter;
-			pro_size[pro_cnt++] = location_counter;
-			location_counter = 0;
-			
-			
-			if(strlen(now->line)>0){
-				now->next = (object_code*)calloc(1, sizeof(object_code));
-				if(now->next==NULL){
-					return -2;
+		}
+		else if(*operand=='='){
+			// pass 1처럼 아직 배치되지 않았거나 이 라인에서 닿는 같은 리터럴이
+			// 있으면 그 리터럴을 사용하고, 없으면 리터럴 테이블의 다음 항목과 같음
+			int pc = tok->addr + ((tok->nixbpe & 1) ? 4 : 3);
+			int shared = 0;
+			for(int k=0;k<next_literal && !shared;k++){
+				shared = literal_table[k]->base==section &&
+						 !strcmp(literal_table[k]->literal, operand) &&
+						 (k >= placed ||
+						  literal_reachable(literal_table[k], tok->nixbpe, pc));
+			}
+			if(!shared && next_literal < literal_table_length &&
+			   literal_table[next_literal]->base==section &&
+			   !strcmp(literal_table[next_literal]->literal, operand)){
+				next_literal++;
+			}
+			name_id id = NAME_NONE;
+			if((err = name_intern(operand, &id)) >= 0){
+				err = xref_add(xrefs, tokens, i, id, section, tok->addr, XREF_USE);
+			}
+		}
+		// BASE는 같은 control section의 심볼, END는 시작 주소의 심볼
+		else if(!strcmp(tok->operator, "BASE") || !strcmp(tok->operator, "END")){
+			name_id id = name_find(operand);
+			for(int k=0;k<symbol_table_length && id!=NAME_NONE;k++){
+				if(symbol_table[k]->name!=id)continue;
+				if(tok->operator[0]=='B' && symbol_table[k]->base!=section)continue;
+				// END의 심볼은 첫 control section의 심볼이므로 그 section의 사용
+				err = xref_add(xrefs, tokens, i, id, symbol_table[k]->base,
+							   tok->addr, XREF_USE);
+				break;
+			}
+		}
+	}
+	
+	// 이전 pool의 리터럴과 주소를 공유하는 리터럴은 그 리터럴이 배치된 라인
+	for(int k=0;k<literal_table_length && err>=0;k++){
+		const literal *lit = literal_table[k];
+		if(lit->skip==lit->size){
+			for(int j=0;j<k;j++){
+				const literal *other = literal_table[j];
+				if(other->base==lit->base && other->skip<other->size &&
+				   other->addr<=lit->addr &&
+				   lit->addr<other->addr + other->size){
+					literal_defs[k] = literal_defs[j];
+					break;
 				}
-				now = now->next;
 			}
-			
-			// "E" 추가
-			strcat(now->line, "E");
-			continue;
 		}
-		
-		// operator가 "LTORG"인 경우
-		else if(!strcmp(tmp_token.operator, "LTORG")){
-			ltorg_flag = 1;
-			// line이 있는 경우만 새로운 줄을 생성
-			if(strlen(now->line)>0){
-				char tmp[100];
-				memset(tmp, 0, sizeof(tmp));
-				int now_pos = strlen(now->line)/2;
-				sprintf(tmp, "T%06X%02X", pos, now_pos);
-				pos += now_pos;
-				strcat(tmp, now->line);
-				memset(now->line, 0, sizeof(now->line));
-				strncpy(now->line, tmp, strlen(tmp));
-				
-				now->next = (object_code*)calloc(1, sizeof(object_code));
-				if(now->next==NULL){
-					return -2;
-				}
-				now = now->next;
-			}
-			
-			for(int k=0;k<literal_table_length;k++){
-				// 리터럴 확인
-				if(!strcmp(literal_table[k]->base, tmp_base)){
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					// 리터럴 타입 확인 후 적절하게 tmp_hex에 넣어줌
-					if(*(literal_table[k]->literal + 1)=='C'){
-						location_counter += literal_table[k]->size;
-						char h[4];
-						for(int j=3;j<3+literal_table[k]->size;j++){
-							memset(h, 0, sizeof(h));
-							sprintf(h, "%02X", literal_table[k]->literal[j]);
-							strcat(tmp_hex, h);
-						}
-						
-					}
-					else if(*(literal_table[k]->literal + 1)=='X'){
-						location_counter += literal_table[k]->size/2;
-						strncpy(tmp_hex, literal_table[k]->literal+3, literal_table[k]->size);
-					}
-					
-					left_str = strlen(now->line);
-					right_str = strlen(tmp_hex);
-					if(left_str + right_str >= 100)return -1;
-					strcat(now->line, tmp_hex);
-				}
-			}
-			// line이 있는 경우만 새로운 줄을 생성
-			if(strlen(now->line)>0){
-				char tmp[100];
-				memset(tmp, 0, sizeof(tmp));
-				int now_pos = strlen(now->line)/2;
-				sprintf(tmp, "T%06X%02X", location_counter - now_pos, now_pos);
-				strcat(tmp, now->line);
-				memset(now->line, 0, sizeof(now->line));
-				strncpy(now->line, tmp, strlen(tmp));
-				
-				now->next = (object_code*)calloc(1, sizeof(object_code));
-				if(now->next==NULL){
-					return -2;
-				}
-				now = now->next;
+		if(literal_defs[k]<0)continue;
+		err = xref_add(xrefs, tokens, literal_defs[k], literal_names[k], lit->base,
+					   lit->addr, XREF_DEF);
+	}
+	
+	free(literal_names);
+	free(literal_defs);
+	if(err<0)return err;
+	
+	return xref_group(xrefs);
+}
+
+/**
+ * @brief label 정의로 기록할 주소를 구한다.
+ *
+ * @param tok label이 있는 라인의 토큰 주소
+ * @param section 라인이 속한 control section 이름
+ * @param symbol_table 심볼 테이블의 주소
+ * @param symbol_table_length 심볼 테이블의 길이
+ * @return 기록할 주소
+ *
+ * @details
+ * EQU로 정의한 심볼은 라인의 Location Counter가 아니라 심볼 테이블의 값이다.
+ * 예를 들어 MAXLEN EQU BUFEND-BUFFER는 정의된 위치와 상관없이 두 주소의 차이를
+ * 기록한다. 나머지 라인은 라인의 주소이다.
+ */
+int xref_def_addr(const token *tok, name_id section, const symbol *symbol_table[],
+				  int symbol_table_length) {
+	if(strcmp(tok->operator, "EQU"))return tok->addr;
+	
+	for(int k=0;k<symbol_table_length;k++){
+		if(symbol_table[k]->name==tok->label_id && symbol_table[k]->base==section){
+			return symbol_table[k]->addr;
+		}
+	}
+	return tok->addr;
+}
+
+/**
+ * @brief 상호 참조 색인에 토큰 테이블의 라인 하나의 참조를 추가한다.
+ *
+ * @param xrefs 상호 참조 색인 주소
+ * @param tokens 토큰 테이블의 주소
+ * @param i 참조가 나온 라인 번호
+ * @param name 참조한 이름
+ * @param section 라인이 속한 control section 이름
+ * @param addr 기록할 주소
+ * @param kind XREF_DEF 등 참조의 종류
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int xref_add(xref_table *xrefs, const token_store *tokens, int i, name_id name,
+			 name_id section, int addr, int kind) {
+	if(xrefs->length == xrefs->capacity){
+		int capacity = xrefs->capacity ? xrefs->capacity * 2 : 16;
+		xref_ref *refs = (xref_ref*)realloc(xrefs->refs, capacity * sizeof(xref_ref));
+		if(refs==NULL)return -2;
+		xrefs->refs = refs;
+		xrefs->capacity = capacity;
+	}
+	
+	xref_ref *ref = &xrefs->refs[xrefs->length++];
+	ref->name = name;
+	ref->section = section;
+	ref->file = tokens->file[i];
+	ref->operator = tokens->operator[i];
+	ref->line = tokens->line[i];
+	ref->addr = addr;
+	ref->order = i;
+	ref->kind = (char)kind;
+	ref->nixbpe = tokens->nixbpe[i];
+	
+	return 0;
+}
+
+/**
+ * @brief qsort에 사용하는 상호 참조 비교 함수
+ *
+ * @details
+ * 이름의 문자열 순서, 종류, 라인 순서로 비교한다. 출력 파일도 같은 순서이므로
+ * 파일에서도 이름을 이진 탐색할 수 있다.
+ */
+int xref_compare(const void *a, const void *b) {
+	const xref_ref *x = (const xref_ref*)a;
+	const xref_ref *y = (const xref_ref*)b;
+	
+	if(x->name!=y->name)return strcmp(name_str(x->name), name_str(y->name));
+	if(x->kind!=y->kind)return x->kind - y->kind;
+	return x->order - y->order;
+}
+
+/**
+ * @brief 모은 참조들을 정렬하고 이름마다 참조 구간을 만든다.
+ *
+ * @param xrefs 참조를 모두 추가한 상호 참조 색인 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int xref_group(xref_table *xrefs) {
+	free(xrefs->names);
+	xrefs->names = NULL;
+	xrefs->names_length = 0;
+	if(xrefs->length==0)return 0;
+	
+	qsort(xrefs->refs, xrefs->length, sizeof(xref_ref), xref_compare);
+	
+	xrefs->names = (xref_name*)calloc(xrefs->length, sizeof(xref_name));
+	if(xrefs->names==NULL)return -2;
+	for(int i=0;i<xrefs->length;i++){
+		if(i==0 || xrefs->refs[i].name!=xrefs->refs[i-1].name){
+			xref_name *n = &xrefs->names[xrefs->names_length++];
+			n->name = xrefs->refs[i].name;
+			n->start = i;
+		}
+		xrefs->names[xrefs->names_length - 1].count[(int)xrefs->refs[i].kind]++;
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 상호 참조 색인에서 이름의 참조 구간을 이진 탐색으로 찾는다.
+ *
+ * @param xrefs xref_build로 만든 상호 참조 색인 주소
+ * @param name 찾을 이름
+ * @return 이름의 참조 구간 (없는 경우 NULL)
+ *
+ * @details
+ * 종류별 참조는 `refs[start]`부터 XREF_DEF, XREF_EXTDEF, XREF_EXTREF, XREF_USE
+ * 순서로 `count`개씩 이어진다.
+ */
+const xref_name *xref_find(const xref_table *xrefs, const char *name) {
+	int lo = 0, hi = xrefs->names_length;
+	
+	while(lo < hi){
+		int mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(name_str(xrefs->names[mid].name), name);
+		if(cmp==0)return &xrefs->names[mid];
+		if(cmp < 0)lo = mid + 1;
+		else hi = mid;
+	}
+	
+	return NULL;
+}
+
+/**
+ * @brief 상호 참조 색인이 사용하던 메모리를 해제한다.
+ *
+ * @param xrefs 상호 참조 색인 주소
+ */
+void xref_table_free(xref_table *xrefs) {
+	free(xrefs->refs);
+	free(xrefs->names);
+	memset(xrefs, 0, sizeof(xref_table));
+}
+
+/**
+ * @brief 상호 참조 색인을 출력 버퍼에 작성한다.
+ *
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @param xrefs xref_build로 만든 상호 참조 색인 주소
+ * @param source_name 소스코드 파일 이름 (INCLUDE 파일이 아닌 위치에 사용)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 참조 하나를 한 줄로, "이름 종류 control_section 파일:줄 주소 operator 주소_지정_방식"을
+ * '\t'로 구분하여 정렬된 순서대로 작성한다. EQU 정의의 주소 열은 심볼의 값이다.
+ * 주소 지정 방식은 명령어의 operand에서 사용한 경우에만 쓰고 나머지는 '-'이다.
+ */
+int render_xref(output_buffer *out, const xref_table *xrefs,
+				const char *source_name) {
+	static const char *kinds[XREF_KINDS] = {"def", "extdef", "extref", "use"};
+	char mode[16];
+	
+	// 한 줄은 이름과 파일 이름을 빼면 64바이트를 넘지 않음
+	if(output_buffer_init(out, xrefs->length * 64 + 1) < 0)return -2;
+	
+	for(int i=0;i<xrefs->length;i++){
+		const xref_ref *ref = &xrefs->refs[i];
+		if(ref->kind==XREF_USE)xref_mode(ref->nixbpe, mode);
+		else strcpy(mode, "-");
+		
+		int err = output_buffer_printf(out, "%s\t%s\t%s\t%s:%d\t%06X\t%s\t%s\n",
+									   name_str(ref->name), kinds[(int)ref->kind],
+									   ref->section!=NAME_NONE ? name_str(ref->section) : "-",
+									   ref->file!=NAME_NONE ? name_str(ref->file) : source_name,
+									   ref->line, ref->addr & 0xFFFFFF,
+									   name_str(ref->operator), mode);
+		if(err < 0){
+			output_buffer_free(out);
+			return err;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 특수 bit 정보로 operand의 주소 지정 방식을 나타내는 문자열을 만든다.
+ *
+ * @param nixbpe 라인의 특수 bit 정보
+ * @param mode 문자열을 저장할 버퍼 (16바이트 이상)
+ *
+ * @details
+ * 4형식은 앞에 '+'를, index를 사용하면 뒤에 ",X"를 붙인다. 3/4형식이 아니면 '-'이다.
+ */
+void xref_mode(char nixbpe, char *mode) {
+	const char *kind;
+	
+	switch(nixbpe & 48){
+	case 48: kind = "simple"; break;
+	case 32: kind = "indirect"; break;
+	case 16: kind = "immediate"; break;
+	default:
+		strcpy(mode, "-");
+		return;
+	}
+	sprintf(mode, "%s%s%s", (nixbpe & 1) ? "+" : "", kind,
+			(nixbpe & 8) ? ",X" : "");
+}
+
+/**
+ * @brief render_xref로 쓴 상호 참조 파일을 mmap하여 질의에 답한다.
+ *
+ * @param xref_dir 상호 참조 파일 경로
+ * @param query 질의 ("defs", "uses", "unused")
+ * @param name 찾을 이름 ("unused"는 NULL)
+ * @param out 초기화된 출력 버퍼 주소 (찾은 줄들을 그대로 작성)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 파일을 읽어 들이거나 다시 어셈블하지 않으므로 큰 프로그램에서도 편집기 같은
+ * 도구가 바로 질의할 수 있다.
+ */
+int xref_query_file(const char *xref_dir, const char *query, const char *name,
+					output_buffer *out) {
+	struct stat st;
+	
+	int fd = open(xref_dir, O_RDONLY);
+	if(fd<0)return -1;
+	if(fstat(fd, &st)<0){
+		close(fd);
+		return -1;
+	}
+	// 빈 파일은 mmap할 수 없으므로 참조가 없는 파일로 질의
+	if(st.st_size==0){
+		close(fd);
+		return xref_query("", 0, query, name, out);
+	}
+	
+	char *map = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map==MAP_FAILED)return -1;
+	
+	int err = xref_query(map, st.st_size, query, name, out);
+	munmap(map, st.st_size);
+	return err;
+}
+
+/**
+ * @brief 상호 참조 파일의 내용으로 질의에 답한다.
+ *
+ * @param data 상호 참조 파일의 내용
+ * @param length 내용의 바이트 수
+ * @param query 질의 ("defs", "uses", "unused")
+ * @param name 찾을 이름 ("unused"는 NULL)
+ * @param out 초기화된 출력 버퍼 주소 (찾은 줄들을 그대로 작성)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * "defs"와 "uses"는 이름을 이진 탐색한 뒤 그 이름의 줄들만 읽으므로 O(log n)
+ * 이다. "unused"는 파일 전체를 이름마다 읽으며 같은 control section에서 사용하거나
+ * EXTDEF하지 않은 정의와 EXTREF 줄을 작성한다. control section 이름은 제외한다.
+ */
+int xref_query(const char *data, size_t length, const char *query,
+			   const char *name, output_buffer *out) {
+	const char *end = data + length;
+	
+	if(strcmp(query, "unused")){
+		const char *want;
+		if(!strcmp(query, "defs"))want = "def\t";
+		else if(!strcmp(query, "uses"))want = "use\t";
+		else return -1;
+		if(name==NULL)return -1;
+		
+		const char *line = data + xref_lower_bound(data, length, name);
+		while(line < end){
+			const char *next = (const char*)memchr(line, '\n', end - line);
+			if(next==NULL)next = end;
+			if(xref_line_compare(line, next, name))break;
+			const char *kind = xref_field(line, next, 1);
+			if(xref_field_equal(kind, next, want) &&
+			   output_buffer_printf(out, "%.*s\n", (int)(next - line), line) < 0){
+				return -2;
+			}
+			line = next + 1;
+		}
+		return 0;
+	}
+	
+	const char *line = data;
+	while(line < end){
+		// 이름 하나의 줄들의 끝을 찾음
+		const char *group = line;
+		const char *next = (const char*)memchr(line, '\n', end - line);
+		size_t name_length = xref_field(line, next!=NULL ? next : end, 1) - line;
+		while(line < end){
+			next = (const char*)memchr(line, '\n', end - line);
+			if(next==NULL)next = end;
+			if(xref_field(line, next, 1) - line != (long)name_length ||
+			   memcmp(line, group, name_length)){
+				break;
+			}
+			line = next + 1;
+		}
+		const char *group_end = line < end ? line : end;
+		
+		// 정의와 EXTREF마다 같은 control section의 사용이나 EXTDEF가 있는지 확인
+		for(const char *p=group;p<group_end;p=next + 1){
+			next = (const char*)memchr(p, '\n', group_end - p);
+			if(next==NULL)next = group_end;
+			const char *kind = xref_field(p, next, 1);
+			const char *operator = xref_field(p, next, 5);
+			// control section 이름은 사용하지 않아도 보고하지 않음
+			int candidate = xref_field_equal(kind, next, "extref\t") ||
+							(xref_field_equal(kind, next, "def\t") &&
+							 !xref_field_equal(operator, next, "START\t") &&
+							 !xref_field_equal(operator, next, "CSECT\t"));
+			if(candidate && !xref_section_used(group, group_end, p, next) &&
+			   output_buffer_printf(out, "%.*s\n", (int)(next - p), p) < 0){
+				return -2;
+			}
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 이름 순서로 정렬된 상호 참조 파일에서 이름이 `name`보다 작지 않은 첫
+ * 줄의 위치를 이진 탐색으로 찾는다.
+ *
+ * @param data 상호 참조 파일의 내용
+ * @param length 내용의 바이트 수
+ * @param name 찾을 이름
+ * @return 찾은 줄의 시작 위치 (없는 경우 length)
+ *
+ * @details
+ * 바이트 위치로 구간을 나누고 가운데 위치가 속한 줄의 처음으로 돌아가 비교한다.
+ * `lo`와 `hi`는 항상 줄의 시작이므로 줄 하나를 읽을 때마다 구간이 줄어든다.
+ */
+size_t xref_lower_bound(const char *data, size_t length, const char *name) {
+	size_t lo = 0, hi = length;
+	
+	while(lo < hi){
+		size_t mid = lo + (hi - lo) / 2;
+		size_t start = mid;
+		while(start > lo && data[start - 1]!='\n')start--;
+		
+		const char *next = (const char*)memchr(data + mid, '\n', length - mid);
+		size_t end = next!=NULL ? (size_t)(next - data) : length;
+		if(xref_line_compare(data + start, data + end, name) < 0)lo = end + 1;
+		else hi = start;
+	}
+	
+	return lo < length ? lo : length;
+}
+
+/**
+ * @brief 상호 참조 파일의 한 줄의 이름을 문자열과 strcmp와 같은 순서로 비교한다.
+ *
+ * @param line 줄의 시작
+ * @param end 줄의 끝 ('\n' 또는 파일의 끝)
+ * @param name 비교할 이름
+ * @return 줄의 이름이 작으면 음수, 같으면 0, 크면 양수
+ */
+int xref_line_compare(const char *line, const char *end, const char *name) {
+	const unsigned char *p = (const unsigned char*)line;
+	const unsigned char *q = (const unsigned char*)name;
+	
+	while(p < (const unsigned char*)end && *p!='\t' && *q && *p==*q){
+		p++;
+		q++;
+	}
+	int c = p < (const unsigned char*)end && *p!='\t' ? *p : 0;
+	return c - *q;
+}
+
+/**
+ * @brief 상호 참조 파일의 한 줄에서 `field`번째 필드의 시작을 찾는다.
+ *
+ * @param line 줄의 시작
+ * @param end 줄의 끝 ('\n' 또는 파일의 끝)
+ * @param field 필드 번호 (0부터, '\t'로 구분)
+ * @return 필드의 시작 (필드가 없는 경우 end)
+ */
+const char *xref_field(const char *line, const char *end, int field) {
+	while(field > 0 && line < end){
+		if(*line++=='\t')field--;
+	}
+	return field > 0 ? end : line;
+}
+
+/**
+ * @brief 이름 하나의 줄들 중에 정의 줄과 같은 control section에서 사용하거나
+ * EXTDEF한 줄이 있는지 확인한다.
+ *
+ * @param group 이름의 첫 줄
+ * @param group_end 이름의 마지막 줄의 끝
+ * @param line 확인할 정의 또는 EXTREF 줄
+ * @param line_end 확인할 줄의 끝
+ * @return 있으면 1, 없으면 0
+ */
+int xref_section_used(const char *group, const char *group_end,
+					  const char *line, const char *line_end) {
+	const char *section = xref_field(line, line_end, 2);
+	size_t section_length = xref_field(line, line_end, 3) - section;
+	const char *next;
+	
+	for(const char *p=group;p<group_end;p=next + 1){
+		next = (const char*)memchr(p, '\n', group_end - p);
+		if(next==NULL)next = group_end;
+		const char *kind = xref_field(p, next, 1);
+		const char *other = xref_field(p, next, 2);
+		if((xref_field_equal(kind, next, "use\t") ||
+			xref_field_equal(kind, next, "extdef\t")) &&
+		   (size_t)(next - other) >= section_length &&
+		   !memcmp(other, section, section_length)){
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief 상호 참조 파일의 필드가 구분자를 포함한 문자열로 시작하는지 확인한다.
+ *
+ * @param field 필드의 시작
+ * @param end 줄의 끝 ('\n' 또는 파일의 끝)
+ * @param str 비교할 문자열 (보통 '\t'로 끝남)
+ * @return 같으면 1, 다르면 0
+ *
+ * @details
+ * mmap한 파일은 '\0'으로 끝나지 않으므로 줄의 끝을 넘어 읽지 않는다.
+ */
+int xref_field_equal(const char *field, const char *end, const char *str) {
+	size_t length = strlen(str);
+	return (size_t)(end - field) >= length && !memcmp(field, str, length);
+}
+
+/**
+ * @brief 기계어 목록으로 오브젝트 코드의 첫 바이트에서 instruction을 바로 찾는
+ * 디코드 테이블을 만든다.
+ *
+ * @param decode_table 바이트 값마다 instruction을 저장할 256칸 배열
+ * @param inst_table 기계어 목록 테이블 주소
+ * @param inst_table_length 기계어 목록 테이블 길이
+ *
+ * @details
+ * 첫 바이트의 상위 6비트가 opcode이고 3, 4형식은 하위 2비트에 n, i 비트가
+ * 들어가므로, 3, 4형식 instruction은 하위 2비트만 다른 네 칸을 모두 채운다.
+ * 1, 2형식은 opcode와 같은 바이트 한 칸만 채운다. 해당하는 instruction이 없는
+ * 칸은 NULL이다.
+ */
+void init_decode_table(const inst *decode_table[], const inst *inst_table[],
+					   int inst_table_length) {
+	memset(decode_table, 0, DECODE_TABLE_LENGTH * sizeof(const inst*));
+	for(int i=0;i<inst_table_length;i++){
+		const inst *in = inst_table[i];
+		if(in->format/10==3){
+			for(int ni=0;ni<4;ni++){
+				decode_table[(in->op & 0xFC) | ni] = in;
+			}
+		}
+		else {
+			decode_table[in->op] = in;
+		}
+	}
+}
+
+/**
+ * @brief 오브젝트 코드를 역어셈블하여 출력 버퍼에 작성한다.
+ *
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param objectcode 오브젝트 코드 버퍼 ('\0'으로 끝날 필요 없음)
+ * @param objectcode_length 오브젝트 코드 버퍼의 바이트 수
+ * @param out 초기화되지 않은 출력 버퍼 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 디코드 테이블은 assembler_load_inst_table에서 만든다. 실패한 경우에도 출력
+ * 버퍼는 output_buffer_free로 해제해야 한다.
+ */
+int assembler_disassemble(assembler_ctx *ctx, const char *objectcode,
+						  size_t objectcode_length, output_buffer *out) {
+	int err;
+	
+	// 명령어 한 줄은 대체로 오브젝트 코드 두 바이트당 스무 바이트 정도
+	if(output_buffer_init(out, objectcode_length * 8 + 64) < 0){
+		ctx->error_stage = "disassemble";
+		return -2;
+	}
+	if((err = disassemble(out, objectcode, objectcode_length,
+						  ctx->decode_table)) < 0){
+		ctx->error_stage = "disassemble";
+	}
+	return err;
+}
+
+/**
+ * @brief 16진수 문자 하나의 값을 구한다.
+ *
+ * @param c 16진수 문자 (대문자, 소문자 모두 허용)
+ * @return 값 (16진수 문자가 아닌 경우 -1)
+ */
+int hex_digit(char c) {
+	if(c>='0' && c<='9')return c - '0';
+	if(c>='A' && c<='F')return c - 'A' + 10;
+	if(c>='a' && c<='f')return c - 'a' + 10;
+	return -1;
+}
+
+/**
+ * @brief 정해진 자리 수의 16진수 문자열을 읽는다.
+ *
+ * @param str 읽을 문자열
+ * @param digits 자리 수 (7 이하)
+ * @return 읽은 값 (16진수가 아닌 문자가 있는 경우 -1)
+ */
+int hex_value(const char *str, int digits) {
+	int value = 0;
+	for(int i=0;i<digits;i++){
+		int d = hex_digit(str[i]);
+		if(d<0)return -1;
+		value = (value << 4) | d;
+	}
+	return value;
+}
+
+/**
+ * @brief 출력 버퍼에 size 바이트를 더 쓸 수 있도록 공간을 확보한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param size 더 쓸 바이트 수 ('\0' 제외)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 호출한 뒤에는 out->data + out->length부터 size 바이트를 직접 작성하고
+ * length를 늘린다. 부족한 경우에만 버퍼를 두 배씩 늘린다.
+ */
+int output_buffer_reserve(output_buffer *out, size_t size) {
+	if(out->length + size + 1 <= out->capacity)return 0;
+	
+	size_t capacity = out->capacity ? out->capacity * 2 : 16;
+	while(capacity < out->length + size + 1)capacity *= 2;
+	char *data = (char*)realloc(out->data, capacity);
+	if(data==NULL)return -2;
+	out->data = data;
+	out->capacity = capacity;
+	
+	return 0;
+}
+
+/**
+ * @brief 값을 정해진 자리 수의 대문자 16진수로 작성한다.
+ *
+ * @param p 작성할 위치
+ * @param value 작성할 값 (자리 수를 넘는 상위 비트는 무시)
+ * @param digits 자리 수
+ * @return 작성한 다음 위치
+ */
+char *put_hex(char *p, unsigned int value, int digits) {
+	static const char hex[] = "0123456789ABCDEF";
+	for(int i=digits-1;i>=0;i--){
+		p[i] = hex[value & 0xF];
+		value >>= 4;
+	}
+	return p + digits;
+}
+
+/**
+ * @brief Define Record의 이름과 주소 경계를 찾는다.
+ *
+ * @param record 'D'를 제외한 Define Record 내용
+ * @param length 내용의 길이 (MAX_LINE_LENGTH 미만)
+ * @param limit 주소의 최댓값 (control section의 길이)
+ * @param name_lengths 항목마다 이름의 길이를 저장할 배열 (MAX_LINE_LENGTH 칸)
+ * @return 항목 수 (나눌 수 없는 경우 -1)
+ *
+ * @details
+ * 이 어셈블러의 Define Record는 이름을 공백으로 6자리에 맞추므로 12글자씩
+ * 나누고, 이때 항목의 이름 길이는 공백을 포함한 6이다. 고정 폭으로 나눌 수
+ * 없으면 이름 뒤에 공백 없이 주소를 붙인 형식(이전 버전과 Java 구현의 출력)으로
+ * 보고, 이름은 숫자로 시작하지 않고 주소는 control section 안에 있어야 한다는
+ * 조건으로 뒤에서부터 "이 위치부터 끝까지 이름과 주소의 반복으로 나눌 수
+ * 있는지"를 구한 뒤 앞에서부터 나눌 수 있는 가장 짧은 이름을 고른다.
+ */
+int disasm_def_split(const char *record, int length, int limit,
+					 int name_lengths[]) {
+	char ok[MAX_LINE_LENGTH + 1];
+	int count = 0;
+	
+	if(length >= MAX_LINE_LENGTH)return -1;
+	
+	if(length > 0 && length % 12 == 0){
+		int pos;
+		for(pos=0;pos<length;pos+=12){
+			int n = 1, addr;
+			if(record[pos]==' ' || (record[pos]>='0' && record[pos]<='9'))break;
+			while(n < 6 && record[pos+n]!=' ')n++;
+			while(n < 6 && record[pos+n]==' ')n++;
+			if(n < 6)break;
+			addr = hex_value(record + pos + 6, 6);
+			if(addr<0 || addr>limit)break;
+			name_lengths[count++] = 6;
+		}
+		if(pos >= length)return count;
+		count = 0;
+	}
+	
+	ok[length] = 1;
+	for(int pos=length-1;pos>=0;pos--){
+		ok[pos] = 0;
+		if(record[pos]>='0' && record[pos]<='9')continue;
+		for(int n=1;pos+n+6<=length;n++){
+			int addr;
+			if(ok[pos+n+6] && (addr = hex_value(record + pos + n, 6)) >= 0 &&
+			   addr <= limit){
+				ok[pos] = 1;
+				break;
 			}
-			continue;
 		}
+	}
+	if(length==0 || !ok[0])return -1;
+	
+	for(int pos=0;pos<length;){
+		int n = 1, addr;
+		while(!(ok[pos+n+6] && (addr = hex_value(record + pos + n, 6)) >= 0 &&
+				addr <= limit))n++;
+		name_lengths[count++] = n;
+		pos += n + 6;
+	}
+	return count;
+}
+
+/**
+ * @brief Header Record에서 이름, 시작 주소, 길이를 읽는다.
+ *
+ * @param line Header Record 라인
+ * @param len 라인의 길이
+ * @param name_length 이름의 길이를 저장할 변수 주소 (뒤의 공백 제외)
+ * @param start 시작 주소를 저장할 변수 주소
+ * @param size 길이를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 이름 뒤에 '\t'가 있으면 그 앞까지, 없으면 6글자를 이름으로 본다.
+ */
+int disasm_header(const char *line, int len, int *name_length, int *start,
+				  int *size) {
+	const char *tab = memchr(line, '\t', len);
+	int n = tab ? tab - line - 1 : 6;
+	int skip = 1 + n + (tab ? 1 : 0);
+	
+	if(skip + 12 > len)return -1;
+	*start = hex_value(line + skip, 6);
+	*size = hex_value(line + skip + 6, 6);
+	if(*start<0 || *size<0)return -1;
+	
+	while(n > 0 && line[n]==' ')n--;
+	*name_length = n;
+	return 0;
+}
+
+/**
+ * @brief 문자열의 일부를 이름으로 등록한다. 뒤에 붙은 공백은 제거한다.
+ *
+ * @param str 이름이 시작하는 위치
+ * @param length 이름의 최대 길이 (MAX_LINE_LENGTH 미만)
+ * @param id 번호를 저장할 변수 주소 (빈 이름은 NAME_NONE)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int disasm_name_intern(const char *str, int length, name_id *id) {
+	char name[MAX_LINE_LENGTH];
+	
+	while(length > 0 && str[length-1]==' ')length--;
+	memcpy(name, str, length);
+	name[length] = '\0';
+	return name_intern(name, id);
+}
+
+/**
+ * @brief 오브젝트 코드 전체에서 Define Record와 Modification Record에 나오는
+ * 이름을 모은다.
+ *
+ * @param data 오브젝트 코드 버퍼
+ * @param length 오브젝트 코드 버퍼의 바이트 수
+ * @param names 이름을 추가할 집합 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * Refer Record의 이름도 공백 없이 이어 붙여지므로, 다른 control section에서
+ * 정의했거나 Modification Record에서 사용한 이름을 기준으로 나누기 위해 먼저
+ * 모아둔다.
+ */
+int disasm_collect_names(const char *data, size_t length, extref_set *names) {
+	int name_lengths[MAX_LINE_LENGTH];
+	int name_length, start, size = 0xFFFFFF;
+	size_t pos = 0;
+	name_id id;
+	int err;
+	
+	while(pos < length){
+		const char *line = data + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		if(len > 0 && line[len-1]=='\r')len--;
+		if(len >= MAX_LINE_LENGTH)return -1;
 		
-		else if(!strcmp(tmp_token.operator, "EQU")){
-			continue;
+		if(len > 0 && line[0]=='H'){
+			if(disasm_header(line, len, &name_length, &start, &size) < 0)return -1;
 		}
-		// 본문 구간
-		else {
-			int next_flag = 0;
-			// operator과 "WORD", "RESW", "RESB", "BYTE" 인 경우
-			if(!strcmp(tmp_token.operator, "WORD")){
-				location_counter += 3;
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "000000");
-				int op = 0;
-				for(int k=0;tmp_token.operand[0][k]!='\0';k++){
-					if(tmp_token.operand[0][k] == '+')op=k;
-					else if(tmp_token.operand[0][k] == '-')op=k;
-					else if(tmp_token.operand[0][k] == '*')op=k;
-					else if(tmp_token.operand[0][k] == '/')op=k;
-				}
-				char tmp[10];
-				memset(tmp, 0, sizeof(tmp));
-				strncpy(tmp, tmp_token.operand[0], op);
-				for(int k=0;k<ref_cnt;k++){
-					if(!strcmp(tmp_ref[k], tmp)){
-						strncpy(now_red->name, tmp_ref[k], strlen(tmp_ref[k]));
-						strncpy(now_red->base, tmp_base, strlen(tmp_base));
-						
-						if(tmp_inst.format==34){
-							now_red->pos = 5;
-							now_red->addr = location_counter + 1;
-						}
-						else {
-							now_red->pos = 6;
-							now_red->addr = location_counter;
-						}
-						now_red->op = '+';
-						
-						now_red->next = (modification_record*)calloc(1, sizeof(modification_record));
-						if(now_red->next==NULL)return -2;
-						now_red = now_red->next;
-					}
-				}
-				memset(tmp, 0, sizeof(tmp));
-				strncpy(tmp, tmp_token.operand[0]+op+1, strlen(tmp_token.operand[0])-op-1);
-				for(int k=0;k<ref_cnt;k++){
-					if(!strcmp(tmp_ref[k], tmp)){
-						strncpy(now_red->name, tmp_ref[k], strlen(tmp_ref[k]));
-						strncpy(now_red->base, tmp_base, strlen(tmp_base));
-						
-						if(tmp_inst.format==34){
-							now_red->pos = 5;
-							now_red->addr = location_counter + 1;
-						}
-						else {
-							now_red->pos = 6;
-							now_red->addr = location_counter;
-						}
-						now_red->op = tmp_token.operand[0][op];
-						
-						now_red->next = (modification_record*)calloc(1, sizeof(modification_record));
-						if(now_red->next==NULL)return -2;
-						now_red = now_red->next;
-					}
-				}
-			}
-			else if(!strcmp(tmp_token.operator, "RESW")){
-				location_counter += 3 * atoi(tmp_token.operand[0]);
-				next_flag = 1;
-			}
-			else if(!strcmp(tmp_token.operator, "RESB")){
-				location_counter += atoi(tmp_token.operand[0]);
-				next_flag = 1;
-			}
-			else if(!strcmp(tmp_token.operator, "BYTE")){
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				// 'X' 또는 'C'와 따옴표 2개의 길이를 뺀 실제 operand의 길이
-				if(*(tmp_token.operand[0])=='X'){
-					location_counter += (strlen(tmp_token.operand[0]) - 3)/2;
-					strncpy(tmp_hex, tmp_token.operand[0] + 2, strlen(tmp_token.operand[0]) - 3);
-				}
-				else if(*(tmp_token.operand[0])=='C'){
-					location_counter += strlen(tmp_token.operand[0]) - 3;
-					next_flag = 1;
-				}
-				
-			}
-			else if(!strcmp(tmp_token.operator, "RSUB")){
-				location_counter += 3;
-				memset(tmp_hex, 0, sizeof(tmp_hex));
-				sprintf(tmp_hex, "%06X", 0x4F0000);
-			}
-			if(next_flag)continue;
-			// n, i 비트가 0인 애들, 1 또는 2형식
-			else if((tmp_token.nixbpe & 32) == 0 && (tmp_token.nixbpe & 16) == 0){
-				// 1형식
-				if(tmp_inst.format==1){
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%02X", tmp_inst.op);
-					location_counter += 1;
-				}
-				// 2형식
-				else if(tmp_inst.format==2){
-					int value = 0;
-					value |= tmp_inst.op;
-					value <<= 4;
-					for(int k=0;k<2;k++){
-						if(tmp_token.operand[k]==NULL){
-							continue;
-						}
-						else if(*tmp_token.operand[k]=='A')value |= 0;
-						else if(*tmp_token.operand[k]=='X')value |= 1;
-						else if(*tmp_token.operand[k]=='L')value |= 2;
-						else if(*tmp_token.operand[k]=='P')value |= 8;
-						else if(*(tmp_token.operand[k]+1)=='W')value |= 9;
-						else if(*tmp_token.operand[k]=='B')value |= 3;
-						else if(*tmp_token.operand[k]=='S')value |= 4;
-						else if(*tmp_token.operand[k]=='T')value |= 5;
-						else if(*tmp_token.operand[k]=='F')value |= 6;
-						if(k==0)value<<=4;
-					}
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%04X", value);
-					location_counter += 2;
-				}
+		else if(len > 0 && line[0]=='D'){
+			int count = disasm_def_split(line + 1, len - 1, size, name_lengths);
+			if(count < 0)return -1;
+			const char *p = line + 1;
+			for(int i=0;i<count;i++){
+				if((err = disasm_name_intern(p, name_lengths[i], &id)) < 0)return err;
+				if((err = extref_set_add(names, id)) < 0)return err;
+				p += name_lengths[i] + 6;
 			}
-			// 3, 4형식
-			else if(tmp_inst.format==34){
-				// DEFREF에 정의된 변수를 사용했을 때
-				for(int k=0;k<ref_cnt;k++){
-					if(tmp_token.operand[0]==NULL)continue;
-					if(!strcmp(tmp_token.operand[0], tmp_ref[k])){
-						strncpy(now_red->name, tmp_ref[k], strlen(tmp_ref[k]));
-						strncpy(now_red->base, tmp_base, strlen(tmp_base));
-						
-						if(tmp_inst.format==34){
-							now_red->pos = 5;
-							now_red->addr = location_counter + 1;
-						}
-						else {
-							now_red->pos = 6;
-							now_red->addr = location_counter;
-						}
-						now_red->op = '+';
-						
-						now_red->next = (modification_record*)calloc(1, sizeof(modification_record));
-						if(now_red->next==NULL)return -2;
-						now_red = now_red->next;
-					}
-				}
-				
-				
-				// value 변수에 논리연산을 사용해서 오브젝트 코드로만들고 16진수 문자열로 변경할 예정
-				int value = 0;
-				// opcode와 or연산하고 왼쪽으로 nixbpe의 6비트만큼 민다.
-				value |= tmp_inst.op;
-				
-				value <<= 4;
-				// nixbpe와 or연산을하고 12	비트만큼 민다.
-				value |= tmp_token.nixbpe;
-				value <<= 12;
-				// 4형식인 경우 8비트만큼 더 민다.
-				if((tmp_token.nixbpe & 1)){
-					value <<= 8;
-				}
-				
-				// immdiate를 고려
-				if((tmp_token.nixbpe & 16) && !(tmp_token.nixbpe & 32)){
-					if(tmp_token.nixbpe & 1)location_counter += 4;
-					else location_counter += 3;
-					value |= atoi(tmp_token.operand[0]+1);
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%06X", value);
-				}
-				else if((tmp_token.nixbpe & 32) && !(tmp_token.nixbpe & 16)){
-					if(tmp_token.nixbpe & 1)location_counter += 4;
-					else location_counter += 3;
-					for(int k=0;k<symbol_table_length;k++){
-						if(!strcmp(symbol_table[k]->name, tmp_token.operand[0] + 1) &&
-						   !strcmp(symbol_table[k]->base, tmp_base)){
-							value |= ((symbol_table[k]->addr - location_counter) & 0b111111111111);
-						}
-					}
-					for(int k=0;k<literal_table_length;k++){
-						if(!strcmp(literal_table[k]->literal, tmp_token.operand[0] + 1) &&
-						   !strcmp(literal_table[k]->base, tmp_base)){
-							value |= ((literal_table[k]->addr - location_counter) & 0b111111111111);
-						}
-					}
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%06X", value);
-				}
-				// 적절한 심보를 찾으면 심볼의 pc relactive값을 넣어줌
-				else if((tmp_token.nixbpe & 2)){
-					location_counter += 3;
-					for(int k=0;k<symbol_table_length;k++){
-						if(!strcmp(symbol_table[k]->name, tmp_token.operand[0]) &&
-						   !strcmp(symbol_table[k]->base, tmp_base)){
-							value |= ((symbol_table[k]->addr - location_counter) & 0b111111111111);
-						}
-					}
-					for(int k=0;k<literal_table_length;k++){
-						if(!strcmp(literal_table[k]->literal, tmp_token.operand[0]) &&
-						   !strcmp(literal_table[k]->base, tmp_base)){
-							value |= ((literal_table[k]->addr - location_counter) & 0b111111111111);
-						}
-					}
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%06X", value);
-				}
-				// 4형식은 심볼의 실제 주소를 넣어줌
-				else if((tmp_token.nixbpe & 1)){
-					location_counter += 4;
-					for(int k=0;k<symbol_table_length;k++){
-						if(!strcmp(symbol_table[k]->name, tmp_token.operand[0]) &&
-						   !strcmp(symbol_table[k]->base, tmp_base)){
-							value |= symbol_table[k]->addr;
-						}
-					}
-					for(int k=0;k<literal_table_length;k++){
-						if(!strcmp(literal_table[k]->literal, tmp_token.operand[0]) &&
-						   !strcmp(literal_table[k]->base, tmp_base)){
-							value |= literal_table[k]->addr;
-						}
-					}
-					memset(tmp_hex, 0, sizeof(tmp_hex));
-					sprintf(tmp_hex, "%08X", value);
-				}
+		}
+		else if(len > 9 && line[0]=='M'){
+			int skip = (line[9]=='+' || line[9]=='-') ? 10 : 9;
+			if((err = disasm_name_intern(line + skip, len - skip, &id)) < 0)return err;
+			if((err = extref_set_add(names, id)) < 0)return err;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief 명령어 하나를 해석하여 주소, 코드, 이름, operand를 출력 버퍼에 작성한다.
+ *
+ * @param out 출력 버퍼 주소 (DISASM_LINE_LENGTH 바이트가 확보되어 있어야 함)
+ * @param addr 명령어의 주소
+ * @param code 명령어가 시작하는 위치의 코드
+ * @param length Text Record에 남은 바이트 수
+ * @param decode_table 디코드 테이블
+ * @return 해석한 바이트 수
+ *
+ * @details
+ * 줄바꿈은 작성하지 않는다. 해당하는 instruction이 없거나 남은 바이트가
+ * 부족하면 한 바이트를 BYTE로 작성한다. 3, 4형식은 nixbpe에 따라 '@', '#',
+ * ",X"를 붙이고, pc relative는 계산한 목표 주소, base relative는 "변위(B)",
+ * immediate 상수는 10진수로 작성한다. n, i 비트가 모두 0이면 SIC 형식의
+ * 15비트 주소로 해석한다.
+ */
+int disasm_instruction(output_buffer *out, int addr, const unsigned char *code,
+					   int length, const inst *decode_table[]) {
+	static const char *registers[16] = {
+		"A", "X", "L", "B", "S", "T", "F", NULL, "PC", "SW",
+	};
+	const inst *in = decode_table[code[0]];
+	char *p = out->data + out->length;
+	int size = 0;
+	
+	if(in!=NULL){
+		size = disasm_instruction_size(code, length, decode_table);
+		if(size > length)in = NULL;
+	}
+	
+	p = put_hex(p, addr, 6);
+	*p++ = '\t';
+	if(in==NULL){
+		p = put_hex(p, code[0], 2);
+		memcpy(p, "\tBYTE\tX'", 8);
+		p = put_hex(p + 8, code[0], 2);
+		*p++ = '\'';
+		out->length = p - out->data;
+		return 1;
+	}
+	
+	for(int i=0;i<size;i++){
+		p = put_hex(p, code[i], 2);
+	}
+	*p++ = '\t';
+	if(size==4)*p++ = '+';
+	size_t name_length = strlen(in->str);
+	memcpy(p, in->str, name_length);
+	p += name_length;
+	
+	// 2형식은 레지스터 번호, 1형식과 operand가 없는 3형식은 이름만 작성
+	if(size==2){
+		*p++ = '\t';
+		for(int k=0;k<(in->ops > 1 ? 2 : 1);k++){
+			int r = k==0 ? code[1] >> 4 : code[1] & 0xF;
+			if(k==1)*p++ = ',';
+			// SVC와 SHIFTL, SHIFTR의 두 번째 operand는 수 (format2_operand 참고)
+			if(!strcmp(in->str, "SVC"))p += sprintf(p, "%d", r);
+			else if(k==1 && !strncmp(in->str, "SHIFT", 5)){
+				p += sprintf(p, "%d", r + 1);
 			}
+			else if(registers[r]!=NULL){
+				name_length = strlen(registers[r]);
+				memcpy(p, registers[r], name_length);
+				p += name_length;
+			}
+			else p += sprintf(p, "%d", r);
+		}
+	}
+	else if(size >= 3 && in->ops > 0){
+		int n = code[0] & 2, i = code[0] & 1;
+		int x = code[1] & 0x80, b = code[1] & 0x40, pc = code[1] & 0x20;
+		
+		*p++ = '\t';
+		if(!n && !i){
+			// SIC 형식은 x 비트 뒤가 모두 주소
+			p = put_hex(p, ((code[1] & 0x7F) << 8) | code[2], 6);
+		}
+		else {
+			int disp;
+			if(size==4)disp = ((code[1] & 0xF) << 16) | (code[2] << 8) | code[3];
+			else disp = ((code[1] & 0xF) << 8) | code[2];
 			
+			if(n && !i)*p++ = '@';
+			else if(i && !n)*p++ = '#';
 			
-			
-			left_str = strlen(now->line);
-			right_str = strlen(tmp_hex);
-			if(left_str+right_str>=100)return -1;
-			
-			
-			
-			if(left_str+right_str >= 0x40){
-				char tmp[100];
-				memset(tmp, 0, sizeof(tmp));
-				int now_pos = strlen(now->line)/2;
-				sprintf(tmp, "T%06X%02X", pos, now_pos);
-				pos += now_pos;
-				strcat(tmp, now->line);
-				memset(now->line, 0, sizeof(now->line));
-				strncpy(now->line, tmp, strlen(tmp));
-				
-				now->next = (object_code*)calloc(1, sizeof(object_code));
-				if(now->next==NULL){
-					return -2;
-				}
-				now = now->next;
+			if(pc){
+				// 변위는 부호가 있는 값
+				int bits = size==4 ? 20 : 12;
+				if(disp & (1 << (bits - 1)))disp -= 1 << bits;
+				p = put_hex(p, (addr + size + disp) & 0xFFFFF, 6);
 			}
-			strcat(now->line, tmp_hex);
-			
+			else if(b){
+				p = put_hex(p, disp, size==4 ? 5 : 3);
+				memcpy(p, "(B)", 3);
+				p += 3;
+			}
+			else if(i && !n)p += sprintf(p, "%d", disp);
+			else p = put_hex(p, disp, 6);
+		}
+		if(x){
+			memcpy(p, ",X", 2);
+			p += 2;
 		}
-		
 	}
 	
-	now = obj_code;
-	int i = 0;
-	while(now!=NULL){
-		if(i >= pro_cnt)break;
+	out->length = p - out->data;
+	return size;
+}
+
+/**
+ * @brief 코드 구간에 걸친 Modification Record들을 주석으로 작성한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param mod_table 주소 순으로 정렬된 Modification Record 배열
+ * @param start 코드 구간의 시작 주소
+ * @param end 코드 구간의 끝 주소 (포함하지 않음)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int disasm_annotate(output_buffer *out, const modification_table *mod_table,
+					int start, int end) {
+	// 시작 주소 이상인 첫 record를 이분 탐색
+	int lo = 0, hi = mod_table->length;
+	while(lo < hi){
+		int mid = (lo + hi) / 2;
+		if(mod_table->records[mid].addr < start)lo = mid + 1;
+		else hi = mid;
+	}
+	
+	for(int i=lo;i<mod_table->length && mod_table->records[i].addr < end;i++){
+		const modification_record *rec = &mod_table->records[i];
+		const char *name = name_str(rec->name);
+		size_t name_length = strlen(name);
 		
-		if(*now->line == 'H'){
-			memset(tmp_hex, 0, sizeof(tmp_hex));
-			sprintf(tmp_hex, "%06X", pro_size[i++]);
-			strcat(now->line, tmp_hex);
+		if(output_buffer_reserve(out, name_length + 16) < 0)return -2;
+		char *p = out->data + out->length;
+		if(i==lo){
+			memcpy(p, "\t; ", 3);
+			p += 3;
 		}
-		
-		now = now->next;
+		else *p++ = ' ';
+		*p++ = 'M';
+		p = put_hex(p, rec->addr, 6);
+		*p++ = ' ';
+		p = put_hex(p, rec->pos, 2);
+		*p++ = rec->op;
+		memcpy(p, name, name_length);
+		out->length = p + name_length - out->data;
+	}
+	return 0;
+}
+
+/**
+ * @brief Refer Record에서 주어진 위치부터 시작하는 이름의 길이를 구한다.
+ *
+ * @param record 'R'을 제외한 Refer Record 내용
+ * @param pos 이름이 시작하는 위치 (공백이 아님)
+ * @param length 내용의 길이 (MAX_LINE_LENGTH 미만)
+ * @param names 오브젝트 코드에 나오는 이름의 집합
+ * @return 이름의 길이
+ *
+ * @details
+ * 6글자 단위로 공백을 채운 형식과 공백 없이 이어 붙인 형식이 모두 있으므로,
+ * 알고 있는 이름 중 가장 긴 것을 고르고, 알 수 없으면 6글자를 하나의 이름으로
+ * 본다.
+ */
+int refer_name_length(const char *record, int pos, int length,
+					  const extref_set *names) {
+	char name[MAX_LINE_LENGTH];
+	int n = 0;
+	
+	for(int k=length-pos;k>0;k--){
+		memcpy(name, record + pos, k);
+		name[k] = '\0';
+		if(extref_set_contains(names, name_find(name)))return k;
 	}
+	while(n < 6 && pos + n < length && record[pos+n]!=' ')n++;
+	return n;
+}
 
+/**
+ * @brief Refer Record의 이름들을 작성한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param record 'R'을 제외한 Refer Record 내용
+ * @param length 내용의 길이 (MAX_LINE_LENGTH 미만)
+ * @param names 오브젝트 코드에 나오는 이름의 집합
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 이름의 경계는 refer_name_length로 나눈다.
+ */
+int disasm_refer_record(output_buffer *out, const char *record, int length,
+						const extref_set *names) {
+	int pos = 0;
+	
+	if(output_buffer_reserve(out, length * 2 + 16) < 0)return -2;
+	memcpy(out->data + out->length, "; EXTREF", 8);
+	out->length += 8;
+	
+	while(pos < length){
+		if(record[pos]==' '){
+			pos++;
+			continue;
+		}
+		
+		int n = refer_name_length(record, pos, length, names);
+		out->data[out->length++] = ' ';
+		memcpy(out->data + out->length, record + pos, n);
+		out->length += n;
+		pos += n;
+	}
+	out->data[out->length++] = '\n';
 	return 0;
 }
 
 /**
- * @brief 심볼 테이블을 파일로 출력한다. `symbol_table_dir`이 NULL인 경우 결과를
- * stdout으로 출력한다.
+ * @brief 한 control section(Header Record부터 End Record까지)을 역어셈블한다.
  *
- * @param symbol_table_dir 심볼 테이블을 저장할 파일 경로, 혹은 NULL
- * @param symbol_table 심볼 테이블 주소
- * @param symbol_table_length 심볼 테이블 길이
+ * @param out 출력 버퍼 주소
+ * @param lines control section의 첫 라인 위치
+ * @param length control section의 바이트 수
+ * @param decode_table 디코드 테이블
+ * @param names 오브젝트 코드에 나오는 이름의 집합
+ * @param mod_table 비어 있는 Modification Record 배열 (재사용)
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 심볼 테이블을 파일로 출력한다. `symbol_table_dir`이 NULL인 경우 결과를
- * stdout으로 출력한다. 명세서에 주어진 출력 예시와 완전히 동일할 필요는 없다.
+ * Modification Record는 Text Record 뒤에 나오므로 먼저 모두 읽어 정렬한 뒤
+ * 명령어마다 수정되는 위치를 주석으로 붙인다. Text Record가 명령어 중간에서
+ * 끊긴 경우 남은 바이트를 다음 record와 이어서 해석한다.
  */
-int make_symbol_table_output(const char *symbol_table_dir,
-							 const symbol *symbol_table[],
-							 int symbol_table_length) {
-	FILE *fp;
-	// 쓰기 권한으로 파일입출력을 시작함
-	// fp가 NULL이면 file pointer를 표준출력으로 설정
-	if(symbol_table_dir==NULL){
-		fp = stdout;
+int disasm_section(output_buffer *out, const char *lines, size_t length,
+				   const inst *decode_table[], const extref_set *names,
+				   modification_table *mod_table) {
+	int name_lengths[MAX_LINE_LENGTH];
+	// Text Record 하나와 이전 record에서 넘어온 명령어 앞부분
+	unsigned char code[256 + 4];
+	int carry = 0, carry_addr = 0;
+	int limit = 0xFFFFFF;
+	size_t pos;
+	name_id id;
+	int err;
+	
+	mod_table->length = 0;
+	for(pos=0;pos<length;){
+		const char *line = lines + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		if(len > 0 && line[len-1]=='\r')len--;
+		if(len==0 || line[0]!='M')continue;
+		
+		int addr = len >= 9 ? hex_value(line + 1, 6) : -1;
+		int half = len >= 9 ? hex_value(line + 7, 2) : -1;
+		if(addr<0 || half<0)return -1;
+		
+		char op = '+';
+		int skip = 9;
+		if(len > 9 && (line[9]=='+' || line[9]=='-')){
+			op = line[9];
+			skip = 10;
+		}
+		if((err = disasm_name_intern(line + skip, len - skip, &id)) < 0)return err;
+		if((err = modification_add(mod_table, id, NAME_NONE, addr, half, op,
+								   NULL)) < 0)return err;
 	}
-	else {
-		fp = fopen(symbol_table_dir, "w");
-		if(fp==NULL){
+	if(mod_table->length > 0){
+		qsort(mod_table->records, mod_table->length,
+			  sizeof(modification_record), modification_compare);
+	}
+	
+	for(pos=0;pos<length;){
+		const char *line = lines + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		if(len > 0 && line[len-1]=='\r')len--;
+		if(len==0)continue;
+		
+		if(line[0]=='H'){
+			int name_length, start;
+			if(disasm_header(line, len, &name_length, &start, &limit) < 0)return -1;
+			if(output_buffer_printf(out, "; section %.*s start=%06X length=%06X\n",
+									name_length, line + 1, start, limit) < 0)return -2;
+		}
+		else if(line[0]=='D'){
+			int count = disasm_def_split(line + 1, len - 1, limit, name_lengths);
+			if(count < 0)return -1;
+			if(output_buffer_reserve(out, len + count * 2 + 16) < 0)return -2;
+			char *p = out->data + out->length;
+			const char *q = line + 1;
+			memcpy(p, "; EXTDEF", 8);
+			p += 8;
+			for(int i=0;i<count;i++){
+				int n = name_lengths[i];
+				*p++ = ' ';
+				memcpy(p, q, n);
+				while(n > 0 && p[n-1]==' ')n--;
+				p[n] = '=';
+				memcpy(p + n + 1, q + name_lengths[i], 6);
+				p += n + 7;
+				q += name_lengths[i] + 6;
+			}
+			*p++ = '\n';
+			out->length = p - out->data;
+		}
+		else if(line[0]=='R'){
+			if((err = disasm_refer_record(out, line + 1, len - 1, names)) < 0)return err;
+		}
+		else if(line[0]=='T'){
+			int addr = len >= 9 ? hex_value(line + 1, 6) : -1;
+			int size = len >= 9 ? hex_value(line + 7, 2) : -1;
+			if(addr<0 || size<0 || len!=9+size*2)return -1;
+			
+			// 이어지지 않는 record라면 남겨둔 바이트를 먼저 해석
+			if(carry > 0 && carry_addr + carry != addr){
+				if((err = disasm_code(out, carry_addr, code, carry, 1,
+									  decode_table, mod_table)) < 0)return err;
+				carry = 0;
+			}
+			if(carry==0)carry_addr = addr;
+			for(int i=0;i<size;i++){
+				int value = hex_value(line + 9 + i*2, 2);
+				if(value<0)return -1;
+				code[carry+i] = value;
+			}
+			
+			int n = disasm_code(out, carry_addr, code, carry + size, 0,
+								decode_table, mod_table);
+			if(n<0)return n;
+			carry += size - n;
+			memmove(code, code + n, carry);
+			carry_addr += n;
+		}
+		else if(line[0]=='E'){
+			if(carry > 0){
+				if((err = disasm_code(out, carry_addr, code, carry, 1,
+									  decode_table, mod_table)) < 0)return err;
+				carry = 0;
+			}
+			int first = len >= 7 ? hex_value(line + 1, 6) : -1;
+			if(len!=1 && first<0)return -1;
+			if(first>=0)err = output_buffer_printf(out, "; end first=%06X\n", first);
+			else err = output_buffer_printf(out, "; end\n");
+			if(err<0)return err;
+		}
+		else if(line[0]!='M'){
 			return -1;
 		}
 	}
+	if(carry > 0 && (err = disasm_code(out, carry_addr, code, carry, 1,
+										decode_table, mod_table)) < 0)return err;
+	out->data[out->length] = '\0';
 	
-	for(int i=0;i<symbol_table_length;i++){
-		if(!strcmp(symbol_table[i]->name, symbol_table[i]->base)){
-			fprintf(fp, "%s\t%X\n",
-					symbol_table[i]->name, symbol_table[i]->addr);
+	return 0;
+}
+
+/**
+ * @brief 오브젝트 코드 명령어의 바이트 수를 구한다.
+ *
+ * @param code 명령어가 시작하는 위치의 코드
+ * @param length 남은 바이트 수 (1 이상)
+ * @param decode_table 디코드 테이블
+ * @return 명령어의 바이트 수 (해당하는 instruction이 없으면 1)
+ *
+ * @details
+ * 3, 4형식은 두 번째 바이트의 e 비트를 보아야 하므로, 한 바이트만 남은 경우
+ * 최소 2바이트가 필요하다고 답한다.
+ */
+int disasm_instruction_size(const unsigned char *code, int length,
+							const inst *decode_table[]) {
+	const inst *in = decode_table[code[0]];
+	
+	if(in==NULL)return 1;
+	if(in->format==1)return 1;
+	if(in->format==2)return 2;
+	if((code[0] & 3)==0)return 3;
+	if(length < 2)return 2;
+	return (code[1] & 0x10) ? 4 : 3;
+}
+
+/**
+ * @brief 이어진 코드를 명령어 단위로 역어셈블한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param addr 코드의 시작 주소
+ * @param code 코드
+ * @param length 코드의 바이트 수
+ * @param final 0이면 끝에서 잘린 명령어를 해석하지 않고 남김
+ * @param decode_table 디코드 테이블
+ * @param mod_table 주소 순으로 정렬된 Modification Record 배열
+ * @return 해석한 바이트 수 (오류인 경우 음수)
+ *
+ * @details
+ * final이 0이 아니면 끝에서 잘린 명령어는 BYTE로 작성한다.
+ */
+int disasm_code(output_buffer *out, int addr, const unsigned char *code,
+				int length, int final, const inst *decode_table[],
+				const modification_table *mod_table) {
+	int i = 0, err;
+	
+	while(i < length){
+		if(!final && i + disasm_instruction_size(code + i, length - i,
+												 decode_table) > length)break;
+		if(output_buffer_reserve(out, DISASM_LINE_LENGTH) < 0)return -2;
+		int n = disasm_instruction(out, addr + i, code + i, length - i,
+								   decode_table);
+		if((err = disasm_annotate(out, mod_table, addr + i, addr + i + n)) < 0)return err;
+		out->data[out->length++] = '\n';
+		i += n;
+	}
+	return i;
+}
+
+/**
+ * @brief 오브젝트 코드 전체를 control section 단위로 역어셈블한다.
+ *
+ * @param out 초기화된 출력 버퍼 주소
+ * @param data 오브젝트 코드 버퍼
+ * @param length 오브젝트 코드 버퍼의 바이트 수
+ * @param decode_table 디코드 테이블
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 빈 줄은 건너뛰며, control section 밖에 Header Record가 아닌 record가 있거나
+ * record의 형식이 맞지 않으면 오류로 처리한다.
+ */
+int disassemble(output_buffer *out, const char *data, size_t length,
+				const inst *decode_table[]) {
+	extref_set names = {0};
+	modification_table mod_table = {0};
+	size_t pos = 0;
+	int err;
+	
+	err = disasm_collect_names(data, length, &names);
+	
+	while(err>=0 && pos < length){
+		const char *line = data + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		size_t next = end ? (size_t)(end - data) + 1 : length;
+		
+		if(*line=='\n' || *line=='\r'){
+			pos = next;
+			continue;
 		}
-		else {
-			fprintf(fp, "%s\t%X\t +1 %s\n",
-					symbol_table[i]->name, symbol_table[i]->addr, symbol_table[i]->base);
+		if(*line!='H'){
+			err = -1;
+			break;
 		}
+		
+		// End Record까지를 하나의 control section으로 봄
+		size_t section_end = next;
+		while(section_end < length && data[section_end]!='E' && data[section_end]!='H'){
+			end = memchr(data + section_end, '\n', length - section_end);
+			section_end = end ? (size_t)(end - data) + 1 : length;
+		}
+		if(section_end < length && data[section_end]=='E'){
+			end = memchr(data + section_end, '\n', length - section_end);
+			section_end = end ? (size_t)(end - data) + 1 : length;
+		}
+		
+		err = disasm_section(out, line, section_end - pos, decode_table,
+							 &names, &mod_table);
+		pos = section_end;
 	}
 	
-	fclose(fp);
+	extref_set_free(&names);
+	free(mod_table.records);
+	return err;
+}
 
-	return 0;
+/**
+ * @brief 단조 증가하는 시계의 현재 시각을 구한다.
+ *
+ * @return 현재 시각 (초, CLOCK_MONOTONIC)
+ */
+double monotonic_seconds(void) {
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
 }
 
 /**
- * @brief 리터럴 테이블을 파일로 출력한다. `literal_table_dir`이 NULL인 경우
- * 결과를 stdout으로 출력한다.
+ * @brief 기계어 목록 읽기부터 출력 파일 쓰기까지를 반복하여 단계별 실행 시간을
+ * 잰다.
  *
- * @param literal_table_dir 리터럴 테이블을 저장할 파일 경로, 혹은 NULL
- * @param literal_table 리터럴 테이블 주소
- * @param literal_table_length 리터럴 테이블 길이
+ * @param ctx 어셈블러 컨텍스트 주소 (listing, optimize, xref 설정을 그대로 사용)
+ * @param inst_table_dir 기계어 목록 파일 경로
+ * @param input_dir 소스코드 파일 경로
+ * @param jobs 출력 작업 배열
+ * @param jobs_length 출력 작업 수
+ * @param runs 반복 횟수 (1 이상)
+ * @param result 결과를 저장할 구조체 주소
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 리터럴 테이블을 파일로 출력한다. `literal_table_dir`이 NULL인 경우 결과를
- * stdout으로 출력한다. 명세서에 주어진 출력 예시와 완전히 동일할 필요는 없다.
+ * 처음 한 번은 파일 캐시와 할당자를 데우는 실행으로 보고 기록하지 않는다.
+ * 소스코드 읽기는 파일을 읽는 시간과 라인 테이블을 만드는 시간을 더한다.
+ * 단계마다 중앙값과 중앙값 절대 편차(MAD)를 구하므로 몇 번의 튀는 실행은
+ * 결과에 영향을 주지 않는다.
  */
-int make_literal_table_output(const char *literal_table_dir,
-							  const literal *literal_table[],
-							  int literal_table_length) {
-	FILE *fp;
-	// 쓰기 권한으로 파일입출력을 시작함
-	// fp가 NULL이면 file pointer를 표준출력으로 설정
-	if(literal_table_dir==NULL){
-		fp = stdout;
-	}
-	else {
-		fp = fopen(literal_table_dir, "w");
-		if(fp==NULL){
-			return -1;
+int run_bench(assembler_ctx *ctx, const char *inst_table_dir,
+			  const char *input_dir, output_job jobs[], int jobs_length,
+			  int runs, bench_result *result) {
+	double *samples = (double*)malloc(runs * BENCH_PHASES * sizeof(double));
+	int err = 0;
+	
+	if(samples==NULL)return -2;
+	memset(result, 0, sizeof(bench_result));
+	result->runs = runs;
+	
+	for(int r=-1;r<runs;r++){
+		char *source = NULL;
+		size_t source_length = 0;
+		
+		if((err = assembler_load_inst_table(ctx, inst_table_dir)) < 0)break;
+		
+		double start = monotonic_seconds();
+		if((err = read_file(input_dir, &source, &source_length)) < 0){
+			ctx->error_stage = "init_input";
+			break;
+		}
+		double read = monotonic_seconds() - start;
+		err = assembler_assemble(ctx, source, source_length);
+		free(source);
+		if(err < 0)break;
+		ctx->phase_seconds[BENCH_INPUT] += read;
+		
+		start = monotonic_seconds();
+		if((err = write_output_files(jobs, jobs_length, 0)) < 0){
+			ctx->error_stage = "write_output_files";
+			break;
+		}
+		ctx->phase_seconds[BENCH_OUTPUT] = monotonic_seconds() - start;
+		
+		if(r < 0){
+			result->input_bytes = source_length;
+			result->input_lines = ctx->input_length;
+			result->inst_entries = ctx->inst_table_length;
+			continue;
+		}
+		for(int p=0;p<BENCH_PHASES;p++){
+			samples[p * runs + r] = ctx->phase_seconds[p];
 		}
 	}
 	
-	for(int i=0;i<literal_table_length;i++){
-		fprintf(fp, "%s\t\t%X\n", literal_table[i]->literal, literal_table[i]->addr);
+	for(int p=0;err>=0 && p<BENCH_PHASES;p++){
+		double *phase = samples + p * runs;
+		result->median[p] = bench_median(phase, runs);
+		for(int r=0;r<runs;r++){
+			phase[r] = phase[r] > result->median[p] ? phase[r] - result->median[p]
+													: result->median[p] - phase[r];
+		}
+		result->mad[p] = bench_median(phase, runs);
 	}
 	
-	fclose(fp);
+	free(samples);
+	return err;
+}
 
-	return 0;
+/**
+ * @brief 표본의 중앙값을 구한다.
+ *
+ * @param samples 표본 배열 (정렬하므로 순서가 바뀜)
+ * @param count 표본 수 (1 이상)
+ * @return 중앙값
+ */
+double bench_median(double samples[], int count) {
+	qsort(samples, count, sizeof(double), bench_double_compare);
+	if(count % 2)return samples[count / 2];
+	return (samples[count / 2 - 1] + samples[count / 2]) / 2;
 }
 
 /**
- * @brief 오브젝트 코드를 파일로 출력한다. `objectcode_dir`이 NULL인 경우 결과를
- * stdout으로 출력한다.
+ * @brief 중앙값 절대 편차(MAD)로 중앙값의 표준 오차를 추정한다.
  *
- * @param objectcode_dir 오브젝트 코드를 저장할 파일 경로, 혹은 NULL
- * @param obj_code 오브젝트 코드에 대한 정보를 담고 있는 구조체 주소
+ * @param mad 중앙값 절대 편차
+ * @param runs 표본 수 (1 이상)
+ * @return 중앙값의 표준 오차
+ *
+ * @details
+ * 정규분포에서 표준편차는 1.4826 * MAD, 중앙값의 표준 오차는
+ * 1.2533 * 표준편차 / √n이다. libm 없이 √n을 뉴턴 방법으로 구한다.
+ */
+double bench_standard_error(double mad, int runs) {
+	double root = runs;
+	
+	for(int i=0;i<32;i++){
+		root = (root + runs / root) / 2;
+	}
+	return 1.4826 * 1.2533 * mad / root;
+}
+
+/**
+ * @brief qsort에 사용할 실수 비교 함수
+ *
+ * @param a 첫 번째 값의 주소
+ * @param b 두 번째 값의 주소
+ * @return a < b이면 음수, 같으면 0, 크면 양수
+ */
+int bench_double_compare(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief 벤치마크 결과를 기준 파일로 저장한다.
+ *
+ * @param dir 저장할 파일 경로
+ * @param result 벤치마크 결과 주소
  * @return 오류 코드 (정상 종료 = 0)
  *
  * @details
- * 오브젝트 코드를 파일로 출력한다. `objectcode_dir`이 NULL인 경우 결과를
- * stdout으로 출력한다. 명세서의 주어진 출력 결과와 완전히 동일해야 한다.
- * 예외적으로 각 라인 뒤쪽의 공백 문자 혹은 개행 문자의 차이는 허용한다.
+ * 첫 라인은 "sicxe-bench\t버전"이고, 이어서 입력의 크기, 기계어 목록의 항목
+ * 수, 반복 횟수와 단계마다 "phase\t이름\t중앙값\tMAD"(초)를 한 줄씩 쓴다.
  */
-int make_objectcode_output(const char *objectcode_dir,
-						   const object_code *obj_code) {
-	FILE *fp;
-	// 쓰기 권한으로 파일입출력을 시작함
-	// fp가 NULL이면 file pointer를 표준출력으로 설정
-	if(objectcode_dir==NULL){
-		fp = stdout;
+int bench_save(const char *dir, const bench_result *result) {
+	output_buffer out = {0};
+	int err;
+	
+	if((err = output_buffer_init(&out, 512)) < 0)return err;
+	err = output_buffer_printf(&out, "sicxe-bench\t%d\ninput\t%ld\t%d\n"
+									 "inst_table\t%d\nruns\t%d\n",
+							   BENCH_VERSION, result->input_bytes, result->input_lines,
+							   result->inst_entries, result->runs);
+	for(int p=0;err>=0 && p<BENCH_PHASES;p++){
+		err = output_buffer_printf(&out, "phase\t%s\t%.9f\t%.9f\n", bench_phase_names[p],
+								   result->median[p], result->mad[p]);
 	}
-	else {
-		fp = fopen(objectcode_dir, "w");
-		if(fp==NULL){
-			return -1;
+	if(err >= 0)err = output_buffer_write(&out, dir);
+	
+	output_buffer_free(&out);
+	return err;
+}
+
+/**
+ * @brief bench_save로 저장한 기준 파일을 읽는다.
+ *
+ * @param dir 기준 파일 경로
+ * @param result 결과를 저장할 구조체 주소
+ * @return 오류 코드 (정상 종료 = 0, 파일이 없거나 버전, 형식이 맞지 않으면 -1)
+ */
+int bench_load(const char *dir, bench_result *result) {
+	char *data = NULL, *line;
+	size_t length;
+	int version = 0, phases = 0, err;
+	
+	if((err = read_file(dir, &data, &length)) < 0)return err;
+	memset(result, 0, sizeof(bench_result));
+	
+	line = data;
+	if(sscanf(line, "sicxe-bench\t%d", &version)!=1 || version!=BENCH_VERSION)err = -1;
+	while(err>=0 && (line = strchr(line, '\n'))!=NULL && *++line!='\0'){
+		char name[32];
+		double median, mad;
+		int p = 0;
+		
+		if(sscanf(line, "input\t%ld\t%d", &result->input_bytes, &result->input_lines)==2 ||
+		   sscanf(line, "inst_table\t%d", &result->inst_entries)==1 ||
+		   sscanf(line, "runs\t%d", &result->runs)==1)continue;
+		if(sscanf(line, "phase\t%31s\t%lf\t%lf", name, &median, &mad)!=3){
+			err = -1;
+			break;
+		}
+		while(p < BENCH_PHASES && strcmp(name, bench_phase_names[p]))p++;
+		if(p==BENCH_PHASES || median <= 0){
+			err = -1;
+			break;
 		}
+		result->median[p] = median;
+		result->mad[p] = mad;
+		phases |= 1 << p;
 	}
+	if(phases!=(1 << BENCH_PHASES) - 1)err = -1;
 	
-	// 오브젝트 코드를 출력
-	object_code *now = obj_code;
-	while(now!=NULL){
-		fputs(now->line, fp);
-		fprintf(fp, "\n");
-		now = now->next;
+	free(data);
+	return err;
+}
+
+/**
+ * @brief 기준 결과와 새 결과의 단계별 처리량을 비교하여 보고서를 작성한다.
+ *
+ * @param base 기준 결과 주소
+ * @param now 새 결과 주소
+ * @param threshold 회귀로 보는 처리량 감소율 (%)
+ * @param report 초기화된 출력 버퍼 주소
+ * @return 회귀한 단계 수 (입력이 기준과 다르면 -1)
+ *
+ * @details
+ * 처리량은 기계어 목록 읽기는 항목 수, 나머지 단계는 소스코드 라인 수를
+ * 중앙값 시간으로 나눈 값이다. 처리량이 threshold% 넘게 줄었고, 중앙값의
+ * 차이가 두 중앙값의 표준 오차 합의 BENCH_NOISE배보다 크면 회귀로 본다.
+ * 줄었지만 측정 잡음 안에 있으면 "불확실"로 표시한다.
+ */
+int bench_compare(const bench_result *base, const bench_result *now,
+				  double threshold, output_buffer *report) {
+	int regressed = 0, err;
+	
+	if(base->input_bytes!=now->input_bytes || base->input_lines!=now->input_lines ||
+	   base->inst_entries!=now->inst_entries){
+		output_buffer_printf(report,
+							 "기준과 입력이 다릅니다. (기준: %ld바이트 %d라인 기계어 %d개, "
+							 "현재: %ld바이트 %d라인 기계어 %d개)\n",
+							 base->input_bytes, base->input_lines, base->inst_entries,
+							 now->input_bytes, now->input_lines, now->inst_entries);
+		return -1;
 	}
 	
-	fclose(fp);
-
-	return 0;
+	err = output_buffer_printf(report, "phase\tbase/s\tnow/s\tchange\tnoise\tresult\n");
+	for(int p=0;err>=0 && p<BENCH_PHASES;p++){
+		double units = p==BENCH_INST_TABLE ? now->inst_entries : now->input_lines;
+		double base_rate = units / base->median[p];
+		double now_rate = now->median[p] > 0 ? units / now->median[p] : 0;
+		double change = (now_rate / base_rate - 1) * 100;
+		double noise = BENCH_NOISE * (bench_standard_error(base->mad[p], base->runs) +
+									  bench_standard_error(now->mad[p], now->runs));
+		const char *verdict = "ok";
+		
+		if(change < -threshold){
+			if(now->median[p] - base->median[p] > noise){
+				verdict = "회귀";
+				regressed++;
+			}
+			else verdict = "불확실";
+		}
+		err = output_buffer_printf(report, "%s\t%.0f\t%.0f\t%+.1f%%\t±%.1f%%\t%s\n",
+								   bench_phase_names[p], base_rate, now_rate, change,
+								   noise / base->median[p] * 100, verdict);
+	}
+	if(err >= 0){
+		err = output_buffer_printf(report,
+								   "\n회귀한 단계: %d / %d (기준 %d회, 현재 %d회, 허용 감소율 "
+								   "%.1f%%)\n",
+								   regressed, BENCH_PHASES, base->runs, now->runs, threshold);
+	}
+	return err < 0 ? err : regressed;
 }
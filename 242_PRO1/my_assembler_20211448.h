@@ -9,13 +9,127 @@
 #ifndef __MY_ASSEMBLER_H__
 #define __MY_ASSEMBLER_H__
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
 #define MAX_INST_TABLE_LENGTH 256
-#define MAX_INPUT_LINES 5000
+#define MAX_LINE_LENGTH 1024
 #define MAX_TABLE_LENGTH 5000
 #define MAX_OPERAND_PER_INST 3
 #define MAX_OBJECT_CODE_STRING 74
 #define MAX_OBJECT_CODE_LENGTH 5000
 #define MAX_CONTROL_SECTION_NUM 10
+#define MAX_TEXT_RECORD_LENGTH 30
+/** 오브젝트 코드에 기록하는 control section 이름과 외부 이름의 최대 길이 */
+#define MAX_EXTERNAL_NAME 6
+#define STREAM_WINDOW_LINES 4096
+#define MAX_OUTPUT_JOBS 8
+#define MAX_MACRO_PARAMS 16
+#define MAX_MACRO_DEPTH 16
+#define MAX_INCLUDE_DEPTH 8
+/** 매크로와 INCLUDE를 확장하여 토큰 테이블에 담을 수 있는 최대 라인 수 */
+#define MAX_EXPANDED_LINES 1000000
+#define MAX_PATH_LENGTH 4096
+#define MAX_EXPR_ITEMS 32
+#define MAX_EXPR_EXTERNS 8
+#define NAME_POOL_CHUNK 4096
+#define NAME_POOL_CHUNKS 4096
+#define DECODE_TABLE_LENGTH 256
+#define DISASM_LINE_LENGTH 64
+#define MAX_DIAG_MESSAGE 160
+/** 한 번의 어셈블에서 기록하는 최대 오류 수 */
+#define MAX_DIAGNOSTICS 1000
+/** 감시 모드에서 마지막 변경 이벤트 뒤에 다른 이벤트를 기다리는 시간 (ms) */
+#define WATCH_SETTLE_MS 20
+/** 감시 모드에서 이름 풀을 비우기 전까지 허용하는 이름 수의 배율 */
+#define WATCH_NAME_GROWTH 2
+/** 리스팅 한 줄을 작성하기 전에 미리 예약하는 바이트 수 */
+#define LISTING_LINE_RESERVE 256
+/** 리스팅 한 줄에서 주소와 구분자, 개행에 필요한 최대 바이트 수 */
+#define LISTING_LINE_SLACK 32
+/** token_store의 operand 수에 더해져 operand 대신 EXTDEF/EXTREF 이름임을 표시 */
+#define TOKEN_STORE_NAMES 0x8000
+
+/** 수식 항목의 종류 */
+#define EXPR_NUMBER 0
+#define EXPR_SYMBOL 1
+#define EXPR_EXTERN 2
+#define EXPR_LOCATION 3
+#define EXPR_OPERATOR 4
+/** 매크로 템플릿에서 인자 참조를 나타내는 바이트, 뒤에 인자 번호 + 1이 온다 */
+#define MACRO_PARAM_MARK '\x01'
+
+/** pass 1 스냅샷 파일의 식별자와 형식 버전 */
+#define SNAPSHOT_MAGIC "SXP1"
+#define SNAPSHOT_VERSION 3
+
+/** peephole 최적화 규칙 (--optimize로 골라 적용) */
+#define PEEPHOLE_CLEAR 1   /** 바로 앞에서 이미 0으로 만든 레지스터의 CLEAR, LD #0 */
+#define PEEPHOLE_LOAD 2    /** 바로 다음 load가 덮어쓰는 같은 레지스터의 load */
+#define PEEPHOLE_JUMP 4    /** 바로 다음 명령어로 가는 jump */
+#define PEEPHOLE_COMPARE 8 /** 바로 앞과 같은 비교 */
+#define PEEPHOLE_ALL 15
+#define PEEPHOLE_RULES 4
+
+/** 상호 참조의 종류 (같은 이름 안에서 이 순서로 정렬) */
+#define XREF_DEF 0    /** 심볼의 label, 리터럴이 배치된 라인 */
+#define XREF_EXTDEF 1 /** EXTDEF */
+#define XREF_EXTREF 2 /** EXTREF */
+#define XREF_USE 3    /** operand에서 사용 */
+#define XREF_KINDS 4
+
+/** 벤치마크에서 시간을 재는 단계 */
+#define BENCH_INST_TABLE 0 /** 기계어 목록 읽기 */
+#define BENCH_INPUT 1      /** 소스코드 읽기 */
+#define BENCH_PASS1 2      /** pass 1 (peephole 최적화 포함) */
+#define BENCH_PASS2 3      /** 테이블 출력과 pass 2 */
+#define BENCH_OUTPUT 4     /** 출력 파일 쓰기 */
+#define BENCH_PHASES 5
+#define BENCH_VERSION 1    /** 기준 파일 형식의 버전 */
+#define BENCH_RUNS 15      /** 기본 반복 횟수 (처음 한 번은 제외) */
+#define BENCH_THRESHOLD 10.0 /** 회귀로 보는 기본 처리량 감소율 (%) */
+#define BENCH_NOISE 3.0    /** 차이가 중앙값의 표준 오차 합의 몇 배를 넘어야 회귀로 볼지 */
+
+/** 이름이 없음을 나타내는 name_id */
+#define NAME_NONE 0
+
+/** assembler_ctx의 출력 버퍼 순서 */
+#define ASSEMBLER_OUTPUT_SYMTAB 0
+#define ASSEMBLER_OUTPUT_LITTAB 1
+#define ASSEMBLER_OUTPUT_OBJECTCODE 2
+#define ASSEMBLER_OUTPUT_LISTING 3
+#define ASSEMBLER_OUTPUT_NUM 4
+
+/**
+ * @brief 이름 풀에 등록된 식별자의 번호
+ *
+ * @details
+ * 같은 문자열은 항상 같은 번호를 가지므로 심볼, control section 이름 등을
+ * 정수 비교만으로 비교할 수 있다. 0(NAME_NONE)은 이름이 없음을 뜻한다.
+ */
+typedef uint32_t name_id;
+
+/**
+ * @brief 프로세스 전체에서 공유하는 식별자 이름 풀
+ *
+ * @details
+ * 문자열은 NAME_POOL_CHUNK개씩 나눈 고정 배열에 저장하여 한 번 발급한 번호의
+ * 문자열 주소가 바뀌지 않는다. 따라서 번호로 문자열을 얻을 때는 잠금이 필요
+ * 없다. 문자열로 번호를 찾는 해시 테이블은 open addressing을 사용한다. 마지막
+ * 어셈블러 컨텍스트를 해제할 때 비운다.
+ */
+typedef struct _name_pool {
+	pthread_rwlock_t lock;            /** 해시 테이블과 발급에 대한 잠금 */
+	char **chunks[NAME_POOL_CHUNKS];  /** 번호별 문자열 */
+	name_id length;                   /** 다음에 발급할 번호 */
+	name_id *slots;                   /** 해시 슬롯 (비어있으면 NAME_NONE) */
+	unsigned int capacity;            /** 슬롯 수 (2의 거듭제곱) */
+} name_pool;
 
 /**
  * @brief 한 개의 SIC/XE instruction을 저장하는 구조체
@@ -41,13 +155,142 @@ typedef struct _inst {
  */
 typedef struct _token {
 	char *label;   /** label을 가리키는 포인터 */
+	name_id label_id; /** 이름 풀에 등록한 label 번호 */
 	char *operator; /** operator를 가리키는 포인터 */
 	char *operand[MAX_OPERAND_PER_INST]; /** operand들을
 											가리키는 포인터 배열 */
 	char *comment; /** comment를 가리키는 포인터 */
 	char nixbpe;   /** 특수 bit 정보 */
+	int addr;      /** 라인의 주소 (pass 1에서 채움) */
+	struct _expression *expr; /** 미리 컴파일한 operand 수식, 혹은 NULL */
+	char *names;   /** EXTDEF, EXTREF의 이름들을 '\0'으로 구분하여 이어 붙인 목록 */
+	int names_length; /** 이름 목록의 길이 */
 } token;
 
+/**
+ * @brief 토큰 테이블을 필드별 배열로 저장하는 구조체 (structure of arrays)
+ *
+ * @details
+ * 라인마다 token과 문자열들을 따로 할당하는 대신, 필드마다 라인 수 크기의 배열을
+ * 하나씩 둔다. label과 operator는 이름 풀 번호로, operand와 comment는 `text`
+ * 안의 위치로 저장한다. operand들은 '\0'으로 구분하여 이어 붙인다. 각 pass는
+ * token_store_get으로 한 라인의 token 뷰를 얻어 사용한다.
+ */
+typedef struct _token_store {
+	int length;                /** 저장된 라인 수 */
+	int capacity;              /** 배열마다 할당된 라인 수 */
+	name_id *label;            /** label 번호 (없으면 NAME_NONE) */
+	name_id *operator;         /** operator 번호 (없으면 NAME_NONE) */
+	short *opcode;             /** 기계어 목록 테이블 번호 (지시어는 -1, pass 1에서 채움) */
+	unsigned int *operand;     /** 첫 번째 operand의 text 위치 (없으면 0) */
+	unsigned short *operands;  /** operand 수 (이름 목록이면 TOKEN_STORE_NAMES를 더함) */
+	unsigned int *comment;     /** comment의 text 위치 (없으면 0) */
+	char *nixbpe;              /** 특수 bit 정보 */
+	int *addr;                 /** 라인의 주소 (pass 1에서 채움) */
+	struct _expression **expr; /** 미리 컴파일한 operand 수식, 혹은 NULL */
+	int *line;                 /** 라인이 나온 소스코드의 줄 번호 (1부터) */
+	name_id *file;             /** 라인이 나온 INCLUDE 파일 (소스코드는 NAME_NONE) */
+	char *text;                /** operand와 comment 문자열 (0번 바이트는 사용하지 않음) */
+	size_t text_length;        /** text에 작성된 바이트 수 */
+	size_t text_capacity;      /** text에 할당된 바이트 수 */
+} token_store;
+
+/**
+ * @brief MACRO와 MEND 사이에 정의된 매크로 하나를 저장하는 구조체
+ *
+ * @details
+ * 본문은 정의할 때 한 번만 파싱한 토큰 템플릿으로 저장한다. 템플릿의 `&이름`
+ * 참조는 MACRO_PARAM_MARK와 인자 번호로 바뀌어 있어 확장할 때 다시 파싱하지
+ * 않고 슬롯만 채운다.
+ */
+typedef struct _macro {
+	char name[10];                     /** 매크로 이름 */
+	char param[MAX_MACRO_PARAMS][10];  /** '&'를 뺀 인자 이름 */
+	char *defaults[MAX_MACRO_PARAMS];  /** keyword 인자의 기본값, 혹은 NULL */
+	int params;                        /** 인자 수 */
+	token *body;                       /** 본문 토큰 템플릿 배열 */
+	int *lines;                        /** 템플릿마다 본문 라인의 줄 번호 */
+	int body_length;                   /** 템플릿 수 */
+	int body_capacity;                 /** 할당된 배열의 크기 */
+	name_id file;                      /** MACRO가 있는 파일 (소스코드는 NAME_NONE) */
+} macro;
+
+/**
+ * @brief 호출 라인의 label을 붙일 본문 라인에 이미 label이 있을 때의 정보
+ *
+ * @details
+ * 호출 라인의 label은 확장된 첫 번째 문장에 붙는데, 그 문장의 템플릿에 label이
+ * 있으면 확장할 수 없다. 본문의 첫 라인이 다른 매크로의 호출이면 그 매크로의
+ * 본문 라인이 된다.
+ */
+typedef struct _macro_clash {
+	const macro *m;                /** label이 있는 본문 라인의 매크로 */
+	int body;                      /** 그 본문 라인의 템플릿 번호 */
+	char label[MAX_LINE_LENGTH];   /** 붙이려던 label */
+	char tmpl[MAX_LINE_LENGTH];    /** 본문 라인의 label (인자를 채운 값) */
+} macro_clash;
+
+/**
+ * @brief pass 1 동안 정의된 매크로들을 저장하는 배열
+ */
+typedef struct _macro_table {
+	macro *macros; /** 매크로 배열 */
+	int length;    /** 정의된 매크로 수 */
+	int capacity;  /** 할당된 배열의 크기 */
+} macro_table;
+
+/**
+ * @brief INCLUDE로 포함한 파일 하나를 mmap하고 미리 파싱해 둔 캐시 항목
+ *
+ * @details
+ * 같은 파일을 포함하는 소스가 많을 때 파일을 한 번만 읽고 파싱하기 위해
+ * 사용한다. 라인의 내용은 mmap한 영역을 그대로 가리킨다.
+ */
+typedef struct _include_file {
+	char *path;          /** 파일 경로 (캐시의 키) */
+	long mtime_sec;      /** 읽을 때의 수정 시각 (초) */
+	long mtime_nsec;     /** 읽을 때의 수정 시각 (나노초) */
+	off_t size;          /** 읽을 때의 파일 크기 */
+	char *map;           /** mmap한 파일 내용, 빈 파일은 NULL */
+	size_t map_length;   /** mmap한 바이트 수 */
+	int lines;           /** 라인 수 */
+	size_t *line_start;  /** 라인별 시작 위치 */
+	int *line_length;    /** 라인별 길이 ('\n' 제외) */
+	token **tokens;      /** 라인별 토큰, 파싱에 실패한 라인은 NULL */
+	int refs;            /** 사용 중인 어셈블 수 */
+	int stale;           /** 캐시에서 빠져 마지막 사용 후 해제해야 하는지 */
+	struct _include_file *next; /** 캐시의 다음 항목 */
+} include_file;
+
+/**
+ * @brief 프로세스 전체에서 공유하는 INCLUDE 파일 캐시
+ */
+typedef struct _include_cache {
+	pthread_mutex_t lock; /** 여러 스레드의 어셈블을 위한 잠금 */
+	include_file *files;  /** 캐시 항목 리스트 */
+} include_cache;
+
+/**
+ * @brief tokenize_input이 소스코드를 토큰으로 바꾸는 동안의 상태
+ */
+typedef struct _tokenize_state {
+	const inst **inst_table; /** 기계어 목록 테이블 */
+	int inst_table_length;
+	token_store *tokens;     /** 결과를 저장할 토큰 테이블 */
+	macro_table mt;          /** 지금까지 정의된 매크로 */
+	macro *defining;         /** 정의 중인 매크로, 혹은 NULL */
+	int expansions;          /** 지금까지 확장한 횟수 */
+	int include_depth;       /** 현재 INCLUDE 중첩 깊이 */
+	const char *include_dir; /** 처리 중인 INCLUDE 파일의 디렉터리, 혹은 NULL */
+	struct _diag_list *diags; /** 오류를 모을 목록, 혹은 NULL */
+	name_id file;            /** 처리 중인 INCLUDE 파일 (소스코드는 NAME_NONE) */
+	int line;                /** 처리 중인 줄 번호 */
+	name_id defining_file;   /** 정의 중인 매크로의 MACRO가 있는 파일 */
+	int defining_line;       /** 정의 중인 매크로의 MACRO가 있는 줄 번호 */
+	int skip_macro;          /** 정의에 실패한 매크로의 본문을 건너뛰는 중인지 */
+	int labels;              /** 지금까지 추가한 라인 중 label이 있는 라인 수 */
+} tokenize_state;
+
 /**
  * @brief 하나의 심볼에 대한 정보를 저장하는 구조체
  *
@@ -57,9 +300,12 @@ typedef struct _token {
  * 추가하는 것을 허용한다.
  */
 typedef struct _symbol {
-	char name[10]; /** 심볼의 이름 */
-	char base[10]; /** 심볼의 위치 */
+	name_id name;  /** 심볼의 이름 */
+	name_id base;  /** 심볼의 위치 (control section 이름) */
 	int addr;      /** 심볼의 주소 */
+	int absolute;  /** 재배치되지 않는 EQU 값인지 여부 */
+	int pending;   /** 수식 EQU의 값이 아직 정해지지 않았는지 여부 */
+	int line;      /** 정의한 라인의 토큰 테이블 번호 (수식 EQU의 계산에 사용) */
 	/* add fields if needed */
 } symbol;
 
@@ -74,12 +320,60 @@ typedef struct _symbol {
  */
 typedef struct _literal {
 	char literal[20]; /** 리터럴의 표현식 */
-	char base[10];    /** 리터럴의 위치 */
+	name_id base;     /** 리터럴의 위치 (control section 이름) */
 	int addr;         /** 리터럴의 주소 */
-	int size;         /** 리터럴의 크기 */
+	int size;         /** 리터럴의 크기 (바이트) */
+	unsigned char value[20]; /** 리터럴의 실제 바이트 값 */
+	int skip;         /** 앞서 배치된 리터럴과 공유하여 출력하지 않는 바이트 수 */
 	/* add fields if needed */
 } literal;
 
+/**
+ * @brief RPN으로 컴파일된 수식의 항목 하나
+ */
+typedef struct _expr_item {
+	char kind;  /** EXPR_NUMBER, EXPR_SYMBOL 등 항목의 종류 */
+	char op;    /** 연산자 ('+', '-', '*', '/', 단항 '-'는 'n') */
+	int value;  /** 숫자 값, 심볼 테이블 번호 또는 외부 참조 번호 */
+} expr_item;
+
+/**
+ * @brief EQU, WORD, 명령어 operand에 사용되는 컴파일된 수식
+ *
+ * @details
+ * 심볼은 심볼 테이블 번호로 미리 결정되어 있어 계산할 때 문자열을 다시
+ * 파싱하거나 심볼을 찾지 않는다. 항목 배열은 필요한 길이만큼만 할당한다.
+ */
+typedef struct _expression {
+	int location;    /** 수식의 '*'가 가리키는 주소 */
+	name_id externs[MAX_EXPR_EXTERNS]; /** 수식에 사용된 외부 참조 이름 */
+	int externs_length;                 /** 외부 참조 이름 수 */
+	int length;      /** 항목 수 */
+	expr_item items[]; /** RPN 순서의 항목 배열 */
+} expression;
+
+/**
+ * @brief 현재 control section에서 EXTREF한 이름들의 집합
+ *
+ * @details
+ * 수식을 컴파일할 때 외부 참조인지 확인하기 위한 open addressing 해시
+ * 테이블이다. 이름 풀의 번호를 저장한다.
+ */
+typedef struct _extref_set {
+	name_id *names;     /** 해시 슬롯 배열 (비어있으면 NAME_NONE) */
+	int capacity;       /** 슬롯 수 (2의 거듭제곱) */
+	int length;         /** 저장된 이름 수 */
+} extref_set;
+
+/**
+ * @brief 수식을 계산한 값과 재배치 정보
+ */
+typedef struct _expr_value {
+	int value;    /** 계산된 값 */
+	int relative; /** relative 항의 개수 (0 = absolute, 1 = relative) */
+	signed char externs[MAX_EXPR_EXTERNS]; /** 외부 참조별로 더해진 횟수 */
+} expr_value;
+
 /**
  * @brief 오브젝트 코드 전체에 대한 정보를 담는 구조체
  *
@@ -94,39 +388,639 @@ typedef struct _object_code {
 	struct _object_code* next; /** 다음 라인을 가리키는 포인터 **/
 } object_code;
 
-/*
-* Modification Recode를 사용하기 위해 필요한 구조체
-*/
+/**
+ * @brief 작성 중인 Text Record 하나를 저장하는 구조체
+ *
+ * @details
+ * 패스 2에서 생성된 코드를 주소가 이어지는 동안 최대 길이까지 모아두었다가
+ * 오브젝트 코드의 한 줄로 내보낸다.
+ */
+typedef struct _text_record {
+	int start;          /** Text Record의 시작 주소 */
+	int length;         /** 현재까지 채워진 바이트 수 */
+	char hex[MAX_TEXT_RECORD_LENGTH * 2 + 1]; /** 채워진 코드의 16진수 문자열 */
+	int aligned_length; /** 명령어 단위로 끊었을 때의 현재 record 길이 */
+	int aligned_end;    /** 명령어 단위로 끊었을 때의 다음 주소 */
+} text_record;
+
+/**
+ * @brief Modification Record 하나에 대한 정보를 저장하는 구조체
+ */
 typedef struct _modification_record {
-	char name[10]; 		/** 어떤 것을 사용했는지 **/
-	char base[10];    	/** 어디서 사용했는지 */
+	name_id name; 		/** 어떤 것을 사용했는지 **/
+	name_id base;    	/** 어디서 사용했는지 */
 	int addr;         	/** 처리해야할 주소 */
 	int pos;         	/** 몇번째 비트에서 해야하는지 */
 	char op;			/** 어떤 연산을 해야하는지 */
-	struct _modification_record* next; /** 다음 라인을 가리키는 포인터 **/
 } modification_record;
 
+/**
+ * @brief 한 control section의 Modification Record들을 저장하는 배열
+ *
+ * @details
+ * 참조마다 할당하는 대신 연속된 배열에 모아두었다가 control section이 끝날 때
+ * 주소 순으로 정렬, 병합하여 출력한다.
+ */
+typedef struct _modification_table {
+	modification_record *records; /** Modification Record 배열 */
+	int length;                   /** 저장된 record 수 */
+	int capacity;                 /** 할당된 배열의 크기 */
+} modification_table;
+
+/**
+ * @brief 어셈블 결과에 대한 통계를 저장하는 구조체
+ *
+ * @details
+ * 패스 2 과정에서 수집한 코드 크기 등의 정보를 저장한다. `--stat` 옵션으로
+ * 출력할 수 있다.
+ */
+typedef struct _assem_stat {
+	int code_bytes;    /** Text Record에 기록된 코드의 총 바이트 수 */
+	int base_relative; /** base relative로 인코딩된 명령어 수 */
+	int literal_bytes; /** 리터럴 pool에 기록된 바이트 수 */
+	int literal_shared; /** 다른 리터럴과 공유하여 생략된 리터럴 바이트 수 */
+	int text_records;   /** 출력된 Text Record 수 */
+	int aligned_records; /** 명령어 단위로 끊었을 때 필요한 Text Record 수 */
+	int mod_records;     /** 출력된 Modification Record 수 */
+	int mod_records_raw; /** 병합 전 Modification Record 수 */
+	int token_lines;     /** 토큰 테이블의 라인 수 */
+	long token_bytes;    /** 토큰 테이블이 할당한 바이트 수 */
+} assem_stat;
+
+/**
+ * @brief peephole 최적화로 control section 하나에서 줄어든 양
+ */
+typedef struct _peephole_section {
+	name_id name;     /** control section 이름 */
+	int instructions; /** 제거한 명령어 수 */
+	int bytes;        /** 줄어든 코드의 바이트 수 */
+} peephole_section;
+
+/**
+ * @brief peephole 최적화 결과를 control section별, 규칙별로 모은 구조체
+ */
+typedef struct _peephole_report {
+	peephole_section sections[MAX_CONTROL_SECTION_NUM]; /** control section별 결과 */
+	int length;                  /** control section 수 */
+	int rules[PEEPHOLE_RULES];   /** 규칙별로 제거한 명령어 수 (PEEPHOLE_* 비트 순서) */
+} peephole_report;
+
+/**
+ * @brief 심볼, 리터럴, 외부 이름이 나온 라인 하나
+ */
+typedef struct _xref_ref {
+	name_id name;     /** 심볼, 리터럴 또는 외부 이름 */
+	name_id section;  /** 라인이 속한 control section 이름 */
+	name_id file;     /** 라인이 나온 INCLUDE 파일 (소스코드는 NAME_NONE) */
+	name_id operator; /** 라인의 operator */
+	int line;         /** 줄 번호 (1부터) */
+	int addr;         /** 라인의 주소 (리터럴의 정의는 리터럴의 주소, EQU의 정의는 심볼의 값) */
+	int order;        /** 토큰 테이블의 라인 번호 (같은 종류 안의 정렬 순서) */
+	char kind;        /** XREF_DEF 등 참조의 종류 */
+	char nixbpe;      /** 라인의 특수 bit 정보 (주소 지정 방식) */
+} xref_ref;
+
+/**
+ * @brief 이름 하나의 참조 목록 (posting list)
+ */
+typedef struct _xref_name {
+	name_id name;             /** 이름 */
+	int start;                /** refs에서 첫 참조의 위치 */
+	int count[XREF_KINDS];    /** 종류별 참조 수 (refs에서 이 순서로 이어짐) */
+} xref_name;
+
+/**
+ * @brief 어셈블 한 번의 상호 참조 색인
+ *
+ * @details
+ * 참조들은 이름의 문자열 순서, 종류, 라인 순서로 정렬되어 있어 이름마다 하나의
+ * 연속된 구간을 이룬다. `names`도 문자열 순서이므로 이름은 이진 탐색으로 찾는다.
+ */
+typedef struct _xref_table {
+	xref_ref *refs;     /** 정렬된 참조 배열 */
+	int length;         /** 참조 수 */
+	int capacity;       /** 할당된 배열의 크기 */
+	xref_name *names;   /** 정렬된 이름별 구간 배열 */
+	int names_length;   /** 이름 수 */
+} xref_table;
+
+/**
+ * @brief 스트리밍 모드에서 pass 1이 임시 파일에 쓰는 라인 하나의 IR 헤더
+ *
+ * @details
+ * 헤더 뒤에 `text_length` 바이트의 operand 문자열('\0'으로 구분)이 이어진다.
+ * pass 2에서 사용하지 않는 comment는 저장하지 않는다.
+ */
+typedef struct _token_ir {
+	name_id label;              /** label 번호 */
+	name_id operator;           /** operator 번호 */
+	int addr;                   /** 라인의 주소 */
+	short opcode;               /** 기계어 목록 테이블 번호 (지시어는 -1) */
+	unsigned short operands;    /** token_store의 operand 수 */
+	unsigned short text_length; /** 뒤따르는 operand 문자열의 바이트 수 */
+	char nixbpe;                /** 특수 bit 정보 */
+	int line;                   /** 소스코드의 줄 번호 */
+	name_id file;               /** INCLUDE 파일 (소스코드는 NAME_NONE) */
+} token_ir;
+
+/**
+ * @brief pass 1 스냅샷 파일의 헤더
+ *
+ * @details
+ * 헤더 뒤에 이름 목록('\0'으로 구분), 토큰 테이블의 필드별 배열(label,
+ * operator, file, operand, comment, addr, line, opcode, operands, nixbpe 순)과
+ * text,
+ * 심볼 테이블과 리터럴 테이블이 차례로 이어진다. 파일 안의 이름은 이름 목록의
+ * 번호(1부터)로 저장하므로 다른 프로세스에서도 읽을 수 있다. 구조체의 크기가
+ * 다르거나 기계어 목록 테이블의 길이가 다르면 읽지 않는다.
+ */
+typedef struct _snapshot_header {
+	char magic[4];           /** SNAPSHOT_MAGIC */
+	uint32_t version;        /** SNAPSHOT_VERSION */
+	uint32_t size;           /** 파일 전체의 바이트 수 */
+	uint32_t inst_table_length; /** 스냅샷을 만들 때의 기계어 목록 테이블 길이 */
+	uint32_t symbol_size;    /** sizeof(symbol) */
+	uint32_t literal_size;   /** sizeof(literal) */
+	uint32_t names;          /** 이름 수 */
+	uint32_t names_bytes;    /** 이름 목록의 바이트 수 */
+	uint32_t tokens;         /** 토큰 테이블의 라인 수 */
+	uint32_t text_bytes;     /** 토큰 테이블 text의 바이트 수 */
+	uint32_t symbols;        /** 심볼 수 */
+	uint32_t literals;       /** 리터럴 수 */
+} snapshot_header;
+
+/**
+ * @brief 수식을 컴파일하는 동안 유지하는 control section 정보
+ */
+typedef struct _expr_scope {
+	name_id base;    /** 현재 control section 이름 */
+	extref_set refs; /** 현재 control section에서 EXTREF한 이름 */
+} expr_scope;
+
+/**
+ * @brief 토큰 테이블을 나누어 처리할 때 라인 사이에 유지되는 pass 1의 상태
+ */
+typedef struct _pass1_state {
+	const inst **inst_table;    /** 기계어 목록 테이블 */
+	int inst_table_length;
+	symbol **symbol_table;      /** 심볼 테이블 */
+	int *symbol_table_length;
+	literal **literal_table;    /** 리터럴 테이블 */
+	int *literal_table_length;
+	name_id base;               /** 현재 control section 이름 */
+	int location_counter;       /** Location Counter */
+	extref_set labels;          /** 현재 control section에서 정의한 label (중복 확인) */
+	struct _diag_list *diags;   /** 오류를 모을 목록, 혹은 NULL */
+} pass1_state;
+
+/**
+ * @brief 토큰 테이블을 나누어 처리할 때 라인 사이에 유지되는 pass 2의 상태
+ *
+ * @details
+ * `out`이 NULL이 아니면 assem_pass2_flush가 완성된 오브젝트 코드 줄을 바로
+ * 파일로 출력하고 해제한다. 길이를 나중에 알 수 있는 Header Record는 자리만
+ * 비워두고 assem_pass2_finish에서 채운다.
+ */
+typedef struct _pass2_state {
+	const inst **inst_table;         /** 기계어 목록 테이블 */
+	int inst_table_length;
+	const symbol **symbol_table;     /** 심볼 테이블 */
+	int symbol_table_length;
+	const literal **literal_table;   /** 리터럴 테이블 */
+	int literal_table_length;
+	object_code *obj_code;           /** 아직 출력하지 않은 첫 번째 줄 */
+	object_code *now;                /** 작성 중인 줄 */
+	modification_table mod_table;    /** 현재 control section의 Modification Record */
+	assem_stat *stat;                /** 어셈블 통계, 혹은 NULL */
+	name_id pro_name;                /** 첫 번째 control section 이름 */
+	int pro_start;                   /** 프로그램 시작 주소 */
+	name_id base;                    /** 현재 control section 이름 */
+	int base_addr;                   /** BASE 주소 (NOBASE인 경우 -1) */
+	int location_counter;            /** Location Counter */
+	int total;                       /** 지금까지의 프로그램 크기 */
+	int section_start;               /** 현재 control section의 시작 주소 */
+	text_record text;                /** 작성 중인 Text Record */
+	int pro_size[MAX_CONTROL_SECTION_NUM]; /** control section별 크기 */
+	int pro_cnt;                     /** 끝난 control section 수 */
+	FILE *out;                       /** 스트리밍 출력 파일, 혹은 NULL */
+	struct _output_buffer *listing;  /** 리스팅 출력 버퍼, 혹은 NULL */
+	long pro_offset[MAX_CONTROL_SECTION_NUM]; /** 출력한 Header Record의 길이 위치 */
+	int pro_written;                 /** 출력한 Header Record 수 */
+	struct _diag_list *diags;        /** 오류를 모을 목록, 혹은 NULL */
+	int *literal_order;              /** 리스팅의 리터럴 주소 순서, 혹은 NULL */
+	int literal_next;                /** 리스팅에 다음 pool을 찾기 시작할 literal_order 위치 */
+} pass2_state;
 
+/**
+ * @brief 감시 모드에서 재사용하는 pass 2 구간 하나의 결과
+ *
+ * @details
+ * pass 2의 토큰 테이블을 START, CSECT 라인 바로 다음에서 나눈 구간마다 만든다.
+ * 구간이 시작할 때는 작성 중인 Text Record와 Modification Record가 비어 있으므로,
+ * 구간의 라인과 시작 상태가 같으면 오브젝트 코드와 리스팅도 같다. 이때는 pass 2를
+ * 수행하지 않고 저장해 둔 줄들을 붙인 뒤 끝난 상태로 건너뛴다.
+ */
+typedef struct _section_result {
+	uint64_t key;                /** 구간의 라인과 시작 상태의 해시 */
+	int lines;                   /** 구간의 라인 수 */
+	char *object;                /** 완성된 오브젝트 코드 줄들 (줄마다 '\n'으로 끝남) */
+	size_t object_length;        /** object의 바이트 수 */
+	char pending[100];           /** 구간이 끝날 때 작성 중이던 줄 */
+	char *listing;               /** 구간의 리스팅, 혹은 NULL */
+	size_t listing_length;       /** listing의 바이트 수 */
+	name_id pro_name;            /** 구간이 끝난 뒤의 pass 2 상태 */
+	int pro_start;
+	name_id base;
+	int base_addr;
+	int location_counter;
+	int section_start;
+	text_record text;
+	int total;                   /** 구간에서 늘어난 프로그램 크기 */
+	int pro_size[MAX_CONTROL_SECTION_NUM]; /** 구간에서 끝난 control section의 크기 */
+	int pro_cnt;                 /** 구간에서 끝난 control section 수 */
+	assem_stat stat;             /** 구간에서 늘어난 통계 */
+} section_result;
+
+/**
+ * @brief 이전 pass 2의 구간 결과들을 모아두는 배열
+ */
+typedef struct _section_cache {
+	section_result *items; /** 구간 결과 배열 */
+	int length;            /** 저장된 구간 수 */
+	int capacity;          /** 할당된 배열의 크기 */
+	int sections;          /** 마지막 pass 2의 구간 수 */
+	int reused;            /** 마지막 pass 2에서 다시 사용한 구간 수 */
+} section_cache;
+
+/**
+ * @brief 파일 하나의 출력 내용을 모아두는 버퍼
+ *
+ * @details
+ * 출력 내용을 미리 할당한 버퍼에 모두 작성한 뒤 한 번의 write로 출력하기 위해
+ * 사용한다.
+ */
+typedef struct _output_buffer {
+	char *data;      /** 작성된 내용 ('\0'으로 끝남) */
+	size_t length;   /** 작성된 바이트 수 */
+	size_t capacity; /** 할당된 바이트 수 */
+} output_buffer;
+
+/**
+ * @brief 출력 버퍼 하나를 파일 하나로 출력하는 작업
+ */
+typedef struct _output_job {
+	const char *dir;          /** 출력할 파일 경로 */
+	const output_buffer *out; /** 출력할 내용 */
+	int err;                  /** 출력 결과 오류 코드 */
+} output_job;
+
+/**
+ * @brief 어셈블 중 발견한 오류 하나의 위치와 내용
+ */
+typedef struct _diagnostic {
+	name_id file;                   /** INCLUDE 파일 (소스코드는 NAME_NONE) */
+	int line;                       /** 줄 번호 (1부터, 모르면 0) */
+	int column;                     /** 열 번호 (1부터, 모르면 0) */
+	char message[MAX_DIAG_MESSAGE]; /** 오류 내용 */
+} diagnostic;
+
+/**
+ * @brief 어셈블 한 번에서 발견한 오류들을 순서대로 모으는 배열
+ *
+ * @details
+ * 각 단계는 오류가 있는 라인을 기록하고 다음 라인으로 넘어가므로 한 번의 실행으로
+ * 여러 오류를 보고할 수 있다. 목록 대신 NULL을 넘기면 첫 오류에서 멈춘다.
+ */
+typedef struct _diag_list {
+	diagnostic *items; /** 오류 배열 */
+	int length;        /** 기록한 오류 수 */
+	int capacity;      /** 할당된 배열의 크기 */
+	int dropped;       /** MAX_DIAGNOSTICS를 넘어 기록하지 못한 오류 수 */
+} diag_list;
+
+/**
+ * @brief 어셈블 한 번에 필요한 모든 상태를 담는 컨텍스트
+ *
+ * @details
+ * 다른 프로그램에 어셈블러를 포함할 수 있도록 기존에 main의 지역 변수였던
+ * 테이블들을 하나로 모은 구조체이다. assembler_create로 생성하고
+ * assembler_destroy로 해제한다. 공유하는 INCLUDE 캐시와 이름 풀은 잠금으로
+ * 보호하므로 스레드마다 별도의 컨텍스트를 사용하면 동시에 어셈블할 수 있다.
+ */
+typedef struct _assembler_ctx {
+	inst *inst_table[MAX_INST_TABLE_LENGTH]; /** 기계어 목록 테이블 */
+	int inst_table_length;
+	char **input;                            /** 소스코드 라인 테이블 */
+	int input_length;
+	token_store tokens;                      /** 토큰 테이블 */
+	symbol *symbol_table[MAX_TABLE_LENGTH];  /** 심볼 테이블 */
+	int symbol_table_length;
+	literal *literal_table[MAX_TABLE_LENGTH]; /** 리터럴 테이블 */
+	int literal_table_length;
+	object_code *obj_code;                   /** 오브젝트 코드 */
+	assem_stat stat;                         /** 어셈블 통계 */
+	const inst *decode_table[DECODE_TABLE_LENGTH]; /** 첫 바이트로 찾는 instruction */
+	output_buffer outputs[ASSEMBLER_OUTPUT_NUM]; /** 어셈블 결과 출력 버퍼 */
+	int listing;                             /** 0이 아니면 pass 2에서 리스팅도 작성 */
+	diag_list diags;                         /** 어셈블 중 발견한 오류 */
+	int optimize;            /** pass 1 뒤에 적용할 PEEPHOLE_* 규칙 (0이면 적용하지 않음) */
+	peephole_report peephole; /** peephole 최적화 결과 */
+	int xref;                /** 0이 아니면 pass 2 전에 상호 참조 색인을 만듦 */
+	xref_table xrefs;        /** 상호 참조 색인 */
+	section_cache *sections; /** 구간 결과를 재사용할 캐시, 혹은 NULL */
+	double phase_seconds[BENCH_PHASES]; /** 마지막 어셈블의 단계별 시간 (초, 출력은 run_bench가 기록) */
+	const char *error_stage; /** 마지막으로 실패한 단계의 이름, 혹은 NULL */
+} assembler_ctx;
+
+/**
+ * @brief 단계별 벤치마크 결과 (기준 파일 하나의 내용)
+ */
+typedef struct _bench_result {
+	int runs;                   /** 반복 횟수 */
+	long input_bytes;           /** 소스코드의 바이트 수 */
+	int input_lines;            /** 소스코드의 라인 수 */
+	int inst_entries;           /** 기계어 목록의 항목 수 */
+	double median[BENCH_PHASES]; /** 단계별 실행 시간의 중앙값 (초) */
+	double mad[BENCH_PHASES];    /** 단계별 실행 시간의 중앙값 절대 편차 (초) */
+} bench_result;
+
+/**
+ * @brief 감시 모드에서 변경을 확인하는 파일 하나
+ *
+ * @details
+ * 편집기는 파일을 새로 만든 뒤 이름을 바꾸어 저장하기도 하므로 파일 대신 파일이
+ * 있는 디렉터리를 감시하고, 이벤트의 이름으로 파일을 구분한다.
+ */
+typedef struct _watch_file {
+	int wd;           /** 파일이 있는 디렉터리의 inotify watch 번호 */
+	char *path;       /** 파일 경로 */
+	const char *name; /** path 안에서 디렉터리를 뺀 파일 이름 */
+} watch_file;
+
+/**
+ * @brief 감시 모드에서 다시 어셈블하는 사이에 유지하는 상태
+ */
+typedef struct _watch_state {
+	int fd;                   /** inotify 파일 디스크립터 */
+	watch_file *files;        /** 소스코드와 INCLUDE 파일 배열 */
+	int files_length;         /** 감시하는 파일 수 */
+	int files_capacity;       /** 할당된 배열의 크기 */
+	section_cache sections;   /** 이전 pass 2의 구간 결과 */
+	output_buffer written[ASSEMBLER_OUTPUT_NUM]; /** 출력 파일에 있는 내용 */
+	int known[ASSEMBLER_OUTPUT_NUM];  /** written이 출력 파일의 내용과 같은지 여부 */
+	name_id names;            /** 이름 풀을 비운 뒤 첫 어셈블을 마친 때의 이름 수 */
+} watch_state;
+
+assembler_ctx *assembler_create(void);
+int assembler_load_inst_table(assembler_ctx *ctx, const char *inst_table_dir);
+int assembler_assemble(assembler_ctx *ctx, const char *source,
+					   size_t source_length);
+int assembler_assemble_stream(assembler_ctx *ctx, const char *input_dir,
+							  const char *objectcode_dir);
+int assembler_assemble_snapshot(assembler_ctx *ctx, const char *snapshot_dir);
+int assembler_assemble_pass2(assembler_ctx *ctx);
+int assembler_save_snapshot(assembler_ctx *ctx, const char *snapshot_dir);
+void assembler_reset(assembler_ctx *ctx);
+void assembler_destroy(assembler_ctx *ctx);
+int assembler_shared_clear(assembler_ctx *ctx);
+int report_diagnostics(assembler_ctx *ctx, const char *source_name, int json);
+int watch_input(assembler_ctx *ctx, const char *input_dir, output_job jobs[],
+				int jobs_length, int thread_flag, int stat_flag, int diag_json);
+int watch_assemble(assembler_ctx *ctx, watch_state *ws, const char *input_dir,
+				   output_job jobs[], int jobs_length, int thread_flag,
+				   int *written);
+int watch_update_files(watch_state *ws, const char *input_dir,
+					   const token_store *tokens);
+int watch_add_file(watch_state *ws, const char *path);
+int watch_wait(watch_state *ws, char *changed, size_t changed_size);
+void watch_state_free(watch_state *ws);
+void watch_stop(int sig);
+void token_free(token *tok);
+void token_clear(token *tok);
+int token_copy(token *dst, const token *src);
+size_t token_names_size(const char *names, int names_length);
+int token_names_append(token *tok, const char *name);
+int token_store_reserve(token_store *store, int capacity);
+int token_store_text(token_store *store, const char *str, size_t length,
+					 unsigned int *offset);
+int token_store_add(token_store *store, const token *tok);
+void token_store_get(const token_store *store, int i, token *tok);
+size_t token_store_bytes(const token_store *store);
+void token_store_clear(token_store *store);
+void token_store_free(token_store *store);
+int token_store_spill(const token_store *store, FILE *fp);
+int token_store_load(token_store *store, FILE *fp, int max_lines);
+void snapshot_name_add(name_id id, name_id *map, name_id *ids,
+					   snapshot_header *header);
+int make_pass1_snapshot(const char *snapshot_dir, const token_store *tokens,
+						int inst_table_length, const symbol *symbol_table[],
+						int symbol_table_length, const literal *literal_table[],
+						int literal_table_length);
+int snapshot_reject(diag_list *diags, const char *format, ...);
+int snapshot_check_line(const inst *inst_table[], const token_store *tokens,
+						int i, diag_list *diags);
+int parse_pass1_snapshot(const char *data, size_t size, const inst *inst_table[],
+						 int inst_table_length, token_store *tokens,
+						 symbol *symbol_table[], int *symbol_table_length,
+						 literal *literal_table[], int *literal_table_length,
+						 diag_list *diags);
+int load_pass1_snapshot(const char *snapshot_dir, const inst *inst_table[],
+						int inst_table_length, token_store *tokens,
+						symbol *symbol_table[], int *symbol_table_length,
+						literal *literal_table[], int *literal_table_length,
+						diag_list *diags);
+void object_code_free(object_code *obj_code);
 int init_inst_table(inst *inst_table[], int *inst_table_length,
 					const char *inst_table_dir);
-int init_input(char *input[], int *input_length, const char *input_dir);
+int init_input(char ***input, int *input_length, const char *input_dir);
+int init_input_buffer(char ***input, int *input_length, const char *source,
+					  size_t source_length, diag_list *diags);
+int read_file(const char *dir, char **data, size_t *length);
+int read_line(FILE *fp, char *line, int line_size);
 int assem_pass1(const inst *inst_table[], int inst_table_length,
-				const char *input[], int input_length, token *tokens[],
-				int *tokens_length, symbol *symbol_table[],
+				const char *input[], int input_length, token_store *tokens,
+				symbol *symbol_table[],
 				int *symbol_table_length, literal *literal_table[],
-				int *literal_table_length);
+				int *literal_table_length, diag_list *diags);
+int assem_pass1_lines(pass1_state *st, token_store *tokens);
+int assem_pass1_tokens(const inst *inst_table[], int inst_table_length,
+					   token_store *tokens, symbol *symbol_table[],
+					   int *symbol_table_length, literal *literal_table[],
+					   int *literal_table_length, diag_list *diags);
+int peephole_optimize(const inst *inst_table[], int inst_table_length,
+					  int rules, token_store *tokens, symbol *symbol_table[],
+					  int *symbol_table_length, literal *literal_table[],
+					  int *literal_table_length, peephole_report *report,
+					  diag_list *diags);
+int peephole_match(const token_store *tokens, int prev, int i, int rules,
+				   int *victim);
+char peephole_register(const char *operator);
+char peephole_zero_register(const token *tok);
+int peephole_same_compare(const token_store *tokens, int prev, int i);
+int peephole_jump_next(const token_store *tokens, int i);
+int peephole_size(const inst *in, const char *operator);
+int peephole_parse_rules(const char *str, int *rules);
+void token_store_remove(token_store *store, const char *removed);
+int pass1_check_line(const token *tok, int inst_index, char *message,
+					 int message_size, int *field);
+int pass1_check_names(const token *tok, char *message, int message_size,
+					  int *field);
+int register_number(const char *name);
+int format2_operand(const char *operator, int k, const char *operand);
+int pass1_check_format2(const token *tok, const inst *in, char *message,
+						int message_size, int *operand);
+int assem_pass1_stream(const inst *inst_table[], int inst_table_length,
+					   FILE *input, FILE *spill, symbol *symbol_table[],
+					   int *symbol_table_length, literal *literal_table[],
+					   int *literal_table_length, assem_stat *stat,
+					   diag_list *diags);
+int tokenize_input(const inst *inst_table[], int inst_table_length,
+				   const char *input[], int input_length, token_store *tokens,
+				   diag_list *diags);
+void token_store_locate(token_store *store, int start, name_id file, int line);
+int tokenize_finish(tokenize_state *st);
+int tokenize_line(tokenize_state *st, const char *line, const token *parsed);
+int tokenize_macro_clash(tokenize_state *st, int column,
+						 const macro_clash *clash);
+int tokenize_added(tokenize_state *st, int start);
+int tokenize_parse_error(tokenize_state *st, const char *line,
+						 char fields[3][MAX_LINE_LENGTH]);
+int tokenize_include(tokenize_state *st, const char *path);
+include_file *include_cache_acquire(const char *path, const inst *inst_table[],
+									int inst_table_length, int *err);
+include_file *include_cache_find(include_cache *cache, const char *path,
+								 long mtime_sec, long mtime_nsec, off_t size);
+void include_cache_release(include_file *f);
+void include_cache_clear(void);
+include_file *include_file_load(const char *path, const inst *inst_table[],
+								int inst_table_length, int *err);
+void include_file_free(include_file *f);
+unsigned int name_hash(const char *str);
+name_id name_pool_lookup(const name_pool *pool, const char *str,
+						 unsigned int *slot);
+int name_intern(const char *str, name_id *id);
+name_id name_find(const char *str);
+const char *name_str(name_id id);
+name_id name_count(void);
+void name_pool_clear(void);
 int token_parsing(const char *input, token *tok, const inst *inst_table[],
 				  int inst_table_length);
+int token_parse_names(token *tok, const char *operand);
+void split_fields(const char *input, char fields[3][MAX_LINE_LENGTH]);
+int split_args(char *field, char *args[], int max);
+const macro *macro_search(const macro_table *mt, const char *name);
+int macro_define(macro_table *mt, const char *name, char *params,
+				 name_id file, macro **defining);
+void macro_mark_params(const macro *m, char *field);
+int macro_template_add(macro *m, token *tok, int line);
+int macro_substitute(const char *field, const char *values[], int id,
+					 char **out);
+int macro_expand(const macro_table *mt, const macro *m, const char *args[],
+				 int args_length, const char *label, token_store *tokens,
+				 int *expansions, int depth, macro_clash *clash);
+void macro_clear(macro *m);
+void macro_table_free(macro_table *mt);
 int search_opcode(const char *str, const inst *inst_table[],
 				  int inst_table_length);
 int make_opcode_output(const char *output_dir, const token *tokens[],
 					   int tokens_length, const inst *inst_table[],
 					   int inst_table_length);
-int assem_pass2(const token *tokens[], int tokens_length,
+int assem_pass2(const token_store *tokens,
 				const inst *inst_table[], int inst_table_length,
 				const symbol *symbol_table[], int symbol_table_length,
 				const literal *literal_table[], int literal_table_length,
-				object_code *obj_code);
+				object_code *obj_code, assem_stat *stat,
+				output_buffer *listing, diag_list *diags,
+				section_cache *sections);
+void assem_pass2_init(pass2_state *st, const inst *inst_table[],
+					  int inst_table_length, const symbol *symbol_table[],
+					  int symbol_table_length, const literal *literal_table[],
+					  int literal_table_length, object_code *obj_code,
+					  assem_stat *stat);
+int assem_pass2_lines(pass2_state *st, const token_store *tokens);
+int assem_pass2_flush(pass2_state *st, int all);
+int assem_pass2_finish(pass2_state *st);
+void object_code_count(const object_code *line, assem_stat *stat);
+int assem_pass2_stream(FILE *spill, const inst *inst_table[],
+					   int inst_table_length, const symbol *symbol_table[],
+					   int symbol_table_length, const literal *literal_table[],
+					   int literal_table_length, FILE *out, assem_stat *stat,
+					   diag_list *diags);
+int assem_pass2_sections(pass2_state *st, const token_store *tokens,
+						 section_cache *cache);
+int section_run(pass2_state *st, const token_store *tokens, int start,
+				int end, section_cache *cache, section_cache *next);
+int section_reuse(pass2_state *st, const section_result *res);
+int section_save(const pass2_state *st, const object_code *first,
+				 size_t listing_start, const assem_stat *stat_start,
+				 int pro_cnt_start, int total_start, section_result *res);
+uint64_t section_key(const pass2_state *st, const token_store *tokens);
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length);
+void token_store_view(const token_store *store, int start, int end,
+					  token_store *view);
+void assem_stat_add(assem_stat *stat, const assem_stat *delta, int sign);
+void section_result_free(section_result *res);
+void section_cache_free(section_cache *cache);
+int literal_encode(const char *str, unsigned char *value);
+int place_literal_pool(literal *literal_table[], int literal_table_length,
+					   int *location_counter);
+int expr_compile(const char *str, name_id base, int location,
+				 const symbol *symbol_table[], int symbol_table_length,
+				 const extref_set *refs, expression **out);
+int extref_set_add(extref_set *set, name_id name);
+int extref_set_contains(const extref_set *set, name_id name);
+void extref_set_clear(extref_set *set);
+void extref_set_free(extref_set *set);
+int expr_precedence(char op);
+int expr_eval(const expression *expr, const symbol *symbol_table[],
+			  expr_value *result);
+int compile_expressions(const inst *inst_table[], token_store *tokens,
+						expr_scope *scope, const symbol *symbol_table[],
+						int symbol_table_length, int *pending,
+						diag_list *diags);
+int expr_find_undefined(const char *str, name_id base,
+						const symbol *symbol_table[], int symbol_table_length,
+						const extref_set *refs, char *name, int name_size);
+int resolve_expressions(const inst *inst_table[], int inst_table_length,
+						token_store *tokens, symbol *symbol_table[],
+						int symbol_table_length, diag_list *diags);
+int encode_operand_expr(int *value, const token *tok,
+						const symbol *symbol_table[], int location_counter,
+						int base_addr, name_id base,
+						modification_table *mod_table, assem_stat *stat);
+int text_record_flush(text_record *text, object_code **now, assem_stat *stat);
+int text_record_append(text_record *text, int addr, const char *hex,
+					   object_code **now, assem_stat *stat);
+int modification_add(modification_table *mod_table, name_id name,
+					 name_id base, int addr, int pos, char op,
+					 assem_stat *stat);
+int modification_compare(const void *a, const void *b);
+int make_external_records(const token *tok, name_id base,
+						  const symbol *symbol_table[], int symbol_table_length,
+						  const literal *literal_table[], int literal_table_length,
+						  object_code **now);
+int make_modification_records(modification_table *mod_table,
+							  object_code **now, assem_stat *stat);
+int make_literal_pool_hex(char *line, int line_size, name_id base,
+						  int location_counter, const literal *literal_table[],
+						  int literal_table_length);
+int listing_section(output_buffer *out, const char *name, int first);
+int listing_line(output_buffer *out, int loc, const token *tok, const char *hex);
+char *listing_format(char *p, const char *end, int loc, const token *tok,
+					 const char *hex);
+char *put_str(char *p, const char *end, const char *str);
+int listing_literal_pool(pass2_state *st, name_id base, int location_counter,
+						 int length);
+int *listing_literal_order(const literal *literal_table[],
+						   int literal_table_length);
+int search_address(const char *str, name_id base,
+				   const symbol *symbol_table[], int symbol_table_length,
+				   const literal *literal_table[], int literal_table_length);
+int literal_reachable(const literal *lit, int nixbpe, int location_counter);
+int search_literal(const char *str, name_id base, int location_counter,
+				   const literal *literal_table[], int literal_table_length);
+int calc_relative_disp(int *value, int target, int location_counter,
+					   int base_addr);
 int make_symbol_table_output(const char *symbol_table_dir,
 							 const symbol *symbol_table[],
 							 int symbol_table_length);
@@ -135,5 +1029,105 @@ int make_literal_table_output(const char *literal_table_dir,
 							  int literal_table_length);
 int make_objectcode_output(const char *objectcode_dir,
 						   const object_code *obj_code);
+int make_stat_output(const char *stat_dir, const assem_stat *stat);
+int make_peephole_output(const char *peephole_dir,
+						 const peephole_report *report);
+int xref_build(xref_table *xrefs, const token_store *tokens,
+			   const symbol *symbol_table[], int symbol_table_length,
+			   const literal *literal_table[], int literal_table_length);
+int xref_def_addr(const token *tok, name_id section, const symbol *symbol_table[],
+				  int symbol_table_length);
+int xref_add(xref_table *xrefs, const token_store *tokens, int i, name_id name,
+			 name_id section, int addr, int kind);
+int xref_compare(const void *a, const void *b);
+int xref_group(xref_table *xrefs);
+const xref_name *xref_find(const xref_table *xrefs, const char *name);
+void xref_table_free(xref_table *xrefs);
+int render_xref(output_buffer *out, const xref_table *xrefs,
+				const char *source_name);
+void xref_mode(char nixbpe, char *mode);
+int xref_query_file(const char *xref_dir, const char *query, const char *name,
+					output_buffer *out);
+int xref_query(const char *data, size_t length, const char *query,
+			   const char *name, output_buffer *out);
+size_t xref_lower_bound(const char *data, size_t length, const char *name);
+int xref_line_compare(const char *line, const char *end, const char *name);
+const char *xref_field(const char *line, const char *end, int field);
+int xref_field_equal(const char *field, const char *end, const char *str);
+int xref_section_used(const char *group, const char *group_end,
+					  const char *line, const char *line_end);
+double monotonic_seconds(void);
+int run_bench(assembler_ctx *ctx, const char *inst_table_dir,
+			  const char *input_dir, output_job jobs[], int jobs_length,
+			  int runs, bench_result *result);
+double bench_median(double samples[], int count);
+double bench_standard_error(double mad, int runs);
+int bench_double_compare(const void *a, const void *b);
+int bench_save(const char *dir, const bench_result *result);
+int bench_load(const char *dir, bench_result *result);
+int bench_compare(const bench_result *base, const bench_result *now,
+				  double threshold, output_buffer *report);
+int output_buffer_init(output_buffer *out, size_t capacity);
+int output_buffer_printf(output_buffer *out, const char *format, ...);
+void output_buffer_free(output_buffer *out);
+int write_all(int fd, struct iovec *iov, int iovcnt);
+int output_buffer_write(const output_buffer *out, const char *dir);
+int render_symbol_table(output_buffer *out, const symbol *symbol_table[],
+						int symbol_table_length);
+int render_literal_table(output_buffer *out, const literal *literal_table[],
+						 int literal_table_length);
+int render_objectcode(output_buffer *out, const object_code *obj_code);
+void *output_job_run(void *arg);
+int write_output_files(output_job jobs[], int jobs_length, int thread_flag);
+int write_tagged_output(output_job jobs[], int jobs_length);
+void init_decode_table(const inst *decode_table[], const inst *inst_table[],
+					   int inst_table_length);
+int pass2_range_error(pass2_state *st, const token_store *tokens, int i,
+					  const token *tok);
+int diag_vadd(diag_list *diags, name_id file, int line, int column,
+			  const char *format, va_list ap);
+void diag_truncate(char *message);
+int diag_add(diag_list *diags, name_id file, int line, int column,
+			 const char *format, ...);
+int diag_token(diag_list *diags, const token_store *tokens, int i, int column,
+			   const char *format, ...);
+int token_column(const token *tok, int field);
+int line_column(const char *line, int field);
+void diag_list_sort(diag_list *diags);
+int diag_compare(const void *a, const void *b);
+void diag_list_free(diag_list *diags);
+int render_diagnostics(output_buffer *out, const diag_list *diags,
+					   const char *source_name, int json);
+int output_buffer_json_string(output_buffer *out, const char *str);
+int assembler_disassemble(assembler_ctx *ctx, const char *objectcode,
+						  size_t objectcode_length, output_buffer *out);
+int hex_digit(char c);
+int hex_value(const char *str, int digits);
+int output_buffer_reserve(output_buffer *out, size_t size);
+char *put_hex(char *p, unsigned int value, int digits);
+int disasm_def_split(const char *record, int length, int limit,
+					 int name_lengths[]);
+int disasm_header(const char *line, int len, int *name_length, int *start,
+				  int *size);
+int disasm_name_intern(const char *str, int length, name_id *id);
+int disasm_collect_names(const char *data, size_t length, extref_set *names);
+int disasm_instruction(output_buffer *out, int addr, const unsigned char *code,
+					   int length, const inst *decode_table[]);
+int disasm_annotate(output_buffer *out, const modification_table *mod_table,
+					int start, int end);
+int refer_name_length(const char *record, int pos, int length,
+					  const extref_set *names);
+int disasm_refer_record(output_buffer *out, const char *record, int length,
+						const extref_set *names);
+int disasm_instruction_size(const unsigned char *code, int length,
+							const inst *decode_table[]);
+int disasm_code(output_buffer *out, int addr, const unsigned char *code,
+				int length, int final, const inst *decode_table[],
+				const modification_table *mod_table);
+int disasm_section(output_buffer *out, const char *lines, size_t length,
+				   const inst *decode_table[], const extref_set *names,
+				   modification_table *mod_table);
+int disassemble(output_buffer *out, const char *data, size_t length,
+				const inst *decode_table[]);
 
 #endif
@@ -0,0 +1,1106 @@
+/**
+ * @file differential.c
+ * @brief C 구현과 Java 구현(SP24_PRO1B)의 출력과 성능을 비교하는 차이 테스트
+ *
+ * @details
+ * 사용법: differential --differential 클래스경로 [프로그램 수] [라인 수] [--keep]
+ *
+ * 어셈블러 소스를 그대로 포함한다. "--differential"이 없으면 어셈블러의 main을
+ * 그대로 실행하므로, 비교할 때 이 실행 파일 자신을 C 어셈블러로 다시 실행한다.
+ * 작업 디렉터리에 inst_table.txt가 있어야 한다. 출력이 다른 프로그램의
+ * 디렉터리만 /tmp/sicxe_diff_* 아래에 남기며, "--keep"을 주면 모두 남긴다.
+ * 보고서는 stdout으로 출력하고, 출력이 다른 프로그램이 있으면 1로 끝난다.
+ */
+
+#define main assembler_main
+#include "../my_assembler_20211448.c"
+#undef main
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/** C와 Java 구현을 비교하는 --differential의 기본값 */
+#define DIFF_PROGRAMS 20     /** 생성할 프로그램 수 */
+#define DIFF_LINES 1000      /** 프로그램 하나의 본문 라인 수 */
+#define DIFF_MAX_LINES 4000  /** 본문 라인 수의 최댓값 (label이 MAX_TABLE_LENGTH 안) */
+#define DIFF_SECTIONS 3      /** 프로그램 하나의 control section 수 */
+#define DIFF_WINDOW 60       /** pc relative 범위를 넘지 않도록 참조하는 라인 거리 */
+#define DIFF_REPORT_LINES 4  /** 출력 파일마다 보여줄 다른 레코드 수 */
+#define DIFF_PATH_LENGTH 512 /** 작업 디렉터리 아래 파일 경로의 최대 길이 */
+
+/**
+ * @brief 차이 비교에서 구현 하나를 한 번 실행한 결과
+ */
+typedef struct _diff_run {
+	double seconds; /** 실행 시간 (초) */
+	long peak_kb;   /** 최대 메모리 사용량 (KB, 자식 프로세스의 ru_maxrss) */
+	int status;     /** 종료 코드 (신호로 끝났으면 -1) */
+} diff_run;
+
+int run_differential(const char *java_classpath, int programs, int lines,
+					 int keep, output_buffer *report);
+int diff_remove(const char *path);
+int diff_program(const char *work_dir, int program, const output_buffer *source,
+				 const output_buffer *inst_table, const char *self,
+				 const char *java_classpath, diff_run runs[2],
+				 output_buffer *report);
+unsigned int diff_random(unsigned int *state);
+int diff_generate(output_buffer *out, unsigned int seed, int lines);
+int diff_operand(output_buffer *out, unsigned int *state, const int labels[],
+				 int i, int start, int end);
+int diff_prepare(const char *dir, const output_buffer *source,
+				 const output_buffer *inst_table);
+int diff_exec(const char *dir, char *const argv[], diff_run *run);
+int diff_normalize(const char *dir, int output, output_buffer *out);
+int diff_normalize_symtab(const char *data, size_t length,
+						  const extref_set *sections, output_buffer *out);
+int diff_normalize_littab(const char *data, size_t length, output_buffer *out);
+int diff_normalize_objectcode(const char *data, size_t length,
+							  output_buffer *out);
+int diff_text_flush(output_buffer *out, const char *section, int addr,
+					const unsigned char *bytes, int length);
+int diff_split(const char *line, int len, const char *fields[],
+			   int lengths[], int max);
+int diff_symbol_section(const char *fields[], const int lengths[], int count,
+						const extref_set *sections, name_id *section);
+int diff_sections(const char *data, size_t length, extref_set *sections);
+int diff_sort_lines(output_buffer *out);
+int diff_line_compare(const void *a, const void *b);
+int diff_compare(const output_buffer *c, const output_buffer *java,
+				 const char *title, output_buffer *report);
+
+int main(int argc, char *argv[]) {
+	const char *java_classpath = NULL;
+	int programs = DIFF_PROGRAMS, lines = DIFF_LINES, keep = 0;
+	output_buffer out = {0};
+	int err;
+	
+	for(int i=1;i<argc;i++){
+		if(!strcmp(argv[i], "--differential")){
+			// Java 클래스 경로, 옵션이 아니면 프로그램 수와 라인 수
+			java_classpath = i+1 < argc ? argv[++i] : "";
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				programs = atoi(argv[++i]);
+			}
+			if(i+1 < argc && strncmp(argv[i+1], "--", 2)){
+				lines = atoi(argv[++i]);
+			}
+		}
+		else if(!strcmp(argv[i], "--keep")){
+			keep = 1;
+		}
+	}
+	// 비교하는 동안 C 어셈블러로 다시 실행된 경우
+	if(java_classpath==NULL)return assembler_main(argc, argv);
+	
+	if(programs <= 0 || lines < DIFF_SECTIONS * 10 || lines > DIFF_MAX_LINES){
+		fprintf(stderr, "--differential: 프로그램 수는 1 이상, 라인 수는 %d 이상 %d "
+						"이하여야 합니다.\n",
+				DIFF_SECTIONS * 10, DIFF_MAX_LINES);
+		return -1;
+	}
+	if((err = output_buffer_init(&out, 4096)) < 0 ||
+	   (err = run_differential(java_classpath, programs, lines, keep, &out)) < 0){
+		fprintf(stderr,
+				"run_differential: 비교 과정에서 실패했습니다. (error_code: %d)\n",
+				err);
+	}
+	else if(output_buffer_write(&out, NULL) < 0){
+		err = -1;
+	}
+	output_buffer_free(&out);
+	// 출력이 다른 프로그램이 있으면 1
+	return err < 0 ? -1 : err > 0;
+}
+
+/**
+ * @brief 생성한 프로그램들을 C 어셈블러와 Java 어셈블러로 각각 어셈블하여 출력과
+ * 성능을 비교한다.
+ *
+ * @param java_classpath Java 어셈블러의 클래스 경로 (Assembler.class가 있는 디렉터리)
+ * @param programs 생성할 프로그램 수
+ * @param lines 프로그램 하나의 본문 라인 수 (DIFF_MAX_LINES 이하)
+ * @param keep 0이 아니면 같은 프로그램의 디렉터리도 남김
+ * @param report 초기화된 출력 버퍼 주소 (비교 결과를 작성)
+ * @return 출력이 다르거나 실패한 프로그램 수 (비교하지 못한 경우 음수의 오류 코드)
+ *
+ * @details
+ * 임시 작업 디렉터리 아래에 프로그램마다 c, java 디렉터리를 만들어 같은
+ * input.txt와 현재 디렉터리의 inst_table.txt를 두고 각 구현을 그 디렉터리에서
+ * 실행한다. C 어셈블러는 지금 실행 중인 파일을 다시 실행한다. 출력이 같은
+ * 프로그램의 디렉터리는 바로 지우고, 다른 프로그램의 디렉터리만 남겨 입력과
+ * 출력, 실행 로그를 확인할 수 있게 한다. 남은 디렉터리가 없으면 작업 디렉터리도
+ * 지운다. `keep`이 0이 아니면 모두 남긴다. 끝에 구현별 처리량(lines/s)과 최대
+ * 메모리 사용량을 나란히 작성한다.
+ */
+int run_differential(const char *java_classpath, int programs, int lines,
+					 int keep, output_buffer *report) {
+	char work_dir[] = "/tmp/sicxe_diff_XXXXXX";
+	char self[DIFF_PATH_LENGTH], path[DIFF_PATH_LENGTH];
+	output_buffer source = {0}, inst_table = {0};
+	diff_run totals[2] = {{0, 0, 0}, {0, 0, 0}};
+	long total_lines[2] = {0, 0};
+	int divergent = 0, err;
+	
+	if((err = read_file("inst_table.txt", &inst_table.data, &inst_table.length)) < 0){
+		return err;
+	}
+	inst_table.capacity = inst_table.length + 1;
+	
+	// 자식 프로세스는 각자의 디렉터리에서 실행하므로 경로는 모두 절대 경로로 바꿈
+	ssize_t self_length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	char *classpath = realpath(java_classpath, NULL);
+	if(self_length < 0 || classpath==NULL || mkdtemp(work_dir)==NULL){
+		free(classpath);
+		output_buffer_free(&inst_table);
+		return -1;
+	}
+	self[self_length] = '\0';
+	
+	if((err = output_buffer_init(&source, lines * 32)) >= 0){
+		err = output_buffer_printf(report,
+								   "program\tlines\tC ms\tC KB\tJava ms\tJava KB\tresult\n");
+	}
+	for(int p=0;err>=0 && p<programs;p++){
+		diff_run runs[2];
+		
+		source.length = 0;
+		if((err = diff_generate(&source, p + 1, lines)) < 0)break;
+		int source_lines = 0;
+		for(size_t i=0;i<source.length;i++){
+			if(source.data[i]=='\n')source_lines++;
+		}
+		
+		if((err = output_buffer_printf(report, "%d\t%d\t", p + 1, source_lines)) < 0 ||
+		   (err = diff_program(work_dir, p + 1, &source, &inst_table, self, classpath,
+							   runs, report)) < 0)break;
+		divergent += err;
+		
+		// 출력이 같으면 더 볼 것이 없으므로 지움
+		snprintf(path, sizeof(path), "%s/p%03d", work_dir, p + 1);
+		if(err==0 && !keep && (err = diff_remove(path)) < 0)break;
+		
+		// 처리량은 정상 종료한 실행만으로 계산
+		for(int k=0;k<2;k++){
+			if(runs[k].status!=0)continue;
+			total_lines[k] += source_lines;
+			totals[k].seconds += runs[k].seconds;
+			if(runs[k].peak_kb > totals[k].peak_kb)totals[k].peak_kb = runs[k].peak_kb;
+		}
+	}
+	
+	if(err >= 0){
+		err = output_buffer_printf(report,
+								   "\nimpl\tlines/s\tpeak KB\n"
+								   "C\t%.0f\t%ld\nJava\t%.0f\t%ld\n"
+								   "\n다른 프로그램: %d / %d\n",
+								   totals[0].seconds > 0 ? total_lines[0] / totals[0].seconds : 0.0,
+								   totals[0].peak_kb,
+								   totals[1].seconds > 0 ? total_lines[1] / totals[1].seconds : 0.0,
+								   totals[1].peak_kb, divergent, programs);
+	}
+	if(err >= 0 && (keep || divergent > 0)){
+		err = output_buffer_printf(report, "작업 디렉터리: %s\n", work_dir);
+	}
+	else if(err >= 0 && rmdir(work_dir) < 0){
+		err = -1;
+	}
+	
+	free(classpath);
+	output_buffer_free(&source);
+	output_buffer_free(&inst_table);
+	return err < 0 ? err : divergent;
+}
+
+/**
+ * @brief 프로그램 하나의 디렉터리를 안의 파일과 함께 지운다.
+ *
+ * @param path 지울 디렉터리 경로
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 프로그램 디렉터리 아래의 구현별 디렉터리는 같은 방법으로 먼저 지운다. 실행
+ * 중에 Java가 만든 다른 파일이 있어도 함께 지운다.
+ */
+int diff_remove(const char *path) {
+	DIR *dir = opendir(path);
+	struct dirent *entry;
+	char child[DIFF_PATH_LENGTH];
+	int err = 0;
+	
+	if(dir==NULL)return -1;
+	while(err==0 && (entry = readdir(dir))!=NULL){
+		if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))continue;
+		if(snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >=
+		   (int)sizeof(child)){
+			err = -1;
+		}
+		else if(unlink(child) < 0){
+			// 구현별 디렉터리는 안의 파일부터 지움
+			err = (errno==EISDIR || errno==EPERM) ? diff_remove(child) : -1;
+		}
+	}
+	closedir(dir);
+	if(err==0 && rmdir(path) < 0)err = -1;
+	return err;
+}
+
+/**
+ * @brief 생성한 프로그램 하나를 두 구현으로 어셈블하고 출력을 비교하여 보고서에
+ * 한 줄을 작성한다.
+ *
+ * @param work_dir 작업 디렉터리 경로
+ * @param program 프로그램 번호
+ * @param source 생성한 소스코드
+ * @param inst_table 기계어 목록 파일의 내용
+ * @param self C 어셈블러 실행 파일의 절대 경로
+ * @param java_classpath Java 어셈블러의 절대 클래스 경로
+ * @param runs 구현별(C, Java) 실행 결과를 저장할 배열
+ * @param report 출력 버퍼 주소
+ * @return 출력이 같으면 0, 다르거나 실패한 구현이 있으면 1 (오류 코드는 음수)
+ *
+ * @details
+ * Java 어셈블러는 소스코드에 오류가 있어도 "Error : "만 출력하고 정상
+ * 종료하므로, 종료 코드와 함께 실행 로그의 내용도 확인한다. 출력 파일이 없거나
+ * 형식이 맞지 않는 것도 그 구현의 실패로 본다.
+ */
+int diff_program(const char *work_dir, int program, const output_buffer *source,
+				 const output_buffer *inst_table, const char *self,
+				 const char *java_classpath, diff_run runs[2],
+				 output_buffer *report) {
+	static const char *impls[2] = {"c", "java"};
+	static const char *titles[3] = {"symtab", "littab", "objectcode"};
+	char dirs[2][DIFF_PATH_LENGTH], path[DIFF_PATH_LENGTH];
+	char *argvs[2][5] = {
+		{(char*)self, NULL},
+		{"java", "-cp", (char*)java_classpath, "Assembler", NULL},
+	};
+	output_buffer records[2] = {{0}}, details = {0};
+	int failed[2] = {0, 0}, differ = 0, err;
+	
+	snprintf(path, sizeof(path), "%s/p%03d", work_dir, program);
+	if(mkdir(path, 0755) < 0 && errno!=EEXIST)return -1;
+	
+	for(int k=0;k<2;k++){
+		char *log = NULL;
+		size_t log_length;
+		
+		if(snprintf(dirs[k], sizeof(dirs[k]), "%s/%s", path, impls[k]) >=
+		   (int)sizeof(dirs[k]))return -1;
+		if((err = diff_prepare(dirs[k], source, inst_table)) < 0)return err;
+		
+		if(diff_exec(dirs[k], argvs[k], &runs[k]) < 0){
+			runs[k].seconds = 0;
+			runs[k].peak_kb = 0;
+			runs[k].status = -1;
+		}
+		failed[k] = runs[k].status!=0;
+		
+		char log_dir[DIFF_PATH_LENGTH + 8];
+		snprintf(log_dir, sizeof(log_dir), "%s/log.txt", dirs[k]);
+		if(!failed[k] && read_file(log_dir, &log, &log_length)==0 &&
+		   strstr(log, "Error")!=NULL)failed[k] = 1;
+		free(log);
+	}
+	
+	err = output_buffer_init(&details, 256);
+	for(int o=0;err>=0 && o<3 && !failed[0] && !failed[1];o++){
+		for(int k=0;k<2;k++){
+			records[k].length = 0;
+			if((err = diff_normalize(dirs[k], o, &records[k])) == -1){
+				// 출력 파일을 읽을 수 없는 구현은 실패로 처리
+				failed[k] = 1;
+				err = 0;
+			}
+			else if(err < 0)break;
+		}
+		if(err < 0 || failed[0] || failed[1])break;
+		
+		if((err = diff_compare(&records[0], &records[1], titles[o], &details)) > 0){
+			differ = 1;
+		}
+	}
+	
+	if(err >= 0){
+		err = output_buffer_printf(report, "%.1f\t%ld\t%.1f\t%ld\t%s\n",
+								   runs[0].seconds * 1000, runs[0].peak_kb,
+								   runs[1].seconds * 1000, runs[1].peak_kb,
+								   failed[0] ? "C 실패" : failed[1] ? "Java 실패"
+								   : differ ? "다름" : "같음");
+	}
+	for(int k=0;err>=0 && k<2;k++){
+		if(failed[k])err = output_buffer_printf(report, "  로그: %s/log.txt\n", dirs[k]);
+	}
+	if(err >= 0 && details.length > 0){
+		err = output_buffer_printf(report, "%s", details.data);
+	}
+	
+	output_buffer_free(&records[0]);
+	output_buffer_free(&records[1]);
+	output_buffer_free(&details);
+	if(err < 0)return err;
+	return failed[0] || failed[1] || differ;
+}
+
+/**
+ * @brief 비교용 프로그램을 생성하는 의사 난수를 구한다. (xorshift)
+ *
+ * @param state 난수 상태 변수 주소 (0이 아니어야 함)
+ * @return 다음 난수
+ */
+unsigned int diff_random(unsigned int *state) {
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/**
+ * @brief 두 구현이 모두 지원하는 문법만으로 비교용 SIC/XE 프로그램을 생성한다.
+ *
+ * @param out 출력 버퍼 주소 (뒤에 이어서 작성)
+ * @param seed 난수의 시드 (같은 시드는 같은 프로그램)
+ * @param lines 본문 라인 수
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 본문을 DIFF_SECTIONS개의 control section으로 나누고, section마다 EXTDEF한
+ * 버퍼를 다른 section에서 EXTREF하여 4형식과 WORD의 수식에서 사용한다. 심볼은
+ * DIFF_WINDOW 라인 안의 label만 참조하고, LTORG를 50라인마다 두고 리터럴도
+ * LTORG 구간마다 새로 만들어 pc relative 범위를 넘지 않게 한다. Java 구현에
+ * 맞추어 WORD는 외부 심볼의 차이만, 4형식은 외부 심볼만 사용하고, RSUB는 빈
+ * operand 뒤에 주석을 붙인다.
+ */
+int diff_generate(output_buffer *out, unsigned int seed, int lines) {
+	static const char *sections[DIFF_SECTIONS] = {"MAIN", "SUBA", "SUBB"};
+	static const char *format3[] = {
+		"LDA", "STA", "LDX", "STX", "LDT", "COMP", "LDCH", "STCH", "STL",
+		"LDL", "J", "JEQ", "JLT", "JGT", "JSUB", "TD", "RD", "WD",
+	};
+	static const char *registers[] = {"A", "X", "S", "T"};
+	unsigned int state = seed * 2654435761u + 1;
+	int err = 0;
+	
+	int *labels = (int*)malloc(lines * sizeof(int));
+	if(labels==NULL)return -2;
+	for(int i=0;i<lines;i++){
+		labels[i] = diff_random(&state) % 5 < 2 ? i : -1;
+	}
+	
+	for(int s=0;err>=0 && s<DIFF_SECTIONS;s++){
+		int start = lines * s / DIFF_SECTIONS, end = lines * (s + 1) / DIFF_SECTIONS;
+		
+		// section의 첫 라인은 항상 label이 있어 참조할 label을 항상 찾을 수 있음
+		labels[start] = start;
+		if(s==0)err = output_buffer_printf(out, "%s\tSTART\t0\n", sections[s]);
+		else err = output_buffer_printf(out, "%s\tCSECT\n", sections[s]);
+		if(err>=0)err = output_buffer_printf(out, "\tEXTDEF\tE%dA,E%dB\n\tEXTREF\t", s, s);
+		for(int k=0, first=1;err>=0 && k<DIFF_SECTIONS;k++){
+			if(k==s)continue;
+			if(s==0)err = output_buffer_printf(out, first ? "%s" : ",%s", sections[k]);
+			if(err>=0)err = output_buffer_printf(out, first && s!=0 ? "E%dA,E%dB" : ",E%dA,E%dB", k, k);
+			first = 0;
+		}
+		if(err>=0)err = output_buffer_printf(out, "\n");
+		
+		for(int i=start;err>=0 && i<end;i++){
+			unsigned int kind = diff_random(&state) % 100;
+			int other = (s + 1 + diff_random(&state) % (DIFF_SECTIONS - 1)) % DIFF_SECTIONS;
+			
+			if(i > start && (i - start) % 50 == 0){
+				if((err = output_buffer_printf(out, "\tLTORG\n")) < 0)break;
+			}
+			// 주석 라인은 본문 라인 앞에 덧붙임
+			if(kind >= 72 && kind < 75){
+				if((err = output_buffer_printf(out, ".\tGENERATED LINE %d\n", i)) < 0)break;
+				kind = diff_random(&state) % 30;
+			}
+			if(labels[i] >= 0 && (err = output_buffer_printf(out, "L%04d", i)) < 0)break;
+			
+			if(kind < 30){
+				err = output_buffer_printf(out, "\t%s\t",
+										   format3[diff_random(&state) % (sizeof(format3) / sizeof(format3[0]))]);
+				if(err>=0)err = diff_operand(out, &state, labels, i, start, end);
+			}
+			else if(kind < 38){
+				static const char *indexed[] = {"LDA", "LDCH", "STCH"};
+				err = output_buffer_printf(out, "\t%s\t", indexed[diff_random(&state) % 3]);
+				if(err>=0)err = diff_operand(out, &state, labels, i, start, end);
+				if(err>=0)err = output_buffer_printf(out, ",X");
+			}
+			else if(kind < 46){
+				static const char *immediate[] = {"LDA", "LDT", "LDX", "COMP"};
+				err = output_buffer_printf(out, "\t%s\t#%u", immediate[diff_random(&state) % 4],
+										   diff_random(&state) % 4096);
+			}
+			else if(kind < 50){
+				err = output_buffer_printf(out, "\t%s\t@", kind % 2 ? "J" : "LDA");
+				if(err>=0)err = diff_operand(out, &state, labels, i, start, end);
+			}
+			else if(kind < 58){
+				// 같은 리터럴은 section에 한 번만 배치되므로 LTORG 구간마다 다른 리터럴을
+				// 사용 (X는 0x40 미만이라 C의 바이트와 겹치지 않음)
+				static const char *literal_ops[] = {"LDA", "TD", "LDCH", "COMP"};
+				int block = (i - start) / 50;
+				err = output_buffer_printf(out, "\t%s\t", literal_ops[diff_random(&state) % 4]);
+				if(err>=0 && kind % 2)err = output_buffer_printf(out, "=X'%02X'", (block * 2 + kind % 4 / 2) % 64);
+				else if(err>=0)err = output_buffer_printf(out, "=C'%c%c'", 'A' + block % 26, 'A' + block / 26 % 26);
+			}
+			else if(kind < 66){
+				const char *r1 = registers[diff_random(&state) % 4];
+				const char *r2 = registers[diff_random(&state) % 4];
+				if(kind % 3==0)err = output_buffer_printf(out, "\tCLEAR\t%s", r1);
+				else if(kind % 3==1)err = output_buffer_printf(out, "\tCOMPR\t%s,%s", r1, r2);
+				else err = output_buffer_printf(out, "\tTIXR\t%s", r1);
+			}
+			else if(kind < 70){
+				if(s==0 && kind % 2)err = output_buffer_printf(out, "\t+JSUB\t%s", sections[other]);
+				else if(kind % 2)err = output_buffer_printf(out, "\t+STCH\tE%dB,X", other);
+				else err = output_buffer_printf(out, "\t+LDA\tE%dA", other);
+			}
+			else if(kind < 75){
+				err = output_buffer_printf(out, "\tRSUB\t\tRETURN");
+			}
+			else if(kind < 83){
+				err = output_buffer_printf(out, "\tBYTE\tX'%02X'", diff_random(&state) % 256);
+			}
+			else if(kind < 90){
+				err = output_buffer_printf(out, "\tBYTE\tC'%c%c'", 'A' + diff_random(&state) % 26,
+										   'A' + diff_random(&state) % 26);
+			}
+			else if(kind < 95){
+				err = output_buffer_printf(out, "\tRESW\t%u", 1 + diff_random(&state) % 2);
+			}
+			else {
+				err = output_buffer_printf(out, "\tRESB\t%u", 1 + diff_random(&state) % 6);
+			}
+			if(err>=0)err = output_buffer_printf(out, "\n");
+		}
+		
+		// 다른 section에서 사용하는 버퍼와 외부 심볼의 차이
+		if(err>=0)err = output_buffer_printf(out, "E%dA\tRESB\t16\nE%dB\tEQU\t*\n"
+												  "E%dL\tEQU\tE%dB-E%dA\n", s, s, s, s, s);
+		for(int k=0;err>=0 && k<DIFF_SECTIONS;k++){
+			if(k!=s)err = output_buffer_printf(out, "\tWORD\tE%dB-E%dA\n", k, k);
+		}
+	}
+	if(err>=0)err = output_buffer_printf(out, "\tEND\tL0000\n");
+	
+	free(labels);
+	return err;
+}
+
+/**
+ * @brief 생성하는 라인에서 참조할 label을 고른다.
+ *
+ * @param out 출력 버퍼 주소 (label 이름을 작성)
+ * @param state 난수 상태 변수 주소
+ * @param labels 라인마다 label 번호 (없으면 -1)
+ * @param i 현재 라인
+ * @param start 현재 control section의 첫 라인
+ * @param end 현재 control section의 끝 라인 (포함하지 않음)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * DIFF_WINDOW 안에서 임의의 라인을 고르고, 그 라인부터 앞쪽, 다음으로 뒤쪽으로
+ * label을 찾는다. 없으면 control section의 첫 라인을 참조한다.
+ */
+int diff_operand(output_buffer *out, unsigned int *state, const int labels[],
+				 int i, int start, int end) {
+	int lo = i - DIFF_WINDOW < start ? start : i - DIFF_WINDOW;
+	int hi = i + DIFF_WINDOW >= end ? end - 1 : i + DIFF_WINDOW;
+	int pick = lo + diff_random(state) % (hi - lo + 1), k = pick;
+	
+	while(k > lo && labels[k] < 0)k--;
+	if(labels[k] < 0){
+		k = pick;
+		while(k < hi && labels[k] < 0)k++;
+	}
+	if(labels[k] < 0)k = start;
+	return output_buffer_printf(out, "L%04d", labels[k]);
+}
+
+/**
+ * @brief 구현 하나를 실행할 디렉터리를 만들고 입력 파일을 둔다.
+ *
+ * @param dir 만들 디렉터리 경로
+ * @param source input.txt로 쓸 소스코드
+ * @param inst_table inst_table.txt로 쓸 기계어 목록
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int diff_prepare(const char *dir, const output_buffer *source,
+				 const output_buffer *inst_table) {
+	char path[DIFF_PATH_LENGTH];
+	int err;
+	
+	if(mkdir(dir, 0755) < 0 && errno!=EEXIST)return -1;
+	snprintf(path, sizeof(path), "%s/input.txt", dir);
+	if((err = output_buffer_write(source, path)) < 0)return err;
+	snprintf(path, sizeof(path), "%s/inst_table.txt", dir);
+	return output_buffer_write(inst_table, path);
+}
+
+/**
+ * @brief 디렉터리에서 프로그램을 실행하고 끝날 때까지 기다린다.
+ *
+ * @param dir 실행할 디렉터리 (stdout과 stderr는 이 디렉터리의 log.txt로 보냄)
+ * @param argv 실행할 프로그램과 인자 (NULL로 끝남, PATH에서 찾음)
+ * @param run 실행 시간, 최대 메모리 사용량, 종료 코드를 저장할 변수 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 최대 메모리 사용량은 wait4가 돌려주는 자식 프로세스의 ru_maxrss이다.
+ * 프로그램을 실행할 수 없으면 종료 코드는 127이다.
+ */
+int diff_exec(const char *dir, char *const argv[], diff_run *run) {
+	struct timespec begin, end;
+	struct rusage usage;
+	int status;
+	
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	pid_t pid = fork();
+	if(pid < 0)return -1;
+	if(pid==0){
+		int fd;
+		if(chdir(dir) < 0 ||
+		   (fd = open("log.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)_exit(127);
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+		execvp(argv[0], argv);
+		fprintf(stderr, "%s: 실행할 수 없습니다. (%s)\n", argv[0], strerror(errno));
+		_exit(127);
+	}
+	
+	while(wait4(pid, &status, 0, &usage) < 0){
+		if(errno!=EINTR)return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	run->seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+	run->peak_kb = usage.ru_maxrss;
+	run->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	return 0;
+}
+
+/**
+ * @brief 구현 하나의 출력 파일을 비교할 수 있는 레코드로 바꾼다.
+ *
+ * @param dir 출력 파일이 있는 디렉터리
+ * @param output 출력 종류 (ASSEMBLER_OUTPUT_SYMTAB, LITTAB, OBJECTCODE 중 하나)
+ * @param out 출력 버퍼 주소 (정렬한 레코드를 한 줄씩 작성)
+ * @return 오류 코드 (정상 종료 = 0, 파일이 없거나 형식이 맞지 않으면 -1)
+ *
+ * @details
+ * 심볼 테이블은 control section을 알아야 하므로 오브젝트 코드의 Header
+ * Record도 함께 읽는다.
+ */
+int diff_normalize(const char *dir, int output, output_buffer *out) {
+	static const char *files[3] = {
+		"output_symtab.txt", "output_littab.txt", "output_objectcode.txt",
+	};
+	char path[DIFF_PATH_LENGTH];
+	char *data = NULL, *object = NULL;
+	size_t length, object_length;
+	extref_set sections = {0};
+	int err;
+	
+	snprintf(path, sizeof(path), "%s/%s", dir, files[output]);
+	if((err = read_file(path, &data, &length)) < 0)return err;
+	if(out->capacity==0 && (err = output_buffer_init(out, length + 64)) < 0){
+		free(data);
+		return err;
+	}
+	
+	if(output==ASSEMBLER_OUTPUT_SYMTAB){
+		snprintf(path, sizeof(path), "%s/%s", dir, files[ASSEMBLER_OUTPUT_OBJECTCODE]);
+		if((err = read_file(path, &object, &object_length)) >= 0 &&
+		   (err = diff_sections(object, object_length, &sections)) >= 0){
+			err = diff_normalize_symtab(data, length, &sections, out);
+		}
+	}
+	else if(output==ASSEMBLER_OUTPUT_LITTAB){
+		err = diff_normalize_littab(data, length, out);
+	}
+	else err = diff_normalize_objectcode(data, length, out);
+	
+	if(err >= 0)err = diff_sort_lines(out);
+	
+	extref_set_free(&sections);
+	free(object);
+	free(data);
+	return err;
+}
+
+/**
+ * @brief 한 라인을 '\t'로 나눈다.
+ *
+ * @param line 라인
+ * @param len 라인의 길이 ('\n' 제외)
+ * @param fields 필드의 시작 위치를 저장할 배열
+ * @param lengths 필드의 길이를 저장할 배열
+ * @param max 배열의 크기 (넘는 필드는 마지막 필드에 포함)
+ * @return 필드 수
+ */
+int diff_split(const char *line, int len, const char *fields[],
+			   int lengths[], int max) {
+	int count = 0, pos = 0;
+	
+	while(count < max){
+		const char *tab = count < max - 1 ? memchr(line + pos, '\t', len - pos) : NULL;
+		int n = tab ? tab - (line + pos) : len - pos;
+		fields[count] = line + pos;
+		lengths[count++] = n;
+		if(tab==NULL)break;
+		pos += n + 1;
+	}
+	return count;
+}
+
+/**
+ * @brief 심볼 테이블 라인 하나가 속한 control section을 구한다.
+ *
+ * @param fields 라인의 필드 (이름, 주소, section 표시)
+ * @param lengths 필드의 길이
+ * @param count 필드 수
+ * @param sections control section 이름의 집합
+ * @param section section의 이름을 저장할 변수 주소 (알 수 없으면 NAME_NONE)
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * C 구현은 " +1 SECTION", Java 구현은 "+ SECTION"으로 relative 심볼의
+ * section을 표시하므로 세 번째 필드의 마지막 단어를 section으로 본다. 표시가
+ * 없는 라인은 control section 이름 자신만 알 수 있다.
+ */
+int diff_symbol_section(const char *fields[], const int lengths[], int count,
+						const extref_set *sections, name_id *section) {
+	name_id id;
+	int err;
+	
+	*section = NAME_NONE;
+	if(count >= 3 && lengths[2] > 0){
+		int n = lengths[2];
+		while(n > 0 && fields[2][n-1]==' ')n--;
+		int k = n;
+		while(k > 0 && fields[2][k-1]!=' ')k--;
+		return disasm_name_intern(fields[2] + k, n - k, section);
+	}
+	if((err = disasm_name_intern(fields[0], lengths[0], &id)) < 0)return err;
+	if(extref_set_contains(sections, id))*section = id;
+	return 0;
+}
+
+/**
+ * @brief 심볼 테이블을 "section\t이름\t주소" 레코드로 바꾼다.
+ *
+ * @param data 심볼 테이블 파일의 내용
+ * @param length 파일의 바이트 수
+ * @param sections control section 이름의 집합
+ * @param out 출력 버퍼 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 외부 심볼(REF) 라인과 절대/상대의 구분은 비교하지 않는다. 빈 줄로 나뉜
+ * 블록 안에서 section 표시가 없는 라인은 바로 앞에서 알게 된 section, 아직
+ * 없으면 블록에서 처음 알게 되는 section에 속한 것으로 본다. C 구현은 블록
+ * 하나에 section 순서대로, Java 구현은 section마다 블록 하나에 해시 순서로
+ * 출력한다.
+ */
+int diff_normalize_symtab(const char *data, size_t length,
+						  const extref_set *sections, output_buffer *out) {
+	const char *fields[3];
+	int lengths[3];
+	size_t pos = 0;
+	int err = 0;
+	
+	while(err>=0 && pos < length){
+		name_id current = NAME_NONE, section;
+		size_t block_end = pos;
+		
+		// 블록의 끝과 처음 알 수 있는 section을 먼저 찾음
+		while(err>=0 && block_end < length){
+			const char *line = data + block_end;
+			const char *end = memchr(line, '\n', length - block_end);
+			int len = end ? end - line : (int)(length - block_end);
+			if(len > 0 && line[len-1]=='\r')len--;
+			if(len==0)break;
+			block_end += (end ? end - line : len) + 1;
+			if(current==NAME_NONE){
+				int count = diff_split(line, len, fields, lengths, 3);
+				err = diff_symbol_section(fields, lengths, count, sections, &current);
+			}
+		}
+		
+		while(err>=0 && pos < block_end){
+			const char *line = data + pos;
+			const char *end = memchr(line, '\n', length - pos);
+			int len = end ? end - line : (int)(length - pos);
+			pos += len + 1;
+			if(len > 0 && line[len-1]=='\r')len--;
+			
+			int count = diff_split(line, len, fields, lengths, 3);
+			if(count < 2)return -1;
+			if(lengths[1]==3 && !memcmp(fields[1], "REF", 3))continue;
+			if((err = diff_symbol_section(fields, lengths, count, sections, &section)) < 0)break;
+			if(section!=NAME_NONE)current = section;
+			
+			const char *p = fields[1];
+			int n = lengths[1], addr = 0;
+			if(n > 2 && p[0]=='0' && (p[1]=='x' || p[1]=='X')){
+				p += 2;
+				n -= 2;
+			}
+			if(n==0 || n > 7)return -1;
+			for(int k=0;k<n;k++){
+				int d = hex_digit(p[k]);
+				if(d < 0)return -1;
+				addr = (addr << 4) | d;
+			}
+			err = output_buffer_printf(out, "%s\t%.*s\t%X\n",
+									   current!=NAME_NONE ? name_str(current) : "-",
+									   lengths[0], fields[0], addr);
+		}
+		
+		// 블록 사이의 빈 줄
+		while(pos < length && (data[pos]=='\n' || data[pos]=='\r'))pos++;
+	}
+	return err;
+}
+
+/**
+ * @brief 리터럴 테이블을 "리터럴\t주소" 레코드로 바꾼다.
+ *
+ * @param data 리터럴 테이블 파일의 내용
+ * @param length 파일의 바이트 수
+ * @param out 출력 버퍼 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * 리터럴 뒤의 첫 번째 비어 있지 않은 필드를 주소로 보고, C 구현이 덧붙이는
+ * 공유하는 리터럴 표시는 비교하지 않는다.
+ */
+int diff_normalize_littab(const char *data, size_t length, output_buffer *out) {
+	const char *fields[4];
+	int lengths[4];
+	size_t pos = 0;
+	int err = 0;
+	
+	while(err>=0 && pos < length){
+		const char *line = data + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		if(len > 0 && line[len-1]=='\r')len--;
+		if(len==0)continue;
+		
+		int count = diff_split(line, len, fields, lengths, 4), k = 1;
+		while(k < count && lengths[k]==0)k++;
+		if(k==count || lengths[k] > 7)return -1;
+		
+		int addr = hex_value(fields[k], lengths[k]);
+		if(addr < 0)return -1;
+		err = output_buffer_printf(out, "%.*s\t%X\n", lengths[0], fields[0], addr);
+	}
+	return err;
+}
+
+/**
+ * @brief 오브젝트 코드를 "section\t레코드 종류\t..." 레코드로 바꾼다.
+ *
+ * @param data 오브젝트 코드 파일의 내용
+ * @param length 파일의 바이트 수
+ * @param out 출력 버퍼 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ *
+ * @details
+ * Define Record와 Refer Record는 이름마다, Modification Record는 레코드마다
+ * 하나로 나눈다. Text Record는 나누는 위치가 구현마다 다르므로 바이트를 이어
+ * 붙인 뒤 주소가 끊기는 곳과 16바이트 경계에서 다시 나눈다. 16진수는 대문자로
+ * 바꾼다.
+ */
+int diff_normalize_objectcode(const char *data, size_t length,
+							  output_buffer *out) {
+	char section[MAX_LINE_LENGTH] = "-";
+	int name_lengths[MAX_LINE_LENGTH];
+	unsigned char text[16];
+	int text_addr = 0, text_length = 0, size = 0xFFFFFF;
+	extref_set names = {0};
+	size_t pos = 0;
+	int err;
+	
+	// Refer Record는 control section 이름도 공백 없이 이어 붙일 수 있음
+	if((err = disasm_collect_names(data, length, &names)) >= 0){
+		err = diff_sections(data, length, &names);
+	}
+	
+	while(err>=0 && pos < length){
+		const char *line = data + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		if(len > 0 && line[len-1]=='\r')len--;
+		while(len > 0 && line[len-1]==' ' && line[0]!='R')len--;
+		if(len==0)continue;
+		if(len >= MAX_LINE_LENGTH){
+			err = -1;
+			break;
+		}
+		
+		if(line[0]!='T' && text_length > 0){
+			err = diff_text_flush(out, section, text_addr, text, text_length);
+			text_length = 0;
+			if(err < 0)break;
+		}
+		
+		if(line[0]=='H'){
+			int name_length, start;
+			if(disasm_header(line, len, &name_length, &start, &size) < 0){
+				err = -1;
+				break;
+			}
+			memcpy(section, line + 1, name_length);
+			section[name_length] = '\0';
+			err = output_buffer_printf(out, "%s\tH\t%06X\t%06X\n", section, start, size);
+		}
+		else if(line[0]=='D'){
+			int count = disasm_def_split(line + 1, len - 1, size, name_lengths);
+			const char *p = line + 1;
+			if(count < 0)err = -1;
+			for(int i=0;err>=0 && i<count;i++){
+				// C 구현은 이름을 6자리로 맞추므로 뒤의 공백은 비교하지 않음
+				int n = name_lengths[i];
+				while(n > 0 && p[n-1]==' ')n--;
+				err = output_buffer_printf(out, "%s\tD\t%.*s\t%06X\n", section,
+										   n, p, hex_value(p + name_lengths[i], 6));
+				p += name_lengths[i] + 6;
+			}
+		}
+		else if(line[0]=='R'){
+			for(int p=1;err>=0 && p<len;){
+				if(line[p]==' '){
+					p++;
+					continue;
+				}
+				int n = refer_name_length(line + 1, p - 1, len - 1, &names);
+				err = output_buffer_printf(out, "%s\tR\t%.*s\n", section, n, line + p);
+				p += n;
+			}
+		}
+		else if(line[0]=='T'){
+			int addr = len >= 9 ? hex_value(line + 1, 6) : -1;
+			int count = len >= 9 ? hex_value(line + 7, 2) : -1;
+			if(addr < 0 || count < 0 || len < 9 + count * 2){
+				err = -1;
+				break;
+			}
+			for(int i=0;err>=0 && i<count;i++){
+				int byte = hex_value(line + 9 + i * 2, 2);
+				if(byte < 0){
+					err = -1;
+					break;
+				}
+				// 주소가 끊기거나 16바이트 경계면 새 레코드
+				if(text_length > 0 && (addr + i != text_addr + text_length ||
+									   (addr + i) % 16==0)){
+					err = diff_text_flush(out, section, text_addr, text, text_length);
+					text_length = 0;
+				}
+				if(text_length==0)text_addr = addr + i;
+				text[text_length++] = byte;
+			}
+		}
+		else if(line[0]=='M'){
+			int addr = len >= 9 ? hex_value(line + 1, 6) : -1;
+			int half = len >= 9 ? hex_value(line + 7, 2) : -1;
+			if(addr < 0 || half < 0){
+				err = -1;
+				break;
+			}
+			int skip = len > 9 && (line[9]=='+' || line[9]=='-') ? 10 : 9;
+			err = output_buffer_printf(out, "%s\tM\t%06X\t%02X\t%c%.*s\n", section,
+									   addr, half, skip==10 ? line[9] : '+',
+									   len - skip, line + skip);
+		}
+		else if(line[0]=='E'){
+			int addr = len >= 7 ? hex_value(line + 1, 6) : -1;
+			if(len > 1 && addr < 0)err = -1;
+			else if(len > 1)err = output_buffer_printf(out, "%s\tE\t%06X\n", section, addr);
+			else err = output_buffer_printf(out, "%s\tE\t-\n", section);
+		}
+		else err = -1;
+	}
+	if(err>=0 && text_length > 0){
+		err = diff_text_flush(out, section, text_addr, text, text_length);
+	}
+	
+	extref_set_free(&names);
+	return err;
+}
+
+/**
+ * @brief 이어 붙인 Text Record의 바이트를 레코드 하나로 작성한다.
+ *
+ * @param out 출력 버퍼 주소
+ * @param section control section 이름
+ * @param addr 첫 바이트의 주소
+ * @param bytes 바이트 배열
+ * @param length 바이트 수 (16 이하)
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int diff_text_flush(output_buffer *out, const char *section, int addr,
+					const unsigned char *bytes, int length) {
+	char hex[33];
+	
+	for(int i=0;i<length;i++){
+		put_hex(hex + i * 2, bytes[i], 2);
+	}
+	hex[length * 2] = '\0';
+	return output_buffer_printf(out, "%s\tT\t%06X\t%s\n", section, addr, hex);
+}
+
+/**
+ * @brief 오브젝트 코드의 Header Record에서 control section 이름을 모은다.
+ *
+ * @param data 오브젝트 코드 파일의 내용
+ * @param length 파일의 바이트 수
+ * @param sections 이름을 추가할 집합 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int diff_sections(const char *data, size_t length, extref_set *sections) {
+	size_t pos = 0;
+	name_id id;
+	int err;
+	
+	while(pos < length){
+		const char *line = data + pos;
+		const char *end = memchr(line, '\n', length - pos);
+		int len = end ? end - line : (int)(length - pos);
+		pos += len + 1;
+		
+		if(len > 0 && line[0]=='H'){
+			int name_length, start, size;
+			if(disasm_header(line, len, &name_length, &start, &size) < 0)return -1;
+			if((err = disasm_name_intern(line + 1, name_length, &id)) < 0)return err;
+			if((err = extref_set_add(sections, id)) < 0)return err;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief 출력 버퍼의 라인들을 사전 순으로 정렬한다.
+ *
+ * @param out 모든 라인이 '\n'으로 끝나는 출력 버퍼 주소
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+int diff_sort_lines(output_buffer *out) {
+	int count = 0;
+	
+	for(size_t i=0;i<out->length;i++){
+		if(out->data[i]=='\n')count++;
+	}
+	if(count < 2)return 0;
+	
+	char **lines = (char**)malloc(count * sizeof(char*));
+	char *data = (char*)malloc(out->capacity);
+	if(lines==NULL || data==NULL){
+		free(lines);
+		free(data);
+		return -2;
+	}
+	
+	// '\n'을 '\0'으로 바꾸어 라인마다 문자열로 비교
+	count = 0;
+	for(size_t i=0, start=0;i<out->length;i++){
+		if(out->data[i]!='\n')continue;
+		out->data[i] = '\0';
+		lines[count++] = out->data + start;
+		start = i + 1;
+	}
+	qsort(lines, count, sizeof(char*), diff_line_compare);
+	
+	size_t length = 0;
+	for(int i=0;i<count;i++){
+		size_t n = strlen(lines[i]);
+		memcpy(data + length, lines[i], n);
+		length += n;
+		data[length++] = '\n';
+	}
+	data[length] = '\0';
+	
+	free(out->data);
+	free(lines);
+	out->data = data;
+	return 0;
+}
+
+/**
+ * @brief qsort에 사용할 라인 비교 함수
+ *
+ * @param a 첫 번째 라인 포인터의 주소
+ * @param b 두 번째 라인 포인터의 주소
+ * @return strcmp와 같음
+ */
+int diff_line_compare(const void *a, const void *b) {
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief 정렬한 두 레코드 목록을 비교하여 다른 레코드를 보고서에 작성한다.
+ *
+ * @param c C 구현의 정렬한 레코드
+ * @param java Java 구현의 정렬한 레코드
+ * @param title 출력 파일의 이름
+ * @param report 출력 버퍼 주소
+ * @return 한쪽에만 있는 레코드 수 (오류 코드는 음수)
+ *
+ * @details
+ * 다른 레코드는 처음 DIFF_REPORT_LINES개까지 C에만 있으면 '<', Java에만
+ * 있으면 '>'를 붙여 작성하고, 끝에 양쪽의 개수를 작성한다.
+ */
+int diff_compare(const output_buffer *c, const output_buffer *java,
+				 const char *title, output_buffer *report) {
+	size_t i = 0, k = 0;
+	int only[2] = {0, 0}, err = 0;
+	
+	while(err>=0 && (i < c->length || k < java->length)){
+		const char *a = c->data + i, *b = java->data + k;
+		size_t la = i < c->length ? (size_t)((char*)memchr(a, '\n', c->length - i) - a) : 0;
+		size_t lb = k < java->length ? (size_t)((char*)memchr(b, '\n', java->length - k) - b) : 0;
+		int cmp;
+		
+		if(i >= c->length)cmp = 1;
+		else if(k >= java->length)cmp = -1;
+		else {
+			cmp = memcmp(a, b, la < lb ? la : lb);
+			if(cmp==0)cmp = la < lb ? -1 : la > lb;
+		}
+		if(cmp==0){
+			i += la + 1;
+			k += lb + 1;
+			continue;
+		}
+		
+		if(only[0] + only[1]==0)err = output_buffer_printf(report, "  %s\n", title);
+		if(err>=0 && only[0] + only[1] < DIFF_REPORT_LINES){
+			if(cmp < 0)err = output_buffer_printf(report, "    < %.*s\n", (int)la, a);
+			else err = output_buffer_printf(report, "    > %.*s\n", (int)lb, b);
+		}
+		if(cmp < 0){
+			only[0]++;
+			i += la + 1;
+		}
+		else {
+			only[1]++;
+			k += lb + 1;
+		}
+	}
+	
+	if(err>=0 && only[0] + only[1] > 0){
+		err = output_buffer_printf(report, "    (C에만 %d개, Java에만 %d개)\n",
+								   only[0], only[1]);
+	}
+	return err < 0 ? err : only[0] + only[1];
+}
@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# @file run_tests.sh
+# @brief 어셈블러의 회귀 테스트
+#
+# @details
+# 사용법: tests/run_tests.sh [어셈블러 실행 파일]
+#
+# 실행 파일을 주지 않으면 my_assembler_20211448.c를 임시 디렉터리에 컴파일한다.
+# 경우마다 임시 디렉터리에 input.txt를 만들고 inst_table.txt를 복사한 뒤
+# 어셈블러를 실행하여 종료 코드와 출력을 확인한다. 하나라도 실패하면 1로 끝난다.
+
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR=$(dirname "$TESTS_DIR")
+WORK=$(mktemp -d /tmp/sicxe_test_XXXXXX) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+if [ -n "$1" ]; then
+	ASM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+else
+	ASM=$WORK/my_assembler
+	${CC:-cc} -O2 -o "$ASM" "$SRC_DIR/my_assembler_20211448.c" -lpthread || exit 1
+fi
+
+passed=0
+failed=0
+
+# 새 경우의 작업 디렉터리를 만들고 그곳으로 이동한다.
+# $1: 경우 이름
+begin() {
+	CASE=$1
+	CASE_DIR=$WORK/$CASE
+	mkdir -p "$CASE_DIR"
+	cp "$SRC_DIR/inst_table.txt" "$CASE_DIR/"
+	cd "$CASE_DIR" || exit 1
+}
+
+# 어셈블러를 실행하고 종료 코드를 RC에 남긴다. 인자는 어셈블러의 옵션이다.
+run() {
+	"$ASM" "$@" >stdout.txt 2>stderr.txt
+	RC=$?
+}
+
+# 조건의 결과를 기록한다.
+# $1: 설명, 나머지: 확인할 명령
+check() {
+	what=$1
+	shift
+	if "$@"; then
+		passed=$((passed + 1))
+	else
+		failed=$((failed + 1))
+		echo "FAIL: $CASE: $what" >&2
+		head -n 5 stderr.txt | sed 's/^/    /' >&2
+	fi
+}
+
+# 파일에 문자열이 있는지 확인한다.
+# $1: 파일, $2: 찾을 문자열
+contains() {
+	grep -qF -- "$2" "$1"
+}
+
+# 테스트 경우들은 아래 파일들에 있다.
+for t in "$TESTS_DIR"/test_*.sh; do
+	. "$t"
+done
+
+echo "passed: $passed, failed: $failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,88 @@
+/**
+ * @file test_api.c
+ * @brief 어셈블러를 라이브러리로 사용할 때의 회귀 테스트
+ *
+ * @details
+ * 어셈블러 소스를 그대로 포함하여 공유 상태(이름 풀, INCLUDE 캐시)까지
+ * 확인한다. 작업 디렉터리에 inst_table.txt가 있어야 한다. 실패한 확인마다
+ * stderr로 출력하고, 하나라도 실패하면 1로 끝난다.
+ */
+
+#define main assembler_main
+#include "../my_assembler_20211448.c"
+#undef main
+
+static int failed = 0;
+
+/**
+ * @brief 조건이 거짓이면 실패로 기록한다.
+ *
+ * @param cond 확인할 조건
+ * @param what 조건의 설명
+ */
+static void check(int cond, const char *what) {
+	if(!cond){
+		fprintf(stderr, "FAIL: %s\n", what);
+		failed++;
+	}
+}
+
+/**
+ * @brief label 이름이 `prefix`로 시작하는 작은 프로그램을 어셈블한다.
+ *
+ * @param ctx 기계어 목록을 읽은 어셈블러 컨텍스트 주소
+ * @param prefix label 이름의 앞부분
+ * @return 오류 코드 (정상 종료 = 0)
+ */
+static int assemble_named(assembler_ctx *ctx, const char *prefix) {
+	char source[256];
+	int length = snprintf(source, sizeof(source),
+						  "%sP\tSTART\t0\n%sA\tLDA\t%sB\n%sB\tWORD\t1\n\tEND\t%sP\n",
+						  prefix, prefix, prefix, prefix, prefix);
+	return assembler_assemble(ctx, source, length);
+}
+
+int main(void) {
+	char prefix[16];
+
+	// 컨텍스트를 만들고 해제하기를 반복해도 이름 풀이 늘어나지 않음
+	for(int round=0;round<200;round++){
+		assembler_ctx *ctx = assembler_create();
+		check(ctx!=NULL, "assembler_create");
+		if(ctx==NULL)return 1;
+		check(assembler_load_inst_table(ctx, "inst_table.txt")==0,
+			  "assembler_load_inst_table");
+		snprintf(prefix, sizeof(prefix), "R%d", round);
+		check(assemble_named(ctx, prefix)==0, "assembler_assemble");
+		assembler_destroy(ctx);
+		check(name_count()==1, "마지막 컨텍스트를 해제하면 이름 풀이 빔");
+	}
+	check(shared_include_cache.files==NULL,
+		  "마지막 컨텍스트를 해제하면 INCLUDE 캐시가 빔");
+
+	// 다른 컨텍스트가 남아 있으면 그 컨텍스트의 이름은 유지됨
+	assembler_ctx *first = assembler_create();
+	assembler_ctx *second = assembler_create();
+	check(first!=NULL && second!=NULL, "assembler_create 두 개");
+	if(first==NULL || second==NULL)return 1;
+	check(assembler_load_inst_table(first, "inst_table.txt")==0 &&
+		  assembler_load_inst_table(second, "inst_table.txt")==0,
+		  "assembler_load_inst_table 두 개");
+	check(assemble_named(second, "KEEP")==0, "두 번째 컨텍스트 어셈블");
+	check(assembler_shared_clear(first)==0,
+		  "다른 컨텍스트가 있으면 assembler_shared_clear가 비우지 않음");
+	assembler_destroy(first);
+	check(second->symbol_table_length > 0 &&
+		  !strcmp(name_str(second->symbol_table[0]->name), "KEEPP"),
+		  "남은 컨텍스트의 심볼 이름이 유지됨");
+
+	// 혼자 남은 컨텍스트는 감시 모드처럼 공유 상태를 비우고 다시 어셈블할 수 있음
+	check(assembler_shared_clear(second)==1,
+		  "혼자 남은 컨텍스트는 assembler_shared_clear로 비움");
+	check(name_count()==1, "assembler_shared_clear 뒤 이름 풀이 빔");
+	check(assemble_named(second, "AGAIN")==0, "비운 뒤 다시 어셈블");
+	assembler_destroy(second);
+	check(name_count()==1, "모든 컨텍스트를 해제하면 이름 풀이 빔");
+
+	return failed > 0;
+}
@@ -0,0 +1,10 @@
+# 어셈블러를 라이브러리로 사용할 때의 공유 상태 (tests/test_api.c)
+
+begin api
+if ${CC:-cc} -g -o test_api "$TESTS_DIR/test_api.c" -lpthread 2>stderr.txt; then
+	./test_api >stdout.txt 2>stderr.txt
+	RC=$?
+else
+	RC=-1
+fi
+check "test_api.c" [ "$RC" -eq 0 ]
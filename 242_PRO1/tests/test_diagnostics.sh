@@ -0,0 +1,21 @@
+# 위치가 있는 오류 메시지
+
+# 같은 control section에서 다시 정의한 label은 두 번째 정의의 위치로 기록하고 실패
+for mode in plain --stream; do
+	begin "duplicate_symbol$mode"
+	printf 'MAIN\tSTART\t0\nL1\tLDA\t#1\nL1\tLDA\t#2\n\tJ\tL1\nS\tCSECT\nL1\tRSUB\n\tEND\tMAIN\n' >input.txt
+	if [ "$mode" = plain ]; then run; else run "$mode"; fi
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "중복 심볼 오류" contains stderr.txt "input.txt:3:1: 오류: 심볼 'L1'이(가) 이미 정의되어 있습니다."
+	check "다른 control section의 같은 이름은 허용" [ "$(grep -c 'L1' stderr.txt)" -eq 1 ]
+	check "오브젝트 코드를 쓰지 않음" [ ! -e output_objectcode.txt ]
+done
+
+# 길이 제한에서 잘린 메시지도 올바른 UTF-8 (잘리는 위치가 한글의 중간이 되는 길이들)
+for n in 103 104 105 106; do
+	begin "long_message_utf8_$n"
+	printf 'MAIN\tSTART\t0\n\tLDA\t%s\n\tEND\tMAIN\n' "$(printf "%${n}s" '' | tr ' ' A)" >input.txt
+	run
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "올바른 UTF-8" sh -c "iconv -f UTF-8 -t UTF-8 stderr.txt >/dev/null"
+done
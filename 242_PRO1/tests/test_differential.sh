@@ -0,0 +1,17 @@
+# C 구현과 Java 구현의 차이 테스트 드라이버 (tests/differential.c)
+
+# Java 대신 오류만 출력하는 스크립트를 사용하면 모든 프로그램이 Java의 실패로 남음
+begin differential_keep_failed
+printf '#!/bin/sh\necho "Error : stand-in"\n' >java
+chmod +x java
+if ${CC:-cc} -g -o differential "$TESTS_DIR/differential.c" -lpthread 2>stderr.txt; then
+	PATH=$CASE_DIR:$PATH ./differential --differential . 2 100 >stdout.txt 2>stderr.txt
+	RC=$?
+else
+	RC=-1
+fi
+check "종료 코드 1" [ "$RC" -eq 1 ]
+check "Java 실패" contains stdout.txt "Java 실패"
+kept=$(sed -n 's/^작업 디렉터리: //p' stdout.txt)
+check "실패한 프로그램의 디렉터리를 남김" [ -f "$kept/p002/java/log.txt" ]
+case $kept in /tmp/sicxe_diff_*) rm -rf "$kept" ;; esac
@@ -0,0 +1,16 @@
+# EQU 값의 계산
+
+# 같은 label을 두 번 정의해도 EQU 계산이 끝남 (끝나지 않으면 timeout이 124로 끝냄)
+for body in 'M\tWORD\t1\nM\tEQU\t5' 'M\tEQU\tA\nM\tEQU\tA'; do
+	for mode in plain --stream; do
+		begin "equ_duplicate_label_$mode"
+		printf "PROG\tSTART\t0\nA\tRESW\t1\n$body\n\tEND\tPROG\n" >input.txt
+		if [ "$mode" = plain ]; then
+			timeout 10 "$ASM" >stdout.txt 2>stderr.txt
+		else
+			timeout 10 "$ASM" "$mode" >stdout.txt 2>stderr.txt
+		fi
+		RC=$?
+		check "EQU 계산이 끝남 ($body)" [ "$RC" -ne 124 ]
+	done
+done
@@ -0,0 +1,34 @@
+# 소스코드 라인 테이블 (라인 수 제한 없음, 라인 길이는 MAX_LINE_LENGTH - 1자)
+
+# 예전 제한인 5000줄을 넘는 소스코드
+for mode in plain --snapshot --listing; do
+	begin "source_over_5000_lines$mode"
+	awk 'BEGIN {
+		print "BIG\tSTART\t0"
+		for(i = 0; i < 8000; i++)print "\tRESB\t1"
+		print "\tEND\tBIG"
+	}' >input.txt
+	if [ "$mode" = plain ]; then run; else run "$mode"; fi
+	check "종료 코드 0" [ "$RC" -eq 0 ]
+	check "프로그램 길이" contains output_objectcode.txt "$(printf 'HBIG\t000000001F40')"
+done
+
+begin source_line_too_long
+awk 'BEGIN {
+	print "BIG\tSTART\t0"
+	printf "\tBYTE\tC\047"
+	for(i = 0; i < 1100; i++)printf "A"
+	print "\047"
+	print "\tEND\tBIG"
+}' >input.txt
+run
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "긴 라인 오류" contains stderr.txt "input.txt:2:1024: 오류: 라인이 1023자를 넘습니다."
+
+# 5000줄을 넘는 INCLUDE 파일
+begin include_over_5000_lines
+awk 'BEGIN { for(i = 0; i < 8000; i++)print "\tRESB\t1" }' >inc.txt
+printf 'BIG\tSTART\t0\n\tINCLUDE\tinc.txt\n\tEND\tBIG\n' >input.txt
+run
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "프로그램 길이" contains output_objectcode.txt "$(printf 'HBIG\t000000001F40')"
@@ -0,0 +1,12 @@
+# 리터럴 pool의 공유
+
+# 이전 pool의 같은 리터럴은 닿는 라인에서만 공유하고, 닿지 않으면 다음 pool에 새로 배치
+begin literal_share_reachable
+printf "MAIN\tSTART\t0\n\tLDA\t=C'EOF'\n\tLTORG\n\tLDA\t=C'EOF'\nBUF\tRESB\t3000\n\tLDA\t=C'EOF'\n\tLDA\t=X'454F46'\n\tEND\tMAIN\n" >input.txt
+run --xref
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "닿는 라인은 이전 pool을 공유" contains output_objectcode.txt "T00000009032000454F46032FFA"
+check "닿지 않는 라인은 새 pool을 사용" contains output_objectcode.txt "T000BC109032003032000454F46"
+check "새 pool의 리터럴" contains output_littab.txt "$(printf "=C'EOF'\t\tBC7")"
+check "같은 값의 리터럴은 새 pool에서 공유" contains output_littab.txt "$(printf "=X'454F46'\t\tBC7\t(=C'EOF'+0)")"
+check "새 pool의 정의" contains output_xref.txt "$(printf "=C'EOF'\tdef\tMAIN\tinput.txt:8\t000BC7\tEND")"
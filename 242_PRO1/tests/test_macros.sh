@@ -0,0 +1,16 @@
+# 매크로 확장
+
+# 호출 라인의 label을 붙일 첫 문장에 이미 label이 있으면 두 label의 위치를 알림
+begin macro_label_clash
+printf 'MAIN\tSTART\t0\nRD\tMACRO\t&A\n.\tcomment\n$LP\tLDA\t&A\n\tJEQ\t$LP\n\tMEND\nCALL\tRD\tBUF\nBUF\tRESB\t3\n\tEND\tMAIN\n' >input.txt
+run
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "호출 label과 본문 label" contains stderr.txt "input.txt:7:1: 오류: label 'CALL'을(를) 붙일 매크로 'RD'의 첫 문장(4번째 줄 1열)에 이미 label '\$AALP'이(가) 있습니다."
+
+# 본문의 label이 다른 매크로의 호출에 붙은 경우는 안쪽 매크로의 본문 라인
+begin macro_label_clash_nested
+printf 'IN\tMACRO\n$X\tLDA\tBUF\n\tMEND\n' >macros.txt
+printf 'MAIN\tSTART\t0\n\tINCLUDE\tmacros.txt\nOUT\tMACRO\nL1\tIN\n\tMEND\n\tOUT\nBUF\tRESB\t3\n\tEND\tMAIN\n' >input.txt
+run
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "안쪽 매크로의 본문 label" contains stderr.txt "input.txt:6:2: 오류: label 'L1'을(를) 붙일 매크로 'IN'의 첫 문장(macros.txt의 2번째 줄 1열)에 이미 label '\$ABX'이(가) 있습니다."
@@ -0,0 +1,60 @@
+# control section 이름과 EXTDEF, EXTREF 이름의 길이 (MAX_EXTERNAL_NAME = 6)
+
+# 이름 $1, $2를 외부 이름으로, $2를 두 번째 control section 이름으로 쓰는 프로그램
+names_input() {
+	printf 'MAIN\tSTART\t0\n\tEXTDEF\t%s,AB\n\tEXTREF\t%s,Q\n%s\tLDA\t#1\nAB\t+JSUB\t%s\n\tWORD\tQ\n%s\tCSECT\n\tEXTDEF\tQ\nQ\tRSUB\n\tEND\tMAIN\n' \
+		"$1" "$2" "$1" "$2" "$2" >input.txt
+}
+
+# 6자 이름과 짧은 이름은 역어셈블하면 그대로 돌아옴
+begin names_round_trip
+names_input SYMBOL CSECT6
+run
+check "종료 코드 0" [ "$RC" -eq 0 ]
+run --disasm
+check "역어셈블 종료 코드 0" [ "$RC" -eq 0 ]
+check "D 레코드의 이름" contains output_disasm.txt "; EXTDEF SYMBOL=000000 AB=000003"
+check "R 레코드의 이름" contains output_disasm.txt "; EXTREF CSECT6 Q"
+check "H 레코드의 이름" contains output_disasm.txt "; section CSECT6 start=000000"
+
+# 6자를 넘는 이름은 D, R 레코드의 고정 폭을 깨므로 오류
+for mode in plain --stream --snapshot; do
+	begin "names_too_long$mode"
+	names_input SYMBOLNAME0 CSYMBOLNAME01
+	if [ "$mode" = plain ]; then run; else run "$mode"; fi
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "EXTDEF 오류" contains stderr.txt "input.txt:2:9: 오류: EXTDEF의 이름 'SYMBOLNAME0'은(는) 6자를 넘을 수 없습니다."
+	check "EXTREF 오류" contains stderr.txt "input.txt:3:9: 오류: EXTREF의 이름 'CSYMBOLNAME01'은(는) 6자를 넘을 수 없습니다."
+	check "CSECT 오류" contains stderr.txt "input.txt:7:1: 오류: control section 이름 'CSYMBOLNAME01'은(는) 6자를 넘을 수 없습니다."
+	check "오브젝트 코드를 쓰지 않음" [ ! -e output_objectcode.txt ]
+done
+
+# 숫자로 끝나는 짧은 이름도 D 레코드에서 6자리로 맞추므로 역어셈블하면 그대로 돌아옴
+begin names_def_fixed_width
+{
+	printf 'MAIN\tSTART\t0\n'
+	for k in 0 1 2 3; do
+		printf '\tEXTDEF\tS%04d' $((k * 10))
+		for j in 1 2 3 4 5 6 7 8 9; do printf ',S%04d' $((k * 10 + j)); done
+		printf '\n'
+	done
+	printf '\tEXTDEF\tA0\nA0\tRESB\t163\n'
+	k=0
+	while [ $k -lt 40 ]; do
+		printf 'S%04d\tWORD\t%d\n' $k $k
+		k=$((k + 1))
+	done
+	printf '\tEND\tMAIN\n'
+} >input.txt
+run
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "이름을 6자리로 맞춤" contains output_objectcode.txt "DS0000 0000A3S0001 0000A6"
+run --disasm
+check "역어셈블 종료 코드 0" [ "$RC" -eq 0 ]
+check "짧은 이름" contains output_disasm.txt "; EXTDEF A0=000000"
+k=0
+while [ $k -lt 40 ]; do
+	addr=$(printf '%06X' $((163 + k * 3)))
+	check "S$k의 주소" contains output_disasm.txt " S$(printf '%04d' $k)=$addr"
+	k=$((k + 1))
+done
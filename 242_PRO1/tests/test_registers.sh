@@ -0,0 +1,27 @@
+# 2형식 명령어의 레지스터와 수 operand
+
+# 올바른 operand는 레지스터 번호와 수로 기록되고 역어셈블하면 그대로 돌아옴
+begin format2_valid
+printf 'MAIN\tSTART\t0\n\tCLEAR\tA\n\tCOMPR\tA,S\n\tTIXR\tT\n\tRMO\tSW,PC\n\tSHIFTL\tS,4\n\tSVC\t3\n\tEND\tMAIN\n' >input.txt
+run
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "2형식 오브젝트 코드" contains output_objectcode.txt "B400A004B850AC98A443B030"
+run --disasm
+check "역어셈블 종료 코드 0" [ "$RC" -eq 0 ]
+check "SHIFTL의 수 operand" contains output_disasm.txt "$(printf 'A443\tSHIFTL\tS,4')"
+check "SVC의 수 operand" contains output_disasm.txt "$(printf 'B030\tSVC\t3')"
+
+# 알 수 없는 레지스터와 잘못된 operand 개수는 그 operand의 열로 오류
+for mode in plain --stream --snapshot; do
+	begin "format2_invalid$mode"
+	printf 'MAIN\tSTART\t0\n\tCLEAR\tQ\n\tCOMPR\tA,ZZ\n\tADDR\tSW,PQ\n\tSHIFTL\tS,17\n\tSVC\tA\n\tRMO\tA\n\tEND\tMAIN\n' >input.txt
+	if [ "$mode" = plain ]; then run; else run "$mode"; fi
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "CLEAR 오류" contains stderr.txt "input.txt:2:8: 오류: 알 수 없는 레지스터 'Q'입니다."
+	check "COMPR 오류" contains stderr.txt "input.txt:3:10: 오류: 알 수 없는 레지스터 'ZZ'입니다."
+	check "ADDR 오류" contains stderr.txt "input.txt:4:10: 오류: 알 수 없는 레지스터 'PQ'입니다."
+	check "SHIFTL 오류" contains stderr.txt "input.txt:5:11: 오류: SHIFTL의 operand '17'은(는) 1~16의 수여야 합니다."
+	check "SVC 오류" contains stderr.txt "input.txt:6:6: 오류: SVC의 operand 'A'은(는) 0~15의 수여야 합니다."
+	check "operand 개수 오류" contains stderr.txt "input.txt:7:6: 오류: RMO에는 operand가 2개 필요합니다."
+	check "오브젝트 코드를 쓰지 않음" [ ! -e output_objectcode.txt ]
+done
@@ -0,0 +1,40 @@
+# 손상된 pass 1 스냅샷은 pass 2 전에 거부
+
+# 스냅샷 헤더(48바이트)의 uint32 필드를 읽는다.
+# $1: 필드의 바이트 위치
+snapshot_field() {
+	od -An -tu4 -j"$1" -N4 output_pass1.bin | tr -d ' '
+}
+
+# 토큰 필드별 배열 안에 바이트 하나를 쓴다.
+# $1: 이름 목록 뒤 배열의 시작 위치 (토큰 수의 배수), $2: 배열 안의 바이트 위치,
+# $3: 8진수 바이트
+snapshot_poke() {
+	names_bytes=$(snapshot_field 28)
+	tokens=$(snapshot_field 32)
+	offset=$((48 + names_bytes + tokens * $1 + $2))
+	printf "\\$3" | dd of=output_pass1.bin bs=1 seek="$offset" conv=notrunc 2>/dev/null
+}
+
+snapshot_input() {
+	printf 'MAIN\tSTART\t0\n\tLDA\t#3\n\tCLEAR\tA\n\tEND\tMAIN\n' >input.txt
+}
+
+# nixbpe는 토큰마다 1바이트로 토큰 수 * 32 위치부터, operand 수는 토큰마다
+# 2바이트로 토큰 수 * 30 위치부터 있음 (라인 0: START, 1: LDA, 2: CLEAR)
+for case in "nixbpe_negative 32 1 377 2번째 토큰의 nixbpe(-1)가 LDA에 맞지 않습니다." \
+			"nixbpe_format2 32 2 60 3번째 토큰의 nixbpe(48)가 CLEAR에 맞지 않습니다." \
+			"operands_count 30 4 2 3번째 토큰: CLEAR에는 operand가 1개 필요합니다."; do
+	set -- $case
+	begin "snapshot_$1"
+	snapshot_input
+	run --snapshot
+	check "스냅샷 종료 코드 0" [ "$RC" -eq 0 ]
+	snapshot_poke "$2" "$3" "$4"
+	rm -f output_objectcode.txt
+	run --from-snapshot
+	shift 4
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "거부한 이유" contains stderr.txt "output_pass1.bin: 오류: 스냅샷 파일이 올바르지 않습니다: $*"
+	check "오브젝트 코드를 쓰지 않음" [ ! -e output_objectcode.txt ]
+done
@@ -0,0 +1,86 @@
+# 심볼 테이블과 리터럴 테이블의 길이 제한 (MAX_TABLE_LENGTH = 5000)
+
+# label이 붙은 라인 $1개로 된 프로그램을 input.txt로 만든다.
+labels_input() {
+	awk -v n="$1" 'BEGIN {
+		print "BIG\tSTART\t0"
+		for(i = 0; i < n; i++)printf "L%05d\tRESW\t1\n", i
+		print "\tEND\tBIG"
+	}' >input.txt
+}
+
+# 서로 다른 리터럴 $1개를 사용하는 프로그램을 input.txt로 만든다.
+literals_input() {
+	awk -v n="$1" 'BEGIN {
+		print "BIG\tSTART\t0"
+		for(i = 0; i < n; i++){
+			printf "\tLDA\t=X\047%06X\047\n", i
+			if(i % 500 == 499)print "\tLTORG"
+		}
+		print "\tEND\tBIG"
+	}' >input.txt
+}
+
+begin stream_symbols_over_limit
+labels_input 6000
+run --stream
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "심볼 테이블 오류" contains stderr.txt "input.txt:5001:1: 오류: 심볼 테이블이 가득 찼습니다."
+
+begin stream_symbols_at_limit
+labels_input 4999
+run --stream
+check "종료 코드 0" [ "$RC" -eq 0 ]
+
+begin stream_literals_over_limit
+literals_input 5100
+run --stream
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "리터럴 테이블 오류" contains stderr.txt "리터럴 테이블이 가득 찼습니다."
+
+# label이 붙은 라인 $2개로 된 INCLUDE 파일 $1을 만든다.
+labels_include() {
+	awk -v n="$2" -v p="$3" 'BEGIN {
+		for(i = 0; i < n; i++)printf "%s%05d\tRESW\t1\n", p, i
+	}' >"$1"
+}
+
+# 각각 3000개의 label이 있는 두 파일을 INCLUDE하는 프로그램
+for mode in plain --stream --snapshot; do
+	begin "include_symbols_over_limit$mode"
+	labels_include inc_a.txt 3000 A
+	labels_include inc_b.txt 3000 B
+	printf 'BIG\tSTART\t0\n\tINCLUDE\tinc_a.txt\n\tINCLUDE\tinc_b.txt\n\tEND\tBIG\n' >input.txt
+	if [ "$mode" = plain ]; then run; else run "$mode"; fi
+	check "종료 코드 255" [ "$RC" -eq 255 ]
+	check "심볼 테이블 오류" contains stderr.txt "inc_b.txt:2000:1: 오류: 심볼 테이블이 가득 찼습니다."
+done
+check "스냅샷을 쓰지 않음" [ ! -e output_pass1.bin ]
+run --from-snapshot
+check "스냅샷 없이 실패" [ "$RC" -ne 0 ]
+
+begin include_symbols_at_limit
+labels_include inc_a.txt 3000 A
+labels_include inc_b.txt 1999 B
+printf 'BIG\tSTART\t0\n\tINCLUDE\tinc_a.txt\n\tINCLUDE\tinc_b.txt\n\tEND\tBIG\n' >input.txt
+run --snapshot
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "심볼 5000개" [ "$(wc -l <output_symtab.txt)" -ge 5000 ]
+run --from-snapshot
+check "스냅샷에서 종료 코드 0" [ "$RC" -eq 0 ]
+
+# 10단계로 중첩된 호출이 10^7줄로 늘어나는 매크로
+begin macro_expansion_over_limit
+awk 'BEGIN {
+	print "BIG\tSTART\t0"
+	print "M0\tMACRO\n\tWORD\t1\n\tMEND"
+	for(k = 1; k < 8; k++){
+		printf "M%d\tMACRO\n", k
+		for(j = 0; j < 10; j++)printf "\tM%d\n", k - 1
+		print "\tMEND"
+	}
+	print "\tM7\n\tEND\tBIG"
+}' >input.txt
+run
+check "종료 코드 255" [ "$RC" -eq 255 ]
+check "확장 라인 오류" contains stderr.txt "input.txt:89:1: 오류: 매크로와 INCLUDE를 확장한 라인이 너무 많습니다."
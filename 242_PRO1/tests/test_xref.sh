@@ -0,0 +1,12 @@
+# 상호 참조 파일 (--xref)
+
+# EQU 정의의 주소 열은 정의된 위치가 아니라 심볼의 값
+begin xref_equ_value
+printf 'MAIN\tSTART\t0\n\t+LDT\t#MAXLEN\nBUFFER\tRESB\t4096\nBUFEND\tEQU\t*\nMAXLEN\tEQU\tBUFEND-BUFFER\nHALF\tEQU\t8\n\tEND\tMAIN\n' >input.txt
+run --xref
+check "종료 코드 0" [ "$RC" -eq 0 ]
+check "절대 EQU 수식의 값" contains output_xref.txt "$(printf 'MAXLEN\tdef\tMAIN\tinput.txt:5\t001000\tEQU')"
+check "절대 EQU 상수의 값" contains output_xref.txt "$(printf 'HALF\tdef\tMAIN\tinput.txt:6\t000008\tEQU')"
+check "상대 EQU의 값" contains output_xref.txt "$(printf 'BUFEND\tdef\tMAIN\tinput.txt:4\t001004\tEQU')"
+check "EQU가 아닌 정의는 라인의 주소" contains output_xref.txt "$(printf 'BUFFER\tdef\tMAIN\tinput.txt:3\t000004\tRESB')"
+check "사용은 라인의 주소" contains output_xref.txt "$(printf 'MAXLEN\tuse\tMAIN\tinput.txt:2\t000000\t+LDT\t+immediate')"